@@ -0,0 +1,96 @@
+// Copyright 2022 Peter Leontev. All Rights Reserved.
+
+#include "AtlasHelpers.h"
+
+
+namespace FAtlasHelpers
+{
+    int32 AlignUp(int32 Value, int32 Alignment)
+    {
+        return (Value + Alignment - 1) / Alignment * Alignment;
+    }
+
+    /** Returns height of the atlas, rects wider than AtlasWidth must be filtered out beforehand */
+    int32 PackShelves(const TArray<FIntPoint>& Sizes, const TArray<int32>& SortedIndices, int32 AtlasWidth, int32 Padding, int32 Alignment, TArray<FIntPoint>& OutPositions)
+    {
+        int32 ShelfX = 0;
+        int32 ShelfY = 0;
+        int32 ShelfHeight = 0;
+
+        for (int32 Index : SortedIndices)
+        {
+            const FIntPoint& Size = Sizes[Index];
+
+            if (ShelfX > 0 && ShelfX + Size.X > AtlasWidth)
+            {
+                ShelfX = 0;
+                ShelfY = AlignUp(ShelfY + ShelfHeight + Padding, Alignment);
+                ShelfHeight = 0;
+            }
+
+            OutPositions[Index] = FIntPoint(ShelfX, ShelfY);
+
+            ShelfX = AlignUp(ShelfX + Size.X + Padding, Alignment);
+            ShelfHeight = FMath::Max(ShelfHeight, Size.Y);
+        }
+
+        return AlignUp(ShelfY + ShelfHeight, Alignment);
+    }
+
+    bool PackRects(const TArray<FIntPoint>& Sizes, int32 MaxAtlasSize, int32 Padding, int32 Alignment, FIntPoint& OutAtlasSize, TArray<FIntPoint>& OutPositions)
+    {
+        Alignment = FMath::Max(1, Alignment);
+
+        TArray<int32> SortedIndices;
+        int64 TotalArea = 0;
+        int32 MaxWidth = 0;
+
+        for (int32 Index = 0; Index < Sizes.Num(); ++Index)
+        {
+            const FIntPoint& Size = Sizes[Index];
+            if (Size.X <= 0 || Size.Y <= 0)
+            {
+                continue;
+            }
+
+            if (Size.X > MaxAtlasSize || Size.Y > MaxAtlasSize)
+            {
+                return false;
+            }
+
+            SortedIndices.Add(Index);
+            TotalArea += (int64)AlignUp(Size.X + Padding, Alignment) * AlignUp(Size.Y + Padding, Alignment);
+            MaxWidth = FMath::Max(MaxWidth, Size.X);
+        }
+
+        if (SortedIndices.Num() == 0)
+        {
+            return false;
+        }
+
+        SortedIndices.StableSort([&Sizes](int32 A, int32 B) { return Sizes[A].Y > Sizes[B].Y; });
+
+        OutPositions.Init(FIntPoint::ZeroValue, Sizes.Num());
+
+        // widen the atlas until everything fits, wider shelves waste less space on the last row
+        const int32 MinWidth = FMath::Max(MaxWidth, (int32)FMath::CeilToInt(FMath::Sqrt((double)TotalArea)));
+        int32 AtlasWidth = FMath::Min((int32)FMath::RoundUpToPowerOfTwo(MinWidth), MaxAtlasSize);
+
+        while (true)
+        {
+            const int32 AtlasHeight = PackShelves(Sizes, SortedIndices, AtlasWidth, Padding, Alignment, OutPositions);
+            if (AtlasHeight <= MaxAtlasSize)
+            {
+                OutAtlasSize = FIntPoint(AlignUp(AtlasWidth, Alignment), AtlasHeight);
+                return OutAtlasSize.X <= MaxAtlasSize;
+            }
+
+            if (AtlasWidth >= MaxAtlasSize)
+            {
+                return false;
+            }
+
+            AtlasWidth = FMath::Min(AtlasWidth * 2, MaxAtlasSize);
+        }
+    }
+}
@@ -0,0 +1,15 @@
+// Copyright 2022 Peter Leontev. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+
+namespace FAtlasHelpers
+{
+    /**
+     * Shelf packs rects into an atlas no larger than MaxAtlasSize on each side, tallest rects go first.
+     * Positions are aligned to Alignment pixels, zero sized rects are skipped. Returns false if rects do not fit
+     */
+    bool PackRects(const TArray<FIntPoint>& Sizes, int32 MaxAtlasSize, int32 Padding, int32 Alignment, FIntPoint& OutAtlasSize, TArray<FIntPoint>& OutPositions);
+}
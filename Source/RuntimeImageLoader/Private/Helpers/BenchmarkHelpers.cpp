@@ -0,0 +1,350 @@
+// Copyright 2022 Peter Leontev. All Rights Reserved.
+
+#include "BenchmarkHelpers.h"
+#include "Modules/ModuleManager.h"
+#include "IImageWrapperModule.h"
+#include "IImageWrapper.h"
+#include "Math/Float16.h"
+#include "Async/ParallelFor.h"
+#include "TGAHelpers.h"
+#include "TIFFLoader.h"
+
+PRAGMA_DISABLE_DEPRECATION_WARNINGS
+#include "qoi.h"
+PRAGMA_ENABLE_DEPRECATION_WARNINGS
+
+
+namespace FBenchmarkHelpers
+{
+    static const int32 TileShift = 6;
+    static const int32 JPEGQuality = 90;
+
+    uint32 HashPixel(uint32 X, uint32 Y, uint32 Channel)
+    {
+        uint32 Hash = (X * 73856093u) ^ (Y * 19349663u) ^ (Channel * 83492791u);
+        Hash = (Hash ^ (Hash >> 13)) * 0x5bd1e995u;
+        return Hash ^ (Hash >> 15);
+    }
+
+    /** 16 bit RGBA pixel of the test image */
+    void GetPixel(int32 X, int32 Y, int32 Size, uint16 OutPixel[4])
+    {
+        const uint32 TileX = X >> TileShift;
+        const uint32 TileY = Y >> TileShift;
+
+        if ((TileX + TileY) & 1)
+        {
+            const int32 Gradient[3] =
+            {
+                X * 65535 / FMath::Max(1, Size - 1),
+                Y * 65535 / FMath::Max(1, Size - 1),
+                (X + Y) * 65535 / FMath::Max(1, 2 * Size - 2)
+            };
+
+            for (int32 Channel = 0; Channel < 3; ++Channel)
+            {
+                const int32 Noise = (int32)(HashPixel(X, Y, Channel) & 4095) - 2048;
+                OutPixel[Channel] = (uint16)FMath::Clamp(Gradient[Channel] + Noise, 0, 65535);
+            }
+        }
+        else
+        {
+            for (int32 Channel = 0; Channel < 3; ++Channel)
+            {
+                OutPixel[Channel] = (uint16)HashPixel(TileX, TileY, Channel);
+            }
+        }
+
+        OutPixel[3] = 65535;
+    }
+
+    template<typename PixelFunc>
+    void ForEachPixel(int32 Size, PixelFunc&& Func)
+    {
+        ParallelFor(Size, [Size, &Func](int32 Y)
+        {
+            uint16 Pixel[4];
+            for (int32 X = 0; X < Size; ++X)
+            {
+                GetPixel(X, Y, Size, Pixel);
+                Func(X, Y, Pixel);
+            }
+        });
+    }
+
+    void MakeBGRA8(int32 Size, TArray64<uint8>& OutPixels)
+    {
+        OutPixels.SetNumUninitialized((int64)Size * Size * 4);
+        uint8* Pixels = OutPixels.GetData();
+
+        ForEachPixel(Size, [Pixels, Size](int32 X, int32 Y, const uint16 Pixel[4])
+        {
+            uint8* Dst = Pixels + ((int64)Y * Size + X) * 4;
+            Dst[0] = Pixel[2] >> 8;
+            Dst[1] = Pixel[1] >> 8;
+            Dst[2] = Pixel[0] >> 8;
+            Dst[3] = Pixel[3] >> 8;
+        });
+    }
+
+    bool CompressWithImageWrapper(EImageFormat ImageFormat, const void* RawData, int64 RawSize, int32 Size, ERGBFormat RGBFormat, int32 BitDepth, int32 Quality, TArray64<uint8>& OutBuffer)
+    {
+        IImageWrapperModule& ImageWrapperModule = FModuleManager::LoadModuleChecked<IImageWrapperModule>(FName("ImageWrapper"));
+
+        TSharedPtr<IImageWrapper> ImageWrapper = ImageWrapperModule.CreateImageWrapper(ImageFormat);
+        if (!ImageWrapper.IsValid() || !ImageWrapper->SetRaw(RawData, RawSize, Size, Size, RGBFormat, BitDepth))
+        {
+            return false;
+        }
+
+        OutBuffer = ImageWrapper->GetCompressed(Quality);
+        return OutBuffer.Num() > 0;
+    }
+
+    void EncodeBMP(const TArray64<uint8>& BGRA8, int32 Size, TArray64<uint8>& OutBuffer)
+    {
+        const int32 RowPitch = Align(Size * 3, 4);
+        const uint32 HeaderSize = 14 + 40;
+        const uint32 ImageSize = (uint32)RowPitch * Size;
+
+        OutBuffer.Init(0, HeaderSize + ImageSize);
+        uint8* Data = OutBuffer.GetData();
+
+        auto Write16 = [](uint8* Dst, uint16 Value) { Dst[0] = Value & 0xFF; Dst[1] = Value >> 8; };
+        auto Write32 = [](uint8* Dst, uint32 Value) { for (int32 Byte = 0; Byte < 4; ++Byte) { Dst[Byte] = (Value >> (Byte * 8)) & 0xFF; } };
+
+        // BITMAPFILEHEADER
+        Data[0] = 'B';
+        Data[1] = 'M';
+        Write32(Data + 2, HeaderSize + ImageSize);
+        Write32(Data + 10, HeaderSize);
+
+        // BITMAPINFOHEADER, 24 bit bottom-up rows
+        Write32(Data + 14, 40);
+        Write32(Data + 18, Size);
+        Write32(Data + 22, Size);
+        Write16(Data + 26, 1);
+        Write16(Data + 28, 24);
+        Write32(Data + 34, ImageSize);
+
+        for (int32 Y = 0; Y < Size; ++Y)
+        {
+            const uint8* Src = BGRA8.GetData() + (int64)(Size - 1 - Y) * Size * 4;
+            uint8* Dst = Data + HeaderSize + (int64)Y * RowPitch;
+
+            for (int32 X = 0; X < Size; ++X, Src += 4, Dst += 3)
+            {
+                Dst[0] = Src[0];
+                Dst[1] = Src[1];
+                Dst[2] = Src[2];
+            }
+        }
+    }
+
+    void EncodeTGA_RLE(const TArray64<uint8>& BGRA8, int32 Size, TArray64<uint8>& OutBuffer)
+    {
+        FTGAHelpers::FTGAFileHeader Header;
+        FMemory::Memzero(Header);
+        Header.ImageTypeCode = 10;
+        Header.Width = (uint16)Size;
+        Header.Height = (uint16)Size;
+        Header.BitsPerPixel = 32;
+        // 8 alpha bits, top-left origin
+        Header.ImageDescriptor = 0x28;
+
+        OutBuffer.Reset((int64)Size * Size * 4 + sizeof(Header));
+        OutBuffer.Append((const uint8*)&Header, sizeof(Header));
+
+        const uint32* Pixels = (const uint32*)BGRA8.GetData();
+
+        // packets never cross rows
+        for (int32 Y = 0; Y < Size; ++Y)
+        {
+            const uint32* Row = Pixels + (int64)Y * Size;
+
+            int32 X = 0;
+            while (X < Size)
+            {
+                int32 RunLength = 1;
+                while (X + RunLength < Size && RunLength < 128 && Row[X + RunLength] == Row[X])
+                {
+                    ++RunLength;
+                }
+
+                if (RunLength > 1)
+                {
+                    OutBuffer.Add((uint8)(0x80 | (RunLength - 1)));
+                    OutBuffer.Append((const uint8*)&Row[X], 4);
+                    X += RunLength;
+                    continue;
+                }
+
+                int32 RawLength = 1;
+                while (X + RawLength < Size && RawLength < 128 &&
+                    (X + RawLength + 1 >= Size || Row[X + RawLength] != Row[X + RawLength + 1]))
+                {
+                    ++RawLength;
+                }
+
+                OutBuffer.Add((uint8)(RawLength - 1));
+                OutBuffer.Append((const uint8*)&Row[X], RawLength * 4);
+                X += RawLength;
+            }
+        }
+    }
+
+    bool EncodeQOI(const TArray64<uint8>& BGRA8, int32 Size, TArray64<uint8>& OutBuffer)
+    {
+        TArray64<uint8> RGBA8 = BGRA8;
+        for (int64 Offset = 0; Offset < RGBA8.Num(); Offset += 4)
+        {
+            Swap(RGBA8[Offset], RGBA8[Offset + 2]);
+        }
+
+        qoi_desc Desc;
+        Desc.width = Size;
+        Desc.height = Size;
+        Desc.channels = 4;
+        Desc.colorspace = QOI_SRGB;
+
+        int EncodedSize = 0;
+        void* Encoded = qoi_encode(RGBA8.GetData(), &Desc, &EncodedSize);
+        if (Encoded == nullptr)
+        {
+            return false;
+        }
+
+        OutBuffer = TArray64<uint8>((const uint8*)Encoded, EncodedSize);
+        // allocated by qoi with malloc
+        ::free(Encoded);
+
+        return true;
+    }
+
+    const TCHAR* GetEncodingName(ECorpusEncoding Encoding)
+    {
+        switch (Encoding)
+        {
+        case ECorpusEncoding::PNG8: return TEXT("PNG8");
+        case ECorpusEncoding::PNG16: return TEXT("PNG16");
+        case ECorpusEncoding::JPEG: return TEXT("JPEG");
+        case ECorpusEncoding::BMP: return TEXT("BMP");
+        case ECorpusEncoding::TGA_RLE: return TEXT("TGA_RLE");
+        case ECorpusEncoding::EXR: return TEXT("EXR");
+        case ECorpusEncoding::TIFF: return TEXT("TIFF");
+        case ECorpusEncoding::QOI: return TEXT("QOI");
+        }
+        return TEXT("Unknown");
+    }
+
+    const TCHAR* GetEncodingExtension(ECorpusEncoding Encoding)
+    {
+        switch (Encoding)
+        {
+        case ECorpusEncoding::PNG8:
+        case ECorpusEncoding::PNG16: return TEXT("png");
+        case ECorpusEncoding::JPEG: return TEXT("jpg");
+        case ECorpusEncoding::BMP: return TEXT("bmp");
+        case ECorpusEncoding::TGA_RLE: return TEXT("tga");
+        case ECorpusEncoding::EXR: return TEXT("exr");
+        case ECorpusEncoding::TIFF: return TEXT("tiff");
+        case ECorpusEncoding::QOI: return TEXT("qoi");
+        }
+        return TEXT("");
+    }
+
+    bool ParseEncoding(const FString& Name, ECorpusEncoding& OutEncoding)
+    {
+        for (uint8 Encoding = (uint8)ECorpusEncoding::PNG8; Encoding <= (uint8)ECorpusEncoding::QOI; ++Encoding)
+        {
+            if (Name.Equals(GetEncodingName((ECorpusEncoding)Encoding), ESearchCase::IgnoreCase))
+            {
+                OutEncoding = (ECorpusEncoding)Encoding;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool EncodeCorpusImage(ECorpusEncoding Encoding, int32 Size, TArray64<uint8>& OutBuffer, FString& OutError)
+    {
+        bool bEncoded = false;
+
+        if (Encoding == ECorpusEncoding::PNG16 || Encoding == ECorpusEncoding::EXR)
+        {
+            const bool bFloat = Encoding == ECorpusEncoding::EXR;
+
+            TArray64<uint16> RGBA16;
+            RGBA16.SetNumUninitialized((int64)Size * Size * 4);
+            uint16* Pixels = RGBA16.GetData();
+
+            ForEachPixel(Size, [Pixels, Size, bFloat](int32 X, int32 Y, const uint16 Pixel[4])
+            {
+                uint16* Dst = Pixels + ((int64)Y * Size + X) * 4;
+                for (int32 Channel = 0; Channel < 4; ++Channel)
+                {
+                    Dst[Channel] = bFloat ? FFloat16(Pixel[Channel] / 65535.f).Encoded : Pixel[Channel];
+                }
+            });
+
+            bEncoded = bFloat ?
+                CompressWithImageWrapper(EImageFormat::EXR, Pixels, RGBA16.Num() * sizeof(uint16), Size, ERGBFormat::RGBAF, 16, 0, OutBuffer) :
+                CompressWithImageWrapper(EImageFormat::PNG, Pixels, RGBA16.Num() * sizeof(uint16), Size, ERGBFormat::RGBA, 16, 0, OutBuffer);
+        }
+        else
+        {
+            TArray64<uint8> BGRA8;
+            MakeBGRA8(Size, BGRA8);
+
+            switch (Encoding)
+            {
+            case ECorpusEncoding::PNG8:
+                bEncoded = CompressWithImageWrapper(EImageFormat::PNG, BGRA8.GetData(), BGRA8.Num(), Size, ERGBFormat::BGRA, 8, 0, OutBuffer);
+                break;
+            case ECorpusEncoding::JPEG:
+                bEncoded = CompressWithImageWrapper(EImageFormat::JPEG, BGRA8.GetData(), BGRA8.Num(), Size, ERGBFormat::BGRA, 8, JPEGQuality, OutBuffer);
+                break;
+            case ECorpusEncoding::BMP:
+                EncodeBMP(BGRA8, Size, OutBuffer);
+                bEncoded = true;
+                break;
+            case ECorpusEncoding::TGA_RLE:
+                // TGA stores width and height in 16 bits
+                bEncoded = Size <= MAX_uint16;
+                if (bEncoded)
+                {
+                    EncodeTGA_RLE(BGRA8, Size, OutBuffer);
+                }
+                break;
+            case ECorpusEncoding::TIFF:
+#if WITH_FREEIMAGE_LIB
+                bEncoded = FRuntimeTiffLoadHelper::Save(BGRA8.GetData(), Size, Size, OutBuffer);
+#endif // WITH_FREEIMAGE_LIB
+                break;
+            case ECorpusEncoding::QOI:
+                bEncoded = EncodeQOI(BGRA8, Size, OutBuffer);
+                break;
+            default:
+                break;
+            }
+        }
+
+        if (!bEncoded)
+        {
+            OutError = FString::Printf(TEXT("Failed to encode %s image of %d x %d"), GetEncodingName(Encoding), Size, Size);
+        }
+
+        return bEncoded;
+    }
+
+    double GetPercentile(const TArray<double>& SortedValues, double Percentile)
+    {
+        if (SortedValues.Num() == 0)
+        {
+            return 0.0;
+        }
+
+        const int32 Rank = FMath::CeilToInt(Percentile / 100.0 * SortedValues.Num());
+        return SortedValues[FMath::Clamp(Rank - 1, 0, SortedValues.Num() - 1)];
+    }
+}
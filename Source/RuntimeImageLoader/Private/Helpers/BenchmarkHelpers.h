@@ -0,0 +1,37 @@
+// Copyright 2022 Peter Leontev. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include "RuntimeImageData.h"
+
+
+namespace FBenchmarkHelpers
+{
+    /** Encodings of the synthetic corpus, each format is generated at every benchmark size */
+    enum class ECorpusEncoding : uint8
+    {
+        PNG8,
+        PNG16,
+        JPEG,
+        BMP,
+        TGA_RLE,
+        EXR,
+        TIFF,
+        QOI
+    };
+
+    const TCHAR* GetEncodingName(ECorpusEncoding Encoding);
+    const TCHAR* GetEncodingExtension(ECorpusEncoding Encoding);
+    bool ParseEncoding(const FString& Name, ECorpusEncoding& OutEncoding);
+
+    /**
+     * Encodes a deterministic Size x Size test image: tiles of noisy gradients that defeat run length coding
+     * alternate with flat tiles that compress well, so every run of the benchmark decodes the same bytes
+     */
+    bool EncodeCorpusImage(ECorpusEncoding Encoding, int32 Size, TArray64<uint8>& OutBuffer, FString& OutError);
+
+    /** Nearest rank percentile of sorted values, Percentile is in 0..100 */
+    double GetPercentile(const TArray<double>& SortedValues, double Percentile);
+}
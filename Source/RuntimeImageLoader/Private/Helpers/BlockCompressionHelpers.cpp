@@ -0,0 +1,965 @@
+// Copyright 2022 Peter Leontev. All Rights Reserved.
+
+#include "BlockCompressionHelpers.h"
+#include "Async/ParallelFor.h"
+
+#include "MipHelpers.h"
+#include "PixelKernels.h"
+
+
+namespace FBlockCompressionHelpers
+{
+    static constexpr int32 BlockSize = 4;
+    static constexpr int32 NumBlockPixels = BlockSize * BlockSize;
+
+    // pixels of a single block in RGBA order, row by row
+    typedef uint8 FBlockPixels[NumBlockPixels][4];
+
+    static void LoadBlock(const uint8* BGRAData, int32 SizeX, int32 SizeY, int32 BlockX, int32 BlockY, FBlockPixels& OutPixels)
+    {
+        for (int32 Y = 0; Y < BlockSize; ++Y)
+        {
+            // blocks of small mips are partially covered, border pixels are repeated
+            const int32 SrcY = FMath::Min(BlockY * BlockSize + Y, SizeY - 1);
+
+            for (int32 X = 0; X < BlockSize; ++X)
+            {
+                const int32 SrcX = FMath::Min(BlockX * BlockSize + X, SizeX - 1);
+                const uint8* SrcPixel = BGRAData + ((int64)SrcY * SizeX + SrcX) * 4;
+
+                uint8* DstPixel = OutPixels[Y * BlockSize + X];
+                DstPixel[0] = SrcPixel[2];
+                DstPixel[1] = SrcPixel[1];
+                DstPixel[2] = SrcPixel[0];
+                DstPixel[3] = SrcPixel[3];
+            }
+        }
+    }
+
+    /** Finds endpoints of the line that fits block colors best using principal component of their covariance */
+    template<int32 NumChannels>
+    static void ComputeEndpoints(const FBlockPixels& Pixels, float OutMin[4], float OutMax[4])
+    {
+        float Mean[4] = { 0.f, 0.f, 0.f, 0.f };
+        for (int32 PixelIndex = 0; PixelIndex < NumBlockPixels; ++PixelIndex)
+        {
+            for (int32 Channel = 0; Channel < NumChannels; ++Channel)
+            {
+                Mean[Channel] += Pixels[PixelIndex][Channel];
+            }
+        }
+        for (int32 Channel = 0; Channel < NumChannels; ++Channel)
+        {
+            Mean[Channel] /= NumBlockPixels;
+        }
+
+        float Covariance[4][4] = {};
+        for (int32 PixelIndex = 0; PixelIndex < NumBlockPixels; ++PixelIndex)
+        {
+            for (int32 Row = 0; Row < NumChannels; ++Row)
+            {
+                const float RowDelta = Pixels[PixelIndex][Row] - Mean[Row];
+                for (int32 Column = 0; Column < NumChannels; ++Column)
+                {
+                    Covariance[Row][Column] += RowDelta * (Pixels[PixelIndex][Column] - Mean[Column]);
+                }
+            }
+        }
+
+        // power iteration converges to the principal axis in a few steps
+        float Axis[4] = { 1.f, 1.f, 1.f, 1.f };
+        bool bHasAxis = false;
+        for (int32 Iteration = 0; Iteration < 8; ++Iteration)
+        {
+            float NewAxis[4] = { 0.f, 0.f, 0.f, 0.f };
+            float MaxComponent = 0.f;
+            for (int32 Row = 0; Row < NumChannels; ++Row)
+            {
+                for (int32 Column = 0; Column < NumChannels; ++Column)
+                {
+                    NewAxis[Row] += Covariance[Row][Column] * Axis[Column];
+                }
+                MaxComponent = FMath::Max(MaxComponent, FMath::Abs(NewAxis[Row]));
+            }
+
+            if (MaxComponent < KINDA_SMALL_NUMBER)
+            {
+                break;
+            }
+
+            for (int32 Channel = 0; Channel < NumChannels; ++Channel)
+            {
+                Axis[Channel] = NewAxis[Channel] / MaxComponent;
+            }
+            bHasAxis = true;
+        }
+
+        float MinProjection = 0.f;
+        float MaxProjection = 0.f;
+        if (bHasAxis)
+        {
+            float AxisLengthSquared = 0.f;
+            for (int32 Channel = 0; Channel < NumChannels; ++Channel)
+            {
+                AxisLengthSquared += Axis[Channel] * Axis[Channel];
+            }
+            const float InvAxisLength = FMath::InvSqrt(AxisLengthSquared);
+            for (int32 Channel = 0; Channel < NumChannels; ++Channel)
+            {
+                Axis[Channel] *= InvAxisLength;
+            }
+
+            MinProjection = MAX_flt;
+            MaxProjection = -MAX_flt;
+            for (int32 PixelIndex = 0; PixelIndex < NumBlockPixels; ++PixelIndex)
+            {
+                float Projection = 0.f;
+                for (int32 Channel = 0; Channel < NumChannels; ++Channel)
+                {
+                    Projection += (Pixels[PixelIndex][Channel] - Mean[Channel]) * Axis[Channel];
+                }
+                MinProjection = FMath::Min(MinProjection, Projection);
+                MaxProjection = FMath::Max(MaxProjection, Projection);
+            }
+        }
+
+        for (int32 Channel = 0; Channel < NumChannels; ++Channel)
+        {
+            OutMin[Channel] = FMath::Clamp(Mean[Channel] + MinProjection * Axis[Channel], 0.f, 255.f);
+            OutMax[Channel] = FMath::Clamp(Mean[Channel] + MaxProjection * Axis[Channel], 0.f, 255.f);
+        }
+    }
+
+    // channels selector search compares, see FPixelKernels::FindNearestColors
+    static constexpr uint32 RGBChannels = 0x7;
+    static constexpr uint32 AlphaChannel = 0x8;
+    static constexpr uint32 RGBAChannels = RGBChannels | AlphaChannel;
+
+    struct FBitWriter
+    {
+        FBitWriter(uint8* InData) : Data(InData) {}
+
+        void Write(uint32 Value, int32 NumBits)
+        {
+            for (int32 Bit = 0; Bit < NumBits; ++Bit, ++BitOffset)
+            {
+                if ((Value >> Bit) & 1)
+                {
+                    Data[BitOffset >> 3] |= 1 << (BitOffset & 7);
+                }
+            }
+        }
+
+        uint8* Data;
+        int32 BitOffset = 0;
+    };
+
+    static void WriteBigEndian(uint64 Bits, uint8* OutData)
+    {
+        for (int32 ByteIndex = 0; ByteIndex < 8; ++ByteIndex)
+        {
+            OutData[ByteIndex] = (uint8)(Bits >> (56 - ByteIndex * 8));
+        }
+    }
+
+    // ---------------------------------------------------------------------------------------------
+    // BC1 / BC3
+
+    static uint16 ToRGB565(const float Color[4])
+    {
+        const uint16 R = (uint16)FMath::RoundToInt(Color[0] * 31.f / 255.f);
+        const uint16 G = (uint16)FMath::RoundToInt(Color[1] * 63.f / 255.f);
+        const uint16 B = (uint16)FMath::RoundToInt(Color[2] * 31.f / 255.f);
+        return (R << 11) | (G << 5) | B;
+    }
+
+    static void FromRGB565(uint16 Color, int32 OutColor[3])
+    {
+        const int32 R = (Color >> 11) & 31;
+        const int32 G = (Color >> 5) & 63;
+        const int32 B = Color & 31;
+        OutColor[0] = (R << 3) | (R >> 2);
+        OutColor[1] = (G << 2) | (G >> 4);
+        OutColor[2] = (B << 3) | (B >> 2);
+    }
+
+    static void EncodeBC1Block(const FBlockPixels& Pixels, uint8* OutBlock)
+    {
+        float Min[4], Max[4];
+        ComputeEndpoints<3>(Pixels, Min, Max);
+
+        // pull endpoints in a bit as interpolated colors cover the extremes poorly
+        for (int32 Channel = 0; Channel < 3; ++Channel)
+        {
+            const float Inset = (Max[Channel] - Min[Channel]) / 16.f;
+            Min[Channel] += Inset;
+            Max[Channel] -= Inset;
+        }
+
+        uint16 Color0 = ToRGB565(Max);
+        uint16 Color1 = ToRGB565(Min);
+        if (Color0 < Color1)
+        {
+            // Color0 > Color1 selects four color mode
+            Swap(Color0, Color1);
+        }
+
+        uint32 Indices = 0;
+        if (Color0 != Color1)
+        {
+            int32 Colors[2][3];
+            FromRGB565(Color0, Colors[0]);
+            FromRGB565(Color1, Colors[1]);
+
+            uint8 Palette[4][4] = {};
+            for (int32 Channel = 0; Channel < 3; ++Channel)
+            {
+                Palette[0][Channel] = (uint8)Colors[0][Channel];
+                Palette[1][Channel] = (uint8)Colors[1][Channel];
+                Palette[2][Channel] = (uint8)((2 * Colors[0][Channel] + Colors[1][Channel]) / 3);
+                Palette[3][Channel] = (uint8)((Colors[0][Channel] + 2 * Colors[1][Channel]) / 3);
+            }
+
+            uint8 PixelIndices[NumBlockPixels];
+            FPixelKernels::FindNearestColors(Pixels[0], NumBlockPixels, Palette[0], 4, RGBChannels, PixelIndices);
+
+            for (int32 PixelIndex = 0; PixelIndex < NumBlockPixels; ++PixelIndex)
+            {
+                Indices |= (uint32)PixelIndices[PixelIndex] << (PixelIndex * 2);
+            }
+        }
+
+        OutBlock[0] = Color0 & 0xFF;
+        OutBlock[1] = Color0 >> 8;
+        OutBlock[2] = Color1 & 0xFF;
+        OutBlock[3] = Color1 >> 8;
+        OutBlock[4] = Indices & 0xFF;
+        OutBlock[5] = (Indices >> 8) & 0xFF;
+        OutBlock[6] = (Indices >> 16) & 0xFF;
+        OutBlock[7] = Indices >> 24;
+    }
+
+    static void EncodeBC3AlphaBlock(const FBlockPixels& Pixels, uint8* OutBlock)
+    {
+        int32 MinAlpha = 255;
+        int32 MaxAlpha = 0;
+        for (int32 PixelIndex = 0; PixelIndex < NumBlockPixels; ++PixelIndex)
+        {
+            MinAlpha = FMath::Min<int32>(MinAlpha, Pixels[PixelIndex][3]);
+            MaxAlpha = FMath::Max<int32>(MaxAlpha, Pixels[PixelIndex][3]);
+        }
+
+        OutBlock[0] = (uint8)MaxAlpha;
+        OutBlock[1] = (uint8)MinAlpha;
+
+        uint64 Indices = 0;
+        if (MaxAlpha > MinAlpha)
+        {
+            // Alpha0 > Alpha1 selects eight alpha mode
+            uint8 Palette[8][4] = {};
+            Palette[0][3] = (uint8)MaxAlpha;
+            Palette[1][3] = (uint8)MinAlpha;
+            for (int32 PaletteIndex = 2; PaletteIndex < 8; ++PaletteIndex)
+            {
+                Palette[PaletteIndex][3] = (uint8)(((8 - PaletteIndex) * MaxAlpha + (PaletteIndex - 1) * MinAlpha) / 7);
+            }
+
+            uint8 PixelIndices[NumBlockPixels];
+            FPixelKernels::FindNearestColors(Pixels[0], NumBlockPixels, Palette[0], 8, AlphaChannel, PixelIndices);
+
+            for (int32 PixelIndex = 0; PixelIndex < NumBlockPixels; ++PixelIndex)
+            {
+                Indices |= (uint64)PixelIndices[PixelIndex] << (PixelIndex * 3);
+            }
+        }
+
+        for (int32 ByteIndex = 0; ByteIndex < 6; ++ByteIndex)
+        {
+            OutBlock[2 + ByteIndex] = (uint8)(Indices >> (ByteIndex * 8));
+        }
+    }
+
+    static void EncodeBC3Block(const FBlockPixels& Pixels, uint8* OutBlock)
+    {
+        EncodeBC3AlphaBlock(Pixels, OutBlock);
+        EncodeBC1Block(Pixels, OutBlock + 8);
+    }
+
+    // ---------------------------------------------------------------------------------------------
+    // BC7, mode 6 only: single subset, RGBA 7.7.7.7 endpoints with unique p-bits and 4 bit indices
+
+    static const int32 BC7Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+    static void QuantizeBC7Endpoint(const float Endpoint[4], uint8 OutQuantized[4], uint8& OutPBit, int32 OutColor[4])
+    {
+        float BestError = MAX_flt;
+        for (uint8 PBit = 0; PBit < 2; ++PBit)
+        {
+            uint8 Quantized[4];
+            int32 Color[4];
+            float Error = 0.f;
+            for (int32 Channel = 0; Channel < 4; ++Channel)
+            {
+                Quantized[Channel] = (uint8)FMath::Clamp(FMath::RoundToInt((Endpoint[Channel] - PBit) * 0.5f), 0, 127);
+                Color[Channel] = (Quantized[Channel] << 1) | PBit;
+                Error += FMath::Square(Color[Channel] - Endpoint[Channel]);
+            }
+
+            if (Error < BestError)
+            {
+                BestError = Error;
+                OutPBit = PBit;
+                FMemory::Memcpy(OutQuantized, Quantized, sizeof(Quantized));
+                FMemory::Memcpy(OutColor, Color, sizeof(Color));
+            }
+        }
+    }
+
+    struct FBC7Mode6Block
+    {
+        uint8 Endpoints[2][4];
+        uint8 PBits[2];
+        uint8 Indices[NumBlockPixels];
+        int32 Error;
+    };
+
+    static void FitBC7Mode6Block(const FBlockPixels& Pixels, const float Endpoint0[4], const float Endpoint1[4], FBC7Mode6Block& OutBlock)
+    {
+        int32 Colors[2][4];
+        QuantizeBC7Endpoint(Endpoint0, OutBlock.Endpoints[0], OutBlock.PBits[0], Colors[0]);
+        QuantizeBC7Endpoint(Endpoint1, OutBlock.Endpoints[1], OutBlock.PBits[1], Colors[1]);
+
+        uint8 Palette[16][4];
+        for (int32 PaletteIndex = 0; PaletteIndex < 16; ++PaletteIndex)
+        {
+            const int32 Weight = BC7Weights[PaletteIndex];
+            for (int32 Channel = 0; Channel < 4; ++Channel)
+            {
+                Palette[PaletteIndex][Channel] = (uint8)(((64 - Weight) * Colors[0][Channel] + Weight * Colors[1][Channel] + 32) >> 6);
+            }
+        }
+
+        OutBlock.Error = FPixelKernels::FindNearestColors(Pixels[0], NumBlockPixels, Palette[0], 16, RGBAChannels, OutBlock.Indices);
+    }
+
+    /** Solves least squares for endpoints that reproduce pixels best with current indices */
+    static bool RefineBC7Endpoints(const FBlockPixels& Pixels, const FBC7Mode6Block& Block, float OutEndpoint0[4], float OutEndpoint1[4])
+    {
+        float A = 0.f, B = 0.f, C = 0.f;
+        float X[4] = { 0.f, 0.f, 0.f, 0.f };
+        float Y[4] = { 0.f, 0.f, 0.f, 0.f };
+
+        for (int32 PixelIndex = 0; PixelIndex < NumBlockPixels; ++PixelIndex)
+        {
+            const float Weight = BC7Weights[Block.Indices[PixelIndex]] / 64.f;
+            const float InvWeight = 1.f - Weight;
+
+            A += InvWeight * InvWeight;
+            B += InvWeight * Weight;
+            C += Weight * Weight;
+
+            for (int32 Channel = 0; Channel < 4; ++Channel)
+            {
+                X[Channel] += InvWeight * Pixels[PixelIndex][Channel];
+                Y[Channel] += Weight * Pixels[PixelIndex][Channel];
+            }
+        }
+
+        const float Determinant = A * C - B * B;
+        if (FMath::Abs(Determinant) < KINDA_SMALL_NUMBER)
+        {
+            return false;
+        }
+
+        for (int32 Channel = 0; Channel < 4; ++Channel)
+        {
+            OutEndpoint0[Channel] = FMath::Clamp((C * X[Channel] - B * Y[Channel]) / Determinant, 0.f, 255.f);
+            OutEndpoint1[Channel] = FMath::Clamp((A * Y[Channel] - B * X[Channel]) / Determinant, 0.f, 255.f);
+        }
+
+        return true;
+    }
+
+    static void EncodeBC7Block(const FBlockPixels& Pixels, uint8* OutBlock)
+    {
+        float Min[4], Max[4];
+        ComputeEndpoints<4>(Pixels, Min, Max);
+
+        FBC7Mode6Block Block;
+        FitBC7Mode6Block(Pixels, Min, Max, Block);
+
+        float RefinedMin[4], RefinedMax[4];
+        if (Block.Error > 0 && RefineBC7Endpoints(Pixels, Block, RefinedMin, RefinedMax))
+        {
+            FBC7Mode6Block RefinedBlock;
+            FitBC7Mode6Block(Pixels, RefinedMin, RefinedMax, RefinedBlock);
+            if (RefinedBlock.Error < Block.Error)
+            {
+                Block = RefinedBlock;
+            }
+        }
+
+        // MSB of the first index is implicit zero
+        if (Block.Indices[0] >= 8)
+        {
+            for (int32 Channel = 0; Channel < 4; ++Channel)
+            {
+                Swap(Block.Endpoints[0][Channel], Block.Endpoints[1][Channel]);
+            }
+            Swap(Block.PBits[0], Block.PBits[1]);
+
+            for (int32 PixelIndex = 0; PixelIndex < NumBlockPixels; ++PixelIndex)
+            {
+                Block.Indices[PixelIndex] = 15 - Block.Indices[PixelIndex];
+            }
+        }
+
+        FMemory::Memzero(OutBlock, 16);
+
+        FBitWriter BitWriter(OutBlock);
+        BitWriter.Write(1 << 6, 7);
+
+        for (int32 Channel = 0; Channel < 4; ++Channel)
+        {
+            BitWriter.Write(Block.Endpoints[0][Channel], 7);
+            BitWriter.Write(Block.Endpoints[1][Channel], 7);
+        }
+
+        BitWriter.Write(Block.PBits[0], 1);
+        BitWriter.Write(Block.PBits[1], 1);
+
+        BitWriter.Write(Block.Indices[0], 3);
+        for (int32 PixelIndex = 1; PixelIndex < NumBlockPixels; ++PixelIndex)
+        {
+            BitWriter.Write(Block.Indices[PixelIndex], 4);
+        }
+    }
+
+    // ---------------------------------------------------------------------------------------------
+    // ETC2 RGB (individual and differential modes) and EAC alpha
+
+    static const int32 ETCModifiers[8][2] = { { 2, 8 }, { 5, 17 }, { 9, 29 }, { 13, 42 }, { 18, 60 }, { 24, 80 }, { 33, 106 }, { 47, 183 } };
+
+    static const int32 EACModifiers[16][8] =
+    {
+        { -3, -6,  -9, -15, 2, 5, 8, 14 },
+        { -3, -7, -10, -13, 2, 6, 9, 12 },
+        { -2, -5,  -8, -13, 1, 4, 7, 12 },
+        { -2, -4,  -6, -13, 1, 3, 5, 12 },
+        { -3, -6,  -8, -12, 2, 5, 7, 11 },
+        { -3, -7,  -9, -11, 2, 6, 8, 10 },
+        { -4, -7,  -8, -11, 3, 6, 7, 10 },
+        { -3, -5,  -8, -11, 2, 4, 7, 10 },
+        { -2, -6,  -8, -10, 1, 5, 7,  9 },
+        { -2, -5,  -8, -10, 1, 4, 7,  9 },
+        { -2, -4,  -8, -10, 1, 3, 7,  9 },
+        { -2, -5,  -7, -10, 1, 4, 6,  9 },
+        { -3, -4,  -7, -10, 2, 3, 6,  9 },
+        { -1, -2,  -3, -10, 0, 1, 2,  9 },
+        { -4, -6,  -8,  -9, 3, 5, 7,  8 },
+        { -3, -5,  -7,  -9, 2, 4, 6,  8 }
+    };
+
+    /** Pixels are addressed column by column in ETC blocks */
+    static int32 GetETCPixelIndex(int32 X, int32 Y)
+    {
+        return X * BlockSize + Y;
+    }
+
+    static int32 FitETCSubBlock(const FBlockPixels& Pixels, const int32 SubBlockPixels[8], const int32 BaseColor[3], int32& OutTable, uint8 OutSelectors[8])
+    {
+        // gathered once so selector search reads them in a row
+        uint8 SubBlock[8][4];
+        for (int32 SubBlockPixel = 0; SubBlockPixel < 8; ++SubBlockPixel)
+        {
+            FMemory::Memcpy(SubBlock[SubBlockPixel], Pixels[SubBlockPixels[SubBlockPixel]], 4);
+        }
+
+        int32 BestTableError = MAX_int32;
+
+        for (int32 Table = 0; Table < 8; ++Table)
+        {
+            // selectors 0..3 stand for +small, +large, -small, -large modifiers
+            const int32 Modifiers[4] = { ETCModifiers[Table][0], ETCModifiers[Table][1], -ETCModifiers[Table][0], -ETCModifiers[Table][1] };
+
+            uint8 Palette[4][4] = {};
+            for (int32 Selector = 0; Selector < 4; ++Selector)
+            {
+                for (int32 Channel = 0; Channel < 3; ++Channel)
+                {
+                    Palette[Selector][Channel] = (uint8)FMath::Clamp(BaseColor[Channel] + Modifiers[Selector], 0, 255);
+                }
+            }
+
+            uint8 Selectors[8];
+            const int32 TableError = FPixelKernels::FindNearestColors(SubBlock[0], 8, Palette[0], 4, RGBChannels, Selectors);
+
+            if (TableError < BestTableError)
+            {
+                BestTableError = TableError;
+                OutTable = Table;
+                FMemory::Memcpy(OutSelectors, Selectors, sizeof(Selectors));
+            }
+        }
+
+        return BestTableError;
+    }
+
+    static void EncodeETC2RGBBlock(const FBlockPixels& Pixels, uint8* OutBlock)
+    {
+        uint64 BestBits = 0;
+        int32 BestError = MAX_int32;
+
+        // flip 0 splits block into 2x4 halves side by side, flip 1 into 4x2 halves on top of each other
+        for (int32 Flip = 0; Flip < 2; ++Flip)
+        {
+            int32 SubBlockPixels[2][8];
+            int32 NumSubBlockPixels[2] = { 0, 0 };
+            float Average[2][3] = {};
+
+            for (int32 Y = 0; Y < BlockSize; ++Y)
+            {
+                for (int32 X = 0; X < BlockSize; ++X)
+                {
+                    const int32 SubBlock = Flip ? (Y >= 2) : (X >= 2);
+                    const int32 PixelIndex = Y * BlockSize + X;
+
+                    SubBlockPixels[SubBlock][NumSubBlockPixels[SubBlock]++] = PixelIndex;
+                    for (int32 Channel = 0; Channel < 3; ++Channel)
+                    {
+                        Average[SubBlock][Channel] += Pixels[PixelIndex][Channel] / 8.f;
+                    }
+                }
+            }
+
+            int32 Quantized[2][3];
+            bool bDifferential = true;
+            for (int32 Channel = 0; Channel < 3; ++Channel)
+            {
+                Quantized[0][Channel] = FMath::Clamp(FMath::RoundToInt(Average[0][Channel] * 31.f / 255.f), 0, 31);
+                Quantized[1][Channel] = FMath::Clamp(FMath::RoundToInt(Average[1][Channel] * 31.f / 255.f), 0, 31);
+
+                const int32 Delta = Quantized[1][Channel] - Quantized[0][Channel];
+                bDifferential &= (Delta >= -4 && Delta <= 3);
+            }
+
+            int32 BaseColors[2][3];
+            for (int32 SubBlock = 0; SubBlock < 2; ++SubBlock)
+            {
+                for (int32 Channel = 0; Channel < 3; ++Channel)
+                {
+                    if (bDifferential)
+                    {
+                        BaseColors[SubBlock][Channel] = (Quantized[SubBlock][Channel] << 3) | (Quantized[SubBlock][Channel] >> 2);
+                    }
+                    else
+                    {
+                        Quantized[SubBlock][Channel] = FMath::Clamp(FMath::RoundToInt(Average[SubBlock][Channel] * 15.f / 255.f), 0, 15);
+                        BaseColors[SubBlock][Channel] = (Quantized[SubBlock][Channel] << 4) | Quantized[SubBlock][Channel];
+                    }
+                }
+            }
+
+            int32 Tables[2];
+            uint8 Selectors[2][8];
+            const int32 Error = FitETCSubBlock(Pixels, SubBlockPixels[0], BaseColors[0], Tables[0], Selectors[0])
+                + FitETCSubBlock(Pixels, SubBlockPixels[1], BaseColors[1], Tables[1], Selectors[1]);
+
+            if (Error >= BestError)
+            {
+                continue;
+            }
+
+            BestError = Error;
+
+            uint64 Bits = 0;
+            if (bDifferential)
+            {
+                Bits |= (uint64)Quantized[0][0] << 59;
+                Bits |= (uint64)((Quantized[1][0] - Quantized[0][0]) & 7) << 56;
+                Bits |= (uint64)Quantized[0][1] << 51;
+                Bits |= (uint64)((Quantized[1][1] - Quantized[0][1]) & 7) << 48;
+                Bits |= (uint64)Quantized[0][2] << 43;
+                Bits |= (uint64)((Quantized[1][2] - Quantized[0][2]) & 7) << 40;
+            }
+            else
+            {
+                Bits |= (uint64)Quantized[0][0] << 60;
+                Bits |= (uint64)Quantized[1][0] << 56;
+                Bits |= (uint64)Quantized[0][1] << 52;
+                Bits |= (uint64)Quantized[1][1] << 48;
+                Bits |= (uint64)Quantized[0][2] << 44;
+                Bits |= (uint64)Quantized[1][2] << 40;
+            }
+
+            Bits |= (uint64)Tables[0] << 37;
+            Bits |= (uint64)Tables[1] << 34;
+            Bits |= (uint64)(bDifferential ? 1 : 0) << 33;
+            Bits |= (uint64)Flip << 32;
+
+            for (int32 SubBlock = 0; SubBlock < 2; ++SubBlock)
+            {
+                for (int32 SubBlockPixel = 0; SubBlockPixel < 8; ++SubBlockPixel)
+                {
+                    const int32 PixelIndex = SubBlockPixels[SubBlock][SubBlockPixel];
+                    const int32 ETCPixelIndex = GetETCPixelIndex(PixelIndex % BlockSize, PixelIndex / BlockSize);
+                    const uint8 Selector = Selectors[SubBlock][SubBlockPixel];
+
+                    Bits |= (uint64)(Selector & 1) << ETCPixelIndex;
+                    Bits |= (uint64)(Selector >> 1) << (16 + ETCPixelIndex);
+                }
+            }
+
+            BestBits = Bits;
+        }
+
+        WriteBigEndian(BestBits, OutBlock);
+    }
+
+    static void EncodeEACAlphaBlock(const FBlockPixels& Pixels, uint8* OutBlock)
+    {
+        int32 MinAlpha = 255;
+        int32 MaxAlpha = 0;
+        for (int32 PixelIndex = 0; PixelIndex < NumBlockPixels; ++PixelIndex)
+        {
+            MinAlpha = FMath::Min<int32>(MinAlpha, Pixels[PixelIndex][3]);
+            MaxAlpha = FMath::Max<int32>(MaxAlpha, Pixels[PixelIndex][3]);
+        }
+
+        uint64 BestBits = 0;
+        int32 BestError = MAX_int32;
+
+        for (int32 Table = 0; Table < 16; ++Table)
+        {
+            const int32 TableMin = EACModifiers[Table][3];
+            const int32 TableMax = EACModifiers[Table][7];
+
+            // stretch table over alpha range of the block
+            const int32 Multiplier = FMath::Clamp(FMath::RoundToInt((float)(MaxAlpha - MinAlpha) / (TableMax - TableMin)), 1, 15);
+            const int32 Base = FMath::Clamp(FMath::RoundToInt((MaxAlpha + MinAlpha) * 0.5f - Multiplier * (TableMax + TableMin) * 0.5f), 0, 255);
+
+            uint8 Palette[8][4] = {};
+            for (int32 Selector = 0; Selector < 8; ++Selector)
+            {
+                Palette[Selector][3] = (uint8)FMath::Clamp(Base + EACModifiers[Table][Selector] * Multiplier, 0, 255);
+            }
+
+            uint8 Selectors[NumBlockPixels];
+            const int32 Error = FPixelKernels::FindNearestColors(Pixels[0], NumBlockPixels, Palette[0], 8, AlphaChannel, Selectors);
+
+            uint64 Bits = ((uint64)Base << 56) | ((uint64)Multiplier << 52) | ((uint64)Table << 48);
+            for (int32 Y = 0; Y < BlockSize; ++Y)
+            {
+                for (int32 X = 0; X < BlockSize; ++X)
+                {
+                    Bits |= (uint64)Selectors[Y * BlockSize + X] << (45 - 3 * GetETCPixelIndex(X, Y));
+                }
+            }
+
+            if (Error < BestError)
+            {
+                BestError = Error;
+                BestBits = Bits;
+            }
+        }
+
+        WriteBigEndian(BestBits, OutBlock);
+    }
+
+    static void EncodeETC2RGBABlock(const FBlockPixels& Pixels, uint8* OutBlock)
+    {
+        EncodeEACAlphaBlock(Pixels, OutBlock);
+        EncodeETC2RGBBlock(Pixels, OutBlock + 8);
+    }
+
+    // ---------------------------------------------------------------------------------------------
+    // BC6H unsigned, mode 11 only: single region, RGB 10.10.10 endpoints and 4 bit indices
+
+    // half float bits of a single block in RGB order, row by row
+    typedef uint16 FHalfBlockPixels[NumBlockPixels][3];
+
+    static constexpr uint16 MaxUnsignedHalf = 0x7BFF;
+
+    static void LoadHalfBlock(const uint16* RGBAHalfData, int32 SizeX, int32 SizeY, int32 BlockX, int32 BlockY, FHalfBlockPixels& OutPixels)
+    {
+        for (int32 Y = 0; Y < BlockSize; ++Y)
+        {
+            const int32 SrcY = FMath::Min(BlockY * BlockSize + Y, SizeY - 1);
+
+            for (int32 X = 0; X < BlockSize; ++X)
+            {
+                const int32 SrcX = FMath::Min(BlockX * BlockSize + X, SizeX - 1);
+                const uint16* SrcPixel = RGBAHalfData + ((int64)SrcY * SizeX + SrcX) * 4;
+
+                for (int32 Channel = 0; Channel < 3; ++Channel)
+                {
+                    // unsigned BC6H has no negatives, infinities or NaNs, bits of positive halves grow with their values
+                    const uint16 Half = SrcPixel[Channel];
+                    OutPixels[Y * BlockSize + X][Channel] = (Half & 0x8000) ? 0 : FMath::Min(Half, MaxUnsignedHalf);
+                }
+            }
+        }
+    }
+
+    static int32 QuantizeBC6HEndpoint(int32 Half)
+    {
+        // inverse of UnquantizeBC6HEndpoint followed by FinishBC6HInterpolation, which maps endpoint to about 31 * Value + 15
+        return FMath::Min(Half / 31, 1023);
+    }
+
+    static int32 UnquantizeBC6HEndpoint(int32 Value)
+    {
+        if (Value == 0)
+        {
+            return 0;
+        }
+        if (Value == 1023)
+        {
+            return 0xFFFF;
+        }
+        return ((Value << 16) + 0x8000) >> 10;
+    }
+
+    static int32 FinishBC6HInterpolation(int32 Value)
+    {
+        return (Value * 31) >> 6;
+    }
+
+    static int64 FitBC6HBlock(const FHalfBlockPixels& Pixels, const int32 Endpoint0[3], const int32 Endpoint1[3], uint8 OutIndices[NumBlockPixels])
+    {
+        int32 Palette[16][3];
+        for (int32 Index = 0; Index < 16; ++Index)
+        {
+            for (int32 Channel = 0; Channel < 3; ++Channel)
+            {
+                const int32 Value0 = UnquantizeBC6HEndpoint(Endpoint0[Channel]);
+                const int32 Value1 = UnquantizeBC6HEndpoint(Endpoint1[Channel]);
+                Palette[Index][Channel] = FinishBC6HInterpolation((Value0 * (64 - BC7Weights[Index]) + Value1 * BC7Weights[Index] + 32) >> 6);
+            }
+        }
+
+        int64 TotalError = 0;
+        for (int32 PixelIndex = 0; PixelIndex < NumBlockPixels; ++PixelIndex)
+        {
+            int64 BestError = MAX_int64;
+            for (int32 Index = 0; Index < 16; ++Index)
+            {
+                int64 Error = 0;
+                for (int32 Channel = 0; Channel < 3; ++Channel)
+                {
+                    const int64 Delta = (int64)Pixels[PixelIndex][Channel] - Palette[Index][Channel];
+                    Error += Delta * Delta;
+                }
+
+                if (Error < BestError)
+                {
+                    BestError = Error;
+                    OutIndices[PixelIndex] = (uint8)Index;
+                }
+            }
+            TotalError += BestError;
+        }
+
+        return TotalError;
+    }
+
+    static void EncodeBC6HBlock(const FHalfBlockPixels& Pixels, uint8* OutBlock)
+    {
+        int32 Min[3] = { MaxUnsignedHalf, MaxUnsignedHalf, MaxUnsignedHalf };
+        int32 Max[3] = { 0, 0, 0 };
+        for (int32 PixelIndex = 0; PixelIndex < NumBlockPixels; ++PixelIndex)
+        {
+            for (int32 Channel = 0; Channel < 3; ++Channel)
+            {
+                Min[Channel] = FMath::Min<int32>(Min[Channel], Pixels[PixelIndex][Channel]);
+                Max[Channel] = FMath::Max<int32>(Max[Channel], Pixels[PixelIndex][Channel]);
+            }
+        }
+
+        // the line runs along one of the diagonals of the bounding box, green and blue may go against red
+        int32 BestEndpoint0[3], BestEndpoint1[3];
+        uint8 BestIndices[NumBlockPixels];
+        int64 BestError = MAX_int64;
+
+        for (int32 Diagonal = 0; Diagonal < 4; ++Diagonal)
+        {
+            int32 Endpoint0[3], Endpoint1[3];
+            for (int32 Channel = 0; Channel < 3; ++Channel)
+            {
+                const bool bFlip = Channel > 0 && ((Diagonal >> (Channel - 1)) & 1);
+                Endpoint0[Channel] = QuantizeBC6HEndpoint(bFlip ? Max[Channel] : Min[Channel]);
+                Endpoint1[Channel] = QuantizeBC6HEndpoint(bFlip ? Min[Channel] : Max[Channel]);
+            }
+
+            uint8 Indices[NumBlockPixels];
+            const int64 Error = FitBC6HBlock(Pixels, Endpoint0, Endpoint1, Indices);
+            if (Error < BestError)
+            {
+                BestError = Error;
+                FMemory::Memcpy(BestEndpoint0, Endpoint0, sizeof(Endpoint0));
+                FMemory::Memcpy(BestEndpoint1, Endpoint1, sizeof(Endpoint1));
+                FMemory::Memcpy(BestIndices, Indices, sizeof(Indices));
+            }
+
+            if (Min[1] == Max[1] && Min[2] == Max[2])
+            {
+                break;
+            }
+        }
+
+        // most significant bit of the first index is implicit zero, weights are symmetric so swapping endpoints fixes it
+        if (BestIndices[0] >= 8)
+        {
+            for (int32 Channel = 0; Channel < 3; ++Channel)
+            {
+                Swap(BestEndpoint0[Channel], BestEndpoint1[Channel]);
+            }
+            for (int32 PixelIndex = 0; PixelIndex < NumBlockPixels; ++PixelIndex)
+            {
+                BestIndices[PixelIndex] = 15 - BestIndices[PixelIndex];
+            }
+        }
+
+        FMemory::Memzero(OutBlock, 16);
+        FBitWriter Writer(OutBlock);
+        Writer.Write(0x03, 5);
+        for (int32 Channel = 0; Channel < 3; ++Channel)
+        {
+            Writer.Write(BestEndpoint0[Channel], 10);
+        }
+        for (int32 Channel = 0; Channel < 3; ++Channel)
+        {
+            Writer.Write(BestEndpoint1[Channel], 10);
+        }
+        for (int32 PixelIndex = 0; PixelIndex < NumBlockPixels; ++PixelIndex)
+        {
+            Writer.Write(BestIndices[PixelIndex], PixelIndex == 0 ? 3 : 4);
+        }
+    }
+
+    // ---------------------------------------------------------------------------------------------
+
+    static FRuntimeImageRawData CompressMip(const FRuntimeImageRawData& MipData, int32 SizeX, int32 SizeY, EPixelFormat CompressedFormat)
+    {
+        typedef void (*FEncodeBlockFunction)(const FBlockPixels&, uint8*);
+
+        FEncodeBlockFunction EncodeBlock = nullptr;
+        switch (CompressedFormat)
+        {
+            case PF_DXT1:           EncodeBlock = &EncodeBC1Block; break;
+            case PF_DXT5:           EncodeBlock = &EncodeBC3Block; break;
+            case PF_BC7:            EncodeBlock = &EncodeBC7Block; break;
+            case PF_ETC2_RGB:       EncodeBlock = &EncodeETC2RGBBlock; break;
+            case PF_ETC2_RGBA:      EncodeBlock = &EncodeETC2RGBABlock; break;
+            case PF_BC6H:           break;
+            default:                checkNoEntry(); break;
+        }
+
+        const int32 NumBlocksX = FMath::DivideAndRoundUp(SizeX, BlockSize);
+        const int32 NumBlocksY = FMath::DivideAndRoundUp(SizeY, BlockSize);
+        const int32 BlockBytes = GPixelFormats[CompressedFormat].BlockBytes;
+
+        FRuntimeImageRawData CompressedData;
+        CompressedData.SetNumUninitialized((int64)NumBlocksX * NumBlocksY * BlockBytes);
+
+        const uint8* SrcData = MipData.GetData();
+        uint8* DstData = CompressedData.GetData();
+
+        if (CompressedFormat == PF_BC6H)
+        {
+            const uint16* SrcHalfData = reinterpret_cast<const uint16*>(SrcData);
+
+            ParallelFor(NumBlocksY, [=](int32 BlockY)
+            {
+                FHalfBlockPixels Pixels;
+                for (int32 BlockX = 0; BlockX < NumBlocksX; ++BlockX)
+                {
+                    LoadHalfBlock(SrcHalfData, SizeX, SizeY, BlockX, BlockY, Pixels);
+                    EncodeBC6HBlock(Pixels, DstData + ((int64)BlockY * NumBlocksX + BlockX) * BlockBytes);
+                }
+            });
+
+            return CompressedData;
+        }
+
+        // each row of blocks is independent
+        ParallelFor(NumBlocksY, [=](int32 BlockY)
+        {
+            FBlockPixels Pixels;
+            for (int32 BlockX = 0; BlockX < NumBlocksX; ++BlockX)
+            {
+                LoadBlock(SrcData, SizeX, SizeY, BlockX, BlockY, Pixels);
+                EncodeBlock(Pixels, DstData + ((int64)BlockY * NumBlocksX + BlockX) * BlockBytes);
+            }
+        });
+
+        return CompressedData;
+    }
+
+    EPixelFormat GetCompressedPixelFormat(ERuntimeImageCompression Compression)
+    {
+        EPixelFormat DesktopFormat = PF_Unknown;
+        EPixelFormat MobileFormat = PF_Unknown;
+
+        switch (Compression)
+        {
+            case ERuntimeImageCompression::Fast:            DesktopFormat = PF_DXT1; MobileFormat = PF_ETC2_RGB; break;
+            case ERuntimeImageCompression::Balanced:        DesktopFormat = PF_DXT5; MobileFormat = PF_ETC2_RGBA; break;
+            case ERuntimeImageCompression::HighQuality:     DesktopFormat = PF_BC7; MobileFormat = PF_ETC2_RGBA; break;
+            default:                                        return PF_Unknown;
+        }
+
+        if (GPixelFormats[DesktopFormat].Supported)
+        {
+            return DesktopFormat;
+        }
+
+        if (GPixelFormats[MobileFormat].Supported)
+        {
+            return MobileFormat;
+        }
+
+        return PF_Unknown;
+    }
+
+    EPixelFormat GetCompressedHDRPixelFormat()
+    {
+        return GPixelFormats[PF_BC6H].Supported ? PF_BC6H : PF_Unknown;
+    }
+
+    bool CanCompressImage(const FRuntimeImageData& ImageData)
+    {
+        // RHIs require top mip of block compressed texture to be made of whole blocks
+        return (ImageData.Format == ERawImageFormat::BGRA8 || ImageData.Format == ERawImageFormat::RGBA16F)
+            && ImageData.SizeX % BlockSize == 0
+            && ImageData.SizeY % BlockSize == 0
+            && !ImageData.bGenerateMipsOnGPU;
+    }
+
+    bool CompressImage(FRuntimeImageData& ImageData, EPixelFormat CompressedFormat)
+    {
+        if (!CanCompressImage(ImageData))
+        {
+            return false;
+        }
+
+        // half float images go to BC6H only and 8 bit images to the other encoders
+        if ((CompressedFormat == PF_BC6H) != (ImageData.Format == ERawImageFormat::RGBA16F))
+        {
+            return false;
+        }
+
+        ImageData.RawData = CompressMip(ImageData.RawData, ImageData.SizeX, ImageData.SizeY, CompressedFormat);
+
+        for (int32 MipIndex = 1; MipIndex <= ImageData.AdditionalMips.Num(); ++MipIndex)
+        {
+            FRuntimeImageRawData& MipData = ImageData.AdditionalMips[MipIndex - 1];
+            MipData = CompressMip(MipData, FMipHelpers::GetMipSize(ImageData.SizeX, MipIndex), FMipHelpers::GetMipSize(ImageData.SizeY, MipIndex), CompressedFormat);
+        }
+
+        // Format keeps describing source pixels, GPU sees blocks only
+        ImageData.PixelFormat = CompressedFormat;
+
+        return true;
+    }
+}
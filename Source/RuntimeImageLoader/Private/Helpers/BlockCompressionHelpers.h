@@ -0,0 +1,25 @@
+// Copyright 2022 Peter Leontev. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "PixelFormat.h"
+
+#include "RuntimeImageData.h"
+#include "RuntimeImageReader.h"
+
+
+namespace FBlockCompressionHelpers
+{
+    /** Picks block compressed format supported by current RHI. Returns PF_Unknown if there is none */
+    EPixelFormat GetCompressedPixelFormat(ERuntimeImageCompression Compression);
+
+    /** BC6H for half float images when current RHI supports it, PF_Unknown otherwise */
+    EPixelFormat GetCompressedHDRPixelFormat();
+
+    /** Only BGRA8 and RGBA16F images with dimensions multiple of block size can be compressed */
+    bool CanCompressImage(const FRuntimeImageData& ImageData);
+
+    /** Encodes RawData and AdditionalMips into blocks of CompressedFormat in place */
+    bool CompressImage(FRuntimeImageData& ImageData, EPixelFormat CompressedFormat);
+}
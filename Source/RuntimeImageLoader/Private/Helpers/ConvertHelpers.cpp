@@ -0,0 +1,284 @@
+// Copyright 2022 Peter Leontev. All Rights Reserved.
+
+#include "ConvertHelpers.h"
+#include "Async/ParallelFor.h"
+
+#include "PixelKernels.h"
+
+
+namespace
+{
+    // pixels converted by one task
+    const int64 ConvertChunkSize = 64 * 1024;
+
+    /** 8 bit sRGB value for every value of the channel type, either converted from linear or just quantized */
+    template<typename ChannelType>
+    struct FSRGBTable
+    {
+        explicit FSRGBTable(bool bFromLinear)
+        {
+            const int32 MaxValue = TNumericLimits<ChannelType>::Max();
+            Values.SetNumUninitialized(MaxValue + 1);
+
+            for (int32 Value = 0; Value <= MaxValue; ++Value)
+            {
+                const float Normalized = (float)Value / MaxValue;
+                const float Encoded = bFromLinear ?
+                    ((Normalized <= 0.0031308f) ? Normalized * 12.92f : 1.055f * FMath::Pow(Normalized, 1.0f / 2.4f) - 0.055f) :
+                    Normalized;
+
+                Values[Value] = (uint8)FMath::Clamp(FMath::RoundToInt(Encoded * 255.0f), 0, 255);
+            }
+        }
+
+        TArray<uint8> Values;
+    };
+
+    template<typename ChannelType>
+    const uint8* GetSRGBTable(bool bFromLinear)
+    {
+        static const FSRGBTable<ChannelType> LinearTable(true);
+        static const FSRGBTable<ChannelType> SRGBTable(false);
+
+        return bFromLinear ? LinearTable.Values.GetData() : SRGBTable.Values.GetData();
+    }
+
+    uint8 ToUNorm8(uint8 Value) { return Value; }
+    uint8 ToUNorm8(uint16 Value) { return (uint8)((Value + 128) / 257); }
+
+    /** Channel indices are positions of R, G, B and A in the source pixel, gray has only one channel */
+    template<typename ChannelType, int32 NumChannels, int32 RIndex, int32 GIndex, int32 BIndex, int32 AIndex>
+    void ConvertPixels(const ChannelType* Source, FColor* Dest, int64 NumPixels, const uint8* ColorTable)
+    {
+        for (int64 Index = 0; Index < NumPixels; ++Index, Source += NumChannels)
+        {
+            FColor& Pixel = Dest[Index];
+
+            if (NumChannels == 1)
+            {
+                const uint8 Value = ColorTable[Source[0]];
+                Pixel.R = Value;
+                Pixel.G = Value;
+                Pixel.B = Value;
+                Pixel.A = 255;
+            }
+            else
+            {
+                Pixel.R = ColorTable[Source[RIndex]];
+                Pixel.G = ColorTable[Source[GIndex]];
+                Pixel.B = ColorTable[Source[BIndex]];
+                Pixel.A = (uint8)ToUNorm8(Source[AIndex]);
+            }
+        }
+    }
+
+    /** Source and destination may be the same for formats of the same pixel size */
+    template<typename ChannelType, int32 NumChannels, int32 RIndex, int32 GIndex, int32 BIndex, int32 AIndex>
+    void ConvertImage(const uint8* Source, uint8* Dest, int64 NumPixels, bool bLinearSource)
+    {
+        const uint8* ColorTable = GetSRGBTable<ChannelType>(bLinearSource);
+        const int32 NumChunks = (int32)FMath::DivideAndRoundUp(NumPixels, ConvertChunkSize);
+
+        ParallelFor(NumChunks, [=](int32 ChunkIndex)
+        {
+            const int64 First = ChunkIndex * ConvertChunkSize;
+            const int64 Num = FMath::Min(ConvertChunkSize, NumPixels - First);
+
+            ConvertPixels<ChannelType, NumChannels, RIndex, GIndex, BIndex, AIndex>(
+                (const ChannelType*)Source + First * NumChannels, (FColor*)Dest + First, Num, ColorTable
+            );
+        });
+    }
+
+    /** Unsigned small float of the half value, conversion works on bits: exponents of both have the same bias */
+    template<int32 NumMantissaBits>
+    uint32 HalfToSmallFloat(uint16 Half)
+    {
+        const int32 DroppedBits = 10 - NumMantissaBits;
+        const uint32 Infinity = 0x1F << NumMantissaBits;
+
+        if (Half & 0x8000)
+        {
+            // negative values can't be stored
+            return 0;
+        }
+
+        if (Half >= 0x7C00)
+        {
+            return (Half == 0x7C00) ? Infinity : Infinity | 1;
+        }
+
+        // round to nearest, carry moves to exponent on its own
+        const uint32 Rounded = ((uint32)Half + (1 << (DroppedBits - 1))) >> DroppedBits;
+        return FMath::Min(Rounded, Infinity - 1);
+    }
+
+    void PackHalfMip(const uint16* Source, uint8* Dest, int64 NumPixels, EPixelFormat PixelFormat)
+    {
+        const int32 NumChunks = (int32)FMath::DivideAndRoundUp(NumPixels, ConvertChunkSize);
+
+        ParallelFor(NumChunks, [=](int32 ChunkIndex)
+        {
+            const int64 First = ChunkIndex * ConvertChunkSize;
+            const int64 Last = FMath::Min(First + ConvertChunkSize, NumPixels);
+
+            if (PixelFormat == PF_R16F)
+            {
+                uint16* DestPixels = (uint16*)Dest;
+                for (int64 Index = First; Index < Last; ++Index)
+                {
+                    DestPixels[Index] = Source[Index * 4];
+                }
+            }
+            else
+            {
+                uint32* DestPixels = (uint32*)Dest;
+                for (int64 Index = First; Index < Last; ++Index)
+                {
+                    const uint16* Pixel = Source + Index * 4;
+                    DestPixels[Index] = HalfToSmallFloat<6>(Pixel[0]) | (HalfToSmallFloat<6>(Pixel[1]) << 11) | (HalfToSmallFloat<5>(Pixel[2]) << 22);
+                }
+            }
+        });
+    }
+
+    void ExpandGrayImage(const uint8* Source, uint8* Dest, int64 NumPixels)
+    {
+        const int32 NumChunks = (int32)FMath::DivideAndRoundUp(NumPixels, ConvertChunkSize);
+
+        ParallelFor(NumChunks, [=](int32 ChunkIndex)
+        {
+            const int64 First = ChunkIndex * ConvertChunkSize;
+            FPixelKernels::ExpandGrayToBGRA(Source + First, Dest + First * 4, FMath::Min(ConvertChunkSize, NumPixels - First));
+        });
+    }
+}
+
+namespace FConvertHelpers
+{
+    bool CanConvertToBGRA8(const FRuntimeImageData& ImageData)
+    {
+        switch (ImageData.Format)
+        {
+            case ERawImageFormat::G8:
+            case ERawImageFormat::G16:
+            case ERawImageFormat::BGRA8:
+            case ERawImageFormat::RGBA16:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    bool ConvertToBGRA8(FRuntimeImageData& ImageData)
+    {
+        if (!CanConvertToBGRA8(ImageData))
+        {
+            return false;
+        }
+
+        const bool bLinearSource = ImageData.GammaSpace == EGammaSpace::Linear;
+        const int64 NumPixels = (int64)ImageData.SizeX * ImageData.SizeY;
+
+        if (ImageData.Format == ERawImageFormat::BGRA8)
+        {
+            if (bLinearSource)
+            {
+                ConvertImage<uint8, 4, 2, 1, 0, 3>(ImageData.RawData.GetData(), ImageData.RawData.GetData(), NumPixels, true);
+            }
+        }
+        else
+        {
+            FRuntimeImageRawData BGRAData;
+            BGRAData.SetNumUninitialized(NumPixels * 4);
+
+            const uint8* Source = ImageData.RawData.GetData();
+            uint8* Dest = BGRAData.GetData();
+
+            switch (ImageData.Format)
+            {
+                case ERawImageFormat::G8:
+                {
+                    if (bLinearSource)
+                    {
+                        ConvertImage<uint8, 1, 0, 0, 0, 0>(Source, Dest, NumPixels, true);
+                    }
+                    else
+                    {
+                        // sRGB gray only has to be replicated
+                        ExpandGrayImage(Source, Dest, NumPixels);
+                    }
+                    break;
+                }
+                case ERawImageFormat::G16:
+                {
+                    ConvertImage<uint16, 1, 0, 0, 0, 0>(Source, Dest, NumPixels, bLinearSource);
+                    break;
+                }
+                case ERawImageFormat::RGBA16:
+                {
+                    ConvertImage<uint16, 4, 0, 1, 2, 3>(Source, Dest, NumPixels, bLinearSource);
+                    break;
+                }
+                default:
+                {
+                    checkNoEntry();
+                    return false;
+                }
+            }
+
+            ImageData.RawData = MoveTemp(BGRAData);
+        }
+
+        ImageData.Format = ERawImageFormat::BGRA8;
+        ImageData.TextureSourceFormat = TSF_BGRA8;
+        ImageData.SRGB = true;
+        ImageData.GammaSpace = EGammaSpace::sRGB;
+
+        return true;
+    }
+
+    EPixelFormat GetHDRPixelFormat(ERuntimeImageHDRFormat HDRFormat)
+    {
+        EPixelFormat PixelFormat = PF_FloatRGBA;
+        switch (HDRFormat)
+        {
+            case ERuntimeImageHDRFormat::RG11B10F:  PixelFormat = PF_FloatR11G11B10; break;
+            case ERuntimeImageHDRFormat::R16F:      PixelFormat = PF_R16F; break;
+            default:                                break;
+        }
+
+        return GPixelFormats[PixelFormat].Supported ? PixelFormat : PF_FloatRGBA;
+    }
+
+    bool PackHDRImage(FRuntimeImageData& ImageData, EPixelFormat PixelFormat)
+    {
+        if (ImageData.Format != ERawImageFormat::RGBA16F || (PixelFormat != PF_R16F && PixelFormat != PF_FloatR11G11B10))
+        {
+            return false;
+        }
+
+        const int32 BytesPerPixel = GPixelFormats[PixelFormat].BlockBytes;
+
+        auto PackMip = [PixelFormat, BytesPerPixel](FRuntimeImageRawData& MipData)
+        {
+            const int64 NumPixels = MipData.Num() / 8;
+
+            FRuntimeImageRawData PackedData;
+            PackedData.SetNumUninitialized(NumPixels * BytesPerPixel);
+            PackHalfMip((const uint16*)MipData.GetData(), PackedData.GetData(), NumPixels, PixelFormat);
+
+            MipData = MoveTemp(PackedData);
+        };
+
+        PackMip(ImageData.RawData);
+        for (FRuntimeImageRawData& MipData : ImageData.AdditionalMips)
+        {
+            PackMip(MipData);
+        }
+
+        ImageData.PixelFormat = PixelFormat;
+
+        return true;
+    }
+}
@@ -0,0 +1,25 @@
+// Copyright 2022 Peter Leontev. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "PixelFormat.h"
+
+#include "RuntimeImageData.h"
+#include "RuntimeImageReader.h"
+
+
+namespace FConvertHelpers
+{
+    /** G8, G16, BGRA8 and RGBA16 images have their own conversion to sRGB BGRA8 */
+    bool CanConvertToBGRA8(const FRuntimeImageData& ImageData);
+
+    /** Converts pixels to sRGB BGRA8 in one pass over the image, in place for BGRA8 images */
+    bool ConvertToBGRA8(FRuntimeImageData& ImageData);
+
+    /** Texture format of RGBA16F images stored as HDRFormat, falls back to PF_FloatRGBA if RHI does not support it */
+    EPixelFormat GetHDRPixelFormat(ERuntimeImageHDRFormat HDRFormat);
+
+    /** Repacks half pixels of RGBA16F image and its mips to PF_R16F or PF_FloatR11G11B10. Format keeps describing source pixels */
+    bool PackHDRImage(FRuntimeImageData& ImageData, EPixelFormat PixelFormat);
+}
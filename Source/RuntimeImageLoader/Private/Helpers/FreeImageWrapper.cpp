@@ -0,0 +1,52 @@
+// Copyright Peter Leontev
+
+#include "FreeImageWrapper.h"
+
+#if WITH_FREEIMAGE_LIB
+
+#include "Misc/Paths.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/CriticalSection.h"
+#include "Misc/ScopeLock.h"
+
+#if PLATFORM_WINDOWS
+#include "Windows/AllowWindowsPlatformTypes.h"
+#endif // PLATFORM_WINDOWS
+
+THIRD_PARTY_INCLUDES_START
+#include "FreeImage.h"
+THIRD_PARTY_INCLUDES_END
+
+void* FFreeImageWrapper::FreeImageDllHandle = nullptr;
+
+void FFreeImageWrapper::FreeImage_Initialise(bool bLoadLocalPluginsOnly)
+{
+	// decode workers can get here at the same time
+	static FCriticalSection InitialiseLock;
+	FScopeLock InitialiseScopeLock(&InitialiseLock);
+
+	if (FreeImageDllHandle != nullptr)
+	{
+		return;
+	}
+
+	FString FreeImageDir = FPaths::Combine(FPaths::EngineDir(), TEXT("Binaries/ThirdParty/FreeImage"), FPlatformProcess::GetBinariesSubdirectory());
+	FString FreeImageLibDir = FPaths::Combine( FreeImageDir, TEXT(FREEIMAGE_LIB_FILENAME));
+	FPlatformProcess::PushDllDirectory(*FreeImageDir);
+	void* DllHandle = FPlatformProcess::GetDllHandle(*FreeImageLibDir);
+	FPlatformProcess::PopDllDirectory(*FreeImageDir);
+
+	if (DllHandle)
+	{
+		::FreeImage_Initialise((BOOL)bLoadLocalPluginsOnly);
+
+		// IsValid does not report the library before it is initialised
+		FreeImageDllHandle = DllHandle;
+	}
+}
+
+#if PLATFORM_WINDOWS
+#include "Windows/HideWindowsPlatformTypes.h"
+#endif // PLATFORM_WINDOWS
+
+#endif // WITH_FREEIMAGE_LIB
@@ -0,0 +1,21 @@
+// Copyright Peter Leontev
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#if WITH_FREEIMAGE_LIB
+
+/** FreeImage is shipped as a dll, shared by all loaders based on it */
+class FFreeImageWrapper
+{
+public:
+	static bool IsValid() { return FreeImageDllHandle != nullptr; }
+
+	static void FreeImage_Initialise(bool bLoadLocalPluginsOnly); // Loads and inits FreeImage on first call, thread safe
+
+private:
+	static void* FreeImageDllHandle; // Loaded on module startup, never release for now
+};
+
+#endif // WITH_FREEIMAGE_LIB
@@ -0,0 +1,117 @@
+// Copyright Peter Leontev
+
+#include "JPEGLoader.h"
+#include "FreeImageWrapper.h"
+
+#if WITH_FREEIMAGE_LIB
+
+#if PLATFORM_WINDOWS
+#include "Windows/AllowWindowsPlatformTypes.h"
+#endif // PLATFORM_WINDOWS
+
+THIRD_PARTY_INCLUDES_START
+#include "FreeImage.h"
+THIRD_PARTY_INCLUDES_END
+
+#if PLATFORM_WINDOWS
+#include "Windows/HideWindowsPlatformTypes.h"
+#endif // PLATFORM_WINDOWS
+
+FRuntimeJpegLoadHelper::FRuntimeJpegLoadHelper()
+{
+	// initialised once by the module
+	if (!FFreeImageWrapper::IsValid())
+	{
+		ErrorMessage = TEXT("FreeImage is not loaded");
+		return;
+	}
+
+	bIsValid = true;
+}
+
+FRuntimeJpegLoadHelper::~FRuntimeJpegLoadHelper()
+{
+	if (Memory)
+	{
+		FreeImage_CloseMemory(Memory);
+	}
+
+	if (Bitmap)
+	{
+		FreeImage_Unload(Bitmap);
+	}
+}
+
+bool FRuntimeJpegLoadHelper::Load(const uint8* Buffer, uint32 Length, int32 RequestedSize)
+{
+	// upper 16 bits of the flags are the requested size, FreeImage picks libjpeg scale denominator from it
+	const int32 Flags = JPEG_FAST | (FMath::Clamp(RequestedSize, 0, 0xFFFF) << 16);
+
+	Memory = FreeImage_OpenMemory(const_cast<uint8*>(Buffer), Length);
+	Bitmap = FreeImage_LoadFromMemory(FIF_JPEG, Memory, Flags);
+
+	if (!Bitmap)
+	{
+		ErrorMessage = TEXT("Failed to decode JPEG");
+		return false;
+	}
+
+	Width = FreeImage_GetWidth(Bitmap);
+	Height = FreeImage_GetHeight(Bitmap);
+
+	const bool bIsSourceGrayScale = FreeImage_GetBPP(Bitmap) == 8 && FreeImage_GetColorType(Bitmap) == FIC_MINISBLACK;
+
+	FIBITMAP* ConvertedBitmap = bIsSourceGrayScale ? Bitmap : FreeImage_ConvertTo32Bits(Bitmap);
+	if (!ConvertedBitmap)
+	{
+		ErrorMessage = TEXT("Failed to convert JPEG pixels");
+		return false;
+	}
+
+	const int32 BytesPerPixel = bIsSourceGrayScale ? 1 : 4;
+	TextureSourceFormat = bIsSourceGrayScale ? TSF_G8 : TSF_BGRA8;
+	RawData.SetNumUninitialized((int64)Width * Height * BytesPerPixel);
+
+	for (int32 Y = 0; Y < Height; Y++)
+	{
+		// FreeImage keeps all images upside-down
+		const BYTE* ScanLine = FreeImage_GetScanLine(ConvertedBitmap, Height - 1 - Y);
+		uint8* TargetPixels = ((uint8*)RawData.GetData()) + (int64)Y * Width * BytesPerPixel;
+
+		if (bIsSourceGrayScale)
+		{
+			FMemory::Memcpy(TargetPixels, ScanLine, Width);
+			continue;
+		}
+
+		for (int32 X = 0; X < Width; X++)
+		{
+			const uint8* P = ScanLine + X * 4;
+			uint8* TargetPixel = TargetPixels + X * 4;
+			// FI_RGBA_X - cross-platform way to retrieve channels
+			TargetPixel[0] = P[FI_RGBA_BLUE];
+			TargetPixel[1] = P[FI_RGBA_GREEN];
+			TargetPixel[2] = P[FI_RGBA_RED];
+			TargetPixel[3] = 255;
+		}
+	}
+
+	if (ConvertedBitmap != Bitmap)
+	{
+		FreeImage_Unload(ConvertedBitmap);
+	}
+
+	return true;
+}
+
+FString FRuntimeJpegLoadHelper::GetError()
+{
+	return ErrorMessage;
+}
+
+bool FRuntimeJpegLoadHelper::IsValid()
+{
+	return bIsValid;
+}
+
+#endif // WITH_FREEIMAGE_LIB
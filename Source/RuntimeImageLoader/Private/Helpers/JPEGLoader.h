@@ -0,0 +1,43 @@
+// Copyright Peter Leontev
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/Texture.h"
+
+#include "RuntimeImageData.h"
+
+struct FIBITMAP;
+struct FIMEMORY;
+
+/**
+ * Decodes JPEG with libjpeg bundled into FreeImage, which can scale DCT blocks down by 2, 4 or 8 while decoding.
+ * Only used for shrunk images, ImageWrapper decodes the others
+ */
+class FRuntimeJpegLoadHelper
+{
+public:
+	FRuntimeJpegLoadHelper();
+	~FRuntimeJpegLoadHelper();
+
+	/** Longer side of the decoded image is not smaller than RequestedSize */
+	bool Load(const uint8* Buffer, uint32 Length, int32 RequestedSize);
+
+	FString GetError();
+
+	bool IsValid();
+
+public:
+	// Resulting image data and properties
+	FRuntimeImageRawData RawData;
+	int32 Width;
+	int32 Height;
+	ETextureSourceFormat TextureSourceFormat = TSF_Invalid;
+
+private:
+	bool bIsValid = false;
+	FIBITMAP* Bitmap = nullptr;
+	FIMEMORY* Memory = nullptr;
+
+	FString ErrorMessage;
+};
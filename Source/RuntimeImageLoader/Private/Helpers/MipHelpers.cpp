@@ -0,0 +1,133 @@
+// Copyright 2022 Peter Leontev. All Rights Reserved.
+
+#include "MipHelpers.h"
+#include "Async/ParallelFor.h"
+
+#include "PixelKernels.h"
+#include "ScratchHelpers.h"
+
+
+namespace FMipHelpers
+{
+    int32 GetMaxNumMips(int32 SizeX, int32 SizeY)
+    {
+        return FMath::FloorLog2(FMath::Max(1, FMath::Max(SizeX, SizeY))) + 1;
+    }
+
+    int32 GetMipSize(int32 Size, int32 MipIndex)
+    {
+        return FMath::Max(1, Size >> MipIndex);
+    }
+
+    bool CanGenerateMipsOnGPU(EPixelFormat PixelFormat)
+    {
+        // must be renderable and filterable
+        switch (PixelFormat)
+        {
+            case PF_B8G8R8A8:
+            case PF_G8:
+            case PF_FloatRGBA:
+                return GPixelFormats[PixelFormat].Supported;
+            default:
+                return false;
+        }
+    }
+
+    template<typename ChannelType, int32 NumChannels>
+    void DownsampleBox(const ChannelType* SrcData, int32 SrcSizeX, int32 SrcSizeY, ChannelType* DstData, int32 DstSizeX, int32 DstSizeY)
+    {
+        ParallelFor(DstSizeY, [=](int32 Y)
+        {
+            const ChannelType* SrcRow0 = SrcData + FMath::Min(Y * 2, SrcSizeY - 1) * SrcSizeX * NumChannels;
+            const ChannelType* SrcRow1 = SrcData + FMath::Min(Y * 2 + 1, SrcSizeY - 1) * SrcSizeX * NumChannels;
+            ChannelType* DstRow = DstData + Y * DstSizeX * NumChannels;
+
+            for (int32 X = 0; X < DstSizeX; ++X)
+            {
+                const int32 X0 = FMath::Min(X * 2, SrcSizeX - 1) * NumChannels;
+                const int32 X1 = FMath::Min(X * 2 + 1, SrcSizeX - 1) * NumChannels;
+
+                for (int32 Channel = 0; Channel < NumChannels; ++Channel)
+                {
+                    const uint32 Sum = (uint32)SrcRow0[X0 + Channel] + SrcRow0[X1 + Channel] + SrcRow1[X0 + Channel] + SrcRow1[X1 + Channel];
+                    DstRow[X * NumChannels + Channel] = (ChannelType)((Sum + 2) / 4);
+                }
+            }
+        });
+    }
+
+    template<int32 NumChannels>
+    void DownsampleBoxFloat16(const FFloat16* SrcData, int32 SrcSizeX, int32 SrcSizeY, FFloat16* DstData, int32 DstSizeX, int32 DstSizeY)
+    {
+        ParallelFor(DstSizeY, [=](int32 Y)
+        {
+            // rows are widened to floats in one go instead of converting every tap
+            FScratchHelpers::FScratchScope Scratch;
+            float* SrcRow0 = Scratch.Alloc<float>((int64)SrcSizeX * NumChannels);
+            float* SrcRow1 = Scratch.Alloc<float>((int64)SrcSizeX * NumChannels);
+            float* DstRow = Scratch.Alloc<float>((int64)DstSizeX * NumChannels);
+
+            FPixelKernels::HalfToFloat((const uint16*)(SrcData + (int64)FMath::Min(Y * 2, SrcSizeY - 1) * SrcSizeX * NumChannels), SrcRow0, (int64)SrcSizeX * NumChannels);
+            FPixelKernels::HalfToFloat((const uint16*)(SrcData + (int64)FMath::Min(Y * 2 + 1, SrcSizeY - 1) * SrcSizeX * NumChannels), SrcRow1, (int64)SrcSizeX * NumChannels);
+
+            for (int32 X = 0; X < DstSizeX; ++X)
+            {
+                const int32 X0 = FMath::Min(X * 2, SrcSizeX - 1) * NumChannels;
+                const int32 X1 = FMath::Min(X * 2 + 1, SrcSizeX - 1) * NumChannels;
+
+                for (int32 Channel = 0; Channel < NumChannels; ++Channel)
+                {
+                    DstRow[X * NumChannels + Channel] = (SrcRow0[X0 + Channel] + SrcRow0[X1 + Channel] + SrcRow1[X0 + Channel] + SrcRow1[X1 + Channel]) * 0.25f;
+                }
+            }
+
+            FPixelKernels::FloatToHalf(DstRow, (uint16*)(DstData + (int64)Y * DstSizeX * NumChannels), (int64)DstSizeX * NumChannels);
+        });
+    }
+
+    bool GenerateMipsOnCPU(FRuntimeImageData& ImageData, int32 NumMips)
+    {
+        ImageData.AdditionalMips.Empty();
+
+        const int32 BytesPerPixel = ImageData.GetBytesPerPixel();
+
+        for (int32 MipIndex = 1; MipIndex < NumMips; ++MipIndex)
+        {
+            const FRuntimeImageRawData& SrcMip = (MipIndex == 1) ? ImageData.RawData : ImageData.AdditionalMips[MipIndex - 2];
+            const int32 SrcSizeX = GetMipSize(ImageData.SizeX, MipIndex - 1);
+            const int32 SrcSizeY = GetMipSize(ImageData.SizeY, MipIndex - 1);
+            const int32 DstSizeX = GetMipSize(ImageData.SizeX, MipIndex);
+            const int32 DstSizeY = GetMipSize(ImageData.SizeY, MipIndex);
+
+            FRuntimeImageRawData DstMip;
+            DstMip.SetNumUninitialized((int64)DstSizeX * DstSizeY * BytesPerPixel);
+
+            switch (ImageData.Format)
+            {
+                case ERawImageFormat::G8:
+                    DownsampleBox<uint8, 1>(SrcMip.GetData(), SrcSizeX, SrcSizeY, DstMip.GetData(), DstSizeX, DstSizeY);
+                    break;
+                case ERawImageFormat::BGRA8:
+                    DownsampleBox<uint8, 4>(SrcMip.GetData(), SrcSizeX, SrcSizeY, DstMip.GetData(), DstSizeX, DstSizeY);
+                    break;
+                case ERawImageFormat::G16:
+                    DownsampleBox<uint16, 1>((const uint16*)SrcMip.GetData(), SrcSizeX, SrcSizeY, (uint16*)DstMip.GetData(), DstSizeX, DstSizeY);
+                    break;
+                case ERawImageFormat::RGBA16:
+                    DownsampleBox<uint16, 4>((const uint16*)SrcMip.GetData(), SrcSizeX, SrcSizeY, (uint16*)DstMip.GetData(), DstSizeX, DstSizeY);
+                    break;
+                case ERawImageFormat::RGBA16F:
+                    DownsampleBoxFloat16<4>((const FFloat16*)SrcMip.GetData(), SrcSizeX, SrcSizeY, (FFloat16*)DstMip.GetData(), DstSizeX, DstSizeY);
+                    break;
+                default:
+                    // shared exponent formats can't be averaged per channel
+                    ImageData.AdditionalMips.Empty();
+                    return false;
+            }
+
+            ImageData.AdditionalMips.Add(MoveTemp(DstMip));
+        }
+
+        return true;
+    }
+}
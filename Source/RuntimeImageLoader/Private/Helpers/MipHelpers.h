@@ -0,0 +1,23 @@
+// Copyright 2022 Peter Leontev. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "PixelFormat.h"
+
+#include "RuntimeImageData.h"
+
+
+namespace FMipHelpers
+{
+    /** Number of mips in a full chain down to 1x1 */
+    int32 GetMaxNumMips(int32 SizeX, int32 SizeY);
+
+    int32 GetMipSize(int32 Size, int32 MipIndex);
+
+    /** Whether mips of a texture of this format can be generated by a GPU pass */
+    bool CanGenerateMipsOnGPU(EPixelFormat PixelFormat);
+
+    /** Fills ImageData.AdditionalMips with 2x2 box filtered mips. Returns false if image format is not supported */
+    bool GenerateMipsOnCPU(FRuntimeImageData& ImageData, int32 NumMips);
+}
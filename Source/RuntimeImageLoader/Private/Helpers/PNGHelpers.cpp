@@ -2,6 +2,132 @@
 
 #include "PNGHelpers.h"
 
+#include "Misc/ScopeExit.h"
+
+#include "ScaledDecodeHelpers.h"
+#include "ScratchHelpers.h"
+
+THIRD_PARTY_INCLUDES_START
+#include "png.h"
+#include <setjmp.h>
+THIRD_PARTY_INCLUDES_END
+
+
+namespace
+{
+    struct FPNGReadBuffer
+    {
+        const uint8* Data;
+        int64 Length;
+        int64 Offset;
+    };
+
+    void ReadFromBuffer(png_structp Png, png_bytep OutData, png_size_t Num)
+    {
+        FPNGReadBuffer* ReadBuffer = (FPNGReadBuffer*)png_get_io_ptr(Png);
+        if (ReadBuffer->Offset + (int64)Num > ReadBuffer->Length)
+        {
+            png_error(Png, "Unexpected end of PNG data");
+        }
+
+        FMemory::Memcpy(OutData, ReadBuffer->Data + ReadBuffer->Offset, Num);
+        ReadBuffer->Offset += Num;
+    }
+
+    void OnError(png_structp Png, png_const_charp Message)
+    {
+        png_longjmp(Png, 1);
+    }
+
+    void OnWarning(png_structp Png, png_const_charp Message)
+    {
+        // warnings do not stop decoding
+    }
+
+    /** Setjmp functions are kept apart so nothing with a destructor lives in the frame libpng jumps to */
+    bool ReadHeader(png_structp Png, png_infop Info, int32& OutWidth, int32& OutHeight, int32& OutNumChannels)
+    {
+        if (setjmp(png_jmpbuf(Png)))
+        {
+            return false;
+        }
+
+        png_read_info(Png, Info);
+
+        png_uint_32 PngWidth = 0;
+        png_uint_32 PngHeight = 0;
+        int32 BitDepth = 0;
+        int32 ColorType = 0;
+        int32 InterlaceType = 0;
+        png_get_IHDR(Png, Info, &PngWidth, &PngHeight, &BitDepth, &ColorType, &InterlaceType, nullptr, nullptr);
+
+        // 16 bit images stay 16 bit, interlaced ones can't be decoded row by row
+        if (BitDepth > 8 || InterlaceType != PNG_INTERLACE_NONE)
+        {
+            return false;
+        }
+
+        const bool bHasTransparency = png_get_valid(Png, Info, PNG_INFO_tRNS) != 0;
+
+        // same formats as ImageWrapper gives: G8 for opaque gray, BGRA8 for the rest
+        if (ColorType == PNG_COLOR_TYPE_GRAY && !bHasTransparency)
+        {
+            png_set_expand_gray_1_2_4_to_8(Png);
+            OutNumChannels = 1;
+        }
+        else
+        {
+            if (ColorType == PNG_COLOR_TYPE_PALETTE)
+            {
+                png_set_palette_to_rgb(Png);
+            }
+            if (ColorType == PNG_COLOR_TYPE_GRAY && BitDepth < 8)
+            {
+                png_set_expand_gray_1_2_4_to_8(Png);
+            }
+            if (bHasTransparency)
+            {
+                png_set_tRNS_to_alpha(Png);
+            }
+            if (ColorType == PNG_COLOR_TYPE_GRAY || ColorType == PNG_COLOR_TYPE_GRAY_ALPHA)
+            {
+                png_set_gray_to_rgb(Png);
+            }
+            png_set_bgr(Png);
+            png_set_filler(Png, 0xFF, PNG_FILLER_AFTER);
+            OutNumChannels = 4;
+        }
+
+        png_read_update_info(Png, Info);
+
+        if (png_get_rowbytes(Png, Info) != (png_size_t)PngWidth * OutNumChannels)
+        {
+            return false;
+        }
+
+        OutWidth = PngWidth;
+        OutHeight = PngHeight;
+
+        return true;
+    }
+
+    bool ReadRows(png_structp Png, uint8* RowBuffer, int32 NumRows, FScaledDecodeHelpers::FRowDownscaler& Downscaler)
+    {
+        if (setjmp(png_jmpbuf(Png)))
+        {
+            return false;
+        }
+
+        for (int32 Y = 0; Y < NumRows; ++Y)
+        {
+            png_read_row(Png, RowBuffer, nullptr);
+            Downscaler.AddRow(Y, RowBuffer);
+        }
+
+        return true;
+    }
+}
+
 namespace FPNGHelpers
 {
     void FillZeroAlphaPNGData(int32 SizeX, int32 SizeY, ETextureSourceFormat SourceFormat, uint8* SourceData)
@@ -23,4 +149,58 @@ namespace FPNGHelpers
             }
         }
     }
+
+    bool DecodeScaled(const uint8* Buffer, int32 Length, const FIntRect& Region, int32 Scale, FRuntimeImageData& OutImage)
+    {
+        png_structp PngPtr = png_create_read_struct(PNG_LIBPNG_VER_STRING, nullptr, &OnError, &OnWarning);
+        png_infop InfoPtr = (PngPtr != nullptr) ? png_create_info_struct(PngPtr) : nullptr;
+
+        ON_SCOPE_EXIT
+        {
+            if (PngPtr != nullptr)
+            {
+                png_destroy_read_struct(&PngPtr, InfoPtr != nullptr ? &InfoPtr : nullptr, nullptr);
+            }
+        };
+
+        if (InfoPtr == nullptr)
+        {
+            return false;
+        }
+
+        FPNGReadBuffer ReadBuffer = { Buffer, Length, 0 };
+        png_set_read_fn(PngPtr, &ReadBuffer, &ReadFromBuffer);
+
+        int32 Width = 0;
+        int32 Height = 0;
+        int32 NumChannels = 0;
+        if (!ReadHeader(PngPtr, InfoPtr, Width, Height, NumChannels) || Region.Max.X > Width || Region.Max.Y > Height)
+        {
+            return false;
+        }
+
+        FScratchHelpers::FScratchScope Scratch;
+        uint8* RowBuffer = Scratch.Alloc<uint8>((int64)Width * NumChannels);
+
+        FScaledDecodeHelpers::FRowDownscaler Downscaler(Region, Scale, NumChannels);
+
+        // rows below the region are not decoded at all
+        if (!ReadRows(PngPtr, RowBuffer, Region.Max.Y, Downscaler))
+        {
+            return false;
+        }
+
+        const ETextureSourceFormat TextureFormat = (NumChannels == 1) ? TSF_G8 : TSF_BGRA8;
+        if (!OutImage.Init2D(Downscaler.GetSizeX(), Downscaler.GetSizeY(), TextureFormat, MoveTemp(Downscaler.Pixels)))
+        {
+            return false;
+        }
+        OutImage.SourceRect = Region;
+        OutImage.SRGB = true;
+        OutImage.GammaSpace = EGammaSpace::sRGB;
+
+        FillZeroAlphaPNGData(OutImage.SizeX, OutImage.SizeY, OutImage.TextureSourceFormat, OutImage.RawData.GetData());
+
+        return true;
+    }
 }
\ No newline at end of file
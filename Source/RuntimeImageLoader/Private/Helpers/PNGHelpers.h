@@ -6,10 +6,15 @@
 #include "Engine/Texture.h"
 
 #include "RuntimeImageData.h"
+#include "PixelKernels.h"
 
 
 namespace FPNGHelpers
 {
+    /** Most rows have no pixels to fill, SIMD scan skips them. 16 bit rows are scanned pixel by pixel */
+    inline bool RowContainsPixel(const uint32* Row, int32 NumPixels, uint32 Value) { return FPixelKernels::ContainsPixel(Row, NumPixels, Value); }
+    inline bool RowContainsPixel(const uint64* Row, int32 NumPixels, uint32 Value) { return true; }
+
     /**
      * This fills any pixels of a texture with have an alpha value of zero,
      * with an RGB from the nearest neighboring pixel which has non-zero alpha.
@@ -64,6 +69,11 @@ namespace FPNGHelpers
             // only wipe out colors that are affected by png turning valid colors white if alpha = 0
             const uint32 WhiteWithZeroAlpha = FColor(255, 255, 255, 0).DWColor();
 
+            if (!RowContainsPixel(reinterpret_cast<const ColorDataType*>(SourceData + Y * TextureWidth * 4), TextureWidth, WhiteWithZeroAlpha))
+            {
+                return true;
+            }
+
             // Left -> Right
             int32 NumLeftmostZerosToProcess = 0;
             const PixelDataType* FillColor = nullptr;
@@ -140,4 +150,10 @@ namespace FPNGHelpers
     };
 
     void FillZeroAlphaPNGData(int32 SizeX, int32 SizeY, ETextureSourceFormat SourceFormat, uint8* SourceData);
+
+    /**
+     * Decodes rows of 8 bit non-interlaced PNG one by one, keeps only pixels of the region shrunk by the scale
+     * and stops after the last row of the region. Returns false for images it can't decode this way
+     */
+    bool DecodeScaled(const uint8* Buffer, int32 Length, const FIntRect& Region, int32 Scale, FRuntimeImageData& OutImage);
 }
\ No newline at end of file
@@ -0,0 +1,845 @@
+// Copyright 2022 Peter Leontev. All Rights Reserved.
+
+#include "PixelKernels.h"
+
+#if PLATFORM_CPU_X86_FAMILY
+    #define PIXEL_KERNELS_X86 1
+    #define PIXEL_KERNELS_NEON 0
+#elif PLATFORM_CPU_ARM_FAMILY && PLATFORM_ENABLE_VECTORINTRINSICS_NEON
+    #define PIXEL_KERNELS_X86 0
+    #define PIXEL_KERNELS_NEON 1
+#else
+    #define PIXEL_KERNELS_X86 0
+    #define PIXEL_KERNELS_NEON 0
+#endif
+
+THIRD_PARTY_INCLUDES_START
+#if PIXEL_KERNELS_X86
+    #include <immintrin.h>
+    #if defined(_MSC_VER)
+        #include <intrin.h>
+    #else
+        #include <cpuid.h>
+    #endif
+#elif PIXEL_KERNELS_NEON
+    #include <arm_neon.h>
+#endif
+THIRD_PARTY_INCLUDES_END
+
+// clang and gcc let a function use only instructions it is compiled for, the module itself is built for SSE2
+#if PIXEL_KERNELS_X86 && (defined(__clang__) || defined(__GNUC__))
+    #define PIXEL_KERNELS_TARGET(InstructionSet) __attribute__((target(InstructionSet)))
+#else
+    #define PIXEL_KERNELS_TARGET(InstructionSet)
+#endif
+
+
+DEFINE_LOG_CATEGORY_STATIC(LogRuntimeImagePixelKernels, Log, All);
+
+namespace
+{
+    //
+    // Plain C++, also handles the tails SIMD kernels leave
+    //
+    void SwizzleRGBAToBGRA_Scalar(const uint8* Source, uint8* Dest, int64 NumPixels)
+    {
+        for (int64 Index = 0; Index < NumPixels; ++Index, Source += 4, Dest += 4)
+        {
+            const uint8 R = Source[0];
+            const uint8 G = Source[1];
+            const uint8 B = Source[2];
+            const uint8 A = Source[3];
+
+            Dest[0] = B;
+            Dest[1] = G;
+            Dest[2] = R;
+            Dest[3] = A;
+        }
+    }
+
+    template<bool bSwapRB>
+    void ExpandToBGRA_Scalar(const uint8* Source, uint8* Dest, int64 NumPixels)
+    {
+        for (int64 Index = 0; Index < NumPixels; ++Index, Source += 3, Dest += 4)
+        {
+            Dest[0] = Source[bSwapRB ? 2 : 0];
+            Dest[1] = Source[1];
+            Dest[2] = Source[bSwapRB ? 0 : 2];
+            Dest[3] = 255;
+        }
+    }
+
+    void ExpandGrayToBGRA_Scalar(const uint8* Source, uint8* Dest, int64 NumPixels)
+    {
+        for (int64 Index = 0; Index < NumPixels; ++Index, Dest += 4)
+        {
+            Dest[0] = Source[Index];
+            Dest[1] = Source[Index];
+            Dest[2] = Source[Index];
+            Dest[3] = 255;
+        }
+    }
+
+    void ExpandA1R5G5B5ToBGRA_Scalar(const uint16* Source, uint32* Dest, int64 NumPixels)
+    {
+        for (int64 Index = 0; Index < NumPixels; ++Index)
+        {
+            const uint32 FilePixel = Source[Index];
+
+            uint32 TexturePixel = (FilePixel & 0x001F) << 3;
+            TexturePixel |= (FilePixel & 0x03E0) << 6;
+            TexturePixel |= (FilePixel & 0x7C00) << 9;
+            TexturePixel |= (FilePixel & 0x8000) << 16;
+
+            Dest[Index] = TexturePixel;
+        }
+    }
+
+    bool ContainsPixel_Scalar(const uint32* Pixels, int64 NumPixels, uint32 Value)
+    {
+        for (int64 Index = 0; Index < NumPixels; ++Index)
+        {
+            if (Pixels[Index] == Value)
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void HalfToFloat_Scalar(const uint16* Source, float* Dest, int64 Num)
+    {
+        for (int64 Index = 0; Index < Num; ++Index)
+        {
+            FFloat16 Half;
+            Half.Encoded = Source[Index];
+            Dest[Index] = Half.GetFloat();
+        }
+    }
+
+    void FloatToHalf_Scalar(const float* Source, uint16* Dest, int64 Num)
+    {
+        for (int64 Index = 0; Index < Num; ++Index)
+        {
+            Dest[Index] = FFloat16(Source[Index]).Encoded;
+        }
+    }
+
+    int32 FindNearestColors_Scalar(const uint8* Pixels, int32 NumPixels, const uint8* Palette, int32 NumColors, uint32 ChannelMask, uint8* OutIndices)
+    {
+        int32 TotalError = 0;
+        for (int32 Index = 0; Index < NumPixels; ++Index)
+        {
+            const uint8* Pixel = Pixels + Index * 4;
+
+            int32 BestError = MAX_int32;
+            for (int32 ColorIndex = 0; ColorIndex < NumColors; ++ColorIndex)
+            {
+                const uint8* Color = Palette + ColorIndex * 4;
+
+                int32 Error = 0;
+                for (int32 Channel = 0; Channel < 4; ++Channel)
+                {
+                    if (ChannelMask & (1 << Channel))
+                    {
+                        const int32 Delta = (int32)Pixel[Channel] - Color[Channel];
+                        Error += Delta * Delta;
+                    }
+                }
+
+                if (Error < BestError)
+                {
+                    BestError = Error;
+                    OutIndices[Index] = (uint8)ColorIndex;
+                }
+            }
+
+            TotalError += BestError;
+        }
+
+        return TotalError;
+    }
+
+#if PIXEL_KERNELS_X86
+    //
+    // SSE2 is always there on x64, SSSE3 adds byte shuffles
+    //
+    __m128i ExpandA1R5G5B5_SSE2(__m128i Pixels)
+    {
+        const __m128i B = _mm_slli_epi32(_mm_and_si128(Pixels, _mm_set1_epi32(0x001F)), 3);
+        const __m128i G = _mm_slli_epi32(_mm_and_si128(Pixels, _mm_set1_epi32(0x03E0)), 6);
+        const __m128i R = _mm_slli_epi32(_mm_and_si128(Pixels, _mm_set1_epi32(0x7C00)), 9);
+        const __m128i A = _mm_slli_epi32(_mm_and_si128(Pixels, _mm_set1_epi32(0x8000)), 16);
+
+        return _mm_or_si128(_mm_or_si128(B, G), _mm_or_si128(R, A));
+    }
+
+    void ExpandA1R5G5B5ToBGRA_SSE2(const uint16* Source, uint32* Dest, int64 NumPixels)
+    {
+        const __m128i Zero = _mm_setzero_si128();
+
+        int64 Index = 0;
+        for (; Index + 8 <= NumPixels; Index += 8)
+        {
+            const __m128i FilePixels = _mm_loadu_si128((const __m128i*)(Source + Index));
+
+            _mm_storeu_si128((__m128i*)(Dest + Index), ExpandA1R5G5B5_SSE2(_mm_unpacklo_epi16(FilePixels, Zero)));
+            _mm_storeu_si128((__m128i*)(Dest + Index + 4), ExpandA1R5G5B5_SSE2(_mm_unpackhi_epi16(FilePixels, Zero)));
+        }
+
+        ExpandA1R5G5B5ToBGRA_Scalar(Source + Index, Dest + Index, NumPixels - Index);
+    }
+
+    bool ContainsPixel_SSE2(const uint32* Pixels, int64 NumPixels, uint32 Value)
+    {
+        const __m128i Needle = _mm_set1_epi32((int32)Value);
+
+        int64 Index = 0;
+        for (; Index + 4 <= NumPixels; Index += 4)
+        {
+            const __m128i Equal = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*)(Pixels + Index)), Needle);
+            if (_mm_movemask_epi8(Equal) != 0)
+            {
+                return true;
+            }
+        }
+
+        return ContainsPixel_Scalar(Pixels + Index, NumPixels - Index, Value);
+    }
+
+    PIXEL_KERNELS_TARGET("ssse3")
+    void SwizzleRGBAToBGRA_SSSE3(const uint8* Source, uint8* Dest, int64 NumPixels)
+    {
+        const __m128i Mask = _mm_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+
+        int64 Index = 0;
+        for (; Index + 4 <= NumPixels; Index += 4)
+        {
+            const __m128i Pixels = _mm_loadu_si128((const __m128i*)(Source + Index * 4));
+            _mm_storeu_si128((__m128i*)(Dest + Index * 4), _mm_shuffle_epi8(Pixels, Mask));
+        }
+
+        SwizzleRGBAToBGRA_Scalar(Source + Index * 4, Dest + Index * 4, NumPixels - Index);
+    }
+
+    template<bool bSwapRB>
+    PIXEL_KERNELS_TARGET("ssse3")
+    void ExpandToBGRA_SSSE3(const uint8* Source, uint8* Dest, int64 NumPixels)
+    {
+        const __m128i Mask = bSwapRB ?
+            _mm_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1) :
+            _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+        const __m128i Alpha = _mm_set1_epi32((int32)0xFF000000);
+
+        // 16 bytes are loaded for 4 pixels of 12 bytes, so the last pixels are left to the scalar loop
+        int64 Index = 0;
+        for (; Index * 3 + 16 <= NumPixels * 3; Index += 4)
+        {
+            const __m128i Pixels = _mm_loadu_si128((const __m128i*)(Source + Index * 3));
+            _mm_storeu_si128((__m128i*)(Dest + Index * 4), _mm_or_si128(_mm_shuffle_epi8(Pixels, Mask), Alpha));
+        }
+
+        ExpandToBGRA_Scalar<bSwapRB>(Source + Index * 3, Dest + Index * 4, NumPixels - Index);
+    }
+
+    PIXEL_KERNELS_TARGET("ssse3")
+    void ExpandGrayToBGRA_SSSE3(const uint8* Source, uint8* Dest, int64 NumPixels)
+    {
+        const __m128i Masks[4] =
+        {
+            _mm_setr_epi8(0, 0, 0, -1, 1, 1, 1, -1, 2, 2, 2, -1, 3, 3, 3, -1),
+            _mm_setr_epi8(4, 4, 4, -1, 5, 5, 5, -1, 6, 6, 6, -1, 7, 7, 7, -1),
+            _mm_setr_epi8(8, 8, 8, -1, 9, 9, 9, -1, 10, 10, 10, -1, 11, 11, 11, -1),
+            _mm_setr_epi8(12, 12, 12, -1, 13, 13, 13, -1, 14, 14, 14, -1, 15, 15, 15, -1)
+        };
+        const __m128i Alpha = _mm_set1_epi32((int32)0xFF000000);
+
+        int64 Index = 0;
+        for (; Index + 16 <= NumPixels; Index += 16)
+        {
+            const __m128i Pixels = _mm_loadu_si128((const __m128i*)(Source + Index));
+
+            for (int32 Part = 0; Part < 4; ++Part)
+            {
+                _mm_storeu_si128((__m128i*)(Dest + (Index + Part * 4) * 4), _mm_or_si128(_mm_shuffle_epi8(Pixels, Masks[Part]), Alpha));
+            }
+        }
+
+        ExpandGrayToBGRA_Scalar(Source + Index, Dest + Index * 4, NumPixels - Index);
+    }
+
+    int32 FindNearestColors_SSE2(const uint8* Pixels, int32 NumPixels, const uint8* Palette, int32 NumColors, uint32 ChannelMask, uint8* OutIndices)
+    {
+        const __m128i Zero = _mm_setzero_si128();
+
+        int16 ChannelWeights[8];
+        for (int32 Channel = 0; Channel < 8; ++Channel)
+        {
+            ChannelWeights[Channel] = (ChannelMask >> (Channel & 3)) & 1;
+        }
+        const __m128i Weights = _mm_loadu_si128((const __m128i*)ChannelWeights);
+
+        int32 TotalError = 0;
+        int32 Index = 0;
+        for (; Index + 4 <= NumPixels; Index += 4)
+        {
+            // channels are widened to 16 bits, two pixels per register
+            const __m128i Block = _mm_loadu_si128((const __m128i*)(Pixels + Index * 4));
+            const __m128i Pixels01 = _mm_unpacklo_epi8(Block, Zero);
+            const __m128i Pixels23 = _mm_unpackhi_epi8(Block, Zero);
+
+            __m128i BestError = _mm_set1_epi32(MAX_int32);
+            __m128i BestIndex = Zero;
+            for (int32 ColorIndex = 0; ColorIndex < NumColors; ++ColorIndex)
+            {
+                int32 ColorValue;
+                FMemory::Memcpy(&ColorValue, Palette + ColorIndex * 4, sizeof(ColorValue));
+                const __m128i Color = _mm_unpacklo_epi8(_mm_set1_epi32(ColorValue), Zero);
+
+                const __m128i Delta01 = _mm_sub_epi16(Pixels01, Color);
+                const __m128i Delta23 = _mm_sub_epi16(Pixels23, Color);
+
+                // RG and BA sums of both pixels, then added up per pixel
+                const __m128 Sums01 = _mm_castsi128_ps(_mm_madd_epi16(Delta01, _mm_mullo_epi16(Delta01, Weights)));
+                const __m128 Sums23 = _mm_castsi128_ps(_mm_madd_epi16(Delta23, _mm_mullo_epi16(Delta23, Weights)));
+                const __m128i Error = _mm_add_epi32(
+                    _mm_castps_si128(_mm_shuffle_ps(Sums01, Sums23, _MM_SHUFFLE(2, 0, 2, 0))),
+                    _mm_castps_si128(_mm_shuffle_ps(Sums01, Sums23, _MM_SHUFFLE(3, 1, 3, 1)))
+                );
+
+                const __m128i Better = _mm_cmplt_epi32(Error, BestError);
+                BestError = _mm_or_si128(_mm_and_si128(Better, Error), _mm_andnot_si128(Better, BestError));
+                BestIndex = _mm_or_si128(_mm_and_si128(Better, _mm_set1_epi32(ColorIndex)), _mm_andnot_si128(Better, BestIndex));
+            }
+
+            alignas(16) int32 Errors[4];
+            alignas(16) int32 Indices[4];
+            _mm_store_si128((__m128i*)Errors, BestError);
+            _mm_store_si128((__m128i*)Indices, BestIndex);
+
+            for (int32 Pixel = 0; Pixel < 4; ++Pixel)
+            {
+                OutIndices[Index + Pixel] = (uint8)Indices[Pixel];
+                TotalError += Errors[Pixel];
+            }
+        }
+
+        return TotalError + FindNearestColors_Scalar(Pixels + Index * 4, NumPixels - Index, Palette, NumColors, ChannelMask, OutIndices + Index);
+    }
+
+    //
+    // AVX2, shuffles stay within 128 bit lanes
+    //
+    PIXEL_KERNELS_TARGET("avx2")
+    void SwizzleRGBAToBGRA_AVX2(const uint8* Source, uint8* Dest, int64 NumPixels)
+    {
+        const __m256i Mask = _mm256_setr_epi8(
+            2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15,
+            2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15
+        );
+
+        int64 Index = 0;
+        for (; Index + 8 <= NumPixels; Index += 8)
+        {
+            const __m256i Pixels = _mm256_loadu_si256((const __m256i*)(Source + Index * 4));
+            _mm256_storeu_si256((__m256i*)(Dest + Index * 4), _mm256_shuffle_epi8(Pixels, Mask));
+        }
+
+        SwizzleRGBAToBGRA_Scalar(Source + Index * 4, Dest + Index * 4, NumPixels - Index);
+    }
+
+    template<bool bSwapRB>
+    PIXEL_KERNELS_TARGET("avx2")
+    void ExpandToBGRA_AVX2(const uint8* Source, uint8* Dest, int64 NumPixels)
+    {
+        const __m256i Mask = bSwapRB ?
+            _mm256_setr_epi8(
+                2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1,
+                2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1) :
+            _mm256_setr_epi8(
+                0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1,
+                0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+        const __m256i Alpha = _mm256_set1_epi32((int32)0xFF000000);
+        // first 12 bytes go to low lane, next 12 bytes to high lane
+        const __m256i LaneSplit = _mm256_setr_epi32(0, 1, 2, 0, 3, 4, 5, 0);
+
+        // 32 bytes are loaded for 8 pixels of 24 bytes
+        int64 Index = 0;
+        for (; Index * 3 + 32 <= NumPixels * 3; Index += 8)
+        {
+            const __m256i Pixels = _mm256_permutevar8x32_epi32(_mm256_loadu_si256((const __m256i*)(Source + Index * 3)), LaneSplit);
+            _mm256_storeu_si256((__m256i*)(Dest + Index * 4), _mm256_or_si256(_mm256_shuffle_epi8(Pixels, Mask), Alpha));
+        }
+
+        ExpandToBGRA_Scalar<bSwapRB>(Source + Index * 3, Dest + Index * 4, NumPixels - Index);
+    }
+
+    PIXEL_KERNELS_TARGET("avx2")
+    void ExpandGrayToBGRA_AVX2(const uint8* Source, uint8* Dest, int64 NumPixels)
+    {
+        const __m256i Replicate = _mm256_set1_epi32(0x00010101);
+        const __m256i Alpha = _mm256_set1_epi32((int32)0xFF000000);
+
+        int64 Index = 0;
+        for (; Index + 8 <= NumPixels; Index += 8)
+        {
+            // every byte goes to its own dword and is copied to B, G and R
+            const __m256i Values = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(Source + Index)));
+            _mm256_storeu_si256((__m256i*)(Dest + Index * 4), _mm256_or_si256(_mm256_mullo_epi32(Values, Replicate), Alpha));
+        }
+
+        ExpandGrayToBGRA_Scalar(Source + Index, Dest + Index * 4, NumPixels - Index);
+    }
+
+    PIXEL_KERNELS_TARGET("avx2")
+    void ExpandA1R5G5B5ToBGRA_AVX2(const uint16* Source, uint32* Dest, int64 NumPixels)
+    {
+        const __m256i BMask = _mm256_set1_epi32(0x001F);
+        const __m256i GMask = _mm256_set1_epi32(0x03E0);
+        const __m256i RMask = _mm256_set1_epi32(0x7C00);
+        const __m256i AMask = _mm256_set1_epi32(0x8000);
+
+        int64 Index = 0;
+        for (; Index + 8 <= NumPixels; Index += 8)
+        {
+            const __m256i Pixels = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)(Source + Index)));
+
+            const __m256i B = _mm256_slli_epi32(_mm256_and_si256(Pixels, BMask), 3);
+            const __m256i G = _mm256_slli_epi32(_mm256_and_si256(Pixels, GMask), 6);
+            const __m256i R = _mm256_slli_epi32(_mm256_and_si256(Pixels, RMask), 9);
+            const __m256i A = _mm256_slli_epi32(_mm256_and_si256(Pixels, AMask), 16);
+
+            _mm256_storeu_si256((__m256i*)(Dest + Index), _mm256_or_si256(_mm256_or_si256(B, G), _mm256_or_si256(R, A)));
+        }
+
+        ExpandA1R5G5B5ToBGRA_Scalar(Source + Index, Dest + Index, NumPixels - Index);
+    }
+
+    PIXEL_KERNELS_TARGET("avx2")
+    bool ContainsPixel_AVX2(const uint32* Pixels, int64 NumPixels, uint32 Value)
+    {
+        const __m256i Needle = _mm256_set1_epi32((int32)Value);
+
+        int64 Index = 0;
+        for (; Index + 8 <= NumPixels; Index += 8)
+        {
+            const __m256i Equal = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i*)(Pixels + Index)), Needle);
+            if (_mm256_movemask_epi8(Equal) != 0)
+            {
+                return true;
+            }
+        }
+
+        return ContainsPixel_Scalar(Pixels + Index, NumPixels - Index, Value);
+    }
+
+    //
+    // F16C converts 8 halfs at once, it comes with AVX
+    //
+    PIXEL_KERNELS_TARGET("avx,f16c")
+    void HalfToFloat_F16C(const uint16* Source, float* Dest, int64 Num)
+    {
+        int64 Index = 0;
+        for (; Index + 8 <= Num; Index += 8)
+        {
+            _mm256_storeu_ps(Dest + Index, _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)(Source + Index))));
+        }
+
+        HalfToFloat_Scalar(Source + Index, Dest + Index, Num - Index);
+    }
+
+    PIXEL_KERNELS_TARGET("avx,f16c")
+    void FloatToHalf_F16C(const float* Source, uint16* Dest, int64 Num)
+    {
+        int64 Index = 0;
+        for (; Index + 8 <= Num; Index += 8)
+        {
+            _mm_storeu_si128((__m128i*)(Dest + Index), _mm256_cvtps_ph(_mm256_loadu_ps(Source + Index), _MM_FROUND_TO_NEAREST_INT));
+        }
+
+        FloatToHalf_Scalar(Source + Index, Dest + Index, Num - Index);
+    }
+
+    struct FCpuFeatures
+    {
+        bool bSSSE3 = false;
+        bool bAVX2 = false;
+        bool bF16C = false;
+    };
+
+    void Cpuid(int32 OutInfo[4], int32 Leaf, int32 SubLeaf)
+    {
+#if defined(_MSC_VER)
+        __cpuidex(OutInfo, Leaf, SubLeaf);
+#else
+        __cpuid_count(Leaf, SubLeaf, OutInfo[0], OutInfo[1], OutInfo[2], OutInfo[3]);
+#endif
+    }
+
+    uint64 ReadXCR0()
+    {
+#if defined(_MSC_VER)
+        return _xgetbv(0);
+#else
+        uint32 Low = 0;
+        uint32 High = 0;
+        __asm__ volatile("xgetbv" : "=a"(Low), "=d"(High) : "c"(0));
+        return ((uint64)High << 32) | Low;
+#endif
+    }
+
+    FCpuFeatures DetectCpuFeatures()
+    {
+        FCpuFeatures Features;
+
+        int32 Info[4] = {};
+        Cpuid(Info, 0, 0);
+        const int32 MaxLeaf = Info[0];
+
+        if (MaxLeaf < 1)
+        {
+            return Features;
+        }
+
+        Cpuid(Info, 1, 0);
+        Features.bSSSE3 = (Info[2] & (1 << 9)) != 0;
+
+        // AVX registers must also be saved by OS on context switches
+        const bool bOSXSAVE = (Info[2] & (1 << 27)) != 0;
+        const bool bAVX = (Info[2] & (1 << 28)) != 0;
+
+        const bool bOSSavesAVX = bOSXSAVE && bAVX && (ReadXCR0() & 0x6) == 0x6;
+        Features.bF16C = bOSSavesAVX && (Info[2] & (1 << 29)) != 0;
+
+        if (MaxLeaf >= 7 && bOSSavesAVX)
+        {
+            Cpuid(Info, 7, 0);
+            Features.bAVX2 = (Info[1] & (1 << 5)) != 0;
+        }
+
+        return Features;
+    }
+#endif // PIXEL_KERNELS_X86
+
+#if PIXEL_KERNELS_NEON
+    //
+    // NEON is always there on ARM platforms UE supports, de-interleaving loads do the shuffles
+    //
+    void SwizzleRGBAToBGRA_NEON(const uint8* Source, uint8* Dest, int64 NumPixels)
+    {
+        int64 Index = 0;
+        for (; Index + 16 <= NumPixels; Index += 16)
+        {
+            uint8x16x4_t Pixels = vld4q_u8(Source + Index * 4);
+
+            const uint8x16_t R = Pixels.val[0];
+            Pixels.val[0] = Pixels.val[2];
+            Pixels.val[2] = R;
+
+            vst4q_u8(Dest + Index * 4, Pixels);
+        }
+
+        SwizzleRGBAToBGRA_Scalar(Source + Index * 4, Dest + Index * 4, NumPixels - Index);
+    }
+
+    template<bool bSwapRB>
+    void ExpandToBGRA_NEON(const uint8* Source, uint8* Dest, int64 NumPixels)
+    {
+        int64 Index = 0;
+        for (; Index + 16 <= NumPixels; Index += 16)
+        {
+            const uint8x16x3_t Pixels = vld3q_u8(Source + Index * 3);
+
+            uint8x16x4_t ExpandedPixels;
+            ExpandedPixels.val[0] = Pixels.val[bSwapRB ? 2 : 0];
+            ExpandedPixels.val[1] = Pixels.val[1];
+            ExpandedPixels.val[2] = Pixels.val[bSwapRB ? 0 : 2];
+            ExpandedPixels.val[3] = vdupq_n_u8(255);
+
+            vst4q_u8(Dest + Index * 4, ExpandedPixels);
+        }
+
+        ExpandToBGRA_Scalar<bSwapRB>(Source + Index * 3, Dest + Index * 4, NumPixels - Index);
+    }
+
+    void ExpandGrayToBGRA_NEON(const uint8* Source, uint8* Dest, int64 NumPixels)
+    {
+        int64 Index = 0;
+        for (; Index + 16 <= NumPixels; Index += 16)
+        {
+            const uint8x16_t Values = vld1q_u8(Source + Index);
+
+            uint8x16x4_t ExpandedPixels;
+            ExpandedPixels.val[0] = Values;
+            ExpandedPixels.val[1] = Values;
+            ExpandedPixels.val[2] = Values;
+            ExpandedPixels.val[3] = vdupq_n_u8(255);
+
+            vst4q_u8(Dest + Index * 4, ExpandedPixels);
+        }
+
+        ExpandGrayToBGRA_Scalar(Source + Index, Dest + Index * 4, NumPixels - Index);
+    }
+
+    uint32x4_t ExpandA1R5G5B5_NEON(uint32x4_t Pixels)
+    {
+        const uint32x4_t B = vshlq_n_u32(vandq_u32(Pixels, vdupq_n_u32(0x001F)), 3);
+        const uint32x4_t G = vshlq_n_u32(vandq_u32(Pixels, vdupq_n_u32(0x03E0)), 6);
+        const uint32x4_t R = vshlq_n_u32(vandq_u32(Pixels, vdupq_n_u32(0x7C00)), 9);
+        const uint32x4_t A = vshlq_n_u32(vandq_u32(Pixels, vdupq_n_u32(0x8000)), 16);
+
+        return vorrq_u32(vorrq_u32(B, G), vorrq_u32(R, A));
+    }
+
+    void ExpandA1R5G5B5ToBGRA_NEON(const uint16* Source, uint32* Dest, int64 NumPixels)
+    {
+        int64 Index = 0;
+        for (; Index + 8 <= NumPixels; Index += 8)
+        {
+            const uint16x8_t FilePixels = vld1q_u16(Source + Index);
+
+            vst1q_u32(Dest + Index, ExpandA1R5G5B5_NEON(vmovl_u16(vget_low_u16(FilePixels))));
+            vst1q_u32(Dest + Index + 4, ExpandA1R5G5B5_NEON(vmovl_u16(vget_high_u16(FilePixels))));
+        }
+
+        ExpandA1R5G5B5ToBGRA_Scalar(Source + Index, Dest + Index, NumPixels - Index);
+    }
+
+    bool ContainsPixel_NEON(const uint32* Pixels, int64 NumPixels, uint32 Value)
+    {
+        const uint32x4_t Needle = vdupq_n_u32(Value);
+
+        int64 Index = 0;
+        for (; Index + 4 <= NumPixels; Index += 4)
+        {
+            const uint32x4_t Equal = vceqq_u32(vld1q_u32(Pixels + Index), Needle);
+            const uint32x2_t AnyEqual = vorr_u32(vget_low_u32(Equal), vget_high_u32(Equal));
+            if ((vget_lane_u32(AnyEqual, 0) | vget_lane_u32(AnyEqual, 1)) != 0)
+            {
+                return true;
+            }
+        }
+
+        return ContainsPixel_Scalar(Pixels + Index, NumPixels - Index, Value);
+    }
+
+    int32 FindNearestColors_NEON(const uint8* Pixels, int32 NumPixels, const uint8* Palette, int32 NumColors, uint32 ChannelMask, uint8* OutIndices)
+    {
+        int16 ChannelWeights[8];
+        for (int32 Channel = 0; Channel < 8; ++Channel)
+        {
+            ChannelWeights[Channel] = (ChannelMask >> (Channel & 3)) & 1;
+        }
+        const int16x8_t Weights = vld1q_s16(ChannelWeights);
+
+        int32 TotalError = 0;
+        int32 Index = 0;
+        for (; Index + 4 <= NumPixels; Index += 4)
+        {
+            // channels are widened to 16 bits, two pixels per register
+            const uint8x16_t Block = vld1q_u8(Pixels + Index * 4);
+            const int16x8_t Pixels01 = vreinterpretq_s16_u16(vmovl_u8(vget_low_u8(Block)));
+            const int16x8_t Pixels23 = vreinterpretq_s16_u16(vmovl_u8(vget_high_u8(Block)));
+
+            int32x4_t BestError = vdupq_n_s32(MAX_int32);
+            int32x4_t BestIndex = vdupq_n_s32(0);
+            for (int32 ColorIndex = 0; ColorIndex < NumColors; ++ColorIndex)
+            {
+                uint32 ColorValue;
+                FMemory::Memcpy(&ColorValue, Palette + ColorIndex * 4, sizeof(ColorValue));
+                const int16x8_t Color = vreinterpretq_s16_u16(vmovl_u8(vreinterpret_u8_u32(vdup_n_u32(ColorValue))));
+
+                const int16x8_t Delta01 = vsubq_s16(Pixels01, Color);
+                const int16x8_t Delta23 = vsubq_s16(Pixels23, Color);
+                const int16x8_t Weighted01 = vmulq_s16(Delta01, Weights);
+                const int16x8_t Weighted23 = vmulq_s16(Delta23, Weights);
+
+                // squared channels of every pixel are added up pairwise
+                const int32x4_t Squares0 = vmull_s16(vget_low_s16(Delta01), vget_low_s16(Weighted01));
+                const int32x4_t Squares1 = vmull_s16(vget_high_s16(Delta01), vget_high_s16(Weighted01));
+                const int32x4_t Squares2 = vmull_s16(vget_low_s16(Delta23), vget_low_s16(Weighted23));
+                const int32x4_t Squares3 = vmull_s16(vget_high_s16(Delta23), vget_high_s16(Weighted23));
+
+                const int32x2_t Error01 = vpadd_s32(
+                    vpadd_s32(vget_low_s32(Squares0), vget_high_s32(Squares0)),
+                    vpadd_s32(vget_low_s32(Squares1), vget_high_s32(Squares1))
+                );
+                const int32x2_t Error23 = vpadd_s32(
+                    vpadd_s32(vget_low_s32(Squares2), vget_high_s32(Squares2)),
+                    vpadd_s32(vget_low_s32(Squares3), vget_high_s32(Squares3))
+                );
+                const int32x4_t Error = vcombine_s32(Error01, Error23);
+
+                const uint32x4_t Better = vcltq_s32(Error, BestError);
+                BestError = vbslq_s32(Better, Error, BestError);
+                BestIndex = vbslq_s32(Better, vdupq_n_s32(ColorIndex), BestIndex);
+            }
+
+            int32 Errors[4];
+            int32 Indices[4];
+            vst1q_s32(Errors, BestError);
+            vst1q_s32(Indices, BestIndex);
+
+            for (int32 Pixel = 0; Pixel < 4; ++Pixel)
+            {
+                OutIndices[Index + Pixel] = (uint8)Indices[Pixel];
+                TotalError += Errors[Pixel];
+            }
+        }
+
+        return TotalError + FindNearestColors_Scalar(Pixels + Index * 4, NumPixels - Index, Palette, NumColors, ChannelMask, OutIndices + Index);
+    }
+
+#if PLATFORM_64BITS
+    // half precision conversions are part of AArch64, optional on 32 bit ARM
+    void HalfToFloat_NEON(const uint16* Source, float* Dest, int64 Num)
+    {
+        int64 Index = 0;
+        for (; Index + 4 <= Num; Index += 4)
+        {
+            vst1q_f32(Dest + Index, vcvt_f32_f16(vreinterpret_f16_u16(vld1_u16(Source + Index))));
+        }
+
+        HalfToFloat_Scalar(Source + Index, Dest + Index, Num - Index);
+    }
+
+    void FloatToHalf_NEON(const float* Source, uint16* Dest, int64 Num)
+    {
+        int64 Index = 0;
+        for (; Index + 4 <= Num; Index += 4)
+        {
+            vst1_u16(Dest + Index, vreinterpret_u16_f16(vcvt_f16_f32(vld1q_f32(Source + Index))));
+        }
+
+        FloatToHalf_Scalar(Source + Index, Dest + Index, Num - Index);
+    }
+#endif // PLATFORM_64BITS
+#endif // PIXEL_KERNELS_NEON
+
+    struct FPixelKernelTable
+    {
+        void (*SwizzleRGBAToBGRA)(const uint8*, uint8*, int64) = &SwizzleRGBAToBGRA_Scalar;
+        void (*ExpandRGBToBGRA)(const uint8*, uint8*, int64) = &ExpandToBGRA_Scalar<true>;
+        void (*ExpandBGRToBGRA)(const uint8*, uint8*, int64) = &ExpandToBGRA_Scalar<false>;
+        void (*ExpandGrayToBGRA)(const uint8*, uint8*, int64) = &ExpandGrayToBGRA_Scalar;
+        void (*ExpandA1R5G5B5ToBGRA)(const uint16*, uint32*, int64) = &ExpandA1R5G5B5ToBGRA_Scalar;
+        bool (*ContainsPixel)(const uint32*, int64, uint32) = &ContainsPixel_Scalar;
+        void (*HalfToFloat)(const uint16*, float*, int64) = &HalfToFloat_Scalar;
+        void (*FloatToHalf)(const float*, uint16*, int64) = &FloatToHalf_Scalar;
+        int32 (*FindNearestColors)(const uint8*, int32, const uint8*, int32, uint32, uint8*) = &FindNearestColors_Scalar;
+    };
+
+    FPixelKernelTable SelectKernels()
+    {
+        FPixelKernelTable Kernels;
+        const TCHAR* InstructionSet = TEXT("C++");
+
+#if PIXEL_KERNELS_X86
+        const FCpuFeatures Features = DetectCpuFeatures();
+
+        InstructionSet = TEXT("SSE2");
+        Kernels.ExpandA1R5G5B5ToBGRA = &ExpandA1R5G5B5ToBGRA_SSE2;
+        Kernels.ContainsPixel = &ContainsPixel_SSE2;
+        Kernels.FindNearestColors = &FindNearestColors_SSE2;
+
+        if (Features.bSSSE3)
+        {
+            InstructionSet = TEXT("SSSE3");
+            Kernels.SwizzleRGBAToBGRA = &SwizzleRGBAToBGRA_SSSE3;
+            Kernels.ExpandRGBToBGRA = &ExpandToBGRA_SSSE3<true>;
+            Kernels.ExpandBGRToBGRA = &ExpandToBGRA_SSSE3<false>;
+            Kernels.ExpandGrayToBGRA = &ExpandGrayToBGRA_SSSE3;
+        }
+
+        if (Features.bAVX2)
+        {
+            InstructionSet = TEXT("AVX2");
+            Kernels.SwizzleRGBAToBGRA = &SwizzleRGBAToBGRA_AVX2;
+            Kernels.ExpandRGBToBGRA = &ExpandToBGRA_AVX2<true>;
+            Kernels.ExpandBGRToBGRA = &ExpandToBGRA_AVX2<false>;
+            Kernels.ExpandGrayToBGRA = &ExpandGrayToBGRA_AVX2;
+            Kernels.ExpandA1R5G5B5ToBGRA = &ExpandA1R5G5B5ToBGRA_AVX2;
+            Kernels.ContainsPixel = &ContainsPixel_AVX2;
+        }
+
+        if (Features.bF16C)
+        {
+            Kernels.HalfToFloat = &HalfToFloat_F16C;
+            Kernels.FloatToHalf = &FloatToHalf_F16C;
+        }
+#elif PIXEL_KERNELS_NEON
+        InstructionSet = TEXT("NEON");
+        Kernels.SwizzleRGBAToBGRA = &SwizzleRGBAToBGRA_NEON;
+        Kernels.ExpandRGBToBGRA = &ExpandToBGRA_NEON<true>;
+        Kernels.ExpandBGRToBGRA = &ExpandToBGRA_NEON<false>;
+        Kernels.ExpandGrayToBGRA = &ExpandGrayToBGRA_NEON;
+        Kernels.ExpandA1R5G5B5ToBGRA = &ExpandA1R5G5B5ToBGRA_NEON;
+        Kernels.ContainsPixel = &ContainsPixel_NEON;
+        Kernels.FindNearestColors = &FindNearestColors_NEON;
+#if PLATFORM_64BITS
+        Kernels.HalfToFloat = &HalfToFloat_NEON;
+        Kernels.FloatToHalf = &FloatToHalf_NEON;
+#endif // PLATFORM_64BITS
+#endif
+
+        UE_LOG(LogRuntimeImagePixelKernels, Log, TEXT("Pixel conversions use %s"), InstructionSet);
+
+        return Kernels;
+    }
+
+    const FPixelKernelTable& GetKernels()
+    {
+        // picked once, first decoding threads race for it safely
+        static const FPixelKernelTable Kernels = SelectKernels();
+        return Kernels;
+    }
+}
+
+namespace FPixelKernels
+{
+    void SwizzleRGBAToBGRA(const uint8* Source, uint8* Dest, int64 NumPixels)
+    {
+        GetKernels().SwizzleRGBAToBGRA(Source, Dest, NumPixels);
+    }
+
+    void ExpandRGBToBGRA(const uint8* Source, uint8* Dest, int64 NumPixels)
+    {
+        GetKernels().ExpandRGBToBGRA(Source, Dest, NumPixels);
+    }
+
+    void ExpandBGRToBGRA(const uint8* Source, uint8* Dest, int64 NumPixels)
+    {
+        GetKernels().ExpandBGRToBGRA(Source, Dest, NumPixels);
+    }
+
+    void ExpandGrayToBGRA(const uint8* Source, uint8* Dest, int64 NumPixels)
+    {
+        GetKernels().ExpandGrayToBGRA(Source, Dest, NumPixels);
+    }
+
+    void ExpandA1R5G5B5ToBGRA(const uint16* Source, uint32* Dest, int64 NumPixels)
+    {
+        GetKernels().ExpandA1R5G5B5ToBGRA(Source, Dest, NumPixels);
+    }
+
+    bool ContainsPixel(const uint32* Pixels, int64 NumPixels, uint32 Value)
+    {
+        return GetKernels().ContainsPixel(Pixels, NumPixels, Value);
+    }
+
+    void HalfToFloat(const uint16* Source, float* Dest, int64 Num)
+    {
+        GetKernels().HalfToFloat(Source, Dest, Num);
+    }
+
+    void FloatToHalf(const float* Source, uint16* Dest, int64 Num)
+    {
+        GetKernels().FloatToHalf(Source, Dest, Num);
+    }
+
+    int32 FindNearestColors(const uint8* Pixels, int32 NumPixels, const uint8* Palette, int32 NumColors, uint32 ChannelMask, uint8* OutIndices)
+    {
+        return GetKernels().FindNearestColors(Pixels, NumPixels, Palette, NumColors, ChannelMask, OutIndices);
+    }
+}
@@ -0,0 +1,43 @@
+// Copyright 2022 Peter Leontev. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+
+/**
+ * Per pixel loops shared by decoders and block encoders. Instruction set is picked once at runtime from what CPU supports:
+ * AVX2 or SSSE3 on x86, NEON on ARM, plain C++ elsewhere
+ */
+namespace FPixelKernels
+{
+    /** RGBA8 -> BGRA8, source and destination can be the same buffer */
+    void SwizzleRGBAToBGRA(const uint8* Source, uint8* Dest, int64 NumPixels);
+
+    /** RGB8 -> BGRA8 with opaque alpha, buffers must not overlap */
+    void ExpandRGBToBGRA(const uint8* Source, uint8* Dest, int64 NumPixels);
+
+    /** BGR8 -> BGRA8 with opaque alpha, buffers must not overlap */
+    void ExpandBGRToBGRA(const uint8* Source, uint8* Dest, int64 NumPixels);
+
+    /** G8 -> BGRA8 with opaque alpha, buffers must not overlap */
+    void ExpandGrayToBGRA(const uint8* Source, uint8* Dest, int64 NumPixels);
+
+    /** TGA A1R5G5B5 -> BGRA8, alpha bit is kept as the top bit of alpha */
+    void ExpandA1R5G5B5ToBGRA(const uint16* Source, uint32* Dest, int64 NumPixels);
+
+    /** True if any pixel equals the value */
+    bool ContainsPixel(const uint32* Pixels, int64 NumPixels, uint32 Value);
+
+    /** Half floats -> floats, Num counts values rather than pixels. F16C on x86, NEON on 64 bit ARM */
+    void HalfToFloat(const uint16* Source, float* Dest, int64 Num);
+
+    /** Floats -> half floats rounded to nearest, buffers must not overlap */
+    void FloatToHalf(const float* Source, uint16* Dest, int64 Num);
+
+    /**
+     * Selector search of block encoders: picks the palette color nearest to every RGBA8 pixel by squared error over the channels
+     * of ChannelMask, bit 0 is R. First color wins ties. Returns the sum of errors of picked colors
+     */
+    int32 FindNearestColors(const uint8* Pixels, int32 NumPixels, const uint8* Palette, int32 NumColors, uint32 ChannelMask, uint8* OutIndices);
+}
@@ -1,14 +1,14 @@
 // Copyright Peter Leontev
 
 #include "QOIHelpers.h"
+#include "ScaledDecodeHelpers.h"
+#include "PixelKernels.h"
 
 #define QOI_IMPLEMENTATION 1
 PRAGMA_DISABLE_DEPRECATION_WARNINGS
 #include "qoi.h"
 PRAGMA_ENABLE_DEPRECATION_WARNINGS
 
-PRAGMA_DISABLE_OPTIMIZATION
-
 bool FQOILoader::IsValidImage(const uint8* Buffer, uint32 Length) const
 {
     if (Buffer == nullptr || 
@@ -61,26 +61,129 @@ bool FQOILoader::Load(const uint8* Buffer, uint32 Length)
     bSRGB = (ImageDescr.colorspace == QOI_SRGB);
 
     // reserver enough memory for BGRA8 
-    RawData.SetNumUninitialized(Width * Height * 4);
+    RawData.SetNumUninitialized((int64)Width * Height * 4);
 
-    bool bSourceHasAlpha = static_cast<uint8>(ImageDescr.channels) == 4;
+    if (ImageDescr.channels == 4)
+    {
+        FPixelKernels::SwizzleRGBAToBGRA(DecodedPixels, RawData.GetData(), (int64)Width * Height);
+    }
+    else
+    {
+        FPixelKernels::ExpandRGBToBGRA(DecodedPixels, RawData.GetData(), (int64)Width * Height);
+    }
 
-    const int32 PixelsLen = Width * Height * ImageDescr.channels;
-    const uint32 Step = ImageDescr.channels;
-    int32 RawDataIndex = 0;
+    QOI_FREE(DecodedPixels);
 
-    // convert RGBA to BGRA
-    for (int32 Index = 0; Index < PixelsLen; Index += Step)
+    return true;
+}
+
+bool FQOILoader::LoadScaled(const uint8* Buffer, uint32 Length, const FIntRect& Region, int32 Scale)
+{
+    if (!IsValidImage(Buffer, Length))
     {
-        RawData[RawDataIndex]     = DecodedPixels[Index + 2];
-        RawData[RawDataIndex + 1] = DecodedPixels[Index + 1];
-        RawData[RawDataIndex + 2] = DecodedPixels[Index];
-        RawData[RawDataIndex + 3] = (bSourceHasAlpha) ? DecodedPixels[Index + 3] : 255;
-        
-        RawDataIndex += 4;
+        ErrorMessage = TEXT("Can't decode input QOI image! Make sure the image is valid!");
+        return false;
     }
 
-    QOI_FREE(DecodedPixels);
+    const unsigned char* bytes = (const unsigned char*)Buffer;
+    int p = 4;
+
+    const int32 SourceWidth = qoi_read_32(bytes, &p);
+    const int32 SourceHeight = qoi_read_32(bytes, &p);
+    const bool bSourceHasAlpha = bytes[p++] == 4;
+    const bool bSourceSRGB = bytes[p++] == QOI_SRGB;
+
+    if (Region.Max.X > SourceWidth || Region.Max.Y > SourceHeight)
+    {
+        ErrorMessage = TEXT("Region is outside of QOI image");
+        return false;
+    }
+
+    FScaledDecodeHelpers::FRowDownscaler Downscaler(Region, Scale, 4);
+
+    TArray<uint8> Row;
+    Row.SetNumUninitialized(SourceWidth * 4);
+
+    qoi_rgba_t index[64];
+    QOI_ZEROARR(index);
+
+    qoi_rgba_t px;
+    px.rgba.r = 0;
+    px.rgba.g = 0;
+    px.rgba.b = 0;
+    px.rgba.a = 255;
+
+    const int chunks_len = Length - (int)sizeof(qoi_padding);
+    int run = 0;
+
+    // same decoding loop as qoi_decode, pixels are written as BGRA row by row
+    for (int32 Y = 0; Y < Region.Max.Y; ++Y)
+    {
+        uint8* Pixel = Row.GetData();
+
+        for (int32 X = 0; X < SourceWidth; ++X, Pixel += 4)
+        {
+            if (run > 0)
+            {
+                run--;
+            }
+            else if (p < chunks_len)
+            {
+                int b1 = bytes[p++];
+
+                if (b1 == QOI_OP_RGB)
+                {
+                    px.rgba.r = bytes[p++];
+                    px.rgba.g = bytes[p++];
+                    px.rgba.b = bytes[p++];
+                }
+                else if (b1 == QOI_OP_RGBA)
+                {
+                    px.rgba.r = bytes[p++];
+                    px.rgba.g = bytes[p++];
+                    px.rgba.b = bytes[p++];
+                    px.rgba.a = bytes[p++];
+                }
+                else if ((b1 & QOI_MASK_2) == QOI_OP_INDEX)
+                {
+                    px = index[b1];
+                }
+                else if ((b1 & QOI_MASK_2) == QOI_OP_DIFF)
+                {
+                    px.rgba.r += ((b1 >> 4) & 0x03) - 2;
+                    px.rgba.g += ((b1 >> 2) & 0x03) - 2;
+                    px.rgba.b += ( b1       & 0x03) - 2;
+                }
+                else if ((b1 & QOI_MASK_2) == QOI_OP_LUMA)
+                {
+                    int b2 = bytes[p++];
+                    int vg = (b1 & 0x3f) - 32;
+                    px.rgba.r += vg - 8 + ((b2 >> 4) & 0x0f);
+                    px.rgba.g += vg;
+                    px.rgba.b += vg - 8 +  (b2       & 0x0f);
+                }
+                else if ((b1 & QOI_MASK_2) == QOI_OP_RUN)
+                {
+                    run = (b1 & 0x3f);
+                }
+
+                index[QOI_COLOR_HASH(px) % 64] = px;
+            }
+
+            Pixel[0] = px.rgba.b;
+            Pixel[1] = px.rgba.g;
+            Pixel[2] = px.rgba.r;
+            Pixel[3] = bSourceHasAlpha ? px.rgba.a : 255;
+        }
+
+        Downscaler.AddRow(Y, Row.GetData());
+    }
+
+    Width = Downscaler.GetSizeX();
+    Height = Downscaler.GetSizeY();
+    TextureSourceFormat = TSF_BGRA8;
+    bSRGB = bSourceSRGB;
+    RawData = MoveTemp(Downscaler.Pixels);
 
     return true;
 }
@@ -89,5 +192,3 @@ FString FQOILoader::GetLastError()
 {
     return ErrorMessage;
 }
-
-PRAGMA_ENABLE_OPTIMIZATION
\ No newline at end of file
@@ -4,17 +4,21 @@
 #include "CoreMinimal.h"
 #include "Engine/Texture.h"
 
+#include "RuntimeImageData.h"
+
 class FQOILoader
 {
 public:
     bool IsValidImage(const uint8* Buffer, uint32 Length) const;
     bool Load(const uint8* Buffer, uint32 Length);
+    /** Decodes pixels up to the last row of the region only and box filters them by the scale on the fly */
+    bool LoadScaled(const uint8* Buffer, uint32 Length, const FIntRect& Region, int32 Scale);
 
     FString GetLastError();
 
 public:
     // Resulting image data and properties
-    TArray<uint8> RawData;
+    FRuntimeImageRawData RawData;
     int32 Width;
     int32 Height;
     ETextureSourceFormat TextureSourceFormat = TSF_Invalid;
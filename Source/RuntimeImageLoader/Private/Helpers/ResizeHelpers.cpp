@@ -0,0 +1,410 @@
+// Copyright 2022 Peter Leontev. All Rights Reserved.
+
+#include "ResizeHelpers.h"
+#include "Async/ParallelFor.h"
+
+#include "PixelKernels.h"
+#include "ScratchHelpers.h"
+
+
+namespace
+{
+    // destination rows filtered by one task
+    const int32 ResizeTileSizeY = 32;
+
+    int32 GetBytesPerPixel(ERawImageFormat::Type Format)
+    {
+        switch (Format)
+        {
+            case ERawImageFormat::G8:       return 1;
+            case ERawImageFormat::G16:      return 2;
+            case ERawImageFormat::BGRA8:    return 4;
+            case ERawImageFormat::RGBA16:   return 8;
+            case ERawImageFormat::RGBA16F:  return 8;
+            default:                        return 0;
+        }
+    }
+
+    float SRGBToLinear(float Value)
+    {
+        return (Value <= 0.04045f) ? Value / 12.92f : FMath::Pow((Value + 0.055f) / 1.055f, 2.4f);
+    }
+
+    float LinearToSRGB(float Value)
+    {
+        return (Value <= 0.0031308f) ? Value * 12.92f : 1.055f * FMath::Pow(Value, 1.0f / 2.4f) - 0.055f;
+    }
+
+    /** 8 bit sRGB values of linear values quantized to 12 bits, fine enough for the darkest shades */
+    struct FLinearToSRGBTable
+    {
+        static const int32 NumEntries = 4096;
+
+        FLinearToSRGBTable()
+        {
+            for (int32 Index = 0; Index <= NumEntries; ++Index)
+            {
+                Values[Index] = (uint8)FMath::Clamp(FMath::RoundToInt(LinearToSRGB((float)Index / NumEntries) * 255.0f), 0, 255);
+            }
+        }
+
+        uint8 Get(float Value) const
+        {
+            return Values[FMath::Clamp(FMath::RoundToInt(Value * NumEntries), 0, NumEntries)];
+        }
+
+        uint8 Values[NumEntries + 1];
+    };
+
+    const FLinearToSRGBTable& GetLinearToSRGBTable()
+    {
+        static const FLinearToSRGBTable Table;
+        return Table;
+    }
+
+    uint8 QuantizeUNorm8(float Value)
+    {
+        return (uint8)FMath::Clamp(FMath::RoundToInt(Value * 255.0f), 0, 255);
+    }
+
+    uint16 QuantizeUNorm16(float Value)
+    {
+        return (uint16)FMath::Clamp(FMath::RoundToInt(Value * 65535.0f), 0, 65535);
+    }
+
+    float EvaluateFilter(ERuntimeImageResizeFilter Filter, float X)
+    {
+        switch (Filter)
+        {
+            case ERuntimeImageResizeFilter::Box:
+            {
+                return (X >= -0.5f && X < 0.5f) ? 1.0f : 0.0f;
+            }
+            case ERuntimeImageResizeFilter::Bilinear:
+            {
+                return FMath::Max(0.0f, 1.0f - FMath::Abs(X));
+            }
+            case ERuntimeImageResizeFilter::Lanczos:
+            {
+                const float AbsX = FMath::Abs(X);
+                if (AbsX < KINDA_SMALL_NUMBER)
+                {
+                    return 1.0f;
+                }
+                if (AbsX >= 3.0f)
+                {
+                    return 0.0f;
+                }
+
+                const float PiX = PI * X;
+                return 3.0f * FMath::Sin(PiX) * FMath::Sin(PiX / 3.0f) / (PiX * PiX);
+            }
+        }
+
+        return 0.0f;
+    }
+
+    float GetFilterSupport(ERuntimeImageResizeFilter Filter)
+    {
+        switch (Filter)
+        {
+            case ERuntimeImageResizeFilter::Box:        return 0.5f;
+            case ERuntimeImageResizeFilter::Bilinear:   return 1.0f;
+            case ERuntimeImageResizeFilter::Lanczos:    return 3.0f;
+        }
+
+        return 1.0f;
+    }
+
+    /** Source pixels and their weights for every destination pixel along one axis */
+    struct FFilterWeights
+    {
+        FFilterWeights(int32 SrcSize, int32 DstSize, ERuntimeImageResizeFilter Filter)
+        {
+            const float Ratio = (float)SrcSize / DstSize;
+            // filter is stretched over all covered source pixels when downscaling
+            const float FilterScale = FMath::Max(Ratio, 1.0f);
+            const float Support = GetFilterSupport(Filter) * FilterScale;
+
+            MaxTaps = FMath::CeilToInt(Support * 2.0f) + 3;
+            FirstTaps.SetNumUninitialized(DstSize);
+            NumTaps.SetNumUninitialized(DstSize);
+            Weights.SetNumZeroed(DstSize * MaxTaps);
+
+            for (int32 Dst = 0; Dst < DstSize; ++Dst)
+            {
+                const float Center = (Dst + 0.5f) * Ratio;
+                const int32 First = FMath::Max(0, FMath::FloorToInt(Center - Support));
+                const int32 Last = FMath::Min(SrcSize - 1, FMath::CeilToInt(Center + Support));
+
+                float* DstWeights = Weights.GetData() + Dst * MaxTaps;
+                float WeightSum = 0.0f;
+                int32 Num = 0;
+
+                for (int32 Src = First; Src <= Last && Num < MaxTaps; ++Src)
+                {
+                    const float Weight = EvaluateFilter(Filter, (Src + 0.5f - Center) / FilterScale);
+                    DstWeights[Num++] = Weight;
+                    WeightSum += Weight;
+                }
+
+                FirstTaps[Dst] = First;
+                NumTaps[Dst] = Num;
+
+                if (FMath::Abs(WeightSum) < KINDA_SMALL_NUMBER)
+                {
+                    // nearest pixel
+                    FirstTaps[Dst] = FMath::Clamp(FMath::FloorToInt(Center), 0, SrcSize - 1);
+                    NumTaps[Dst] = 1;
+                    DstWeights[0] = 1.0f;
+                    continue;
+                }
+
+                // pixels beyond the edges are dropped, the rest is renormalized
+                for (int32 Tap = 0; Tap < Num; ++Tap)
+                {
+                    DstWeights[Tap] /= WeightSum;
+                }
+            }
+        }
+
+        const float* GetWeights(int32 Dst) const
+        {
+            return Weights.GetData() + Dst * MaxTaps;
+        }
+
+        int32 MaxTaps = 0;
+        TArray<int32> FirstTaps;
+        TArray<int32> NumTaps;
+        TArray<float> Weights;
+    };
+
+    void ReadRow(const FRuntimeImageData& ImageData, int32 Y, FLinearColor* OutRow)
+    {
+        const bool bSRGB = ImageData.GammaSpace != EGammaSpace::Linear;
+        const uint8* Row = ImageData.RawData.GetData() + (int64)Y * ImageData.SizeX * GetBytesPerPixel(ImageData.Format);
+
+        switch (ImageData.Format)
+        {
+            case ERawImageFormat::G8:
+            {
+                for (int32 X = 0; X < ImageData.SizeX; ++X)
+                {
+                    const float Value = bSRGB ? FLinearColor::sRGBToLinearTable[Row[X]] : Row[X] / 255.0f;
+                    OutRow[X] = FLinearColor(Value, Value, Value, 1.0f);
+                }
+                break;
+            }
+            case ERawImageFormat::G16:
+            {
+                const uint16* Pixels = (const uint16*)Row;
+                for (int32 X = 0; X < ImageData.SizeX; ++X)
+                {
+                    const float Value = bSRGB ? SRGBToLinear(Pixels[X] / 65535.0f) : Pixels[X] / 65535.0f;
+                    OutRow[X] = FLinearColor(Value, Value, Value, 1.0f);
+                }
+                break;
+            }
+            case ERawImageFormat::BGRA8:
+            {
+                const FColor* Pixels = (const FColor*)Row;
+                for (int32 X = 0; X < ImageData.SizeX; ++X)
+                {
+                    const FColor& Pixel = Pixels[X];
+                    OutRow[X] = bSRGB ?
+                        FLinearColor(FLinearColor::sRGBToLinearTable[Pixel.R], FLinearColor::sRGBToLinearTable[Pixel.G], FLinearColor::sRGBToLinearTable[Pixel.B], Pixel.A / 255.0f) :
+                        FLinearColor(Pixel.R / 255.0f, Pixel.G / 255.0f, Pixel.B / 255.0f, Pixel.A / 255.0f);
+                }
+                break;
+            }
+            case ERawImageFormat::RGBA16:
+            {
+                const uint16* Pixels = (const uint16*)Row;
+                for (int32 X = 0; X < ImageData.SizeX; ++X, Pixels += 4)
+                {
+                    const FLinearColor Color(Pixels[0] / 65535.0f, Pixels[1] / 65535.0f, Pixels[2] / 65535.0f, Pixels[3] / 65535.0f);
+                    OutRow[X] = bSRGB ? FLinearColor(SRGBToLinear(Color.R), SRGBToLinear(Color.G), SRGBToLinear(Color.B), Color.A) : Color;
+                }
+                break;
+            }
+            case ERawImageFormat::RGBA16F:
+            {
+                // FLinearColor is four floats in RGBA order, same as the half pixels
+                FPixelKernels::HalfToFloat((const uint16*)Row, (float*)OutRow, (int64)ImageData.SizeX * 4);
+                break;
+            }
+            default:
+            {
+                checkNoEntry();
+                break;
+            }
+        }
+    }
+
+    void WriteRow(const FLinearColor* Row, int32 SizeX, ERawImageFormat::Type Format, bool bSRGB, uint8* OutRow)
+    {
+        const FLinearToSRGBTable& SRGBTable = GetLinearToSRGBTable();
+
+        switch (Format)
+        {
+            case ERawImageFormat::G8:
+            {
+                for (int32 X = 0; X < SizeX; ++X)
+                {
+                    OutRow[X] = bSRGB ? SRGBTable.Get(Row[X].R) : QuantizeUNorm8(Row[X].R);
+                }
+                break;
+            }
+            case ERawImageFormat::G16:
+            {
+                uint16* Pixels = (uint16*)OutRow;
+                for (int32 X = 0; X < SizeX; ++X)
+                {
+                    Pixels[X] = QuantizeUNorm16(bSRGB ? LinearToSRGB(FMath::Max(0.0f, Row[X].R)) : Row[X].R);
+                }
+                break;
+            }
+            case ERawImageFormat::BGRA8:
+            {
+                FColor* Pixels = (FColor*)OutRow;
+                for (int32 X = 0; X < SizeX; ++X)
+                {
+                    const FLinearColor& Color = Row[X];
+                    FColor& Pixel = Pixels[X];
+
+                    Pixel.R = bSRGB ? SRGBTable.Get(Color.R) : QuantizeUNorm8(Color.R);
+                    Pixel.G = bSRGB ? SRGBTable.Get(Color.G) : QuantizeUNorm8(Color.G);
+                    Pixel.B = bSRGB ? SRGBTable.Get(Color.B) : QuantizeUNorm8(Color.B);
+                    Pixel.A = QuantizeUNorm8(Color.A);
+                }
+                break;
+            }
+            case ERawImageFormat::RGBA16:
+            {
+                uint16* Pixels = (uint16*)OutRow;
+                for (int32 X = 0; X < SizeX; ++X, Pixels += 4)
+                {
+                    const FLinearColor& Color = Row[X];
+
+                    Pixels[0] = QuantizeUNorm16(bSRGB ? LinearToSRGB(FMath::Max(0.0f, Color.R)) : Color.R);
+                    Pixels[1] = QuantizeUNorm16(bSRGB ? LinearToSRGB(FMath::Max(0.0f, Color.G)) : Color.G);
+                    Pixels[2] = QuantizeUNorm16(bSRGB ? LinearToSRGB(FMath::Max(0.0f, Color.B)) : Color.B);
+                    Pixels[3] = QuantizeUNorm16(Color.A);
+                }
+                break;
+            }
+            case ERawImageFormat::RGBA16F:
+            {
+                FPixelKernels::FloatToHalf((const float*)Row, (uint16*)OutRow, (int64)SizeX * 4);
+                break;
+            }
+            default:
+            {
+                checkNoEntry();
+                break;
+            }
+        }
+    }
+}
+
+namespace FResizeHelpers
+{
+    bool CanResizeImage(const FRuntimeImageData& ImageData)
+    {
+        // shared exponent pixels can't be filtered per channel
+        return GetBytesPerPixel(ImageData.Format) > 0 && ImageData.SizeX > 0 && ImageData.SizeY > 0;
+    }
+
+    bool ResizeImage(FRuntimeImageData& ImageData, int32 SizeX, int32 SizeY, ERuntimeImageResizeFilter Filter, bool bConvertToBGRA8)
+    {
+        if (!CanResizeImage(ImageData) || SizeX <= 0 || SizeY <= 0)
+        {
+            return false;
+        }
+
+        const ERawImageFormat::Type DstFormat = bConvertToBGRA8 ? ERawImageFormat::BGRA8 : ImageData.Format;
+        const bool bDstSRGB = bConvertToBGRA8 || ImageData.GammaSpace != EGammaSpace::Linear;
+        const int64 DstPitch = (int64)SizeX * GetBytesPerPixel(DstFormat);
+
+        const FFilterWeights WeightsX(ImageData.SizeX, SizeX, Filter);
+        const FFilterWeights WeightsY(ImageData.SizeY, SizeY, Filter);
+
+        FRuntimeImageRawData DstData;
+        DstData.SetNumUninitialized(DstPitch * SizeY);
+
+        const FRuntimeImageData& SrcImage = ImageData;
+        const int32 NumTiles = FMath::DivideAndRoundUp(SizeY, ResizeTileSizeY);
+
+        ParallelFor(NumTiles, [&](int32 TileIndex)
+        {
+            const int32 DstY0 = TileIndex * ResizeTileSizeY;
+            const int32 DstY1 = FMath::Min(DstY0 + ResizeTileSizeY, SizeY);
+
+            // source rows the tile depends on
+            int32 SrcY0 = MAX_int32;
+            int32 SrcY1 = 0;
+            for (int32 DstY = DstY0; DstY < DstY1; ++DstY)
+            {
+                SrcY0 = FMath::Min(SrcY0, WeightsY.FirstTaps[DstY]);
+                SrcY1 = FMath::Max(SrcY1, WeightsY.FirstTaps[DstY] + WeightsY.NumTaps[DstY]);
+            }
+
+            // horizontal pass goes to the rows of the tile, vertical pass reads them
+            FScratchHelpers::FScratchScope Scratch;
+            FLinearColor* SrcRow = Scratch.Alloc<FLinearColor>(SrcImage.SizeX);
+            FLinearColor* FilteredRows = Scratch.Alloc<FLinearColor>((int64)(SrcY1 - SrcY0) * SizeX);
+            FLinearColor* DstRow = Scratch.Alloc<FLinearColor>(SizeX);
+
+            for (int32 SrcY = SrcY0; SrcY < SrcY1; ++SrcY)
+            {
+                ReadRow(SrcImage, SrcY, SrcRow);
+
+                FLinearColor* FilteredRow = FilteredRows + (SrcY - SrcY0) * SizeX;
+                for (int32 DstX = 0; DstX < SizeX; ++DstX)
+                {
+                    const FLinearColor* Taps = SrcRow + WeightsX.FirstTaps[DstX];
+                    const float* Weights = WeightsX.GetWeights(DstX);
+
+                    FLinearColor Sum(0.0f, 0.0f, 0.0f, 0.0f);
+                    for (int32 Tap = 0; Tap < WeightsX.NumTaps[DstX]; ++Tap)
+                    {
+                        Sum += Taps[Tap] * Weights[Tap];
+                    }
+                    FilteredRow[DstX] = Sum;
+                }
+            }
+
+            for (int32 DstY = DstY0; DstY < DstY1; ++DstY)
+            {
+                const FLinearColor* Taps = FilteredRows + (WeightsY.FirstTaps[DstY] - SrcY0) * SizeX;
+                const float* Weights = WeightsY.GetWeights(DstY);
+
+                FMemory::Memzero(DstRow, SizeX * sizeof(FLinearColor));
+                for (int32 Tap = 0; Tap < WeightsY.NumTaps[DstY]; ++Tap)
+                {
+                    const FLinearColor* TapRow = Taps + Tap * SizeX;
+                    for (int32 DstX = 0; DstX < SizeX; ++DstX)
+                    {
+                        DstRow[DstX] += TapRow[DstX] * Weights[Tap];
+                    }
+                }
+
+                WriteRow(DstRow, SizeX, DstFormat, bDstSRGB, DstData.GetData() + DstY * DstPitch);
+            }
+        });
+
+        ImageData.RawData = MoveTemp(DstData);
+        ImageData.SizeX = SizeX;
+        ImageData.SizeY = SizeY;
+
+        if (bConvertToBGRA8)
+        {
+            ImageData.Format = ERawImageFormat::BGRA8;
+            ImageData.TextureSourceFormat = TSF_BGRA8;
+            ImageData.SRGB = true;
+            ImageData.GammaSpace = EGammaSpace::sRGB;
+        }
+
+        return true;
+    }
+}
@@ -0,0 +1,21 @@
+// Copyright 2022 Peter Leontev. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include "RuntimeImageData.h"
+#include "RuntimeImageReader.h"
+
+
+namespace FResizeHelpers
+{
+    /** G8, G16, BGRA8, RGBA16 and RGBA16F images can be resized */
+    bool CanResizeImage(const FRuntimeImageData& ImageData);
+
+    /**
+     * Separable resampling in linear space, tiles of rows are filtered in parallel.
+     * With bConvertToBGRA8 pixels are written as sRGB BGRA8 on the way, so the image is walked only once
+     */
+    bool ResizeImage(FRuntimeImageData& ImageData, int32 SizeX, int32 SizeY, ERuntimeImageResizeFilter Filter, bool bConvertToBGRA8);
+}
@@ -0,0 +1,135 @@
+// Copyright 2022 Peter Leontev. All Rights Reserved.
+
+#include "ScaledDecodeHelpers.h"
+
+
+namespace FScaledDecodeHelpers
+{
+    FIntRect ClampRegion(const FIntRect& CropRect, int32 Width, int32 Height)
+    {
+        const FIntRect ImageRect(0, 0, Width, Height);
+        if (CropRect.Area() <= 0)
+        {
+            return ImageRect;
+        }
+
+        FIntRect Region = ImageRect;
+        Region.Clip(CropRect);
+
+        return (Region.Area() > 0) ? Region : ImageRect;
+    }
+
+    bool GetDecodeRegion(const FRuntimeImageDecodeHints& DecodeHints, int32 Width, int32 Height, int32 MaxScale, FIntRect& OutRegion, int32& OutScale)
+    {
+        OutRegion = ClampRegion(DecodeHints.CropRect, Width, Height);
+
+        // same size transform stage resizes the region to
+        const FIntPoint TargetSize = DecodeHints.GetTargetSize(OutRegion.Size());
+
+        OutScale = 1;
+        while (OutScale * 2 <= MaxScale && OutRegion.Width() / (OutScale * 2) >= TargetSize.X && OutRegion.Height() / (OutScale * 2) >= TargetSize.Y)
+        {
+            OutScale *= 2;
+        }
+
+        return OutScale > 1 || OutRegion != FIntRect(0, 0, Width, Height);
+    }
+
+    void CropImage(FRuntimeImageData& ImageData, const FIntRect& Region)
+    {
+        const int64 BytesPerPixel = ImageData.GetBytesPerPixel();
+        const int64 SourcePitch = ImageData.SizeX * BytesPerPixel;
+        const int64 CroppedPitch = Region.Width() * BytesPerPixel;
+
+        FRuntimeImageRawData CroppedData;
+        CroppedData.SetNumUninitialized(CroppedPitch * Region.Height());
+
+        for (int32 Y = 0; Y < Region.Height(); ++Y)
+        {
+            FMemory::Memcpy(
+                CroppedData.GetData() + Y * CroppedPitch,
+                ImageData.RawData.GetData() + (Region.Min.Y + Y) * SourcePitch + Region.Min.X * BytesPerPixel,
+                CroppedPitch
+            );
+        }
+
+        ImageData.RawData = MoveTemp(CroppedData);
+        ImageData.SizeX = Region.Width();
+        ImageData.SizeY = Region.Height();
+        ImageData.SourceRect = Region;
+    }
+
+    FRowDownscaler::FRowDownscaler(const FIntRect& InRegion, int32 InScale, int32 InNumChannels)
+        : Region(InRegion)
+        , Scale(InScale)
+        , NumChannels(InNumChannels)
+    {
+        SizeX = FMath::DivideAndRoundUp(Region.Width(), Scale);
+        SizeY = FMath::DivideAndRoundUp(Region.Height(), Scale);
+
+        Pixels.SetNumUninitialized((int64)SizeX * SizeY * NumChannels);
+
+        if (Scale > 1)
+        {
+            RowSums.SetNumZeroed(SizeX * NumChannels);
+        }
+    }
+
+    void FRowDownscaler::AddRow(int32 Y, const uint8* Row)
+    {
+        if (Y < Region.Min.Y || Y >= Region.Max.Y)
+        {
+            return;
+        }
+
+        const uint8* RegionRow = Row + Region.Min.X * NumChannels;
+        const int32 RegionWidth = Region.Width();
+
+        if (Scale == 1)
+        {
+            FMemory::Memcpy(Pixels.GetData() + (int64)OutputRow * SizeX * NumChannels, RegionRow, RegionWidth * NumChannels);
+            ++OutputRow;
+            return;
+        }
+
+        for (int32 X = 0; X < RegionWidth; ++X)
+        {
+            uint32* Sums = RowSums.GetData() + (X / Scale) * NumChannels;
+            const uint8* Pixel = RegionRow + X * NumChannels;
+
+            for (int32 Channel = 0; Channel < NumChannels; ++Channel)
+            {
+                Sums[Channel] += Pixel[Channel];
+            }
+        }
+
+        ++NumSummedRows;
+
+        if (NumSummedRows == Scale || Y == Region.Max.Y - 1)
+        {
+            FlushRow();
+        }
+    }
+
+    void FRowDownscaler::FlushRow()
+    {
+        uint8* OutputPixels = Pixels.GetData() + (int64)OutputRow * SizeX * NumChannels;
+        const int32 RegionWidth = Region.Width();
+
+        for (int32 X = 0; X < SizeX; ++X)
+        {
+            // last column and row of blocks can be narrower
+            const uint32 NumSamples = FMath::Min(Scale, RegionWidth - X * Scale) * NumSummedRows;
+
+            for (int32 Channel = 0; Channel < NumChannels; ++Channel)
+            {
+                const int32 Index = X * NumChannels + Channel;
+                OutputPixels[Index] = (uint8)((RowSums[Index] + NumSamples / 2) / NumSamples);
+            }
+        }
+
+        FMemory::Memzero(RowSums.GetData(), RowSums.Num() * sizeof(uint32));
+        NumSummedRows = 0;
+        ++OutputRow;
+    }
+}
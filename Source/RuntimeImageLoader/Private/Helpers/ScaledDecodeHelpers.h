@@ -0,0 +1,57 @@
+// Copyright 2022 Peter Leontev. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include "RuntimeImageData.h"
+
+
+namespace FScaledDecodeHelpers
+{
+    /** Clamps crop rect to the image, empty or invalid rect means whole image */
+    FIntRect ClampRegion(const FIntRect& CropRect, int32 Width, int32 Height);
+
+    /**
+     * Clamps crop rect of decode hints and picks the largest power of two the region can be shrunk by
+     * without going below the size transform stage resizes it to. Returns false if decoder has nothing to skip
+     */
+    bool GetDecodeRegion(const FRuntimeImageDecodeHints& DecodeHints, int32 Width, int32 Height, int32 MaxScale, FIntRect& OutRegion, int32& OutScale);
+
+    /** Copies the region out of the image, region is in pixels of the image */
+    void CropImage(FRuntimeImageData& ImageData, const FIntRect& Region);
+
+    /**
+     * Box filters rows of 8 bit pixels as decoder produces them from top to bottom.
+     * Rows outside of the region are ignored
+     */
+    class FRowDownscaler
+    {
+    public:
+        FRowDownscaler(const FIntRect& InRegion, int32 InScale, int32 InNumChannels);
+
+        /** Takes full width row of the source image */
+        void AddRow(int32 Y, const uint8* Row);
+
+        /** Rows below the region do not need to be decoded */
+        bool IsComplete(int32 Y) const { return Y >= Region.Max.Y - 1; }
+
+        int32 GetSizeX() const { return SizeX; }
+        int32 GetSizeY() const { return SizeY; }
+
+        FRuntimeImageRawData Pixels;
+
+    private:
+        void FlushRow();
+
+        const FIntRect Region;
+        const int32 Scale;
+        const int32 NumChannels;
+        int32 SizeX;
+        int32 SizeY;
+
+        TArray<uint32> RowSums;
+        int32 NumSummedRows = 0;
+        int32 OutputRow = 0;
+    };
+}
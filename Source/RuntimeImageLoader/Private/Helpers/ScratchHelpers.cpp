@@ -0,0 +1,60 @@
+// Copyright 2022 Peter Leontev. All Rights Reserved.
+
+#include "ScratchHelpers.h"
+
+
+namespace FScratchHelpers
+{
+    static const int64 MinBlockSize = 64 * 1024;
+
+    FScratchArena& FScratchArena::Get()
+    {
+        static thread_local FScratchArena Arena;
+        return Arena;
+    }
+
+    void* FScratchArena::Alloc(int64 Size)
+    {
+        Size = Align(FMath::Max<int64>(Size, 1), 16);
+
+        // blocks in use are never reallocated, so pointers that were handed out stay valid
+        while (BlockIndex < Blocks.Num() && Offset + Size > Blocks[BlockIndex].Num())
+        {
+            ++BlockIndex;
+            Offset = 0;
+        }
+
+        if (BlockIndex == Blocks.Num())
+        {
+            const int64 LastBlockSize = Blocks.Num() > 0 ? Blocks.Last().Num() : 0;
+
+            TArray64<uint8>& Block = Blocks.AddDefaulted_GetRef();
+            Block.SetNumUninitialized(FMath::Max3(Size, LastBlockSize * 2, MinBlockSize));
+        }
+
+        // TArray memory is aligned to 16 bytes
+        void* Memory = Blocks[BlockIndex].GetData() + Offset;
+        Offset += Size;
+
+        return Memory;
+    }
+
+    void FScratchArena::Reset(const FMark& Mark)
+    {
+        BlockIndex = Mark.BlockIndex;
+        Offset = Mark.Offset;
+
+        if (BlockIndex == 0 && Offset == 0 && Blocks.Num() > 1)
+        {
+            // nothing is in use, peak usage fits a single block from now on
+            int64 TotalSize = 0;
+            for (const TArray64<uint8>& Block : Blocks)
+            {
+                TotalSize += Block.Num();
+            }
+
+            Blocks.Empty(1);
+            Blocks.AddDefaulted_GetRef().SetNumUninitialized(TotalSize);
+        }
+    }
+}
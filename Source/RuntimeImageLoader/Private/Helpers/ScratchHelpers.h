@@ -0,0 +1,70 @@
+// Copyright 2022 Peter Leontev. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+
+namespace FScratchHelpers
+{
+    /**
+     * Bump allocator for temporary buffers of the calling thread. Memory is reused by every image the thread works on,
+     * it grows to the peak usage and is not given back. Allocations are freed by FScratchScope
+     */
+    class FScratchArena
+    {
+    public:
+        /** Arena of the calling thread */
+        static FScratchArena& Get();
+
+        /** Uninitialized memory aligned to 16 bytes */
+        void* Alloc(int64 Size);
+
+        template<typename T>
+        T* Alloc(int64 Num)
+        {
+            return (T*)Alloc(Num * (int64)sizeof(T));
+        }
+
+    private:
+        friend class FScratchScope;
+
+        struct FMark
+        {
+            int32 BlockIndex = 0;
+            int64 Offset = 0;
+        };
+
+        FMark GetMark() const { return { BlockIndex, Offset }; }
+        void Reset(const FMark& Mark);
+
+        TArray<TArray64<uint8>> Blocks;
+        int32 BlockIndex = 0;
+        int64 Offset = 0;
+    };
+
+    /** Frees scratch memory allocated by the calling thread since the scope was opened */
+    class FScratchScope
+    {
+    public:
+        FScratchScope()
+            : Arena(FScratchArena::Get())
+            , Mark(Arena.GetMark())
+        {}
+
+        ~FScratchScope()
+        {
+            Arena.Reset(Mark);
+        }
+
+        template<typename T>
+        T* Alloc(int64 Num)
+        {
+            return Arena.Alloc<T>(Num);
+        }
+
+    private:
+        FScratchArena& Arena;
+        const FScratchArena::FMark Mark;
+    };
+}
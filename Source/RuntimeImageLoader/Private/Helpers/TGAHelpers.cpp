@@ -1,6 +1,7 @@
 // Copyright 2022 Peter Leontev. All Rights Reserved.
 
 #include "TGAHelpers.h"
+#include "PixelKernels.h"
 
 
 namespace FTGAHelpers
@@ -159,22 +160,12 @@ namespace FTGAHelpers
         uint8* IdData = (uint8*)TGA + sizeof(FTGAFileHeader);
         uint8* ColorMap = IdData + TGA->IdFieldLength;
         uint16* ImageData = (uint16*)(ColorMap + (TGA->ColorMapEntrySize + 4) / 8 * TGA->ColorMapLength);
-        uint16 FilePixel = 0;
-        uint32 TexturePixel = 0;
 
         for (int32 Y = TGA->Height - 1; Y >= 0; Y--)
         {
-            for (int32 X = 0; X < TGA->Width; X++)
-            {
-                FilePixel = *ImageData++;
-                // Convert file format A1R5G5B5 into pixel format B8G8R8A8
-                TexturePixel = (FilePixel & 0x001F) << 3;
-                TexturePixel |= (FilePixel & 0x03E0) << 6;
-                TexturePixel |= (FilePixel & 0x7C00) << 9;
-                TexturePixel |= (FilePixel & 0x8000) << 16;
-                // Store.
-                *((TextureData + Y * TGA->Width) + X) = TexturePixel;
-            }
+            // Convert file format A1R5G5B5 into pixel format B8G8R8A8
+            FPixelKernels::ExpandA1R5G5B5ToBGRA(ImageData, TextureData + Y * TGA->Width, TGA->Width);
+            ImageData += TGA->Width;
         }
     }
 
@@ -183,18 +174,10 @@ namespace FTGAHelpers
         uint8* IdData = (uint8*)TGA + sizeof(FTGAFileHeader);
         uint8* ColorMap = IdData + TGA->IdFieldLength;
         uint8* ImageData = (uint8*)(ColorMap + (TGA->ColorMapEntrySize + 4) / 8 * TGA->ColorMapLength);
-        uint8 Pixel[4];
 
         for (int32 Y = 0; Y < TGA->Height; Y++)
         {
-            for (int32 X = 0; X < TGA->Width; X++)
-            {
-                Pixel[0] = *((ImageData + (TGA->Height - Y - 1)*TGA->Width * 3) + X * 3 + 0);
-                Pixel[1] = *((ImageData + (TGA->Height - Y - 1)*TGA->Width * 3) + X * 3 + 1);
-                Pixel[2] = *((ImageData + (TGA->Height - Y - 1)*TGA->Width * 3) + X * 3 + 2);
-                Pixel[3] = 255;
-                *((TextureData + Y * TGA->Width) + X) = *(uint32*)&Pixel;
-            }
+            FPixelKernels::ExpandBGRToBGRA(ImageData + (TGA->Height - Y - 1) * TGA->Width * 3, (uint8*)(TextureData + Y * TGA->Width), TGA->Width);
         }
     }
 
@@ -279,29 +262,46 @@ namespace FTGAHelpers
         bool FlipY = (TGA->ImageDescriptor & 0x20) ? 1 : 0;
         if (FlipY || FlipX)
         {
-            TArray<uint8> FlippedData;
-            FlippedData.AddUninitialized(TextureDataSize);
-
-            int32 NumBlocksX = TGA->Width;
-            int32 NumBlocksY = TGA->Height;
-            int32 BlockBytes = TGA->BitsPerPixel == 8 ? 1 : 4;
+            // flip in place, no need for another image sized buffer
+            const int32 NumBlocksX = TGA->Width;
+            const int32 NumBlocksY = TGA->Height;
+            const int32 BlockBytes = TGA->BitsPerPixel == 8 ? 1 : 4;
+            const int32 RowBytes = NumBlocksX * BlockBytes;
 
             uint8* MipData = (uint8*)TextureData;
 
-            for (int32 Y = 0; Y < NumBlocksY; Y++)
+            if (FlipY)
+            {
+                TArray<uint8> RowData;
+                RowData.AddUninitialized(RowBytes);
+
+                for (int32 Y = 0; Y < NumBlocksY / 2; Y++)
+                {
+                    uint8* TopRow = MipData + Y * RowBytes;
+                    uint8* BottomRow = MipData + (NumBlocksY - Y - 1) * RowBytes;
+
+                    FMemory::Memcpy(RowData.GetData(), TopRow, RowBytes);
+                    FMemory::Memcpy(TopRow, BottomRow, RowBytes);
+                    FMemory::Memcpy(BottomRow, RowData.GetData(), RowBytes);
+                }
+            }
+
+            if (FlipX)
             {
-                for (int32 X = 0; X < NumBlocksX; X++)
+                for (int32 Y = 0; Y < NumBlocksY; Y++)
                 {
-                    int32 DestX = FlipX ? (NumBlocksX - X - 1) : X;
-                    int32 DestY = FlipY ? (NumBlocksY - Y - 1) : Y;
-                    FMemory::Memcpy(
-                        &FlippedData[(DestX + DestY * NumBlocksX) * BlockBytes],
-                        &MipData[(X + Y * NumBlocksX) * BlockBytes],
-                        BlockBytes
-                    );
+                    uint8* Row = MipData + Y * RowBytes;
+                    for (int32 X = 0; X < NumBlocksX / 2; X++)
+                    {
+                        uint8* LeftBlock = Row + X * BlockBytes;
+                        uint8* RightBlock = Row + (NumBlocksX - X - 1) * BlockBytes;
+                        for (int32 ByteIndex = 0; ByteIndex < BlockBytes; ByteIndex++)
+                        {
+                            Swap(LeftBlock[ByteIndex], RightBlock[ByteIndex]);
+                        }
+                    }
                 }
             }
-            FMemory::Memcpy(MipData, FlippedData.GetData(), FlippedData.Num());
         }
 
         return true;
@@ -1,6 +1,9 @@
 // Copyright Peter Leontev
 
 #include "TIFFLoader.h"
+#include "FreeImageWrapper.h"
+#include "PixelKernels.h"
+#include "Async/ParallelFor.h"
 
 DEFINE_LOG_CATEGORY_STATIC(LogRuntimeImageLoaderTIFFLoader, Log, All);
 
@@ -14,51 +17,16 @@ THIRD_PARTY_INCLUDES_START
 #include "FreeImage.h"
 THIRD_PARTY_INCLUDES_END
 
-class FFreeImageWrapper
-{
-public:
-	static bool IsValid() { return FreeImageDllHandle != nullptr; }
-
-	static void FreeImage_Initialise(bool bLoadLocalPluginsOnly); // Loads and inits FreeImage on first call
-
-private:
-	static void* FreeImageDllHandle; // Lazy init on first use, never release for now
-};
-
-void* FFreeImageWrapper::FreeImageDllHandle = nullptr;
-
-void FFreeImageWrapper::FreeImage_Initialise(bool bLoadLocalPluginsOnly)
-{
-	if (FreeImageDllHandle != nullptr)
-	{
-		return;
-	}
-
-	if (FreeImageDllHandle == nullptr)
-	{
-		FString FreeImageDir = FPaths::Combine(FPaths::EngineDir(), TEXT("Binaries/ThirdParty/FreeImage"), FPlatformProcess::GetBinariesSubdirectory());
-		FString FreeImageLibDir = FPaths::Combine( FreeImageDir, TEXT(FREEIMAGE_LIB_FILENAME));
-		FPlatformProcess::PushDllDirectory(*FreeImageDir);
-		FreeImageDllHandle = FPlatformProcess::GetDllHandle(*FreeImageLibDir);
-		FPlatformProcess::PopDllDirectory(*FreeImageDir);
-	}
-
-	if (FreeImageDllHandle)
-	{
-		::FreeImage_Initialise((BOOL)bLoadLocalPluginsOnly);
-	}
-}
-
 #if PLATFORM_WINDOWS
 #include "Windows/HideWindowsPlatformTypes.h"
 #endif // PLATFORM_WINDOWS
 
 FRuntimeTiffLoadHelper::FRuntimeTiffLoadHelper()
 {
-	FFreeImageWrapper::FreeImage_Initialise(false);
+	// initialised once by the module
 	if (!FFreeImageWrapper::IsValid())
 	{
-		SetError(TEXT("Can't initialize FreeImage"));
+		SetError(TEXT("FreeImage is not loaded"));
 		return;
 	}
 
@@ -78,6 +46,41 @@ FRuntimeTiffLoadHelper::~FRuntimeTiffLoadHelper()
 	}
 }
 
+namespace
+{
+	const int32 RowsPerChunk = 32;
+
+	/** Runs Func(Y, ScanLine) for rows of the bitmap in parallel, top to bottom. FreeImage keeps rows upside-down */
+	template<typename RowFuncType>
+	void ForEachRow(FIBITMAP* Bitmap, int32 Height, RowFuncType&& RowFunc)
+	{
+		const int32 NumChunks = FMath::DivideAndRoundUp(Height, RowsPerChunk);
+
+		ParallelFor(NumChunks, [Bitmap, Height, &RowFunc](int32 ChunkIndex)
+		{
+			const int32 LastY = FMath::Min(Height, (ChunkIndex + 1) * RowsPerChunk);
+			for (int32 Y = ChunkIndex * RowsPerChunk; Y < LastY; ++Y)
+			{
+				RowFunc(Y, FreeImage_GetScanLine(Bitmap, Height - 1 - Y));
+			}
+		});
+	}
+
+	/** Bitmap itself if it is of the type already, otherwise a converted copy which has to be unloaded */
+	FIBITMAP* GetBitmapOfType(FIBITMAP* Bitmap, FREE_IMAGE_TYPE Type)
+	{
+		return FreeImage_GetImageType(Bitmap) == Type ? Bitmap : FreeImage_ConvertToType(Bitmap, Type, true);
+	}
+
+	void UnloadConverted(FIBITMAP* ConvertedBitmap, FIBITMAP* Bitmap)
+	{
+		if (ConvertedBitmap != Bitmap)
+		{
+			FreeImage_Unload(ConvertedBitmap);
+		}
+	}
+}
+
 bool FRuntimeTiffLoadHelper::Load(const uint8 * Buffer, uint32 Length)
 {
 	FREE_IMAGE_FORMAT FileType = FIF_TIFF;
@@ -90,12 +93,6 @@ bool FRuntimeTiffLoadHelper::Load(const uint8 * Buffer, uint32 Length)
 		return false;
 	}
 
-	// FreeImage keeps all images upside-down
-	if (!ensure(FreeImage_FlipVertical(Bitmap)))
-	{
-		UE_LOG(LogRuntimeImageLoaderTIFFLoader, Error, TEXT("Can't flip TIFF image"));
-	}
-
 	const int32 BitsPerPixel = FreeImage_GetBPP(Bitmap);
 
 	bool bIsSourceSupported = true;
@@ -159,8 +156,8 @@ bool FRuntimeTiffLoadHelper::Load(const uint8 * Buffer, uint32 Length)
 
 	case FIT_BITMAP:
 	{
-		// treat 1-bit dib as grayscale
-		bIsSourceGrayScale = BitsPerPixel == 1;
+		// treat 1-bit dib as grayscale, 8-bit grey is copied to G8 as is
+		bIsSourceGrayScale = BitsPerPixel == 1 || (BitsPerPixel == 8 && FreeImage_GetColorType(Bitmap) == FIC_MINISBLACK);
 		break;
 	}
 	case FIT_UNKNOWN:
@@ -181,158 +178,210 @@ bool FRuntimeTiffLoadHelper::Load(const uint8 * Buffer, uint32 Length)
 	Width = FreeImage_GetWidth(Bitmap);
 	Height = FreeImage_GetHeight(Bitmap);
 
+	// pixels are written straight into RawData from the decoded bitmap, intermediate bitmaps are only made for uncommon layouts
 	if (bIsSourceFloatingPoint)
 	{
-		// Floating point images converted to RGBA16F
-		RawData.SetNumUninitialized(Height * Width * 4 * sizeof(FFloat16));
-
-		TextureSourceFormat = TSF_RGBA16F;
-		CompressionSettings = TC_HDR_Compressed;
-		bSRGB = false;
-
-		FIBITMAP* ConvertedBitmap = FreeImage_ConvertToType(Bitmap, FIT_RGBAF, true);
-		if (ConvertedBitmap)
-		{
-			BYTE* Bits = FreeImage_GetBits(ConvertedBitmap);
-			int32 Pitch = FreeImage_GetPitch(ConvertedBitmap);
-			for (int Y = 0; Y < Height; Y++)
-			{
-				BYTE* ScanLine = Bits + Pitch * Y;
-				FIRGBAF* Pixels = (FIRGBAF*)ScanLine;
-				for (int X = 0; X < Width; X++)
-				{
-					FIRGBAF P = Pixels[X];
-					FFloat16* TargetPixel = ((FFloat16*)RawData.GetData()) + (X + Y * Width) * 4;
-					TargetPixel[0].Set(P.red);
-					TargetPixel[1].Set(P.green);
-					TargetPixel[2].Set(P.blue);
-					TargetPixel[3].Set(P.alpha);
-				}
-			}
-
-			FreeImage_Unload(ConvertedBitmap);
-		}
+		return ConvertToRGBA16F();
 	}
 	else if (bIsSourceGrayScale)
 	{
 		// Grayscale images converted to either G8 or RGBA16
-		if (bIsSource16BitsPerChannel)
-		{
-			ConvertToRGBA16();
-		}
-		{
-			RawData.SetNumUninitialized(Height * Width * 4);
+		return bIsSource16BitsPerChannel ? ConvertToRGBA16() : ConvertToG8(bShouldConvertToByte);
+	}
+	else // rgb(a)
+	{
+		return bIsSource16BitsPerChannel ? ConvertToRGBA16() : ConvertToBGRA8();
+	}
+}
 
-			TextureSourceFormat = TSF_G8;
-			CompressionSettings = TC_Grayscale;
-			bSRGB = false;
+bool FRuntimeTiffLoadHelper::ConvertToRGBA16F()
+{
+	// Floating point images converted to RGBA16F
+	FIBITMAP* SourceBitmap = GetBitmapOfType(Bitmap, FIT_RGBAF);
+	if (!SourceBitmap)
+	{
+		return false;
+	}
 
-			FIBITMAP* ConvertedBitmap;
-			if (bShouldConvertToByte) {
-				ConvertedBitmap = FreeImage_ConvertToStandardType(Bitmap, true);
-			}
-			else
-			{
-				ConvertedBitmap = FreeImage_ConvertToGreyscale(Bitmap);
-			}
+	RawData.SetNumUninitialized((int64)Height * Width * 4 * sizeof(FFloat16));
 
-			if (ConvertedBitmap)
-			{
+	TextureSourceFormat = TSF_RGBA16F;
+	CompressionSettings = TC_HDR_Compressed;
+	bSRGB = false;
 
-				BYTE* Bits = FreeImage_GetBits(ConvertedBitmap);
-				int32 Pitch = FreeImage_GetPitch(ConvertedBitmap);
-				for (int Y = 0; Y < Height; Y++)
-				{
-					BYTE* ScanLine = Bits + Pitch * Y;
-					uint8* TargetPixels = ((uint8*)RawData.GetData()) + Y * Width;
-					for (int X = 0; X < Width; X++)
-					{
-						uint8 P = ScanLine[X];
-						TargetPixels[X] = P;
-					}
-				}
-				FreeImage_Unload(ConvertedBitmap);
-			}
-		}
+	FFloat16* TargetPixels = (FFloat16*)RawData.GetData();
+	const int32 RowWidth = Width;
+
+	ForEachRow(SourceBitmap, Height, [TargetPixels, RowWidth](int32 Y, const BYTE* ScanLine)
+	{
+		// FIRGBAF is four floats in RGBA order
+		FPixelKernels::FloatToHalf((const float*)ScanLine, (uint16*)(TargetPixels + (int64)Y * RowWidth * 4), (int64)RowWidth * 4);
+	});
+
+	UnloadConverted(SourceBitmap, Bitmap);
+	return true;
+}
+
+bool FRuntimeTiffLoadHelper::ConvertToG8(bool bShouldConvertToByte)
+{
+	FIBITMAP* SourceBitmap = Bitmap;
+	if (bShouldConvertToByte)
+	{
+		SourceBitmap = FreeImage_ConvertToStandardType(Bitmap, true);
 	}
-	else // rgb(a)
+	else if (FreeImage_GetBPP(Bitmap) != 8 || FreeImage_GetColorType(Bitmap) != FIC_MINISBLACK)
 	{
-		if (bIsSource16BitsPerChannel)
-		{
-			ConvertToRGBA16();
-		}
-		else
-		{
-			// Convert to RGBA(8-bit)
+		SourceBitmap = FreeImage_ConvertToGreyscale(Bitmap);
+	}
 
-			RawData.SetNumUninitialized(Height * Width * 4);
+	if (!SourceBitmap)
+	{
+		return false;
+	}
 
-			TextureSourceFormat = TSF_BGRA8;
-			CompressionSettings = TC_Default;
-			bSRGB = true;
+	RawData.SetNumUninitialized((int64)Height * Width);
 
-			FIBITMAP* ConvertedBitmap = FreeImage_ConvertTo32Bits(Bitmap);
-			if (ConvertedBitmap)
-			{
+	TextureSourceFormat = TSF_G8;
+	CompressionSettings = TC_Grayscale;
+	bSRGB = false;
 
-				BYTE* Bits = FreeImage_GetBits(ConvertedBitmap);
-				int32 Pitch = FreeImage_GetPitch(ConvertedBitmap);
-				for (int Y = 0; Y < Height; Y++)
-				{
-					BYTE* ScanLine = Bits + Pitch * Y;
-					for (int X = 0; X < Width; X++)
-					{
-						uint8* P = ScanLine + X * 4;
-						uint8* TargetPixel = ((uint8*)RawData.GetData()) + (X + Y * Width) * 4;
-						// FI_RGBA_X - cross-platform way to retrieve channels
-						TargetPixel[0] = P[FI_RGBA_BLUE];
-						TargetPixel[1] = P[FI_RGBA_GREEN];
-						TargetPixel[2] = P[FI_RGBA_RED];
-						TargetPixel[3] = P[FI_RGBA_ALPHA];
-					}
-				}
-
-				FreeImage_Unload(ConvertedBitmap);
-			}
-		}
+	uint8* TargetPixels = RawData.GetData();
+	const int32 RowWidth = Width;
+
+	ForEachRow(SourceBitmap, Height, [TargetPixels, RowWidth](int32 Y, const BYTE* ScanLine)
+	{
+		FMemory::Memcpy(TargetPixels + (int64)Y * RowWidth, ScanLine, RowWidth);
+	});
+
+	UnloadConverted(SourceBitmap, Bitmap);
+	return true;
+}
+
+bool FRuntimeTiffLoadHelper::ConvertToBGRA8()
+{
+	// 24 and 32 bit bitmaps are read as is, alpha of 24 bit ones is opaque
+	const int32 SourceBPP = FreeImage_GetBPP(Bitmap);
+	const bool bReadDirectly = SourceBPP == 24 || SourceBPP == 32;
+
+	FIBITMAP* SourceBitmap = bReadDirectly ? Bitmap : FreeImage_ConvertTo32Bits(Bitmap);
+	if (!SourceBitmap)
+	{
+		return false;
 	}
 
+	RawData.SetNumUninitialized((int64)Height * Width * 4);
+
+	TextureSourceFormat = TSF_BGRA8;
+	CompressionSettings = TC_Default;
+	bSRGB = true;
+
+	uint8* TargetPixels = RawData.GetData();
+	const int32 RowWidth = Width;
+	const int32 BytesPerPixel = FreeImage_GetBPP(SourceBitmap) / 8;
+
+	ForEachRow(SourceBitmap, Height, [TargetPixels, RowWidth, BytesPerPixel](int32 Y, const BYTE* ScanLine)
+	{
+		uint8* TargetPixel = TargetPixels + (int64)Y * RowWidth * 4;
+		for (int32 X = 0; X < RowWidth; X++, TargetPixel += 4)
+		{
+			const uint8* P = ScanLine + X * BytesPerPixel;
+			// FI_RGBA_X - cross-platform way to retrieve channels
+			TargetPixel[0] = P[FI_RGBA_BLUE];
+			TargetPixel[1] = P[FI_RGBA_GREEN];
+			TargetPixel[2] = P[FI_RGBA_RED];
+			TargetPixel[3] = BytesPerPixel == 4 ? P[FI_RGBA_ALPHA] : 255;
+		}
+	});
+
+	UnloadConverted(SourceBitmap, Bitmap);
 	return true;
 }
 
 bool FRuntimeTiffLoadHelper::ConvertToRGBA16()
 {
-	RawData.SetNumUninitialized(Height * Width * 4 * 2);
+	// RGB16 and grayscale UINT16 are expanded while copying, everything else goes through FreeImage
+	const int32 SourceType = FreeImage_GetImageType(Bitmap);
+	const bool bReadDirectly = SourceType == FIT_RGBA16 || SourceType == FIT_RGB16 || SourceType == FIT_UINT16;
+
+	FIBITMAP* SourceBitmap = bReadDirectly ? Bitmap : FreeImage_ConvertToType(Bitmap, FIT_RGBA16, true);
+	if (!SourceBitmap)
+	{
+		return false;
+	}
+
+	RawData.SetNumUninitialized((int64)Height * Width * 4 * sizeof(uint16));
 
 	TextureSourceFormat = TSF_RGBA16;
 	CompressionSettings = TC_Default;
 	bSRGB = false;
 
-	FIBITMAP* ConvertedBitmap = FreeImage_ConvertToType(Bitmap, FIT_RGBA16, true);
-	if (ConvertedBitmap)
+	uint16* TargetPixels = (uint16*)RawData.GetData();
+	const int32 RowWidth = Width;
+	const int32 Type = FreeImage_GetImageType(SourceBitmap);
+
+	ForEachRow(SourceBitmap, Height, [TargetPixels, RowWidth, Type](int32 Y, const BYTE* ScanLine)
 	{
-		BYTE* Bits = FreeImage_GetBits(ConvertedBitmap);
-		int32 Pitch = FreeImage_GetPitch(ConvertedBitmap);
-		for (int Y = 0; Y < Height; Y++)
+		uint16* TargetPixel = TargetPixels + (int64)Y * RowWidth * 4;
+		for (int32 X = 0; X < RowWidth; X++, TargetPixel += 4)
 		{
-			BYTE* ScanLine = Bits + Pitch * Y;
-			FIRGBA16* Pixels = (FIRGBA16*)ScanLine;
-			uint16* TargetScanLine = ((uint16*)RawData.GetData()) + Y * Width * 4;
-			for (int X = 0; X < Width; X++)
+			if (Type == FIT_RGBA16)
 			{
-				FIRGBA16 P = Pixels[X];
-				uint16* TargetPixel = TargetScanLine + X * 4;
+				const FIRGBA16& P = ((const FIRGBA16*)ScanLine)[X];
 				TargetPixel[0] = P.red;
 				TargetPixel[1] = P.green;
 				TargetPixel[2] = P.blue;
 				TargetPixel[3] = P.alpha;
 			}
+			else if (Type == FIT_RGB16)
+			{
+				const FIRGB16& P = ((const FIRGB16*)ScanLine)[X];
+				TargetPixel[0] = P.red;
+				TargetPixel[1] = P.green;
+				TargetPixel[2] = P.blue;
+				TargetPixel[3] = MAX_uint16;
+			}
+			else
+			{
+				const uint16 P = ((const uint16*)ScanLine)[X];
+				TargetPixel[0] = P;
+				TargetPixel[1] = P;
+				TargetPixel[2] = P;
+				TargetPixel[3] = MAX_uint16;
+			}
 		}
+	});
 
-		FreeImage_Unload(ConvertedBitmap);
-		return true;
+	UnloadConverted(SourceBitmap, Bitmap);
+	return true;
+}
+
+bool FRuntimeTiffLoadHelper::Save(const uint8* BGRA8, int32 Width, int32 Height, TArray64<uint8>& OutBuffer)
+{
+	if (!FFreeImageWrapper::IsValid())
+	{
+		return false;
 	}
-	return false;
+
+	FIBITMAP* SaveBitmap = FreeImage_ConvertFromRawBits(const_cast<uint8*>(BGRA8), Width, Height, Width * 4, 32, FI_RGBA_RED_MASK, FI_RGBA_GREEN_MASK, FI_RGBA_BLUE_MASK, TRUE);
+	if (!SaveBitmap)
+	{
+		return false;
+	}
+
+	FIMEMORY* SaveMemory = FreeImage_OpenMemory();
+
+	BYTE* SavedData = nullptr;
+	DWORD SavedSize = 0;
+	const bool bSaved = FreeImage_SaveToMemory(FIF_TIFF, SaveBitmap, SaveMemory, TIFF_NONE) && FreeImage_AcquireMemory(SaveMemory, &SavedData, &SavedSize);
+	if (bSaved)
+	{
+		OutBuffer = TArray64<uint8>(SavedData, SavedSize);
+	}
+
+	FreeImage_CloseMemory(SaveMemory);
+	FreeImage_Unload(SaveBitmap);
+
+	return bSaved;
 }
 
 void FRuntimeTiffLoadHelper::SetError(const FString& InErrorMessage)
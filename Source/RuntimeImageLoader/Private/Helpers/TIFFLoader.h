@@ -5,6 +5,8 @@
 #include "CoreMinimal.h"
 #include "Engine/Texture.h"
 
+#include "RuntimeImageData.h"
+
 struct FIBITMAP;
 struct FIMEMORY;
 
@@ -16,6 +18,9 @@ public:
 
 	bool Load(const uint8* Buffer, uint32 Length);
 
+	/** Encodes top-down 8 bit BGRA pixels as uncompressed TIFF */
+	static bool Save(const uint8* BGRA8, int32 Width, int32 Height, TArray64<uint8>& OutBuffer);
+
 	int32 GetBitDepth() const;
 
 	void SetError(const FString& InErrorMessage);
@@ -25,7 +30,7 @@ public:
 
 public:
 	// Resulting image data and properties
-	TArray<uint8> RawData;
+	FRuntimeImageRawData RawData;
 	int32 Width;
 	int32 Height;
 	ETextureSourceFormat TextureSourceFormat = TSF_Invalid;
@@ -34,6 +39,9 @@ public:
 	int32 BitDepth;
 
 private:
+	bool ConvertToRGBA16F();
+	bool ConvertToG8(bool bShouldConvertToByte);
+	bool ConvertToBGRA8();
 	bool ConvertToRGBA16();
 
 private:
@@ -2,12 +2,22 @@
 #include "ImageReaderLocal.h"
 #include "ImageReaderHttp.h"
 
+bool FImageReaderFactory::IsHttpURI(const FString& ImageURI)
+{
+    return ImageURI.StartsWith("http://") || ImageURI.StartsWith("https://");
+}
+
 TSharedPtr<IImageReader, ESPMode::ThreadSafe> FImageReaderFactory::CreateReader(const FString& ImageURI)
 {
-    if (ImageURI.StartsWith("http://") || ImageURI.StartsWith("https://"))
+    if (IsHttpURI(ImageURI))
     {
-        return MakeShared<FImageReaderHttp, ESPMode::ThreadSafe>();
+        return CreateHttpReader(1, 1);
     }
 
     return MakeShared<FImageReaderLocal, ESPMode::ThreadSafe>();
 }
+
+TSharedPtr<IImageReader, ESPMode::ThreadSafe> FImageReaderFactory::CreateHttpReader(int32 MaxConcurrentDownloads, int32 MaxDownloadsPerHost)
+{
+    return MakeShared<FImageReaderHttp, ESPMode::ThreadSafe>(MaxConcurrentDownloads, MaxDownloadsPerHost);
+}
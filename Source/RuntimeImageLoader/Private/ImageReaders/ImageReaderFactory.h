@@ -7,5 +7,9 @@
 class FImageReaderFactory
 {
 public:
+    static bool IsHttpURI(const FString& ImageURI);
+
     static TSharedPtr<IImageReader, ESPMode::ThreadSafe> CreateReader(const FString& ImageURI);
-};
\ No newline at end of file
+    /** Http reader is meant to be shared by all requests so it can keep several downloads in flight */
+    static TSharedPtr<IImageReader, ESPMode::ThreadSafe> CreateHttpReader(int32 MaxConcurrentDownloads, int32 MaxDownloadsPerHost);
+};
@@ -4,44 +4,86 @@
 #include "Launch/Resources/Version.h"
 #include "Interfaces/IHttpRequest.h"
 #include "Interfaces/IHttpResponse.h"
+#include "GenericPlatform/GenericPlatformHttp.h"
 #include "HTTPManager.h"
 #include "HttpModule.h"
+#include "Async/Future.h"
+#include "Misc/ScopeLock.h"
 
-bool FImageReaderHttp::ReadImage(const FString& ImageURI, TArray<uint8>& OutImageData)
+#include "RuntimeImageLoaderStats.h"
+
+FImageReaderHttp::FImageReaderHttp(int32 InMaxConcurrentDownloads, int32 InMaxDownloadsPerHost)
+    : MaxConcurrentDownloads(FMath::Max(1, InMaxConcurrentDownloads))
+    , MaxDownloadsPerHost(FMath::Max(1, InMaxDownloadsPerHost))
 {
-    ImageData = &OutImageData;
-    
-    if (DownloadFuture.IsValid())
-    {
-        ensure(false);
-        return false;
-    }
+}
 
-    DownloadFuture = MakeShared<TFutureState<bool>, ESPMode::ThreadSafe>();
+FImageReaderHttp::~FImageReaderHttp()
+{
+    FScopeLock DownloadsScopeLock(&DownloadsLock);
 
-    // Create the Http request and add to pending request list
-    CurrentHttpRequest = FHttpModule::Get().CreateRequest();
+    for (const FDownloadPtr& Download : ActiveDownloads)
     {
-        CurrentHttpRequest->OnProcessRequestComplete().BindRaw(this, &FImageReaderHttp::HandleImageRequest);
-        CurrentHttpRequest->SetURL(ImageURI);
-        CurrentHttpRequest->SetVerb(TEXT("GET"));
-        CurrentHttpRequest->SetTimeout(60.0f);
-        CurrentHttpRequest->ProcessRequest();
+        Download->HttpRequest->OnProcessRequestComplete().Unbind();
+        Download->HttpRequest->CancelRequest();
     }
 
+    ActiveDownloads.Empty();
+    QueuedDownloads.Empty();
+}
+
+bool FImageReaderHttp::ReadImage(const FString& ImageURI, TArray<uint8>& OutImageData, FString& OutError)
+{
+    TSharedRef<TPromise<bool>, ESPMode::ThreadSafe> DownloadPromise = MakeShared<TPromise<bool>, ESPMode::ThreadSafe>();
+    TFuture<bool> DownloadFuture = DownloadPromise->GetFuture();
+
+    // caller waits for the future, so the outputs outlive the read
+    ReadImageAsync(ImageURI, FImageCacheValidators(), INDEX_NONE,
+        [DownloadPromise, &OutImageData, &OutError](FImageReadResponse&& Response)
+        {
+            OutImageData = MoveTemp(Response.ImageData);
+            OutError = MoveTemp(Response.Error);
+            DownloadPromise->SetValue(Response.bSucceeded);
+        }
+    );
+
     if (IsInGameThread())
     {
-        Flush();
+        // completion is dispatched on game thread so it has to be pumped here, without waiting for other downloads
+        while (!DownloadFuture.IsReady())
+        {
+            Tick();
+            FPlatformProcess::Sleep(0.f);
+        }
     }
 
-    bool bResult = DownloadFuture->GetResult();
+    return DownloadFuture.Get();
+}
 
-    return bResult;
+void FImageReaderHttp::ReadImageAsync(const FString& ImageURI, const FImageCacheValidators& Validators, int32 ReadId, FOnImageReadCompleted OnCompleted)
+{
+    ReadImageProgressive(ImageURI, Validators, ReadId, 0, nullptr, MoveTemp(OnCompleted));
 }
 
-FString FImageReaderHttp::GetLastError() const
+void FImageReaderHttp::ReadImageProgressive(const FString& ImageURI, const FImageCacheValidators& Validators, int32 ReadId, int32 ChunkSize, FOnImageReadProgress OnProgress, FOnImageReadCompleted OnCompleted)
 {
-    return OutError;
+    FDownloadPtr Download = MakeShared<FDownload, ESPMode::ThreadSafe>();
+    {
+        Download->ImageURI = ImageURI;
+        Download->Host = FGenericPlatformHttp::GetUrlDomain(ImageURI);
+        Download->ReadId = ReadId;
+        Download->Validators = Validators;
+        Download->OnCompleted = MoveTemp(OnCompleted);
+        Download->ChunkSize = FMath::Max(0, ChunkSize);
+        Download->OnProgress = MoveTemp(OnProgress);
+    }
+
+    {
+        FScopeLock DownloadsScopeLock(&DownloadsLock);
+        QueuedDownloads.Add(Download);
+    }
+
+    StartQueuedDownloads();
 }
 
 void FImageReaderHttp::Flush()
@@ -55,25 +97,350 @@ void FImageReaderHttp::Flush()
 
 void FImageReaderHttp::Cancel()
 {
-    if (CurrentHttpRequest.IsValid() && DownloadFuture.IsValid() && !DownloadFuture->IsComplete())
+    TArray<FDownloadPtr> DownloadsToCancel;
+    TArray<FDownloadPtr> DownloadsToDrop;
+    {
+        FScopeLock DownloadsScopeLock(&DownloadsLock);
+
+        DownloadsToCancel = ActiveDownloads;
+        DownloadsToDrop = MoveTemp(QueuedDownloads);
+    }
+
+    for (const FDownloadPtr& Download : DownloadsToDrop)
+    {
+        FImageReadResponse Response;
+        Response.Error = TEXT("Download was cancelled");
+
+        Download->OnCompleted(MoveTemp(Response));
+    }
+
+    // completion delegates take care of the rest
+    for (const FDownloadPtr& Download : DownloadsToCancel)
+    {
+        Download->HttpRequest->CancelRequest();
+    }
+}
+
+void FImageReaderHttp::CancelRead(int32 ReadId)
+{
+    if (ReadId == INDEX_NONE)
+    {
+        return;
+    }
+
+    FDownloadPtr DownloadToDrop;
+    TSharedPtr<IHttpRequest, ESPMode::ThreadSafe> RequestToCancel;
+    {
+        FScopeLock DownloadsScopeLock(&DownloadsLock);
+
+        const int32 QueuedIndex = QueuedDownloads.IndexOfByPredicate([ReadId](const FDownloadPtr& Download) { return Download->ReadId == ReadId; });
+        if (QueuedIndex != INDEX_NONE)
+        {
+            DownloadToDrop = QueuedDownloads[QueuedIndex];
+            QueuedDownloads.RemoveAt(QueuedIndex);
+        }
+        else if (const FDownloadPtr* ActiveDownload = ActiveDownloads.FindByPredicate([ReadId](const FDownloadPtr& Download) { return Download->ReadId == ReadId; }))
+        {
+            // progressive download replaces its request with every chunk
+            (*ActiveDownload)->bCancelled = true;
+            RequestToCancel = (*ActiveDownload)->HttpRequest;
+        }
+    }
+
+    if (DownloadToDrop.IsValid())
+    {
+        FImageReadResponse Response;
+        Response.Error = TEXT("Download was cancelled");
+
+        DownloadToDrop->OnCompleted(MoveTemp(Response));
+    }
+
+    if (RequestToCancel.IsValid())
+    {
+        // completion delegate reports the error and frees the slot
+        RequestToCancel->CancelRequest();
+    }
+}
+
+void FImageReaderHttp::PrioritizeRead(int32 ReadId)
+{
+    if (ReadId == INDEX_NONE)
     {
-        CurrentHttpRequest->CancelRequest();
+        return;
     }
+
+    {
+        FScopeLock DownloadsScopeLock(&DownloadsLock);
+
+        const int32 QueuedIndex = QueuedDownloads.IndexOfByPredicate([ReadId](const FDownloadPtr& Download) { return Download->ReadId == ReadId; });
+        if (QueuedIndex == INDEX_NONE)
+        {
+            // started already
+            return;
+        }
+
+        FDownloadPtr Download = QueuedDownloads[QueuedIndex];
+        QueuedDownloads.RemoveAt(QueuedIndex);
+        QueuedDownloads.Insert(Download, 0);
+    }
+
+    StartQueuedDownloads();
 }
 
-void FImageReaderHttp::HandleImageRequest(FHttpRequestPtr HttpRequest, FHttpResponsePtr HttpResponse, bool bSucceeded)
+void FImageReaderHttp::Tick()
 {
-    if (HttpResponse->GetResponseCode() == 200)
+    check(IsInGameThread());
+
+    // unlike Flush, does not wait for other downloads
+    FHttpModule::Get().GetHttpManager().Tick(0.f);
+}
+
+void FImageReaderHttp::StartQueuedDownloads()
+{
+    TArray<FDownloadPtr> DownloadsToStart;
+    {
+        FScopeLock DownloadsScopeLock(&DownloadsLock);
+
+        for (int32 DownloadIndex = 0; DownloadIndex < QueuedDownloads.Num() && ActiveDownloads.Num() < MaxConcurrentDownloads;)
+        {
+            FDownloadPtr Download = QueuedDownloads[DownloadIndex];
+            if (!CanStartDownload(*Download))
+            {
+                ++DownloadIndex;
+                continue;
+            }
+
+            QueuedDownloads.RemoveAt(DownloadIndex);
+
+            Download->HttpRequest = FHttpModule::Get().CreateRequest();
+
+            ActiveDownloads.Add(Download);
+            NumActiveDownloadsPerHost.FindOrAdd(Download->Host)++;
+
+            DownloadsToStart.Add(Download);
+        }
+    }
+
+    // request completion can be reported immediately so it's started outside of the lock
+    for (const FDownloadPtr& Download : DownloadsToStart)
     {
-        ImageData->Append(HttpResponse->GetContent().GetData(), HttpResponse->GetContentLength());
-        DownloadFuture->EmplaceResult(true);
+        StartDownload(Download);
+    }
+}
+
+bool FImageReaderHttp::CanStartDownload(const FDownload& Download) const
+{
+    const int32* NumActiveDownloads = NumActiveDownloadsPerHost.Find(Download.Host);
+    return NumActiveDownloads == nullptr || *NumActiveDownloads < MaxDownloadsPerHost;
+}
+
+void FImageReaderHttp::StartDownload(const FDownloadPtr& Download)
+{
+    TSharedPtr<IHttpRequest, ESPMode::ThreadSafe> HttpRequest = Download->HttpRequest;
+    {
+        HttpRequest->OnProcessRequestComplete().BindRaw(this, &FImageReaderHttp::HandleImageRequest, Download);
+        HttpRequest->SetURL(Download->ImageURI);
+        HttpRequest->SetVerb(TEXT("GET"));
+        // connections are pooled per host by http backend, ask server to keep them open between images
+        HttpRequest->SetHeader(TEXT("Connection"), TEXT("keep-alive"));
+        HttpRequest->SetTimeout(60.0f);
+
+        const int64 RangeStart = Download->ReceivedData.Num();
+        if (Download->ChunkSize > 0)
+        {
+            // servers without range support answer with the whole image
+            HttpRequest->SetHeader(TEXT("Range"), FString::Printf(TEXT("bytes=%lld-%lld"), RangeStart, RangeStart + Download->ChunkSize - 1));
+
+            // whole image is sent again if it was changed since the first chunk
+            const FString& IfRange = Download->ChunkValidators.ETag.IsEmpty() ? Download->ChunkValidators.LastModified : Download->ChunkValidators.ETag;
+            if (RangeStart > 0 && !IfRange.IsEmpty())
+            {
+                HttpRequest->SetHeader(TEXT("If-Range"), IfRange);
+            }
+        }
+
+        // server answers with 304 and no content if cached copy is still valid
+        if (RangeStart == 0 && !Download->Validators.ETag.IsEmpty())
+        {
+            HttpRequest->SetHeader(TEXT("If-None-Match"), Download->Validators.ETag);
+        }
+        if (RangeStart == 0 && !Download->Validators.LastModified.IsEmpty())
+        {
+            HttpRequest->SetHeader(TEXT("If-Modified-Since"), Download->Validators.LastModified);
+        }
+    }
+
+    if (!HttpRequest->ProcessRequest())
+    {
+        HandleImageRequest(HttpRequest, nullptr, false, Download);
+    }
+}
+
+void FImageReaderHttp::HandleImageRequest(FHttpRequestPtr HttpRequest, FHttpResponsePtr HttpResponse, bool bSucceeded, FDownloadPtr Download)
+{
+    {
+        FScopeLock DownloadsScopeLock(&DownloadsLock);
+
+        if (ActiveDownloads.Remove(Download) == 0)
+        {
+            // already handled
+            return;
+        }
+
+        int32& NumActiveDownloads = NumActiveDownloadsPerHost.FindChecked(Download->Host);
+        if (--NumActiveDownloads == 0)
+        {
+            NumActiveDownloadsPerHost.Remove(Download->Host);
+        }
+    }
+
+    FImageReadResponse Response;
+
+    bool bCancelled = false;
+    {
+        FScopeLock DownloadsScopeLock(&DownloadsLock);
+        bCancelled = Download->bCancelled;
+    }
+
+    if (HttpResponse.IsValid())
+    {
+        INC_MEMORY_STAT_BY(STAT_RuntimeImageLoader_BytesDownloaded, HttpResponse->GetContent().Num());
+    }
+
+    const int32 ResponseCode = HttpResponse.IsValid() ? HttpResponse->GetResponseCode() : 0;
+    const bool bNotModified = ResponseCode == 304 && Download->Validators.IsSet();
+    const bool bPartialContent = ResponseCode == 206 && Download->ChunkSize > 0;
+
+    bool bValidChunk = true;
+    if (!bCancelled && bSucceeded && HttpResponse.IsValid() && bPartialContent)
+    {
+        bool bHasMoreChunks = false;
+        bValidChunk = AppendChunk(*HttpResponse, *Download, bHasMoreChunks);
+
+        if (bValidChunk && bHasMoreChunks)
+        {
+            if (Download->OnProgress)
+            {
+                Download->OnProgress(Download->ReceivedData, Download->TotalSize);
+            }
+
+            StartNextChunk(Download);
+            return;
+        }
+    }
+
+    if (bCancelled)
+    {
+        Response.Error = TEXT("Download was cancelled");
+    }
+    else if (!bValidChunk)
+    {
+        Response.Error = FString::Printf(TEXT("Unexpected range of partial content: %s"), *HttpResponse->GetHeader(TEXT("Content-Range")));
+    }
+    else if (bSucceeded && HttpResponse.IsValid() && (ResponseCode == 200 || bNotModified || bPartialContent))
+    {
+        Response.bSucceeded = true;
+        Response.bNotModified = bNotModified;
+        if (bPartialContent)
+        {
+            Response.ImageData = MoveTemp(Download->ReceivedData);
+        }
+        else if (!bNotModified)
+        {
+            Response.ImageData = HttpResponse->GetContent();
+        }
+
+        Response.Validators.ETag = HttpResponse->GetHeader(TEXT("ETag"));
+        Response.Validators.LastModified = HttpResponse->GetHeader(TEXT("Last-Modified"));
+        ParseCacheControl(HttpResponse->GetHeader(TEXT("Cache-Control")), Response);
+    }
+    else if (HttpResponse.IsValid())
+    {
+        Response.Error = FString::Printf(TEXT("Error code: %d, Content: %s"), ResponseCode, *HttpResponse->GetContentAsString());
     }
     else
     {
-        OutError = FString::Printf(TEXT("Error code: %d, Content: %d"), HttpResponse->GetResponseCode(), *HttpResponse->GetContentAsString());
-        DownloadFuture->EmplaceResult(false);
+        Response.Error = TEXT("Connection failed or download was cancelled");
     }
 
-    CurrentHttpRequest = nullptr;
-    DownloadFuture = nullptr;
-}
\ No newline at end of file
+    Download->OnCompleted(MoveTemp(Response));
+
+    StartQueuedDownloads();
+}
+
+void FImageReaderHttp::StartNextChunk(const FDownloadPtr& Download)
+{
+    {
+        FScopeLock DownloadsScopeLock(&DownloadsLock);
+
+        Download->HttpRequest = FHttpModule::Get().CreateRequest();
+
+        ActiveDownloads.Add(Download);
+        NumActiveDownloadsPerHost.FindOrAdd(Download->Host)++;
+    }
+
+    StartDownload(Download);
+}
+
+bool FImageReaderHttp::AppendChunk(const IHttpResponse& HttpResponse, FDownload& Download, bool& bOutHasMoreChunks)
+{
+    // Content-Range: bytes <first>-<last>/<total or *>
+    const FString ContentRange = HttpResponse.GetHeader(TEXT("Content-Range"));
+
+    FString Range;
+    FString Total;
+    if (!ContentRange.StartsWith(TEXT("bytes "), ESearchCase::IgnoreCase) || !ContentRange.Mid(6).Split(TEXT("/"), &Range, &Total))
+    {
+        return false;
+    }
+
+    if (FCString::Atoi64(*Range) != Download.ReceivedData.Num())
+    {
+        return false;
+    }
+
+    if (Download.ReceivedData.Num() == 0)
+    {
+        Download.ChunkValidators.ETag = HttpResponse.GetHeader(TEXT("ETag"));
+        Download.ChunkValidators.LastModified = HttpResponse.GetHeader(TEXT("Last-Modified"));
+    }
+
+    const TArray<uint8>& Content = HttpResponse.GetContent();
+    Download.ReceivedData.Append(Content);
+    Download.TotalSize = Total.TrimStartAndEnd().Equals(TEXT("*")) ? -1 : FCString::Atoi64(*Total);
+
+    bOutHasMoreChunks = (Download.TotalSize >= 0) ? Download.ReceivedData.Num() < Download.TotalSize : Content.Num() == Download.ChunkSize;
+
+    return Content.Num() > 0;
+}
+
+void FImageReaderHttp::ParseCacheControl(const FString& CacheControl, FImageReadResponse& OutResponse)
+{
+    TArray<FString> Directives;
+    CacheControl.ParseIntoArray(Directives, TEXT(","));
+
+    bool bNoCache = false;
+    for (FString& Directive : Directives)
+    {
+        Directive.TrimStartAndEndInline();
+
+        if (Directive.StartsWith(TEXT("max-age="), ESearchCase::IgnoreCase))
+        {
+            OutResponse.MaxAge = FMath::Max(0, FCString::Atoi(*Directive.Mid(8)));
+        }
+        else if (Directive.Equals(TEXT("no-cache"), ESearchCase::IgnoreCase))
+        {
+            // can be stored but has to be validated every time
+            bNoCache = true;
+        }
+        else if (Directive.Equals(TEXT("no-store"), ESearchCase::IgnoreCase))
+        {
+            OutResponse.bNoStore = true;
+        }
+    }
+
+    if (bNoCache)
+    {
+        OutResponse.MaxAge = 0;
+    }
+}
@@ -4,28 +4,74 @@
 
 #include "CoreMinimal.h"
 #include "Interfaces/IHttpRequest.h"
-#include "Async/Future.h"
+#include "Interfaces/IHttpResponse.h"
+#include "HAL/CriticalSection.h"
 #include "ImageReaders/IImageReader.h"
 
+/**
+ * Downloads images over HTTP. Single instance is shared by all requests:
+ * it keeps up to MaxConcurrentDownloads requests in flight and queues the rest.
+ */
 class FImageReaderHttp : public IImageReader
 {
 public:
-    virtual ~FImageReaderHttp() {}
+    FImageReaderHttp(int32 InMaxConcurrentDownloads, int32 InMaxDownloadsPerHost);
+    virtual ~FImageReaderHttp();
 
-    virtual bool ReadImage(const FString& ImageURI, TArray<uint8>& OutImageData) override;
-    virtual FString GetLastError() const override;
+    virtual bool ReadImage(const FString& ImageURI, TArray<uint8>& OutImageData, FString& OutError) override;
     virtual void Flush() override;
     virtual void Cancel() override;
 
+    virtual bool SupportsAsyncRead() const override { return true; }
+    virtual void ReadImageAsync(const FString& ImageURI, const FImageCacheValidators& Validators, int32 ReadId, FOnImageReadCompleted OnCompleted) override;
+    virtual void ReadImageProgressive(const FString& ImageURI, const FImageCacheValidators& Validators, int32 ReadId, int32 ChunkSize, FOnImageReadProgress OnProgress, FOnImageReadCompleted OnCompleted) override;
+    virtual void CancelRead(int32 ReadId) override;
+    virtual void PrioritizeRead(int32 ReadId) override;
+    virtual void Tick() override;
+
 private:
+    struct FDownload
+    {
+        FString ImageURI;
+        FString Host;
+        int32 ReadId = INDEX_NONE;
+        // set by CancelRead, progressive download does not request next chunks
+        bool bCancelled = false;
+        FImageCacheValidators Validators;
+        FOnImageReadCompleted OnCompleted;
+        TSharedPtr<IHttpRequest, ESPMode::ThreadSafe> HttpRequest;
+
+        // progressive downloads are split into range requests of this size
+        int32 ChunkSize = 0;
+        FOnImageReadProgress OnProgress;
+        TArray<uint8> ReceivedData;
+        int64 TotalSize = -1;
+        // later chunks are accepted only if image was not changed since the first one
+        FImageCacheValidators ChunkValidators;
+    };
+
+    typedef TSharedPtr<FDownload, ESPMode::ThreadSafe> FDownloadPtr;
+
+    /** Starts queued downloads while there are free slots */
+    void StartQueuedDownloads();
+    bool CanStartDownload(const FDownload& Download) const;
+    void StartDownload(const FDownloadPtr& Download);
+    /** Keeps download slot and requests the next range of progressive download */
+    void StartNextChunk(const FDownloadPtr& Download);
+    /** Returns false if chunk does not continue already received data */
+    static bool AppendChunk(const IHttpResponse& HttpResponse, FDownload& Download, bool& bOutHasMoreChunks);
+
     /** Handles image requests coming from the web */
-    void HandleImageRequest(FHttpRequestPtr HttpRequest, FHttpResponsePtr HttpResponse, bool bSucceeded);
+    void HandleImageRequest(FHttpRequestPtr HttpRequest, FHttpResponsePtr HttpResponse, bool bSucceeded, FDownloadPtr Download);
 
-private:
-    TArray<uint8>* ImageData;
-    TSharedPtr<TFutureState<bool>, ESPMode::ThreadSafe> DownloadFuture;
+    static void ParseCacheControl(const FString& CacheControl, FImageReadResponse& OutResponse);
 
-    TSharedPtr<IHttpRequest, ESPMode::ThreadSafe> CurrentHttpRequest;
+private:
+    const int32 MaxConcurrentDownloads;
+    const int32 MaxDownloadsPerHost;
 
-    FString OutError;
-};
\ No newline at end of file
+    TArray<FDownloadPtr> QueuedDownloads;
+    TArray<FDownloadPtr> ActiveDownloads;
+    TMap<FString, int32> NumActiveDownloadsPerHost;
+    mutable FCriticalSection DownloadsLock;
+};
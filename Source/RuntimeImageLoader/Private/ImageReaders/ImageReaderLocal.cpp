@@ -1,48 +1,90 @@
 // Copyright 2022 Peter Leontev. All Rights Reserved.
 
 #include "ImageReaderLocal.h"
-#include "HAL/FileManager.h"
-#include "Misc/FileHelper.h"
+#include "HAL/PlatformFileManager.h"
+#include "GenericPlatform/GenericPlatformFile.h"
+#include "Async/MappedFileHandle.h"
+#include "Templates/UniquePtr.h"
 #include "Stats/Stats.h"
 
-bool FImageReaderLocal::ReadImage(const FString& ImageURI, TArray<uint8>& OutImageData)
-{
-    QUICK_SCOPE_CYCLE_COUNTER(STAT_RuntimeImageUtils_ImportFileAsTexture);
+#include "RuntimeImageLoaderStats.h"
 
+namespace
+{
     // TODO:
     const int64 MAX_FILESIZE_BYTES = 999999999;
+}
 
-    IFileManager& FileManager = IFileManager::Get();
-    if (!FileManager.FileExists(*ImageURI))
+bool FImageReaderLocal::ReadImage(const FString& ImageURI, TArray<uint8>& OutImageData, FString& OutError)
+{
+    // opening the file tells whether it exists, no need to ask file system separately
+    TUniquePtr<IFileHandle> FileHandle(FPlatformFileManager::Get().GetPlatformFile().OpenRead(*ImageURI));
+    if (!FileHandle.IsValid())
     {
         OutError = FString::Printf(TEXT("Image does not exist: %s"), *ImageURI);
         return false;
     }
 
-    const int64 ImageFileSizeBytes = FileManager.FileSize(*ImageURI);
-    check(ImageFileSizeBytes != INDEX_NONE);
-
-    // check filesize
-    if (ImageFileSizeBytes > MAX_FILESIZE_BYTES)
+    const int64 ImageFileSizeBytes = FileHandle->Size();
+    if (!CheckFileSize(ImageURI, ImageFileSizeBytes, OutError))
     {
-        OutError = FString::Printf(TEXT("Image filesize > %d MBs): %s"), MAX_FILESIZE_BYTES, *ImageURI);
         return false;
     }
 
-    QUICK_SCOPE_CYCLE_COUNTER(STAT_FImageReaderLocal_LoadFileToArray);
-    if (!FFileHelper::LoadFileToArray(OutImageData, *ImageURI))
+    OutImageData.SetNumUninitialized(ImageFileSizeBytes);
+    if (!FileHandle->Read(OutImageData.GetData(), ImageFileSizeBytes))
     {
+        OutImageData.Empty();
         OutError = FString::Printf(TEXT("Image loading I/O error: %s"), *ImageURI);
         return false;
     }
-    OutImageData.Add(0);
+
+    INC_MEMORY_STAT_BY(STAT_RuntimeImageLoader_BytesRead, ImageFileSizeBytes);
 
     return true;
 }
 
-FString FImageReaderLocal::GetLastError() const
+bool FImageReaderLocal::ReadImageBuffer(const FString& ImageURI, FImageReadBuffer& OutBuffer, FString& OutError)
 {
-    return OutError;
+    // not every platform file supports mapping, e.g. pak files
+    TUniquePtr<IMappedFileHandle> MappedFile(FPlatformFileManager::Get().GetPlatformFile().OpenMapped(*ImageURI));
+    if (MappedFile.IsValid())
+    {
+        const int64 ImageFileSizeBytes = MappedFile->GetFileSize();
+        if (!CheckFileSize(ImageURI, ImageFileSizeBytes, OutError))
+        {
+            return false;
+        }
+
+        TUniquePtr<IMappedFileRegion> MappedRegion(MappedFile->MapRegion(0, ImageFileSizeBytes));
+        if (MappedRegion.IsValid())
+        {
+            // decoders read straight from the page cache
+            OutBuffer.SetMappedFile(MoveTemp(MappedFile), MoveTemp(MappedRegion));
+
+            INC_MEMORY_STAT_BY(STAT_RuntimeImageLoader_BytesRead, ImageFileSizeBytes);
+            return true;
+        }
+    }
+
+    return IImageReader::ReadImageBuffer(ImageURI, OutBuffer, OutError);
+}
+
+bool FImageReaderLocal::CheckFileSize(const FString& ImageURI, int64 FileSize, FString& OutError)
+{
+    if (FileSize <= 0)
+    {
+        OutError = FString::Printf(TEXT("Image file is empty: %s"), *ImageURI);
+        return false;
+    }
+
+    if (FileSize > MAX_FILESIZE_BYTES)
+    {
+        OutError = FString::Printf(TEXT("Image filesize > %lld bytes: %s"), MAX_FILESIZE_BYTES, *ImageURI);
+        return false;
+    }
+
+    return true;
 }
 
 void FImageReaderLocal::Flush()
@@ -10,11 +10,12 @@ class FImageReaderLocal : public IImageReader
 public:
     virtual ~FImageReaderLocal() {}
 
-    virtual bool ReadImage(const FString& ImageURI, TArray<uint8>& OutImageData) override;
-    virtual FString GetLastError() const override;
+    virtual bool ReadImage(const FString& ImageURI, TArray<uint8>& OutImageData, FString& OutError) override;
+    /** Maps the file where platform supports it, falls back to reading it into memory */
+    virtual bool ReadImageBuffer(const FString& ImageURI, FImageReadBuffer& OutBuffer, FString& OutError) override;
     virtual void Flush() override;
     virtual void Cancel() override;
 
 private:
-    FString OutError;
+    static bool CheckFileSize(const FString& ImageURI, int64 FileSize, FString& OutError);
 };
\ No newline at end of file
@@ -0,0 +1,484 @@
+// Copyright 2022 Peter Leontev. All Rights Reserved.
+
+#include "RuntimeImageBenchmark.h"
+#include "Async/Async.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformMemory.h"
+#include "HAL/PlatformTime.h"
+#include "HAL/PlatformProperties.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Engine/Texture2D.h"
+#include "RenderingThread.h"
+#include "UObject/UObjectGlobals.h"
+#include "UObject/Package.h"
+#include "Dom/JsonObject.h"
+#include "Serialization/JsonWriter.h"
+#include "Serialization/JsonSerializer.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogRuntimeImageBenchmark, Log, All);
+
+namespace
+{
+    const int32 NumBaselineFrames = 60;
+    const double HitchFrameFactor = 2.0;
+
+    const TCHAR* const SupportedExtensions[] = { TEXT("png"), TEXT("jpg"), TEXT("jpeg"), TEXT("bmp"), TEXT("tga"), TEXT("exr"), TEXT("tif"), TEXT("tiff"), TEXT("qoi") };
+
+    bool IsSupportedExtension(const FString& Extension)
+    {
+        for (const TCHAR* SupportedExtension : SupportedExtensions)
+        {
+            if (Extension == SupportedExtension)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    FAutoConsoleCommand RuntimeImageBenchmarkCommand(
+        TEXT("RuntimeImageLoader.Benchmark"),
+        TEXT("Loads a generated image corpus with several transform settings and writes a JSON report to Saved/RuntimeImageLoader/Benchmark.\n")
+        TEXT("Optional: Sizes=512,1024,2048,4096,8192 Formats=PNG8,PNG16,JPEG,BMP,TGA_RLE,EXR,TIFF,QOI Iterations=5 Corpus=<dir> Output=<file.json>"),
+        FConsoleCommandWithArgsDelegate::CreateStatic(&URuntimeImageBenchmark::Run)
+    );
+}
+
+TWeakObjectPtr<URuntimeImageBenchmark> URuntimeImageBenchmark::ActiveBenchmark;
+
+void URuntimeImageBenchmark::Run(const TArray<FString>& Args)
+{
+    if (ActiveBenchmark.IsValid())
+    {
+        UE_LOG(LogRuntimeImageBenchmark, Warning, TEXT("Benchmark is already running"));
+        return;
+    }
+
+    URuntimeImageBenchmark* Benchmark = NewObject<URuntimeImageBenchmark>(GetTransientPackage());
+    Benchmark->AddToRoot();
+
+    if (!Benchmark->Start(Args))
+    {
+        Benchmark->RemoveFromRoot();
+        return;
+    }
+
+    ActiveBenchmark = Benchmark;
+}
+
+bool URuntimeImageBenchmark::Start(const TArray<FString>& Args)
+{
+    const FString Params = FString::Join(Args, TEXT(" "));
+    const FString BenchmarkDir = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("RuntimeImageLoader"), TEXT("Benchmark"));
+
+    TArray<int32> Sizes = { 512, 1024, 2048, 4096, 8192 };
+    FString SizesValue;
+    if (FParse::Value(*Params, TEXT("Sizes="), SizesValue))
+    {
+        TArray<FString> SizeStrings;
+        SizesValue.ParseIntoArray(SizeStrings, TEXT(","));
+
+        Sizes.Reset();
+        for (const FString& SizeString : SizeStrings)
+        {
+            const int32 Size = FCString::Atoi(*SizeString);
+            if (Size > 0)
+            {
+                Sizes.Add(Size);
+            }
+        }
+    }
+
+    TArray<FBenchmarkHelpers::ECorpusEncoding> Encodings;
+    FString FormatsValue;
+    if (FParse::Value(*Params, TEXT("Formats="), FormatsValue))
+    {
+        TArray<FString> FormatStrings;
+        FormatsValue.ParseIntoArray(FormatStrings, TEXT(","));
+
+        for (const FString& FormatString : FormatStrings)
+        {
+            FBenchmarkHelpers::ECorpusEncoding Encoding;
+            if (!FBenchmarkHelpers::ParseEncoding(FormatString, Encoding))
+            {
+                UE_LOG(LogRuntimeImageBenchmark, Error, TEXT("Unknown benchmark format: %s"), *FormatString);
+                return false;
+            }
+            Encodings.Add(Encoding);
+        }
+    }
+    else
+    {
+        for (uint8 Encoding = (uint8)FBenchmarkHelpers::ECorpusEncoding::PNG8; Encoding <= (uint8)FBenchmarkHelpers::ECorpusEncoding::QOI; ++Encoding)
+        {
+            Encodings.Add((FBenchmarkHelpers::ECorpusEncoding)Encoding);
+        }
+    }
+
+    FParse::Value(*Params, TEXT("Iterations="), Iterations);
+    Iterations = FMath::Max(1, Iterations);
+
+    FString CorpusDir = FPaths::Combine(BenchmarkDir, TEXT("Corpus"));
+    FParse::Value(*Params, TEXT("Corpus="), CorpusDir);
+
+    OutputFilename = FPaths::Combine(BenchmarkDir, FString::Printf(TEXT("Benchmark-%s.json"), *FDateTime::Now().ToString()));
+    FParse::Value(*Params, TEXT("Output="), OutputFilename);
+
+    UE_LOG(LogRuntimeImageBenchmark, Log, TEXT("Preparing benchmark corpus in %s"), *CorpusDir);
+
+    // encoding 8K images takes a while, keep the game thread responsive
+    CorpusFuture = Async(EAsyncExecution::Thread, [this, CorpusDir, Sizes, Encodings]()
+    {
+        PrepareCorpus(CorpusDir, Sizes, Encodings);
+    });
+
+    State = EState::PreparingCorpus;
+    return true;
+}
+
+void URuntimeImageBenchmark::PrepareCorpus(const FString& CorpusDir, const TArray<int32>& Sizes, const TArray<FBenchmarkHelpers::ECorpusEncoding>& Encodings)
+{
+    IFileManager& FileManager = IFileManager::Get();
+    FileManager.MakeDirectory(*CorpusDir, true);
+
+    for (FBenchmarkHelpers::ECorpusEncoding Encoding : Encodings)
+    {
+        for (int32 Size : Sizes)
+        {
+            FRuntimeImageBenchmarkFile File;
+            File.Filename = FPaths::Combine(CorpusDir, FString::Printf(TEXT("%s_%d.%s"), FBenchmarkHelpers::GetEncodingName(Encoding), Size, FBenchmarkHelpers::GetEncodingExtension(Encoding)));
+            File.Format = FBenchmarkHelpers::GetEncodingName(Encoding);
+            File.Size = FIntPoint(Size, Size);
+
+            // the corpus is deterministic, files of previous runs are reused
+            if (!FileManager.FileExists(*File.Filename))
+            {
+                TArray64<uint8> Buffer;
+                FString Error;
+                if (!FBenchmarkHelpers::EncodeCorpusImage(Encoding, Size, Buffer, Error) || !FFileHelper::SaveArrayToFile(Buffer, *File.Filename))
+                {
+                    UE_LOG(LogRuntimeImageBenchmark, Warning, TEXT("Skipping %s: %s"), *File.Filename, Error.IsEmpty() ? TEXT("failed to write file") : *Error);
+                    continue;
+                }
+            }
+
+            File.FileSize = FileManager.FileSize(*File.Filename);
+            Files.Add(MoveTemp(File));
+        }
+    }
+
+    // images put into the corpus directory by hand are benchmarked too, their size is known after the first load
+    TArray<FString> FoundFiles;
+    FileManager.FindFiles(FoundFiles, *CorpusDir, nullptr);
+    FoundFiles.Sort();
+
+    for (const FString& FoundFile : FoundFiles)
+    {
+        const FString Extension = FPaths::GetExtension(FoundFile).ToLower();
+        if (!IsSupportedExtension(Extension))
+        {
+            continue;
+        }
+
+        const FString Filename = FPaths::Combine(CorpusDir, FoundFile);
+        if (Files.ContainsByPredicate([&Filename](const FRuntimeImageBenchmarkFile& File) { return File.Filename == Filename; }))
+        {
+            continue;
+        }
+
+        // generated files of sizes or formats that are not benchmarked this time
+        FString EncodingName, SizeString;
+        FBenchmarkHelpers::ECorpusEncoding Encoding;
+        if (FPaths::GetBaseFilename(FoundFile).Split(TEXT("_"), &EncodingName, &SizeString, ESearchCase::IgnoreCase, ESearchDir::FromEnd) &&
+            FBenchmarkHelpers::ParseEncoding(EncodingName, Encoding) && SizeString.IsNumeric())
+        {
+            continue;
+        }
+
+        FRuntimeImageBenchmarkFile& File = Files.AddDefaulted_GetRef();
+        File.Filename = Filename;
+        File.Format = Extension.ToUpper();
+        File.FileSize = FileManager.FileSize(*Filename);
+    }
+}
+
+void URuntimeImageBenchmark::AddConfigs()
+{
+    for (int32 FileIndex = 0; FileIndex < Files.Num(); ++FileIndex)
+    {
+        for (bool bForUI : { true, false })
+        {
+            // full size goes first, it tells the size of images that were not generated
+            for (bool bResize : { false, true })
+            {
+                FRuntimeImageBenchmarkConfig& Config = Configs.AddDefaulted_GetRef();
+                Config.FileIndex = FileIndex;
+                Config.Name = FString::Printf(TEXT("%s %s %s"), *FPaths::GetBaseFilename(Files[FileIndex].Filename), bForUI ? TEXT("UI") : TEXT("3D"), bResize ? TEXT("Half") : TEXT("Full"));
+                Config.TransformParams.bForUI = bForUI;
+
+                if (bResize)
+                {
+                    Config.TransformParams.PercentSizeX = 50;
+                    Config.TransformParams.PercentSizeY = 50;
+                    Config.TransformParams.ResizeFilter = ERuntimeImageResizeFilter::Bilinear;
+                }
+            }
+        }
+    }
+}
+
+void URuntimeImageBenchmark::Tick(float DeltaTime)
+{
+    switch (State)
+    {
+    case EState::PreparingCorpus:
+    {
+        if (!CorpusFuture.IsReady())
+        {
+            return;
+        }
+
+        if (Files.Num() == 0)
+        {
+            UE_LOG(LogRuntimeImageBenchmark, Error, TEXT("Benchmark corpus is empty"));
+            Finish();
+            return;
+        }
+
+        AddConfigs();
+
+        // cached files or pooled textures would be measured instead of decodes and uploads
+        ImageReader = NewObject<URuntimeImageReader>(this);
+        ImageReader->Initialize(false);
+
+        UE_LOG(LogRuntimeImageBenchmark, Log, TEXT("Running %d benchmark configurations, %d iterations each"), Configs.Num(), Iterations);
+
+        State = EState::MeasuringBaseline;
+        LastFrameTime = FPlatformTime::Seconds();
+        break;
+    }
+    case EState::MeasuringBaseline:
+    {
+        const double Now = FPlatformTime::Seconds();
+        BaselineFrameTimesMs.Add((Now - LastFrameTime) * 1000.0);
+        LastFrameTime = Now;
+
+        if (BaselineFrameTimesMs.Num() < NumBaselineFrames)
+        {
+            return;
+        }
+
+        BaselineFrameTimesMs.Sort();
+        BaselineFrameMs = FBenchmarkHelpers::GetPercentile(BaselineFrameTimesMs, 50.0);
+
+        State = EState::Running;
+        ConfigIndex = 0;
+        StartConfig();
+        break;
+    }
+    case EState::Running:
+    {
+        SampleFrame();
+
+        FImageReadResult ReadResult;
+        if (!ImageReader->GetResult(RequestId, ReadResult))
+        {
+            return;
+        }
+
+        const double LatencyMs = (FPlatformTime::Seconds() - RequestStartTime) * 1000.0;
+
+        FRuntimeImageBenchmarkConfig& Config = Configs[ConfigIndex];
+        FRuntimeImageBenchmarkFile& File = Files[Config.FileIndex];
+
+        if (ReadResult.OutError.IsEmpty() && IsValid(ReadResult.OutTexture))
+        {
+            if (File.Size == FIntPoint::ZeroValue && !Config.TransformParams.IsPercentSizeValid())
+            {
+                File.Size = FIntPoint(ReadResult.OutTexture->GetSizeX(), ReadResult.OutTexture->GetSizeY());
+            }
+
+            if (Iteration >= 0)
+            {
+                Config.LatenciesMs.Add(LatencyMs);
+            }
+        }
+        else if (Iteration >= 0)
+        {
+            ++Config.NumFailed;
+            Config.LastError = ReadResult.OutError;
+        }
+
+        ImageReader->ReleaseTexture(ReadResult.OutTexture);
+
+        if (++Iteration < Iterations)
+        {
+            SubmitRequest();
+            return;
+        }
+
+        UE_LOG(LogRuntimeImageBenchmark, Log, TEXT("[%d/%d] %s done"), ConfigIndex + 1, Configs.Num(), *Config.Name);
+
+        if (++ConfigIndex < Configs.Num())
+        {
+            StartConfig();
+            return;
+        }
+
+        Finish();
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+bool URuntimeImageBenchmark::IsTickable() const
+{
+    return State != EState::Finished && !HasAnyFlags(RF_ClassDefaultObject);
+}
+
+TStatId URuntimeImageBenchmark::GetStatId() const
+{
+    RETURN_QUICK_DECLARE_CYCLE_STAT(URuntimeImageBenchmark, STATGROUP_Tickables);
+}
+
+void URuntimeImageBenchmark::StartConfig()
+{
+    // textures of the previous configuration must not count towards peak memory of this one
+    CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+    FlushRenderingCommands();
+
+    FRuntimeImageBenchmarkConfig& Config = Configs[ConfigIndex];
+    Config.BaselineMemory = FPlatformMemory::GetStats().UsedPhysical;
+    Config.FramePeakMemory = Config.BaselineMemory;
+
+    Iteration = -1;
+    SubmitRequest();
+
+    // garbage collection above is not a hitch of the loader
+    LastFrameTime = FPlatformTime::Seconds();
+}
+
+void URuntimeImageBenchmark::SubmitRequest()
+{
+    const FRuntimeImageBenchmarkConfig& Config = Configs[ConfigIndex];
+
+    FImageReadRequest Request;
+    Request.ImageFilename = Files[Config.FileIndex].Filename;
+    Request.TransformParams = Config.TransformParams;
+
+    RequestStartTime = FPlatformTime::Seconds();
+    RequestId = ImageReader->AddRequest(Request);
+    ImageReader->Trigger();
+}
+
+void URuntimeImageBenchmark::SampleFrame()
+{
+    FRuntimeImageBenchmarkConfig& Config = Configs[ConfigIndex];
+
+    const double Now = FPlatformTime::Seconds();
+    const double FrameMs = (Now - LastFrameTime) * 1000.0;
+    LastFrameTime = Now;
+
+    Config.MaxFrameMs = FMath::Max(Config.MaxFrameMs, FrameMs);
+    if (FrameMs > BaselineFrameMs * HitchFrameFactor)
+    {
+        Config.HitchMs += FrameMs - BaselineFrameMs;
+    }
+
+    Config.FramePeakMemory = FMath::Max(Config.FramePeakMemory, FPlatformMemory::GetStats().UsedPhysical);
+}
+
+void URuntimeImageBenchmark::Finish()
+{
+    if (Configs.Num() > 0)
+    {
+        WriteReport();
+    }
+
+    if (IsValid(ImageReader))
+    {
+        ImageReader->Deinitialize();
+        ImageReader = nullptr;
+    }
+
+    State = EState::Finished;
+    ActiveBenchmark.Reset();
+    RemoveFromRoot();
+}
+
+void URuntimeImageBenchmark::WriteReport() const
+{
+    TArray<TSharedPtr<FJsonValue>> Results;
+
+    for (const FRuntimeImageBenchmarkConfig& Config : Configs)
+    {
+        const FRuntimeImageBenchmarkFile& File = Files[Config.FileIndex];
+
+        TArray<double> Latencies = Config.LatenciesMs;
+        Latencies.Sort();
+
+        double TotalLatencyMs = 0.0;
+        for (double Latency : Latencies)
+        {
+            TotalLatencyMs += Latency;
+        }
+
+        const double Megapixels = (double)File.Size.X * File.Size.Y / 1000000.0;
+
+        TSharedRef<FJsonObject> Latency = MakeShared<FJsonObject>();
+        Latency->SetNumberField(TEXT("Min"), Latencies.Num() > 0 ? Latencies[0] : 0.0);
+        Latency->SetNumberField(TEXT("Mean"), Latencies.Num() > 0 ? TotalLatencyMs / Latencies.Num() : 0.0);
+        Latency->SetNumberField(TEXT("P50"), FBenchmarkHelpers::GetPercentile(Latencies, 50.0));
+        Latency->SetNumberField(TEXT("P90"), FBenchmarkHelpers::GetPercentile(Latencies, 90.0));
+        Latency->SetNumberField(TEXT("P99"), FBenchmarkHelpers::GetPercentile(Latencies, 99.0));
+        Latency->SetNumberField(TEXT("Max"), Latencies.Num() > 0 ? Latencies.Last() : 0.0);
+
+        TSharedRef<FJsonObject> GameThread = MakeShared<FJsonObject>();
+        GameThread->SetNumberField(TEXT("MaxFrameMs"), Config.MaxFrameMs);
+        GameThread->SetNumberField(TEXT("HitchMs"), Config.HitchMs);
+
+        TSharedRef<FJsonObject> Result = MakeShared<FJsonObject>();
+        Result->SetStringField(TEXT("Name"), Config.Name);
+        Result->SetStringField(TEXT("File"), FPaths::GetCleanFilename(File.Filename));
+        Result->SetStringField(TEXT("Format"), File.Format);
+        Result->SetNumberField(TEXT("Width"), File.Size.X);
+        Result->SetNumberField(TEXT("Height"), File.Size.Y);
+        Result->SetNumberField(TEXT("FileSizeBytes"), (double)File.FileSize);
+        Result->SetBoolField(TEXT("bForUI"), Config.TransformParams.bForUI);
+        Result->SetNumberField(TEXT("ResizePercent"), Config.TransformParams.IsPercentSizeValid() ? Config.TransformParams.PercentSizeX : 100);
+        Result->SetNumberField(TEXT("Iterations"), Iterations);
+        Result->SetNumberField(TEXT("Failed"), Config.NumFailed);
+        Result->SetStringField(TEXT("Error"), Config.LastError);
+        Result->SetNumberField(TEXT("ThroughputMPs"), TotalLatencyMs > 0.0 ? Megapixels * Latencies.Num() / (TotalLatencyMs / 1000.0) : 0.0);
+        Result->SetObjectField(TEXT("LatencyMs"), Latency);
+        Result->SetNumberField(TEXT("FramePeakMemoryMB"), (double)(Config.FramePeakMemory - Config.BaselineMemory) / (1024.0 * 1024.0));
+        Result->SetObjectField(TEXT("GameThread"), GameThread);
+
+        Results.Add(MakeShared<FJsonValueObject>(Result));
+    }
+
+    TSharedRef<FJsonObject> Report = MakeShared<FJsonObject>();
+    Report->SetStringField(TEXT("Date"), FDateTime::UtcNow().ToIso8601());
+    Report->SetStringField(TEXT("Platform"), FPlatformProperties::IniPlatformName());
+    Report->SetStringField(TEXT("CPU"), FPlatformMisc::GetCPUBrand().TrimStartAndEnd());
+    Report->SetNumberField(TEXT("NumCores"), FPlatformMisc::NumberOfCoresIncludingHyperthreads());
+    Report->SetNumberField(TEXT("BaselineFrameMs"), BaselineFrameMs);
+    Report->SetArrayField(TEXT("Results"), Results);
+
+    FString Json;
+    TSharedRef<TJsonWriter<>> JsonWriter = TJsonWriterFactory<>::Create(&Json);
+    FJsonSerializer::Serialize(Report, JsonWriter);
+
+    if (FFileHelper::SaveStringToFile(Json, *OutputFilename))
+    {
+        UE_LOG(LogRuntimeImageBenchmark, Log, TEXT("Benchmark report saved to %s"), *OutputFilename);
+    }
+    else
+    {
+        UE_LOG(LogRuntimeImageBenchmark, Error, TEXT("Failed to save benchmark report to %s"), *OutputFilename);
+    }
+}
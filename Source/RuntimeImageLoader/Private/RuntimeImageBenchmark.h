@@ -0,0 +1,104 @@
+// Copyright 2022 Peter Leontev. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Tickable.h"
+#include "Async/Future.h"
+#include "RuntimeImageReader.h"
+#include "Helpers/BenchmarkHelpers.h"
+#include "RuntimeImageBenchmark.generated.h"
+
+
+struct FRuntimeImageBenchmarkFile
+{
+    FString Filename;
+    FString Format;
+    FIntPoint Size = FIntPoint::ZeroValue;
+    int64 FileSize = 0;
+};
+
+struct FRuntimeImageBenchmarkConfig
+{
+    int32 FileIndex = INDEX_NONE;
+    FString Name;
+    FTransformImageParams TransformParams;
+
+    TArray<double> LatenciesMs;
+    int32 NumFailed = 0;
+    FString LastError;
+
+    uint64 BaselineMemory = 0;
+    // highest memory use sampled once per frame, peaks within a frame are missed
+    uint64 FramePeakMemory = 0;
+
+    double MaxFrameMs = 0.0;
+    double HitchMs = 0.0;
+};
+
+/**
+ * Loads every image of the corpus with each transform configuration through a dedicated image reader, one request at a time,
+ * and writes throughput, latency percentiles, per-frame peak memory and game thread hitches to a JSON report.
+ * Started by the RuntimeImageLoader.Benchmark console command
+ */
+UCLASS(Transient)
+class URuntimeImageBenchmark : public UObject, public FTickableGameObject
+{
+    GENERATED_BODY()
+
+public:
+    /** Accepts Sizes=512,1024 Formats=PNG8,JPEG Iterations=N Corpus=<dir> Output=<file.json> */
+    static void Run(const TArray<FString>& Args);
+
+protected:
+    // FTickableGameObject
+    void Tick(float DeltaTime) override;
+    bool IsTickable() const override;
+    TStatId GetStatId() const override;
+    // ~FTickableGameObject
+
+private:
+    bool Start(const TArray<FString>& Args);
+    void PrepareCorpus(const FString& CorpusDir, const TArray<int32>& Sizes, const TArray<FBenchmarkHelpers::ECorpusEncoding>& Encodings);
+    void AddConfigs();
+
+    void StartConfig();
+    void SubmitRequest();
+    void SampleFrame();
+    void Finish();
+    void WriteReport() const;
+
+private:
+    enum class EState : uint8
+    {
+        PreparingCorpus,
+        MeasuringBaseline,
+        Running,
+        Finished
+    };
+
+    EState State = EState::PreparingCorpus;
+
+    UPROPERTY()
+    URuntimeImageReader* ImageReader = nullptr;
+
+    TFuture<void> CorpusFuture;
+    TArray<FRuntimeImageBenchmarkFile> Files;
+    TArray<FRuntimeImageBenchmarkConfig> Configs;
+
+    int32 Iterations = 5;
+    FString OutputFilename;
+
+    // frame time of an idle game thread, hitches are measured against it
+    TArray<double> BaselineFrameTimesMs;
+    double BaselineFrameMs = 0.0;
+    double LastFrameTime = 0.0;
+
+    int32 ConfigIndex = INDEX_NONE;
+    // iteration -1 warms up caches of the decoders and is not measured
+    int32 Iteration = 0;
+    int32 RequestId = INDEX_NONE;
+    double RequestStartTime = 0.0;
+
+    static TWeakObjectPtr<URuntimeImageBenchmark> ActiveBenchmark;
+};
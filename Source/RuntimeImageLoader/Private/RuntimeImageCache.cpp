@@ -0,0 +1,312 @@
+// Copyright 2022 Peter Leontev. All Rights Reserved.
+
+#include "RuntimeImageCache.h"
+#include "Engine/Texture2D.h"
+#include "RenderUtils.h"
+#include "Launch/Resources/Version.h"
+
+
+DEFINE_LOG_CATEGORY_STATIC(LogRuntimeImageCache, Log, All);
+
+void URuntimeImageCache::Initialize(int64 InTextureBudget, int64 InImageDataBudget)
+{
+    TextureBudget = InTextureBudget;
+    ImageDataBudget = InImageDataBudget;
+}
+
+FString URuntimeImageCache::MakeCacheKey(const FString& ImageFilename, const FTransformImageParams& TransformParams)
+{
+    // every param that changes resulting pixels must be part of the key
+    return FString::Printf(
+        TEXT("%s|%d|%d|%d|%d|%d|%d|%d|%d,%d,%d,%d|%d|%d,%d|%d|%d"),
+        *ImageFilename,
+        TransformParams.bForUI ? 1 : 0,
+        TransformParams.PercentSizeX,
+        TransformParams.PercentSizeY,
+        TransformParams.bGenerateMips ? 1 : 0,
+        TransformParams.NumMips,
+        TransformParams.bGenerateMipsOnGPU ? 1 : 0,
+        (int32)TransformParams.Compression,
+        TransformParams.CropOffset.X,
+        TransformParams.CropOffset.Y,
+        TransformParams.CropSize.X,
+        TransformParams.CropSize.Y,
+        (int32)TransformParams.SizeMode,
+        TransformParams.TargetSize.X,
+        TransformParams.TargetSize.Y,
+        (int32)TransformParams.ResizeFilter,
+        (int32)TransformParams.HDRFormat
+    );
+}
+
+UTexture2D* URuntimeImageCache::FindTexture(const FString& CacheKey)
+{
+    check(IsInGameThread());
+
+    if (FRuntimeImageCacheTextureEntry* Entry = Textures.Find(CacheKey))
+    {
+        if (IsValid(Entry->Texture))
+        {
+            MarkUsed(TextureLru, Entry->LruNode);
+            return Entry->Texture;
+        }
+
+        RemoveTextureEntry(CacheKey);
+        return nullptr;
+    }
+
+    TWeakObjectPtr<UTexture2D> EvictedTexture;
+    if (EvictedTextures.RemoveAndCopyValue(CacheKey, EvictedTexture))
+    {
+        TextureKeys.RemoveSingle(EvictedTexture, CacheKey);
+
+        if (EvictedTexture.IsValid())
+        {
+            // still in use, bring it back to level 1
+            UTexture2D* Texture = EvictedTexture.Get();
+            AddTexture(CacheKey, Texture);
+            return Texture;
+        }
+    }
+
+    return nullptr;
+}
+
+void URuntimeImageCache::AddTexture(const FString& CacheKey, UTexture2D* Texture)
+{
+    check(IsInGameThread());
+
+    if (!IsValid(Texture) || TextureBudget <= 0)
+    {
+        return;
+    }
+
+    RemoveTextureEntry(CacheKey);
+
+    TWeakObjectPtr<UTexture2D> EvictedTexture;
+    if (EvictedTextures.RemoveAndCopyValue(CacheKey, EvictedTexture))
+    {
+        TextureKeys.RemoveSingle(EvictedTexture, CacheKey);
+    }
+
+    FRuntimeImageCacheTextureEntry Entry;
+    {
+        Entry.Texture = Texture;
+        Entry.SizeInBytes = GetTextureSize(Texture);
+    }
+
+    TextureLru.AddHead(CacheKey);
+    Entry.LruNode = TextureLru.GetHead();
+
+    TextureCacheSize += Entry.SizeInBytes;
+    Textures.Add(CacheKey, Entry);
+    TextureKeys.AddUnique(Texture, CacheKey);
+
+    TrimTextures();
+}
+
+void URuntimeImageCache::RemoveTexture(const UTexture2D* Texture)
+{
+    check(IsInGameThread());
+
+    TArray<FString> CacheKeys;
+    TextureKeys.MultiFind(Texture, CacheKeys);
+    TextureKeys.Remove(Texture);
+
+    for (const FString& CacheKey : CacheKeys)
+    {
+        const FRuntimeImageCacheTextureEntry* Entry = Textures.Find(CacheKey);
+        if (Entry != nullptr && Entry->Texture == Texture)
+        {
+            TextureCacheSize -= Entry->SizeInBytes;
+            TextureLru.RemoveNode(Entry->LruNode);
+            Textures.Remove(CacheKey);
+        }
+
+        const TWeakObjectPtr<UTexture2D>* EvictedTexture = EvictedTextures.Find(CacheKey);
+        if (EvictedTexture != nullptr && EvictedTexture->Get() == Texture)
+        {
+            EvictedTextures.Remove(CacheKey);
+        }
+    }
+}
+
+FRuntimeImageDataPtr URuntimeImageCache::FindImageData(const FString& CacheKey)
+{
+    check(IsInGameThread());
+
+    if (FRuntimeImageCacheDataEntry* Entry = ImageDatas.Find(CacheKey))
+    {
+        MarkUsed(ImageDataLru, Entry->LruNode);
+        return Entry->ImageData;
+    }
+
+    return nullptr;
+}
+
+void URuntimeImageCache::AddImageData(const FString& CacheKey, FRuntimeImageDataPtr ImageData)
+{
+    check(IsInGameThread());
+
+    if (!ImageData.IsValid() || !IsImageDataCacheEnabled())
+    {
+        return;
+    }
+
+    RemoveImageDataEntry(CacheKey);
+
+    FRuntimeImageCacheDataEntry Entry;
+    {
+        Entry.ImageData = ImageData;
+        Entry.SizeInBytes = GetImageDataSize(*ImageData);
+    }
+
+    ImageDataLru.AddHead(CacheKey);
+    Entry.LruNode = ImageDataLru.GetHead();
+
+    ImageDataCacheSize += Entry.SizeInBytes;
+    ImageDatas.Add(CacheKey, MoveTemp(Entry));
+
+    TrimImageData();
+}
+
+void URuntimeImageCache::Empty()
+{
+    Textures.Empty();
+    EvictedTextures.Empty();
+    TextureKeys.Empty();
+    NumEvictedAfterPurge = 0;
+    ImageDatas.Empty();
+
+    TextureLru.Empty();
+    ImageDataLru.Empty();
+
+    TextureCacheSize = 0;
+    ImageDataCacheSize = 0;
+}
+
+void URuntimeImageCache::TrimTextures()
+{
+    // most recently added texture stays even if it's over budget on its own
+    while (TextureCacheSize > TextureBudget && Textures.Num() > 1)
+    {
+        const FString EvictedKey = TextureLru.GetTail()->GetValue();
+        TextureLru.RemoveNode(TextureLru.GetTail());
+
+        FRuntimeImageCacheTextureEntry EvictedEntry;
+        Textures.RemoveAndCopyValue(EvictedKey, EvictedEntry);
+
+        TextureCacheSize -= EvictedEntry.SizeInBytes;
+
+        if (IsValid(EvictedEntry.Texture))
+        {
+            EvictedTextures.Add(EvictedKey, EvictedEntry.Texture);
+        }
+        else
+        {
+            TextureKeys.RemoveSingle(EvictedEntry.Texture, EvictedKey);
+        }
+
+        UE_LOG(LogRuntimeImageCache, Verbose, TEXT("Texture evicted from cache: %s"), *EvictedKey);
+    }
+
+    PurgeEvictedTextures();
+}
+
+void URuntimeImageCache::TrimImageData()
+{
+    while (ImageDataCacheSize > ImageDataBudget && ImageDatas.Num() > 0)
+    {
+        const FString EvictedKey = ImageDataLru.GetTail()->GetValue();
+        RemoveImageDataEntry(EvictedKey);
+
+        UE_LOG(LogRuntimeImageCache, Verbose, TEXT("Image data evicted from cache: %s"), *EvictedKey);
+    }
+}
+
+void URuntimeImageCache::RemoveTextureEntry(const FString& CacheKey)
+{
+    FRuntimeImageCacheTextureEntry Entry;
+    if (!Textures.RemoveAndCopyValue(CacheKey, Entry))
+    {
+        return;
+    }
+
+    TextureCacheSize -= Entry.SizeInBytes;
+    TextureLru.RemoveNode(Entry.LruNode);
+    TextureKeys.RemoveSingle(Entry.Texture, CacheKey);
+}
+
+void URuntimeImageCache::RemoveImageDataEntry(const FString& CacheKey)
+{
+    FRuntimeImageCacheDataEntry Entry;
+    if (!ImageDatas.RemoveAndCopyValue(CacheKey, Entry))
+    {
+        return;
+    }
+
+    ImageDataCacheSize -= Entry.SizeInBytes;
+    ImageDataLru.RemoveNode(Entry.LruNode);
+}
+
+void URuntimeImageCache::PurgeEvictedTextures()
+{
+    // scan is amortized over the evictions since the last one
+    if (EvictedTextures.Num() <= 2 * NumEvictedAfterPurge + 16)
+    {
+        return;
+    }
+
+    for (auto It = EvictedTextures.CreateIterator(); It; ++It)
+    {
+        if (!It.Value().IsValid())
+        {
+            TextureKeys.RemoveSingle(It.Value(), It.Key());
+            It.RemoveCurrent();
+        }
+    }
+
+    NumEvictedAfterPurge = EvictedTextures.Num();
+}
+
+void URuntimeImageCache::MarkUsed(FRuntimeImageCacheLruList& Lru, FRuntimeImageCacheLruList::TDoubleLinkedListNode* Node)
+{
+    if (Node != Lru.GetHead())
+    {
+        Lru.RemoveNode(Node, false);
+        Lru.AddHead(Node);
+    }
+}
+
+int64 URuntimeImageCache::GetTextureSize(const UTexture2D* Texture)
+{
+#if ENGINE_MAJOR_VERSION < 5
+    const FTexturePlatformData* PlatformData = Texture->PlatformData;
+#else
+    const FTexturePlatformData* PlatformData = Texture->GetPlatformData();
+#endif
+
+    if (PlatformData == nullptr)
+    {
+        return 0;
+    }
+
+    int64 SizeInBytes = 0;
+    for (const FTexture2DMipMap& Mip : PlatformData->Mips)
+    {
+        SizeInBytes += CalculateImageBytes(Mip.SizeX, Mip.SizeY, 0, PlatformData->PixelFormat);
+    }
+
+    return SizeInBytes;
+}
+
+int64 URuntimeImageCache::GetImageDataSize(const FRuntimeImageData& ImageData)
+{
+    int64 SizeInBytes = ImageData.RawData.Num();
+    for (const FRuntimeImageRawData& MipData : ImageData.AdditionalMips)
+    {
+        SizeInBytes += MipData.Num();
+    }
+
+    return SizeInBytes;
+}
@@ -44,13 +44,34 @@ void FRuntimeImageData::Init2D(int32 InSizeX, int32 InSizeY, ETextureSourceForma
     SizeY = InSizeY;
     NumSlices = 1;
     NumMips = 1;
+    AdditionalMips.Empty();
+    bGenerateMipsOnGPU = false;
     TextureSourceFormat = InFormat;
     Format = ToRawImageFormat(InFormat);
+    SourceRect = FIntRect(0, 0, SizeX, SizeY);
 
-    RawData.AddUninitialized(SizeX * SizeY * GetBytesPerPixel());
+    RawData.SetNumUninitialized(SizeX * SizeY * GetBytesPerPixel());
 
     if (InData)
     {
         FMemory::Memcpy(RawData.GetData(), InData, RawData.Num());
     }
 }
+
+bool FRuntimeImageData::Init2D(int32 InSizeX, int32 InSizeY, ETextureSourceFormat InFormat, FRuntimeImageRawData&& InRawData)
+{
+    SizeX = InSizeX;
+    SizeY = InSizeY;
+    NumSlices = 1;
+    NumMips = 1;
+    AdditionalMips.Empty();
+    bGenerateMipsOnGPU = false;
+    TextureSourceFormat = InFormat;
+    Format = ToRawImageFormat(InFormat);
+    SourceRect = FIntRect(0, 0, SizeX, SizeY);
+
+    RawData = MoveTemp(InRawData);
+
+    // decoders of malformed files can report a size their pixels do not have
+    return RawData.Num() == (int64)SizeX * SizeY * GetBytesPerPixel();
+}
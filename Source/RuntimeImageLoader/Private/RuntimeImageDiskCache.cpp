@@ -0,0 +1,295 @@
+// Copyright 2022 Peter Leontev. All Rights Reserved.
+
+#include "RuntimeImageDiskCache.h"
+#include "HAL/FileManager.h"
+#include "Misc/Paths.h"
+#include "Misc/ScopeLock.h"
+#include "Misc/SecureHash.h"
+#include "Misc/Guid.h"
+#include "Serialization/Archive.h"
+#include "RenderUtils.h"
+
+#include "Helpers/MipHelpers.h"
+
+
+DEFINE_LOG_CATEGORY_STATIC(LogRuntimeImageDiskCache, Log, All);
+
+namespace
+{
+    const uint32 DiskCacheMagic = 0x52494443; // RIDC
+    // bump when layout of the entry changes
+    const uint32 DiskCacheVersion = 1;
+
+    const TCHAR* DiskCacheExtension = TEXT(".ricache");
+
+    /** Same layout as TArray serialization, but count is checked against the rest of the archive before anything is allocated */
+    void LoadRawData(FArchive& Ar, FRuntimeImageRawData& OutRawData)
+    {
+        FRuntimeImageRawData::SizeType Num = 0;
+        Ar << Num;
+
+        if (Ar.IsError() || Num < 0 || (int64)Num > Ar.TotalSize() - Ar.Tell())
+        {
+            Ar.SetError();
+            return;
+        }
+
+        OutRawData.SetNumUninitialized(Num);
+        Ar.Serialize(OutRawData.GetData(), Num);
+    }
+}
+
+FRuntimeImageDiskCache::FRuntimeImageDiskCache(const FString& InCacheDirectory, int64 InMaxCacheSize)
+    : CacheDirectory(InCacheDirectory)
+    , MaxCacheSize(InMaxCacheSize)
+{
+    IFileManager::Get().MakeDirectory(*CacheDirectory, true);
+}
+
+bool FRuntimeImageDiskCache::LoadHeader(const FString& CacheKey, FRuntimeImageDiskCacheHeader& OutHeader) const
+{
+    TUniquePtr<FArchive> Reader(IFileManager::Get().CreateFileReader(*GetEntryFilename(CacheKey), FILEREAD_Silent));
+    if (!Reader.IsValid())
+    {
+        return false;
+    }
+
+    return SerializeHeader(*Reader, OutHeader) && !Reader->IsError();
+}
+
+bool FRuntimeImageDiskCache::LoadImageData(const FString& CacheKey, FRuntimeImageData& OutImageData) const
+{
+    TUniquePtr<FArchive> Reader(IFileManager::Get().CreateFileReader(*GetEntryFilename(CacheKey), FILEREAD_Silent));
+    if (!Reader.IsValid())
+    {
+        return false;
+    }
+
+    FRuntimeImageDiskCacheHeader Header;
+    if (!SerializeHeader(*Reader, Header))
+    {
+        return false;
+    }
+
+    SerializeImageData(*Reader, OutImageData);
+
+    return !Reader->IsError() && IsImageDataValid(OutImageData);
+}
+
+void FRuntimeImageDiskCache::Store(const FString& CacheKey, const FRuntimeImageDiskCacheHeader& Header, const FRuntimeImageData& ImageData)
+{
+    const FString EntryFilename = GetEntryFilename(CacheKey);
+    // readers never see partially written entries
+    const FString TempFilename = EntryFilename + FString::Printf(TEXT(".%s.tmp"), *FGuid::NewGuid().ToString());
+
+    {
+        TUniquePtr<FArchive> Writer(IFileManager::Get().CreateFileWriter(*TempFilename, FILEWRITE_Silent));
+        if (!Writer.IsValid())
+        {
+            UE_LOG(LogRuntimeImageDiskCache, Warning, TEXT("Failed to write disk cache entry: %s"), *TempFilename);
+            return;
+        }
+
+        FRuntimeImageDiskCacheHeader HeaderCopy(Header);
+        SerializeHeader(*Writer, HeaderCopy);
+        // saving archive does not modify pixels, no need to copy them
+        SerializeImageData(*Writer, const_cast<FRuntimeImageData&>(ImageData));
+
+        if (!Writer->Close())
+        {
+            Writer.Reset();
+            IFileManager::Get().Delete(*TempFilename, false, true, true);
+            return;
+        }
+    }
+
+    FScopeLock EntriesScopeLock(&EntriesLock);
+
+    if (!IFileManager::Get().Move(*EntryFilename, *TempFilename, true, true, false, true))
+    {
+        IFileManager::Get().Delete(*TempFilename, false, true, true);
+    }
+}
+
+void FRuntimeImageDiskCache::Remove(const FString& CacheKey)
+{
+    FScopeLock EntriesScopeLock(&EntriesLock);
+
+    IFileManager::Get().Delete(*GetEntryFilename(CacheKey), false, true, true);
+}
+
+void FRuntimeImageDiskCache::Trim()
+{
+    struct FEntryInfo
+    {
+        FString Filename;
+        int64 Size;
+        FDateTime ModificationTime;
+    };
+
+    TArray<FEntryInfo> Entries;
+    int64 CacheSize = 0;
+
+    FScopeLock EntriesScopeLock(&EntriesLock);
+
+    IFileManager::Get().IterateDirectoryStat(*CacheDirectory,
+        [&Entries, &CacheSize](const TCHAR* Filename, const FFileStatData& StatData)
+        {
+            if (!StatData.bIsDirectory)
+            {
+                if (FString(Filename).EndsWith(DiskCacheExtension))
+                {
+                    Entries.Add({ Filename, StatData.FileSize, StatData.ModificationTime });
+                    CacheSize += StatData.FileSize;
+                }
+                else if (FString(Filename).EndsWith(TEXT(".tmp")))
+                {
+                    // leftover of interrupted write
+                    IFileManager::Get().Delete(Filename, false, true, true);
+                }
+            }
+            return true;
+        }
+    );
+
+    if (CacheSize <= MaxCacheSize)
+    {
+        return;
+    }
+
+    Entries.Sort([](const FEntryInfo& A, const FEntryInfo& B) { return A.ModificationTime < B.ModificationTime; });
+
+    for (const FEntryInfo& Entry : Entries)
+    {
+        if (CacheSize <= MaxCacheSize)
+        {
+            break;
+        }
+
+        if (IFileManager::Get().Delete(*Entry.Filename, false, true, true))
+        {
+            CacheSize -= Entry.Size;
+        }
+    }
+
+    UE_LOG(LogRuntimeImageDiskCache, Log, TEXT("Disk cache was trimmed to %lld bytes"), CacheSize);
+}
+
+bool FRuntimeImageDiskCache::IsImageDataValid(const FRuntimeImageData& ImageData)
+{
+    if (ImageData.SizeX <= 0 || ImageData.SizeY <= 0 || ImageData.PixelFormat <= PF_Unknown || ImageData.PixelFormat >= PF_MAX ||
+        ImageData.NumMips < 1 || ImageData.NumMips > MAX_TEXTURE_MIP_COUNT)
+    {
+        return false;
+    }
+
+    // block compressed format is picked for the RHI the entry was stored with, another RHI may not support it
+    if (!GPixelFormats[ImageData.PixelFormat].Supported)
+    {
+        return false;
+    }
+
+    // mips are either all stored or built on GPU after upload
+    const int32 NumAdditionalMips = ImageData.AdditionalMips.Num();
+    if (NumAdditionalMips != ImageData.NumMips - 1 && !(ImageData.bGenerateMipsOnGPU && NumAdditionalMips == 0))
+    {
+        return false;
+    }
+
+    if ((SIZE_T)ImageData.RawData.Num() != CalculateImageBytes(ImageData.SizeX, ImageData.SizeY, 0, ImageData.PixelFormat))
+    {
+        return false;
+    }
+
+    for (int32 MipIndex = 1; MipIndex <= NumAdditionalMips; ++MipIndex)
+    {
+        const int32 MipSizeX = FMipHelpers::GetMipSize(ImageData.SizeX, MipIndex);
+        const int32 MipSizeY = FMipHelpers::GetMipSize(ImageData.SizeY, MipIndex);
+        if ((SIZE_T)ImageData.AdditionalMips[MipIndex - 1].Num() != CalculateImageBytes(MipSizeX, MipSizeY, 0, ImageData.PixelFormat))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+FString FRuntimeImageDiskCache::GetEntryFilename(const FString& CacheKey) const
+{
+    return FPaths::Combine(CacheDirectory, FMD5::HashAnsiString(*CacheKey) + DiskCacheExtension);
+}
+
+bool FRuntimeImageDiskCache::SerializeHeader(FArchive& Ar, FRuntimeImageDiskCacheHeader& Header)
+{
+    uint32 Magic = DiskCacheMagic;
+    uint32 Version = DiskCacheVersion;
+
+    Ar << Magic;
+    Ar << Version;
+
+    if (Ar.IsLoading() && (Magic != DiskCacheMagic || Version != DiskCacheVersion))
+    {
+        return false;
+    }
+
+    Ar << Header.ImageURI;
+    Ar << Header.Validators.ETag;
+    Ar << Header.Validators.LastModified;
+    Ar << Header.ExpirationTime;
+    Ar << Header.SourceModificationTime;
+
+    return true;
+}
+
+void FRuntimeImageDiskCache::SerializeImageData(FArchive& Ar, FRuntimeImageData& ImageData)
+{
+    int32 Format = (int32)ImageData.Format;
+    int32 GammaSpace = (int32)ImageData.GammaSpace;
+    int32 TextureSourceFormat = (int32)ImageData.TextureSourceFormat;
+    int32 CompressionSettings = (int32)ImageData.CompressionSettings;
+    int32 PixelFormat = (int32)ImageData.PixelFormat;
+
+    Ar << ImageData.SizeX;
+    Ar << ImageData.SizeY;
+    Ar << ImageData.NumSlices;
+    Ar << Format;
+    Ar << GammaSpace;
+    Ar << ImageData.NumMips;
+    Ar << ImageData.SRGB;
+    Ar << TextureSourceFormat;
+    Ar << CompressionSettings;
+    Ar << PixelFormat;
+    Ar << ImageData.bGenerateMipsOnGPU;
+    Ar << ImageData.ModificationTime;
+
+    if (!Ar.IsLoading())
+    {
+        Ar << ImageData.RawData;
+        Ar << ImageData.AdditionalMips;
+        return;
+    }
+
+    ImageData.Format = (ERawImageFormat::Type)Format;
+    ImageData.GammaSpace = (EGammaSpace)GammaSpace;
+    ImageData.TextureSourceFormat = (ETextureSourceFormat)TextureSourceFormat;
+    ImageData.CompressionSettings = (TextureCompressionSettings)CompressionSettings;
+    ImageData.PixelFormat = (EPixelFormat)PixelFormat;
+
+    // broken entry must not make the reader allocate whatever its counts say
+    LoadRawData(Ar, ImageData.RawData);
+
+    int32 NumAdditionalMips = 0;
+    Ar << NumAdditionalMips;
+
+    if (Ar.IsError() || NumAdditionalMips < 0 || NumAdditionalMips >= MAX_TEXTURE_MIP_COUNT)
+    {
+        Ar.SetError();
+        return;
+    }
+
+    ImageData.AdditionalMips.SetNum(NumAdditionalMips);
+    for (int32 MipIndex = 0; MipIndex < NumAdditionalMips && !Ar.IsError(); ++MipIndex)
+    {
+        LoadRawData(Ar, ImageData.AdditionalMips[MipIndex]);
+    }
+}
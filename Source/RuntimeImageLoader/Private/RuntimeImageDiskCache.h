@@ -0,0 +1,60 @@
+// Copyright 2022 Peter Leontev. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Misc/DateTime.h"
+
+#include "ImageReaders/IImageReader.h"
+#include "RuntimeImageData.h"
+
+
+/** Describes image a disk cache entry was made from */
+struct FRuntimeImageDiskCacheHeader
+{
+    FString ImageURI;
+
+    // HTTP sources
+    FImageCacheValidators Validators;
+    // entry can be used without validation till then
+    FDateTime ExpirationTime;
+
+    // local files
+    FDateTime SourceModificationTime;
+};
+
+/**
+ * Stores transformed GPU-ready pixels on disk between sessions, one file per entry.
+ * Entry is a small header followed by mips data. Thread-safe.
+ */
+class FRuntimeImageDiskCache
+{
+public:
+    FRuntimeImageDiskCache(const FString& InCacheDirectory, int64 InMaxCacheSize);
+
+    bool LoadHeader(const FString& CacheKey, FRuntimeImageDiskCacheHeader& OutHeader) const;
+    /** Returns false if entry can't be read or is broken */
+    bool LoadImageData(const FString& CacheKey, FRuntimeImageData& OutImageData) const;
+
+    void Store(const FString& CacheKey, const FRuntimeImageDiskCacheHeader& Header, const FRuntimeImageData& ImageData);
+    void Remove(const FString& CacheKey);
+
+    /** Deletes least recently written entries till cache fits its size budget */
+    void Trim();
+
+private:
+    FString GetEntryFilename(const FString& CacheKey) const;
+
+    /** Reads header and leaves archive at the beginning of image data. Returns false for entries of older versions */
+    static bool SerializeHeader(FArchive& Ar, FRuntimeImageDiskCacheHeader& Header);
+    static void SerializeImageData(FArchive& Ar, FRuntimeImageData& ImageData);
+    /** Returns false if pixels do not match size, format and mips of the entry */
+    static bool IsImageDataValid(const FRuntimeImageData& ImageData);
+
+private:
+    const FString CacheDirectory;
+    const int64 MaxCacheSize;
+
+    // guards writes of the same entries and trimming
+    mutable FCriticalSection EntriesLock;
+};
@@ -3,18 +3,48 @@
 #include "RuntimeImageLoader.h"
 #include "Subsystems/SubsystemBlueprintLibrary.h"
 #include "UObject/WeakObjectPtr.h"
+#include "RHI.h"
+#include "Async/Async.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Dom/JsonObject.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonSerializer.h"
+#include "JsonObjectConverter.h"
+#include "RuntimeImageLoaderSettings.h"
+#include "RuntimeImageCache.h"
+#include "RuntimeImageUtils.h"
+#include "ImageReaders/ImageReaderFactory.h"
+#include "Helpers/AtlasHelpers.h"
+#include "RuntimeImageLoaderStats.h"
 
 DEFINE_LOG_CATEGORY_STATIC(LogRuntimeImageLoader, Log, All);
 
 void URuntimeImageLoader::Initialize(FSubsystemCollectionBase& Collection)
 {
     InitializeImageReader();
+
+    const URuntimeImageLoaderSettings* Settings = GetDefault<URuntimeImageLoaderSettings>();
+
+    ImageCache = NewObject<URuntimeImageCache>(this);
+    ImageCache->Initialize(
+        Settings->bEnableCache ? (int64)Settings->TextureCacheBudgetMB * 1024 * 1024 : 0,
+        Settings->bEnableCache ? (int64)Settings->ImageDataCacheBudgetMB * 1024 * 1024 : 0
+    );
+
+    if (Settings->bEnableCache && !Settings->WarmUpManifest.IsEmpty())
+    {
+        PrefetchFromManifest(FPaths::IsRelative(Settings->WarmUpManifest) ? FPaths::Combine(FPaths::ProjectDir(), Settings->WarmUpManifest) : Settings->WarmUpManifest);
+    }
 }
 
 void URuntimeImageLoader::Deinitialize()
 {
     ImageReader->Deinitialize();
     ImageReader = nullptr;
+
+    ImageCache->Empty();
+    ImageCache = nullptr;
 }
 
 bool URuntimeImageLoader::DoesSupportWorldType(EWorldType::Type WorldType) const
@@ -29,10 +59,415 @@ void URuntimeImageLoader::LoadImageAsync(const FString& ImageFilename, const FTr
         return;
     }
 
+    EnqueueRequest(MakeLatentRequest(ImageFilename, TransformParams, OutTexture, bSuccess, OutError, LatentInfo));
+}
+
+void URuntimeImageLoader::LoadImageProgressiveAsync(const FString& ImageFilename, const FTransformImageParams& TransformParams, FOnImagePreviewAvailable OnPreviewAvailable, UTexture2D*& OutTexture, bool& bSuccess, FString& OutError, FLatentActionInfo LatentInfo, UObject* WorldContextObject /*= nullptr*/)
+{
+    if (!IsValid(WorldContextObject))
+    {
+        return;
+    }
+
+    FLoadImageRequest Request = MakeLatentRequest(ImageFilename, TransformParams, OutTexture, bSuccess, OutError, LatentInfo);
+    {
+        Request.Params.bProgressive = true;
+        Request.OnPreviewAvailable = OnPreviewAvailable;
+    }
+
+    EnqueueRequest(MoveTemp(Request));
+}
+
+FRuntimeImageRequestHandle URuntimeImageLoader::LoadImageAsyncWithHandle(const FString& ImageFilename, const FTransformImageParams& TransformParams, int32 Priority, FOnImageLoaded OnImageLoaded)
+{
+    FLoadImageRequest Request = MakeDelegateRequest(ImageFilename, TransformParams, OnImageLoaded);
+    Request.Priority = Priority;
+
+    return EnqueueRequest(MoveTemp(Request));
+}
+
+FLoadImageRequest URuntimeImageLoader::MakeDelegateRequest(const FString& ImageFilename, const FTransformImageParams& TransformParams, FOnImageLoaded OnImageLoaded) const
+{
+    FLoadImageRequest Request;
+    {
+        Request.Params.ImageFilename = ImageFilename;
+        Request.Params.TransformParams = TransformParams;
+        Request.CacheKey = URuntimeImageCache::MakeCacheKey(ImageFilename, TransformParams);
+
+        Request.OnRequestCompleted.BindLambda(
+            [OnImageLoaded](const FImageReadResult& ReadResult)
+            {
+                if (!ReadResult.OutError.IsEmpty())
+                {
+                    UE_LOG(LogRuntimeImageLoader, Error, TEXT("Failed to load image. Error: %s"), *ReadResult.OutError);
+                }
+
+                OnImageLoaded.ExecuteIfBound(ReadResult.OutTexture, ReadResult.OutError.IsEmpty(), ReadResult.OutError);
+            }
+        );
+    }
+
+    return Request;
+}
+
+FRuntimeImageRequestHandle URuntimeImageLoader::UpdateTextureFromImage(UTexture2D* ExistingTexture, const FString& ImageFilename, const FTransformImageParams& TransformParams, FIntPoint DirtyOffset, FIntPoint DirtySize, FOnImageLoaded OnImageLoaded)
+{
+    check(IsInGameThread());
+
+    FLoadImageRequest Request = MakeDelegateRequest(ImageFilename, TransformParams, OnImageLoaded);
+    {
+        // pixels of the file are expected to change, cached ones would be stale
+        Request.CacheKey.Empty();
+        Request.Params.TargetTexture = ExistingTexture;
+        Request.Params.DirtyRegion = FIntRect(DirtyOffset, DirtyOffset + DirtySize);
+    }
+
+    if (IsValid(ExistingTexture))
+    {
+        // cache would hand it out again while its pixels are overwritten
+        ImageCache->RemoveTexture(ExistingTexture);
+    }
+
+    return EnqueueRequest(MoveTemp(Request));
+}
+
+FRuntimeImageRequestHandle URuntimeImageLoader::UpdateRenderTargetFromImage(UTextureRenderTarget2D* RenderTarget, const FString& ImageFilename, const FTransformImageParams& TransformParams, FIntPoint DirtyOffset, FIntPoint DirtySize, FOnRenderTargetUpdated OnUpdated)
+{
+    check(IsInGameThread());
+
+    if (!IsValid(RenderTarget))
+    {
+        OnUpdated.ExecuteIfBound(false, TEXT("Render target is not valid"));
+        return FRuntimeImageRequestHandle();
+    }
+
     FLoadImageRequest Request;
     {
         Request.Params.ImageFilename = ImageFilename;
         Request.Params.TransformParams = TransformParams;
+        Request.Params.TargetRenderTarget = RenderTarget;
+        Request.Params.DirtyRegion = FIntRect(DirtyOffset, DirtyOffset + DirtySize);
+
+        Request.OnRequestCompleted.BindLambda(
+            [OnUpdated](const FImageReadResult& ReadResult)
+            {
+                if (!ReadResult.OutError.IsEmpty())
+                {
+                    UE_LOG(LogRuntimeImageLoader, Error, TEXT("Failed to update render target. Error: %s"), *ReadResult.OutError);
+                }
+
+                OnUpdated.ExecuteIfBound(ReadResult.OutError.IsEmpty(), ReadResult.OutError);
+            }
+        );
+    }
+
+    return EnqueueRequest(MoveTemp(Request));
+}
+
+void URuntimeImageLoader::Prefetch(const TArray<FString>& ImageFilenames, const FTransformImageParams& TransformParams)
+{
+    check(IsInGameThread());
+
+    if (!ImageCache->IsImageDataCacheEnabled())
+    {
+        UE_LOG(LogRuntimeImageLoader, Warning, TEXT("Images are not prefetched as image data cache is disabled"));
+        return;
+    }
+
+    for (const FString& ImageFilename : ImageFilenames)
+    {
+        FLoadImageRequest Request;
+        {
+            Request.Params.ImageFilename = ImageFilename;
+            Request.Params.TransformParams = TransformParams;
+            Request.Params.bDecodeOnly = true;
+            Request.CacheKey = URuntimeImageCache::MakeCacheKey(ImageFilename, TransformParams);
+            Request.Priority = MIN_int32;
+            Request.bPrefetch = true;
+        }
+
+        EnqueueRequest(MoveTemp(Request));
+    }
+}
+
+bool URuntimeImageLoader::PrefetchFromManifest(const FString& ManifestFilename)
+{
+    check(IsInGameThread());
+
+    FString ManifestString;
+    if (!FFileHelper::LoadFileToString(ManifestString, *ManifestFilename))
+    {
+        UE_LOG(LogRuntimeImageLoader, Warning, TEXT("Failed to read prefetch manifest %s"), *ManifestFilename);
+        return false;
+    }
+
+    TSharedPtr<FJsonObject> Manifest;
+    TSharedRef<TJsonReader<>> JsonReader = TJsonReaderFactory<>::Create(ManifestString);
+    if (!FJsonSerializer::Deserialize(JsonReader, Manifest) || !Manifest.IsValid())
+    {
+        UE_LOG(LogRuntimeImageLoader, Warning, TEXT("Prefetch manifest %s is not valid JSON"), *ManifestFilename);
+        return false;
+    }
+
+    const FString ManifestDir = FPaths::GetPath(ManifestFilename);
+
+    const TArray<TSharedPtr<FJsonValue>>* Groups = nullptr;
+    if (Manifest->TryGetArrayField(TEXT("Groups"), Groups))
+    {
+        for (const TSharedPtr<FJsonValue>& GroupValue : *Groups)
+        {
+            const TSharedPtr<FJsonObject>* Group = nullptr;
+            if (!GroupValue.IsValid() || !GroupValue->TryGetObject(Group))
+            {
+                continue;
+            }
+
+            // keys have to match the requests that show the images, so missing params are the defaults of those
+            FTransformImageParams TransformParams;
+            const TSharedPtr<FJsonObject>* TransformParamsObject = nullptr;
+            if ((*Group)->TryGetObjectField(TEXT("TransformParams"), TransformParamsObject))
+            {
+                FJsonObjectConverter::JsonObjectToUStruct(TransformParamsObject->ToSharedRef(), FTransformImageParams::StaticStruct(), &TransformParams);
+            }
+
+            TArray<FString> ImageFilenames;
+            (*Group)->TryGetStringArrayField(TEXT("Images"), ImageFilenames);
+
+            for (FString& ImageFilename : ImageFilenames)
+            {
+                if (!FImageReaderFactory::IsHttpURI(ImageFilename) && FPaths::IsRelative(ImageFilename))
+                {
+                    ImageFilename = FPaths::Combine(ManifestDir, ImageFilename);
+                }
+            }
+
+            Prefetch(ImageFilenames, TransformParams);
+        }
+    }
+
+    return true;
+}
+
+void URuntimeImageLoader::LoadImagesAsync(const TArray<FString>& ImageFilenames, const FTransformImageParams& TransformParams, int32 Priority, bool bPackIntoAtlas, FOnBatchItemLoaded OnItemLoaded, FOnBatchLoaded OnBatchLoaded, int32 MaxAtlasSize /*= 4096*/)
+{
+    check(IsInGameThread());
+
+    const int32 BatchId = NextBatchId++;
+
+    FRuntimeImageBatch& Batch = Batches.Add(BatchId);
+    {
+        Batch.Textures.SetNumZeroed(ImageFilenames.Num());
+        Batch.bPackIntoAtlas = bPackIntoAtlas;
+        Batch.MaxAtlasSize = FMath::Min<int32>(MaxAtlasSize, GetMax2DTextureDimension());
+        Batch.OnItemLoaded = OnItemLoaded;
+        Batch.OnBatchLoaded = OnBatchLoaded;
+    }
+
+    if (ImageFilenames.Num() == 0)
+    {
+        FinishBatch(BatchId);
+        return;
+    }
+
+    for (int32 ItemIndex = 0; ItemIndex < ImageFilenames.Num(); ++ItemIndex)
+    {
+        FLoadImageRequest Request;
+        {
+            Request.Params.ImageFilename = ImageFilenames[ItemIndex];
+            Request.Params.TransformParams = TransformParams;
+            Request.CacheKey = URuntimeImageCache::MakeCacheKey(ImageFilenames[ItemIndex], TransformParams);
+            Request.Priority = Priority;
+
+            Request.OnRequestCompleted.BindUObject(this, &URuntimeImageLoader::HandleBatchItemLoaded, BatchId, ItemIndex);
+            Request.bBatchItem = true;
+        }
+
+        EnqueueRequest(MoveTemp(Request));
+    }
+}
+
+bool URuntimeImageLoader::CancelRequest(FRuntimeImageRequestHandle Handle)
+{
+    check(IsInGameThread());
+
+    if (!Handle.IsValid())
+    {
+        return false;
+    }
+
+    auto HasHandle = [&Handle](const FLoadImageRequest& Request) { return Request.Handle == Handle.Id; };
+
+    // waiting for a free slot
+    const int32 QueuedIndex = Requests.IndexOfByPredicate(HasHandle);
+    if (QueuedIndex != INDEX_NONE)
+    {
+        FLoadImageRequest CancelledRequest = MoveTemp(Requests[QueuedIndex]);
+        Requests.RemoveAt(QueuedIndex);
+
+        CompleteCancelledRequest(CancelledRequest);
+        return true;
+    }
+
+    // waiting for the active request of the same image
+    for (TPair<FString, TArray<FLoadImageRequest>>& SameKeyRequests : CoalescedRequests)
+    {
+        const int32 CoalescedIndex = SameKeyRequests.Value.IndexOfByPredicate(HasHandle);
+        if (CoalescedIndex != INDEX_NONE)
+        {
+            FLoadImageRequest CancelledRequest = MoveTemp(SameKeyRequests.Value[CoalescedIndex]);
+            SameKeyRequests.Value.RemoveAt(CoalescedIndex);
+
+            CompleteCancelledRequest(CancelledRequest);
+            return true;
+        }
+    }
+
+    for (auto It = ActiveRequests.CreateIterator(); It; ++It)
+    {
+        FLoadImageRequest& ActiveRequest = It.Value();
+        if (!HasHandle(ActiveRequest))
+        {
+            continue;
+        }
+
+        if (ActiveRequest.bPrefetch)
+        {
+            ImageReader->CancelRequest(It.Key());
+            --NumActivePrefetches;
+
+            // pixels are only decoded for the cache, requests waiting for them load the image themselves
+            TArray<FLoadImageRequest> SameKeyRequests;
+            CoalescedRequests.RemoveAndCopyValue(ActiveRequest.CacheKey, SameKeyRequests);
+            It.RemoveCurrent();
+
+            for (FLoadImageRequest& SameKeyRequest : SameKeyRequests)
+            {
+                EnqueueRequest(MoveTemp(SameKeyRequest));
+            }
+
+            return true;
+        }
+
+        FLoadImageRequest CancelledRequest = ActiveRequest;
+
+        TArray<FLoadImageRequest>* SameKeyRequests = CoalescedRequests.Find(ActiveRequest.CacheKey);
+        if (SameKeyRequests != nullptr && SameKeyRequests->Num() > 0)
+        {
+            // image is still needed, the first waiting request takes over
+            const int32 RequestId = ActiveRequest.Params.RequestId;
+            ActiveRequest = (*SameKeyRequests)[0];
+            ActiveRequest.Params.RequestId = RequestId;
+
+            SameKeyRequests->RemoveAt(0);
+        }
+        else
+        {
+            ImageReader->CancelRequest(It.Key());
+
+            CoalescedRequests.Remove(ActiveRequest.CacheKey);
+            It.RemoveCurrent();
+        }
+
+        CompleteCancelledRequest(CancelledRequest);
+        return true;
+    }
+
+    return false;
+}
+
+bool URuntimeImageLoader::SetRequestPriority(FRuntimeImageRequestHandle Handle, int32 Priority)
+{
+    check(IsInGameThread());
+
+    if (!Handle.IsValid())
+    {
+        return false;
+    }
+
+    const int32 QueuedIndex = Requests.IndexOfByPredicate([&Handle](const FLoadImageRequest& Request) { return Request.Handle == Handle.Id; });
+    if (QueuedIndex != INDEX_NONE)
+    {
+        FLoadImageRequest Request = MoveTemp(Requests[QueuedIndex]);
+        Requests.RemoveAt(QueuedIndex);
+
+        Request.Priority = Priority;
+        EnqueueRequest(MoveTemp(Request));
+
+        return true;
+    }
+
+    // stages run in order of arrival, only download that did not start yet can still move ahead
+    for (TPair<int32, FLoadImageRequest>& ActiveRequest : ActiveRequests)
+    {
+        if (ActiveRequest.Value.Handle == Handle.Id)
+        {
+            if (Priority > ActiveRequest.Value.Priority)
+            {
+                ImageReader->PrioritizeRequest(ActiveRequest.Key);
+            }
+            ActiveRequest.Value.Priority = Priority;
+            return true;
+        }
+    }
+
+    // request waits for the one loading the same image
+    for (TPair<FString, TArray<FLoadImageRequest>>& SameKeyRequests : CoalescedRequests)
+    {
+        FLoadImageRequest* CoalescedRequest = SameKeyRequests.Value.FindByPredicate([&Handle](const FLoadImageRequest& Request) { return Request.Handle == Handle.Id; });
+        if (CoalescedRequest == nullptr)
+        {
+            continue;
+        }
+
+        CoalescedRequest->Priority = Priority;
+
+        for (TPair<int32, FLoadImageRequest>& ActiveRequest : ActiveRequests)
+        {
+            if (ActiveRequest.Value.CacheKey == SameKeyRequests.Key && Priority > ActiveRequest.Value.Priority)
+            {
+                ImageReader->PrioritizeRequest(ActiveRequest.Key);
+            }
+        }
+        return true;
+    }
+
+    return false;
+}
+
+FRuntimeImageRequestHandle URuntimeImageLoader::EnqueueRequest(FLoadImageRequest&& Request)
+{
+    if (Request.Handle == INDEX_NONE)
+    {
+        Request.Handle = NextRequestHandle++;
+    }
+
+    FRuntimeImageRequestHandle Handle;
+    Handle.Id = Request.Handle;
+
+    if (!Request.bPrefetch && !Request.CacheKey.IsEmpty())
+    {
+        // image is needed now, prefetch that did not start yet would only wait behind it
+        Requests.RemoveAll([&Request](const FLoadImageRequest& QueuedRequest) { return QueuedRequest.bPrefetch && QueuedRequest.CacheKey == Request.CacheKey; });
+    }
+
+    // requests of the same priority keep their order
+    int32 InsertIndex = Requests.Num();
+    while (InsertIndex > 0 && Requests[InsertIndex - 1].Priority < Request.Priority)
+    {
+        --InsertIndex;
+    }
+    Requests.Insert(MoveTemp(Request), InsertIndex);
+
+    return Handle;
+}
+
+FLoadImageRequest URuntimeImageLoader::MakeLatentRequest(const FString& ImageFilename, const FTransformImageParams& TransformParams, UTexture2D*& OutTexture, bool& bSuccess, FString& OutError, FLatentActionInfo LatentInfo)
+{
+    FLoadImageRequest Request;
+    {
+        Request.Params.ImageFilename = ImageFilename;
+        Request.Params.TransformParams = TransformParams;
+        Request.CacheKey = URuntimeImageCache::MakeCacheKey(ImageFilename, TransformParams);
 
         Request.OnRequestCompleted.BindLambda(
             [this, &OutTexture, &bSuccess, &OutError, LatentInfo](const FImageReadResult& ReadResult)
@@ -72,27 +507,143 @@ void URuntimeImageLoader::LoadImageAsync(const FString& ImageFilename, const FTr
         );
     }
 
-    Requests.Enqueue(Request);
+    return Request;
 }
 
 void URuntimeImageLoader::LoadImageSync(const FString& ImageFilename, const FTransformImageParams& TransformParams, UTexture2D*& OutTexture, bool& bSuccess, FString& OutError)
 {
-    FImageReadRequest ReadRequest;
+    if (!TryLoadImageSync(ImageFilename, TransformParams, 0.f, FOnImageLoaded(), OutTexture, bSuccess, OutError))
     {
-        ReadRequest.ImageFilename = ImageFilename;
-        ReadRequest.TransformParams = TransformParams;
+        bSuccess = false;
+        OutTexture = nullptr;
+        OutError = TEXT("Image reader was stopped");
     }
+}
+
+bool URuntimeImageLoader::TryLoadImageSync(const FString& ImageFilename, const FTransformImageParams& TransformParams, float TimeoutSeconds, FOnImageLoaded OnImageLoaded, UTexture2D*& OutTexture, bool& bSuccess, FString& OutError)
+{
+    check(IsInGameThread());
 
-    ImageReader->BlockTillAllRequestsFinished();
-    ImageReader->AddRequest(ReadRequest);
-    ImageReader->BlockTillAllRequestsFinished();
+    FLoadImageRequest Request = MakeDelegateRequest(ImageFilename, TransformParams, OnImageLoaded);
+
+    if (UTexture2D* CachedTexture = ImageCache->FindTexture(Request.CacheKey))
+    {
+        INC_DWORD_STAT(STAT_RuntimeImageLoader_TextureCacheHits);
+
+        AddTextureUsers(CachedTexture, 1);
+
+        bSuccess = true;
+        OutTexture = CachedTexture;
+        OutError = TEXT("");
+        return true;
+    }
+
+    INC_DWORD_STAT(STAT_RuntimeImageLoader_TextureCacheMisses);
+
+    // zero or less waits till the image is loaded
+    const double EndTime = FPlatformTime::Seconds() + TimeoutSeconds;
+    auto GetRemainingSeconds = [TimeoutSeconds, EndTime]()
+    {
+        return TimeoutSeconds > 0.f ? FMath::Max(KINDA_SMALL_NUMBER, (float)(EndTime - FPlatformTime::Seconds())) : 0.f;
+    };
 
     FImageReadResult ReadResult;
-    ImageReader->GetResult(ReadResult);
+
+    const int32 LoadingRequestId = CoalescedRequests.Contains(Request.CacheKey) ? FindLoadingRequest(Request.CacheKey) : INDEX_NONE;
+    if (LoadingRequestId != INDEX_NONE)
+    {
+        // same image is being loaded already, that request is waited for instead of loading the image twice
+        const bool bLoadingPrefetch = ActiveRequests[LoadingRequestId].bPrefetch;
+
+        ImageReader->SetRequestExpedited(LoadingRequestId, true);
+        if (!ImageReader->WaitForResult(LoadingRequestId, GetRemainingSeconds(), ReadResult))
+        {
+            ImageReader->SetRequestExpedited(LoadingRequestId, false);
+
+            bSuccess = false;
+            OutTexture = nullptr;
+            OutError = TEXT("Image is still loading");
+
+            // completed together with the request it waits for
+            CoalescedRequests.FindOrAdd(Request.CacheKey).Add(MoveTemp(Request));
+            return false;
+        }
+
+        CompleteRequest(ReadResult);
+
+        if (!bLoadingPrefetch)
+        {
+            bSuccess = ReadResult.OutError.IsEmpty();
+            if (bSuccess)
+            {
+                AddTextureUsers(ReadResult.OutTexture, 1);
+            }
+
+            OutTexture = ReadResult.OutTexture;
+            OutError = ReadResult.OutError;
+
+            return true;
+        }
+
+        // prefetch only decoded the pixels, they are uploaded below
+    }
+
+    Request.Params.bExpedited = true;
+    PrepareRequestForCache(Request.Params, Request.CacheKey);
+
+    Request.Params.RequestId = ImageReader->AddRequest(Request.Params);
+
+    // async requests of the same image wait for this one
+    CoalescedRequests.FindOrAdd(Request.CacheKey);
+
+    if (!ImageReader->WaitForResult(Request.Params.RequestId, GetRemainingSeconds(), ReadResult))
+    {
+        bSuccess = false;
+        OutTexture = nullptr;
+        OutError = TEXT("Image is still loading");
+
+        // nobody waits for it anymore, so it does not run past other requests. Completed by tick as any other request
+        ImageReader->SetRequestExpedited(Request.Params.RequestId, false);
+        Request.Params.bExpedited = false;
+
+        ActiveRequests.Add(Request.Params.RequestId, MoveTemp(Request));
+        return false;
+    }
+
+    AddResultToCache(Request.CacheKey, ReadResult);
+
+    TArray<FLoadImageRequest> SameKeyRequests;
+    CoalescedRequests.RemoveAndCopyValue(Request.CacheKey, SameKeyRequests);
 
     bSuccess = ReadResult.OutError.IsEmpty();
+    if (bSuccess)
+    {
+        AddTextureUsers(ReadResult.OutTexture, 1 + SameKeyRequests.Num());
+    }
+
     OutTexture = ReadResult.OutTexture;
     OutError = ReadResult.OutError;
+
+    for (FLoadImageRequest& SameKeyRequest : SameKeyRequests)
+    {
+        ensure(SameKeyRequest.OnRequestCompleted.IsBound());
+        SameKeyRequest.OnRequestCompleted.Execute(ReadResult);
+    }
+
+    return true;
+}
+
+int32 URuntimeImageLoader::FindLoadingRequest(const FString& CacheKey) const
+{
+    for (const TPair<int32, FLoadImageRequest>& ActiveRequest : ActiveRequests)
+    {
+        if (ActiveRequest.Value.CacheKey == CacheKey)
+        {
+            return ActiveRequest.Key;
+        }
+    }
+
+    return INDEX_NONE;
 }
 
 void URuntimeImageLoader::CancelAll()
@@ -100,36 +651,420 @@ void URuntimeImageLoader::CancelAll()
     check (IsInGameThread());
 
     Requests.Empty();
-    ActiveRequest.Invalidate();
+    ActiveRequests.Empty();
+    CoalescedRequests.Empty();
+    Batches.Empty();
+    NumActivePrefetches = 0;
 
     ImageReader->Clear();
 }
 
+void URuntimeImageLoader::ReleaseTexture(UTexture2D* Texture)
+{
+    check(IsInGameThread());
+
+    if (!IsValid(Texture))
+    {
+        return;
+    }
+
+    // drop counts of textures that were garbage collected without being released
+    for (auto It = TextureUsers.CreateIterator(); It; ++It)
+    {
+        if (!It.Key().IsValid())
+        {
+            It.RemoveCurrent();
+        }
+    }
+
+    int32* NumUsers = TextureUsers.Find(Texture);
+    if (NumUsers != nullptr && --(*NumUsers) > 0)
+    {
+        // cache or coalesced requests handed the same texture to others who still use it
+        return;
+    }
+    TextureUsers.Remove(Texture);
+
+    // cache would hand it out again while its pixels are overwritten
+    ImageCache->RemoveTexture(Texture);
+    ImageReader->ReleaseTexture(Texture);
+}
+
+void URuntimeImageLoader::AddTextureUsers(UTexture2D* Texture, int32 NumUsers)
+{
+    if (IsValid(Texture))
+    {
+        TextureUsers.FindOrAdd(Texture) += NumUsers;
+    }
+}
+
 void URuntimeImageLoader::Tick(float DeltaTime)
 {
     ensure(IsValid(ImageReader));
+
+    const URuntimeImageLoaderSettings* Settings = GetDefault<URuntimeImageLoaderSettings>();
     
-    if (!ActiveRequest.IsRequestValid() && !Requests.IsEmpty())
+    bool bAddedRequests = false;
+    while (ActiveRequests.Num() < Settings->MaxConcurrentRequests && Requests.Num() > 0)
     {
-        Requests.Dequeue(ActiveRequest);
+        // prefetches are sorted behind all other requests
+        if (Requests[0].bPrefetch && NumActivePrefetches >= Settings->MaxConcurrentPrefetches)
+        {
+            break;
+        }
+
+        FLoadImageRequest Request = MoveTemp(Requests[0]);
+        Requests.RemoveAt(0);
+
+        if (Request.bPrefetch)
+        {
+            if (!PreparePrefetch(Request))
+            {
+                continue;
+            }
+
+            // requests of the same image wait for the prefetch instead of loading it twice
+            CoalescedRequests.Add(Request.CacheKey);
+            ++NumActivePrefetches;
+        }
+        // requests that update existing textures have no cache key, they neither use caches nor share results
+        else if (!Request.CacheKey.IsEmpty())
+        {
+            if (CompleteRequestFromCache(Request))
+            {
+                continue;
+            }
+
+            if (TArray<FLoadImageRequest>* SameKeyRequests = CoalescedRequests.Find(Request.CacheKey))
+            {
+                // same image is being loaded already
+                SameKeyRequests->Add(MoveTemp(Request));
+                continue;
+            }
+
+            PrepareRequestForCache(Request.Params, Request.CacheKey);
+
+            CoalescedRequests.Add(Request.CacheKey);
+        }
 
-        FImageReadRequest ReadRequest(ActiveRequest.Params);
+        Request.Params.RequestId = ImageReader->AddRequest(Request.Params);
+        ActiveRequests.Add(Request.Params.RequestId, MoveTemp(Request));
 
-        ImageReader->AddRequest(ReadRequest);
+        bAddedRequests = true;
+    }
+
+    if (bAddedRequests)
+    {
         ImageReader->Trigger();
     }
 
-    if (ActiveRequest.IsRequestValid() && ImageReader->IsWorkCompleted())
+    ReportPreviews();
+
+    SET_DWORD_STAT(STAT_RuntimeImageLoader_RequestsWaiting, Requests.Num());
+
+    FImageReadResult ReadResult;
+    if (Settings->bPreserveRequestOrder)
+    {
+        while (ImageReader->GetResult(ReadResult))
+        {
+            CompleteRequest(ReadResult);
+        }
+    }
+    else
+    {
+        TArray<int32> RequestIds;
+        ActiveRequests.GetKeys(RequestIds);
+
+        for (int32 RequestId : RequestIds)
+        {
+            if (ImageReader->GetResult(RequestId, ReadResult))
+            {
+                CompleteRequest(ReadResult);
+            }
+        }
+    }
+}
+
+void URuntimeImageLoader::ReportPreviews()
+{
+    for (TPair<int32, FLoadImageRequest>& ActiveRequest : ActiveRequests)
+    {
+        FLoadImageRequest& Request = ActiveRequest.Value;
+        if (!Request.OnPreviewAvailable.IsBound() || Request.bPreviewReported)
+        {
+            continue;
+        }
+
+        UTexture2D* PreviewTexture = nullptr;
+        if (ImageReader->GetPreview(ActiveRequest.Key, PreviewTexture))
+        {
+            Request.bPreviewReported = true;
+            Request.OnPreviewAvailable.Execute(PreviewTexture);
+        }
+    }
+}
+
+void URuntimeImageLoader::CompleteRequest(const FImageReadResult& ReadResult)
+{
+    FLoadImageRequest Request;
+    if (!ActiveRequests.RemoveAndCopyValue(ReadResult.RequestId, Request))
+    {
+        // request was cancelled or it's a sync request
+        return;
+    }
+
+    if (Request.bPrefetch)
+    {
+        CompletePrefetch(Request, ReadResult);
+        return;
+    }
+
+    AddResultToCache(Request.CacheKey, ReadResult);
+
+    TArray<FLoadImageRequest> SameKeyRequests;
+    CoalescedRequests.RemoveAndCopyValue(Request.CacheKey, SameKeyRequests);
+
+    if (ReadResult.OutError.IsEmpty())
+    {
+        AddTextureUsers(ReadResult.OutTexture, 1 + SameKeyRequests.Num());
+    }
+
+    ensure(Request.OnRequestCompleted.IsBound());
+    Request.OnRequestCompleted.Execute(ReadResult);
+
+    // coalesced requests share the texture
+    for (FLoadImageRequest& SameKeyRequest : SameKeyRequests)
+    {
+        ensure(SameKeyRequest.OnRequestCompleted.IsBound());
+        SameKeyRequest.OnRequestCompleted.Execute(ReadResult);
+    }
+}
+
+bool URuntimeImageLoader::CompleteRequestFromCache(FLoadImageRequest& Request)
+{
+    UTexture2D* CachedTexture = ImageCache->FindTexture(Request.CacheKey);
+    if (CachedTexture == nullptr)
+    {
+        INC_DWORD_STAT(STAT_RuntimeImageLoader_TextureCacheMisses);
+        return false;
+    }
+
+    INC_DWORD_STAT(STAT_RuntimeImageLoader_TextureCacheHits);
+
+    AddTextureUsers(CachedTexture, 1);
+
+    FImageReadResult ReadResult;
+    {
+        ReadResult.ImageFilename = Request.Params.ImageFilename;
+        ReadResult.OutTexture = CachedTexture;
+    }
+
+    ensure(Request.OnRequestCompleted.IsBound());
+    Request.OnRequestCompleted.Execute(ReadResult);
+
+    return true;
+}
+
+void URuntimeImageLoader::PrepareRequestForCache(FImageReadRequest& ReadRequest, const FString& CacheKey) const
+{
+    ReadRequest.DecodedImageData = ImageCache->FindImageData(CacheKey);
+    ReadRequest.bKeepImageData = ImageCache->IsImageDataCacheEnabled() && !ReadRequest.DecodedImageData.IsValid();
+
+    if (ReadRequest.DecodedImageData.IsValid())
+    {
+        INC_DWORD_STAT(STAT_RuntimeImageLoader_ImageDataCacheHits);
+    }
+}
+
+void URuntimeImageLoader::AddResultToCache(const FString& CacheKey, const FImageReadResult& ReadResult)
+{
+    if (CacheKey.IsEmpty() || !ReadResult.OutError.IsEmpty() || !IsValid(ReadResult.OutTexture))
+    {
+        return;
+    }
+
+    ImageCache->AddTexture(CacheKey, ReadResult.OutTexture);
+    ImageCache->AddImageData(CacheKey, ReadResult.ImageData);
+}
+
+bool URuntimeImageLoader::PreparePrefetch(const FLoadImageRequest& Request) const
+{
+    // pixels or texture are there already or the image is being loaded by another request
+    return !CoalescedRequests.Contains(Request.CacheKey)
+        && ImageCache->FindTexture(Request.CacheKey) == nullptr
+        && !ImageCache->FindImageData(Request.CacheKey).IsValid();
+}
+
+void URuntimeImageLoader::CompletePrefetch(const FLoadImageRequest& Request, const FImageReadResult& ReadResult)
+{
+    --NumActivePrefetches;
+
+    if (ReadResult.OutError.IsEmpty())
+    {
+        ImageCache->AddImageData(Request.CacheKey, ReadResult.ImageData);
+    }
+    else
     {
-        FImageReadResult ReadResult;
-        ImageReader->GetResult(ReadResult);
+        UE_LOG(LogRuntimeImageLoader, Warning, TEXT("Failed to prefetch image %s. Error: %s"), *ReadResult.ImageFilename, *ReadResult.OutError);
+    }
+
+    // requests that came in meanwhile only upload the cached pixels now
+    TArray<FLoadImageRequest> SameKeyRequests;
+    CoalescedRequests.RemoveAndCopyValue(Request.CacheKey, SameKeyRequests);
 
-        ensure(ActiveRequest.OnRequestCompleted.IsBound());
+    for (FLoadImageRequest& SameKeyRequest : SameKeyRequests)
+    {
+        EnqueueRequest(MoveTemp(SameKeyRequest));
+    }
+}
 
-        ActiveRequest.OnRequestCompleted.Execute(ReadResult);
+void URuntimeImageLoader::CompleteCancelledRequest(FLoadImageRequest& Request)
+{
+    if (!Request.bBatchItem)
+    {
+        return;
+    }
 
-        ActiveRequest.Invalidate();
+    // batch still finishes once all of its items did, cancelled ones count as failed
+    FImageReadResult ReadResult;
+    {
+        ReadResult.ImageFilename = Request.Params.ImageFilename;
+        ReadResult.OutError = TEXT("Request was cancelled");
     }
+
+    ensure(Request.OnRequestCompleted.IsBound());
+    Request.OnRequestCompleted.Execute(ReadResult);
+}
+
+void URuntimeImageLoader::HandleBatchItemLoaded(const FImageReadResult& ReadResult, int32 BatchId, int32 ItemIndex)
+{
+    FRuntimeImageBatch* Batch = Batches.Find(BatchId);
+    if (Batch == nullptr)
+    {
+        return;
+    }
+
+    const bool bSucceeded = ReadResult.OutError.IsEmpty() && IsValid(ReadResult.OutTexture);
+    if (!bSucceeded)
+    {
+        UE_LOG(LogRuntimeImageLoader, Error, TEXT("Failed to load image %s of the batch. Error: %s"), *ReadResult.ImageFilename, *ReadResult.OutError);
+    }
+
+    Batch->Textures[ItemIndex] = bSucceeded ? ReadResult.OutTexture : nullptr;
+    Batch->NumCompleted++;
+    Batch->NumFailed += bSucceeded ? 0 : 1;
+
+    const float BatchProgress = (float)Batch->NumCompleted / Batch->Textures.Num();
+    Batch->OnItemLoaded.ExecuteIfBound(ItemIndex, Batch->Textures[ItemIndex], bSucceeded, ReadResult.OutError, BatchProgress);
+
+    // callback may have cancelled everything
+    Batch = Batches.Find(BatchId);
+    if (Batch == nullptr || Batch->NumCompleted < Batch->Textures.Num())
+    {
+        return;
+    }
+
+    if (Batch->bPackIntoAtlas && PackBatchIntoAtlas(BatchId, *Batch))
+    {
+        return;
+    }
+
+    FinishBatch(BatchId);
+}
+
+bool URuntimeImageLoader::PackBatchIntoAtlas(int32 BatchId, FRuntimeImageBatch& Batch)
+{
+    // images are copied as they are, so they must be stored the same way
+    const UTexture2D* FirstTexture = nullptr;
+    TArray<FIntPoint> Sizes;
+    Sizes.SetNumZeroed(Batch.Textures.Num());
+
+    for (int32 ItemIndex = 0; ItemIndex < Batch.Textures.Num(); ++ItemIndex)
+    {
+        const UTexture2D* Texture = Batch.Textures[ItemIndex];
+        if (Texture == nullptr)
+        {
+            continue;
+        }
+
+        if (FirstTexture == nullptr)
+        {
+            FirstTexture = Texture;
+        }
+        else if (Texture->GetPixelFormat() != FirstTexture->GetPixelFormat() || Texture->SRGB != FirstTexture->SRGB)
+        {
+            UE_LOG(LogRuntimeImageLoader, Warning, TEXT("Images of the batch are not packed into atlas, %s and %s have different formats"), *FirstTexture->GetName(), *Texture->GetName());
+            return false;
+        }
+
+        Sizes[ItemIndex] = FIntPoint(Texture->GetSizeX(), Texture->GetSizeY());
+    }
+
+    if (FirstTexture == nullptr)
+    {
+        return false;
+    }
+
+    // padding keeps bilinear filtering from picking neighbour images, compressed images are copied by whole blocks
+    const int32 AtlasPadding = 2;
+    const FPixelFormatInfo& FormatInfo = GPixelFormats[FirstTexture->GetPixelFormat()];
+
+    FIntPoint AtlasSize;
+    TArray<FIntPoint> Positions;
+    if (!FAtlasHelpers::PackRects(Sizes, Batch.MaxAtlasSize, AtlasPadding, FMath::Max(FormatInfo.BlockSizeX, FormatInfo.BlockSizeY), AtlasSize, Positions))
+    {
+        UE_LOG(LogRuntimeImageLoader, Warning, TEXT("Images of the batch do not fit atlas of %d x %d"), Batch.MaxAtlasSize, Batch.MaxAtlasSize);
+        return false;
+    }
+
+    FRuntimeImageData AtlasData;
+    {
+        AtlasData.SizeX = AtlasSize.X;
+        AtlasData.SizeY = AtlasSize.Y;
+        AtlasData.PixelFormat = FirstTexture->GetPixelFormat();
+        AtlasData.SRGB = FirstTexture->SRGB;
+        AtlasData.NumMips = 1;
+    }
+
+    Batch.AtlasTexture = FRuntimeImageUtils::CreateTexture(TEXT("Atlas"), AtlasData);
+
+    Batch.AtlasUVs.SetNum(Batch.Textures.Num());
+    for (int32 ItemIndex = 0; ItemIndex < Batch.Textures.Num(); ++ItemIndex)
+    {
+        Batch.AtlasUVs[ItemIndex] = Sizes[ItemIndex].X > 0 ?
+            FBox2D(FVector2D(Positions[ItemIndex]) / FVector2D(AtlasSize), FVector2D(Positions[ItemIndex] + Sizes[ItemIndex]) / FVector2D(AtlasSize)) :
+            FBox2D(ForceInit);
+    }
+
+    TWeakObjectPtr<URuntimeImageLoader> WeakThis(this);
+    ImageReader->CreateAtlasTexture(Batch.AtlasTexture, AtlasData, Batch.Textures, Positions,
+        [WeakThis, BatchId]()
+        {
+            AsyncTask(ENamedThreads::GameThread,
+                [WeakThis, BatchId]()
+                {
+                    if (URuntimeImageLoader* Loader = WeakThis.Get())
+                    {
+                        Loader->FinishBatch(BatchId);
+                    }
+                }
+            );
+        }
+    );
+
+    return true;
+}
+
+void URuntimeImageLoader::FinishBatch(int32 BatchId)
+{
+    FRuntimeImageBatch Batch;
+    if (!Batches.RemoveAndCopyValue(BatchId, Batch))
+    {
+        // cancelled
+        return;
+    }
+
+    Batch.OnBatchLoaded.ExecuteIfBound(Batch.Textures, Batch.NumFailed, Batch.AtlasTexture, Batch.AtlasUVs);
 }
 
 TStatId URuntimeImageLoader::GetStatId() const
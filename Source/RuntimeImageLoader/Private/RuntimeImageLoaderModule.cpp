@@ -1,12 +1,18 @@
 // Copyright 2022 Peter Leontev. All Rights Reserved.
 
 #include "RuntimeImageLoaderModule.h"
+#include "Helpers/FreeImageWrapper.h"
 
 #define LOCTEXT_NAMESPACE "FRuntimeImageLoaderModule"
 
 void FRuntimeImageLoaderModule::StartupModule()
 {
 	// This code will execute after your module is loaded into memory; the exact timing is specified in the .uplugin file per-module
+
+#if WITH_FREEIMAGE_LIB
+	// loaded before any worker decodes a TIFF, loaders only check that it is valid
+	FFreeImageWrapper::FreeImage_Initialise(false);
+#endif // WITH_FREEIMAGE_LIB
 }
 
 void FRuntimeImageLoaderModule::ShutdownModule()
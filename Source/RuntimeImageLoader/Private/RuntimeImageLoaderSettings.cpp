@@ -0,0 +1,31 @@
+// Copyright 2022 Peter Leontev. All Rights Reserved.
+
+#include "RuntimeImageLoaderSettings.h"
+#include "HAL/PlatformMisc.h"
+#include "Misc/Paths.h"
+
+URuntimeImageLoaderSettings::URuntimeImageLoaderSettings()
+{
+    CategoryName = TEXT("Plugins");
+}
+
+int32 URuntimeImageLoaderSettings::GetNumWorkers() const
+{
+    if (NumWorkers > 0)
+    {
+        return NumWorkers;
+    }
+
+    // leave cores for game and rendering threads
+    return FMath::Clamp(FPlatformMisc::NumberOfCores() - 2, 1, 8);
+}
+
+FString URuntimeImageLoaderSettings::GetDiskCacheDirectory() const
+{
+    if (!DiskCacheDirectory.IsEmpty())
+    {
+        return DiskCacheDirectory;
+    }
+
+    return FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("RuntimeImageLoader"), TEXT("Cache"));
+}
@@ -0,0 +1,46 @@
+// Copyright 2022 Peter Leontev. All Rights Reserved.
+
+#include "RuntimeImageLoaderStats.h"
+
+UE_TRACE_CHANNEL_DEFINE(RuntimeImageLoaderChannel);
+
+DEFINE_STAT(STAT_RuntimeImageLoader_Fetch);
+DEFINE_STAT(STAT_RuntimeImageLoader_SniffFormat);
+DEFINE_STAT(STAT_RuntimeImageLoader_Decode);
+DEFINE_STAT(STAT_RuntimeImageLoader_DecodePNG);
+DEFINE_STAT(STAT_RuntimeImageLoader_DecodeJPEG);
+DEFINE_STAT(STAT_RuntimeImageLoader_DecodeBMP);
+DEFINE_STAT(STAT_RuntimeImageLoader_DecodeTGA);
+DEFINE_STAT(STAT_RuntimeImageLoader_DecodeEXR);
+DEFINE_STAT(STAT_RuntimeImageLoader_DecodeTIFF);
+DEFINE_STAT(STAT_RuntimeImageLoader_DecodeQOI);
+DEFINE_STAT(STAT_RuntimeImageLoader_DecodePreview);
+DEFINE_STAT(STAT_RuntimeImageLoader_Transform);
+DEFINE_STAT(STAT_RuntimeImageLoader_Upload);
+DEFINE_STAT(STAT_RuntimeImageLoader_ConstructTexture);
+DEFINE_STAT(STAT_RuntimeImageLoader_ProcessUploads);
+DEFINE_STAT(STAT_RuntimeImageLoader_FinalizeTexture);
+DEFINE_STAT(STAT_RuntimeImageLoader_WaitForGameThread);
+DEFINE_STAT(STAT_RuntimeImageLoader_WaitForResult);
+DEFINE_STAT(STAT_RuntimeImageLoader_FetchQueue);
+DEFINE_STAT(STAT_RuntimeImageLoader_DecodeQueue);
+DEFINE_STAT(STAT_RuntimeImageLoader_TransformQueue);
+DEFINE_STAT(STAT_RuntimeImageLoader_UploadQueue);
+DEFINE_STAT(STAT_RuntimeImageLoader_WaitingForMemory);
+DEFINE_STAT(STAT_RuntimeImageLoader_RequestsInFlight);
+DEFINE_STAT(STAT_RuntimeImageLoader_RequestsWaiting);
+DEFINE_STAT(STAT_RuntimeImageLoader_UploadsInFlight);
+DEFINE_STAT(STAT_RuntimeImageLoader_RequestsCompleted);
+DEFINE_STAT(STAT_RuntimeImageLoader_RequestsFailed);
+DEFINE_STAT(STAT_RuntimeImageLoader_TextureCacheHits);
+DEFINE_STAT(STAT_RuntimeImageLoader_TextureCacheMisses);
+DEFINE_STAT(STAT_RuntimeImageLoader_ImageDataCacheHits);
+DEFINE_STAT(STAT_RuntimeImageLoader_DiskCacheHits);
+DEFINE_STAT(STAT_RuntimeImageLoader_DiskCacheMisses);
+DEFINE_STAT(STAT_RuntimeImageLoader_TexturePoolHits);
+DEFINE_STAT(STAT_RuntimeImageLoader_BytesDownloaded);
+DEFINE_STAT(STAT_RuntimeImageLoader_BytesRead);
+DEFINE_STAT(STAT_RuntimeImageLoader_BytesDecoded);
+DEFINE_STAT(STAT_RuntimeImageLoader_BytesUploaded);
+DEFINE_STAT(STAT_RuntimeImageLoader_DecodeMemoryReserved);
+DEFINE_STAT(STAT_RuntimeImageLoader_TextureMemory);
@@ -0,0 +1,68 @@
+// Copyright 2022 Peter Leontev. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Stats/Stats.h"
+#include "Trace/Trace.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+
+/** Stage timings are traced to Unreal Insights with -trace=cpu,RuntimeImageLoader */
+UE_TRACE_CHANNEL_EXTERN(RuntimeImageLoaderChannel);
+
+/** Cycle stat that shows up both in "stat RuntimeImageLoader" and in Insights captures */
+#define SCOPE_RUNTIME_IMAGE_CYCLE_COUNTER(Stat) \
+    SCOPE_CYCLE_COUNTER(Stat); \
+    TRACE_CPUPROFILER_EVENT_SCOPE_ON_CHANNEL(Stat, RuntimeImageLoaderChannel)
+
+DECLARE_STATS_GROUP(TEXT("Runtime Image Loader"), STATGROUP_RuntimeImageLoader, STATCAT_Advanced);
+
+// stages
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Fetch"), STAT_RuntimeImageLoader_Fetch, STATGROUP_RuntimeImageLoader, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Sniff Format"), STAT_RuntimeImageLoader_SniffFormat, STATGROUP_RuntimeImageLoader, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Decode"), STAT_RuntimeImageLoader_Decode, STATGROUP_RuntimeImageLoader, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Decode PNG"), STAT_RuntimeImageLoader_DecodePNG, STATGROUP_RuntimeImageLoader, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Decode JPEG"), STAT_RuntimeImageLoader_DecodeJPEG, STATGROUP_RuntimeImageLoader, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Decode BMP"), STAT_RuntimeImageLoader_DecodeBMP, STATGROUP_RuntimeImageLoader, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Decode TGA"), STAT_RuntimeImageLoader_DecodeTGA, STATGROUP_RuntimeImageLoader, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Decode EXR"), STAT_RuntimeImageLoader_DecodeEXR, STATGROUP_RuntimeImageLoader, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Decode TIFF"), STAT_RuntimeImageLoader_DecodeTIFF, STATGROUP_RuntimeImageLoader, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Decode QOI"), STAT_RuntimeImageLoader_DecodeQOI, STATGROUP_RuntimeImageLoader, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Decode Preview"), STAT_RuntimeImageLoader_DecodePreview, STATGROUP_RuntimeImageLoader, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Transform"), STAT_RuntimeImageLoader_Transform, STATGROUP_RuntimeImageLoader, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Upload"), STAT_RuntimeImageLoader_Upload, STATGROUP_RuntimeImageLoader, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Construct Texture"), STAT_RuntimeImageLoader_ConstructTexture, STATGROUP_RuntimeImageLoader, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Process Uploads (RT)"), STAT_RuntimeImageLoader_ProcessUploads, STATGROUP_RuntimeImageLoader, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Finalize Texture (RT)"), STAT_RuntimeImageLoader_FinalizeTexture, STATGROUP_RuntimeImageLoader, );
+
+// waits
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Wait For Game Thread"), STAT_RuntimeImageLoader_WaitForGameThread, STATGROUP_RuntimeImageLoader, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Wait For Sync Result"), STAT_RuntimeImageLoader_WaitForResult, STATGROUP_RuntimeImageLoader, );
+
+// queues, sampled every frame
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Fetch Queue"), STAT_RuntimeImageLoader_FetchQueue, STATGROUP_RuntimeImageLoader, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Decode Queue"), STAT_RuntimeImageLoader_DecodeQueue, STATGROUP_RuntimeImageLoader, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Transform Queue"), STAT_RuntimeImageLoader_TransformQueue, STATGROUP_RuntimeImageLoader, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Upload Queue"), STAT_RuntimeImageLoader_UploadQueue, STATGROUP_RuntimeImageLoader, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Waiting For Memory"), STAT_RuntimeImageLoader_WaitingForMemory, STATGROUP_RuntimeImageLoader, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Requests In Flight"), STAT_RuntimeImageLoader_RequestsInFlight, STATGROUP_RuntimeImageLoader, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Requests Waiting"), STAT_RuntimeImageLoader_RequestsWaiting, STATGROUP_RuntimeImageLoader, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Texture Uploads In Flight"), STAT_RuntimeImageLoader_UploadsInFlight, STATGROUP_RuntimeImageLoader, );
+
+// totals since start
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Requests Completed"), STAT_RuntimeImageLoader_RequestsCompleted, STATGROUP_RuntimeImageLoader, );
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Requests Failed"), STAT_RuntimeImageLoader_RequestsFailed, STATGROUP_RuntimeImageLoader, );
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Texture Cache Hits"), STAT_RuntimeImageLoader_TextureCacheHits, STATGROUP_RuntimeImageLoader, );
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Texture Cache Misses"), STAT_RuntimeImageLoader_TextureCacheMisses, STATGROUP_RuntimeImageLoader, );
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Image Data Cache Hits"), STAT_RuntimeImageLoader_ImageDataCacheHits, STATGROUP_RuntimeImageLoader, );
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Disk Cache Hits"), STAT_RuntimeImageLoader_DiskCacheHits, STATGROUP_RuntimeImageLoader, );
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Disk Cache Misses"), STAT_RuntimeImageLoader_DiskCacheMisses, STATGROUP_RuntimeImageLoader, );
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Texture Pool Hits"), STAT_RuntimeImageLoader_TexturePoolHits, STATGROUP_RuntimeImageLoader, );
+
+// bytes
+DECLARE_MEMORY_STAT_EXTERN(TEXT("Bytes Downloaded"), STAT_RuntimeImageLoader_BytesDownloaded, STATGROUP_RuntimeImageLoader, );
+DECLARE_MEMORY_STAT_EXTERN(TEXT("Bytes Read From Disk"), STAT_RuntimeImageLoader_BytesRead, STATGROUP_RuntimeImageLoader, );
+DECLARE_MEMORY_STAT_EXTERN(TEXT("Bytes Decoded"), STAT_RuntimeImageLoader_BytesDecoded, STATGROUP_RuntimeImageLoader, );
+DECLARE_MEMORY_STAT_EXTERN(TEXT("Bytes Uploaded"), STAT_RuntimeImageLoader_BytesUploaded, STATGROUP_RuntimeImageLoader, );
+DECLARE_MEMORY_STAT_EXTERN(TEXT("Decode Memory Reserved"), STAT_RuntimeImageLoader_DecodeMemoryReserved, STATGROUP_RuntimeImageLoader, );
+DECLARE_MEMORY_STAT_EXTERN(TEXT("Texture Memory"), STAT_RuntimeImageLoader_TextureMemory, STATGROUP_RuntimeImageLoader, );
@@ -0,0 +1,390 @@
+// Copyright 2022 Peter Leontev. All Rights Reserved.
+
+#include "RuntimeImageProgressiveDecoder.h"
+
+#include "RuntimeImageUtils.h"
+
+THIRD_PARTY_INCLUDES_START
+#include "png.h"
+#include <setjmp.h>
+THIRD_PARTY_INCLUDES_END
+
+
+DEFINE_LOG_CATEGORY_STATIC(LogRuntimeImageProgressiveDecoder, Log, All);
+
+namespace
+{
+    /**
+     * Feeds libpng with bytes as they arrive. Rows are decoded straight to BGRA8.
+     * Interlaced images get a blocky preview of the whole image after every Adam7 pass,
+     * the others get their top rows.
+     */
+    class FPNGProgressiveDecoder : public FRuntimeImageProgressiveDecoder
+    {
+    public:
+        FPNGProgressiveDecoder()
+        {
+            PngPtr = png_create_read_struct(PNG_LIBPNG_VER_STRING, this, nullptr, &FPNGProgressiveDecoder::OnWarning);
+            if (PngPtr != nullptr)
+            {
+                InfoPtr = png_create_info_struct(PngPtr);
+            }
+
+            if (InfoPtr == nullptr)
+            {
+                bFailed = true;
+                return;
+            }
+
+            png_set_progressive_read_fn(PngPtr, this, &FPNGProgressiveDecoder::OnInfo, &FPNGProgressiveDecoder::OnRow, &FPNGProgressiveDecoder::OnEnd);
+        }
+
+        virtual ~FPNGProgressiveDecoder()
+        {
+            if (PngPtr != nullptr)
+            {
+                png_destroy_read_struct(&PngPtr, InfoPtr != nullptr ? &InfoPtr : nullptr, nullptr);
+            }
+        }
+
+        virtual bool AppendData(const uint8* Data, int64 Num) override
+        {
+            if (bFailed || bFinished)
+            {
+                return false;
+            }
+
+            if (!ProcessData(Data, Num))
+            {
+                UE_LOG(LogRuntimeImageProgressiveDecoder, Verbose, TEXT("PNG can't be decoded progressively, previews are disabled"));
+                bFailed = true;
+                return false;
+            }
+
+            const bool bHasNewPreview = bInterlaced ? (NumCompletedPasses > NumPreviewedPasses) : (NumDecodedRows - NumPreviewedRows >= FMath::Max(1, Height / 8));
+            return bHasNewPreview && !bFinished;
+        }
+
+        virtual bool GetPreview(FRuntimeImageData& OutImageData) override
+        {
+            if (bFailed || Pixels.Num() == 0)
+            {
+                return false;
+            }
+
+            OutImageData.Init2D(Width, Height, TSF_BGRA8, Pixels.GetData());
+            OutImageData.SRGB = true;
+            OutImageData.GammaSpace = EGammaSpace::sRGB;
+
+            if (bInterlaced)
+            {
+                NumPreviewedPasses = NumCompletedPasses;
+                FillInterlacedPreview(OutImageData);
+            }
+            else
+            {
+                NumPreviewedRows = NumDecodedRows;
+            }
+
+            return true;
+        }
+
+    private:
+        /** Separate function so nothing with a destructor lives in the frame libpng jumps to */
+        bool ProcessData(const uint8* Data, int64 Num)
+        {
+            if (setjmp(png_jmpbuf(PngPtr)))
+            {
+                return false;
+            }
+
+            png_process_data(PngPtr, InfoPtr, (png_bytep)Data, (png_size_t)Num);
+            return true;
+        }
+
+        /** Spreads pixels of completed passes over the blocks of pixels that are not decoded yet */
+        void FillInterlacedPreview(FRuntimeImageData& ImageData) const
+        {
+            if (NumCompletedPasses <= 0 || NumCompletedPasses >= 7)
+            {
+                return;
+            }
+
+            // block each known pixel covers after the given number of Adam7 passes
+            static const int32 BlockSizesX[] = { 8, 4, 4, 2, 2, 1 };
+            static const int32 BlockSizesY[] = { 8, 8, 4, 4, 2, 2 };
+
+            const int32 BlockSizeX = BlockSizesX[NumCompletedPasses - 1];
+            const int32 BlockSizeY = BlockSizesY[NumCompletedPasses - 1];
+
+            uint32* PreviewPixels = (uint32*)ImageData.RawData.GetData();
+
+            for (int32 Y = 0; Y < Height; ++Y)
+            {
+                const uint32* SourceRow = PreviewPixels + (int64)(Y - Y % BlockSizeY) * Width;
+                uint32* DestRow = PreviewPixels + (int64)Y * Width;
+
+                for (int32 X = 0; X < Width; ++X)
+                {
+                    DestRow[X] = SourceRow[X - X % BlockSizeX];
+                }
+            }
+        }
+
+        static void OnInfo(png_structp Png, png_infop Info)
+        {
+            FPNGProgressiveDecoder* Decoder = (FPNGProgressiveDecoder*)png_get_progressive_ptr(Png);
+
+            png_uint_32 PngWidth = 0;
+            png_uint_32 PngHeight = 0;
+            int32 BitDepth = 0;
+            int32 ColorType = 0;
+            int32 InterlaceType = 0;
+            png_get_IHDR(Png, Info, &PngWidth, &PngHeight, &BitDepth, &ColorType, &InterlaceType, nullptr, nullptr);
+
+            // previews are always 8 bit BGRA
+            if (ColorType == PNG_COLOR_TYPE_PALETTE)
+            {
+                png_set_palette_to_rgb(Png);
+            }
+            if (ColorType == PNG_COLOR_TYPE_GRAY && BitDepth < 8)
+            {
+                png_set_expand_gray_1_2_4_to_8(Png);
+            }
+            if (png_get_valid(Png, Info, PNG_INFO_tRNS))
+            {
+                png_set_tRNS_to_alpha(Png);
+            }
+            if (BitDepth == 16)
+            {
+                png_set_strip_16(Png);
+            }
+            if (ColorType == PNG_COLOR_TYPE_GRAY || ColorType == PNG_COLOR_TYPE_GRAY_ALPHA)
+            {
+                png_set_gray_to_rgb(Png);
+            }
+            png_set_bgr(Png);
+            png_set_filler(Png, 0xFF, PNG_FILLER_AFTER);
+
+            png_set_interlace_handling(Png);
+            png_read_update_info(Png, Info);
+
+            if (png_get_rowbytes(Png, Info) != (png_size_t)PngWidth * 4)
+            {
+                png_error(Png, "Unexpected row size");
+            }
+
+            Decoder->Width = PngWidth;
+            Decoder->Height = PngHeight;
+            Decoder->bInterlaced = InterlaceType == PNG_INTERLACE_ADAM7;
+            Decoder->Pixels.SetNumZeroed((int64)PngWidth * PngHeight * 4);
+        }
+
+        static void OnRow(png_structp Png, png_bytep NewRow, png_uint_32 RowNum, int32 Pass)
+        {
+            FPNGProgressiveDecoder* Decoder = (FPNGProgressiveDecoder*)png_get_progressive_ptr(Png);
+
+            // passes before the current one are complete
+            Decoder->NumCompletedPasses = FMath::Max(Decoder->NumCompletedPasses, Pass);
+
+            if (NewRow == nullptr || (int32)RowNum >= Decoder->Height)
+            {
+                return;
+            }
+
+            // writes only the pixels of the current pass for interlaced images
+            png_progressive_combine_row(Png, Decoder->Pixels.GetData() + (int64)RowNum * Decoder->Width * 4, NewRow);
+
+            Decoder->NumDecodedRows = FMath::Max(Decoder->NumDecodedRows, (int32)RowNum + 1);
+        }
+
+        static void OnEnd(png_structp Png, png_infop Info)
+        {
+            FPNGProgressiveDecoder* Decoder = (FPNGProgressiveDecoder*)png_get_progressive_ptr(Png);
+            Decoder->bFinished = true;
+        }
+
+        static void OnWarning(png_structp Png, png_const_charp Message)
+        {
+            // warnings do not stop decoding
+        }
+
+    private:
+        png_structp PngPtr = nullptr;
+        png_infop InfoPtr = nullptr;
+
+        TArray64<uint8> Pixels;
+        int32 Width = 0;
+        int32 Height = 0;
+        bool bInterlaced = false;
+
+        int32 NumCompletedPasses = 0;
+        int32 NumPreviewedPasses = 0;
+        int32 NumDecodedRows = 0;
+        int32 NumPreviewedRows = 0;
+
+        bool bFinished = false;
+        bool bFailed = false;
+    };
+
+    /**
+     * JPEG decoder fills missing data in, so the prefix is decoded again every time it grows enough:
+     * progressive images get sharper after every scan, baseline ones reveal more rows.
+     */
+    class FJPEGProgressiveDecoder : public FRuntimeImageProgressiveDecoder
+    {
+    public:
+        explicit FJPEGProgressiveDecoder(int64 InTotalSize)
+            : TotalSize(InTotalSize)
+        {
+        }
+
+        virtual bool AppendData(const uint8* Data, int64 Num) override
+        {
+            if (NumPreviews >= MaxPreviews)
+            {
+                return false;
+            }
+
+            EncodedData.Append(Data, Num);
+            ParseMarkers();
+
+            if (NumScans == 0)
+            {
+                return false;
+            }
+
+            if (bProgressive)
+            {
+                // last scan is still being downloaded
+                return NumScans - 1 > NumPreviewedScans;
+            }
+
+            const int64 PreviewStep = (TotalSize > 0) ? TotalSize / 4 : 256 * 1024;
+            return EncodedData.Num() - NumPreviewedBytes >= PreviewStep;
+        }
+
+        virtual bool GetPreview(FRuntimeImageData& OutImageData) override
+        {
+            NumPreviewedScans = NumScans - 1;
+            NumPreviewedBytes = EncodedData.Num();
+            ++NumPreviews;
+
+            // decoder rejects data without EOI, the missing part is filled in once it sees the end of image
+            const int64 PrefixSize = EncodedData.Num();
+            EncodedData.Add(0xFF);
+            EncodedData.Add(0xD9);
+
+            FString Error;
+            const bool bDecoded = FRuntimeImageUtils::ImportBufferAsImage(EncodedData.GetData(), (int32)EncodedData.Num(), OutImageData, Error, ERuntimeImageFormat::JPEG);
+
+            EncodedData.SetNum(PrefixSize);
+
+            if (NumPreviews >= MaxPreviews)
+            {
+                // every preview decodes the whole prefix again, the rest of the image is only decoded once it's downloaded
+                EncodedData.Empty();
+            }
+
+            if (!bDecoded)
+            {
+                UE_LOG(LogRuntimeImageProgressiveDecoder, Verbose, TEXT("JPEG preview of %lld bytes was not decoded: %s"), PrefixSize, *Error);
+            }
+
+            return bDecoded;
+        }
+
+    private:
+        /** Walks segments by their lengths, so markers inside APPn segments, e.g. an EXIF thumbnail, are not counted */
+        void ParseMarkers()
+        {
+            while (ParseOffset + 1 < EncodedData.Num())
+            {
+                const uint8 Byte = EncodedData[ParseOffset];
+                const uint8 Marker = EncodedData[ParseOffset + 1];
+
+                if (bInEntropyData)
+                {
+                    // 0xFF of entropy coded data is followed by a stuffed zero, restart markers are part of the scan too
+                    const bool bScanEnded = Byte == 0xFF && Marker != 0x00 && Marker != 0xFF && !(Marker >= 0xD0 && Marker <= 0xD7);
+                    if (bScanEnded)
+                    {
+                        bInEntropyData = false;
+                    }
+                    else
+                    {
+                        ++ParseOffset;
+                    }
+                    continue;
+                }
+
+                if (Byte != 0xFF || Marker == 0xFF)
+                {
+                    // fill bytes
+                    ++ParseOffset;
+                    continue;
+                }
+
+                // SOI, EOI, TEM and RSTn have no segment
+                if (Marker == 0xD8 || Marker == 0xD9 || Marker == 0x01 || (Marker >= 0xD0 && Marker <= 0xD7))
+                {
+                    ParseOffset += 2;
+                    continue;
+                }
+
+                if (ParseOffset + 3 >= EncodedData.Num())
+                {
+                    // segment length did not arrive yet
+                    return;
+                }
+
+                const int32 SegmentLength = (EncodedData[ParseOffset + 2] << 8) | EncodedData[ParseOffset + 3];
+
+                // SOFn except DHT, JPG and DAC which share the range
+                const bool bFrameMarker = Marker >= 0xC0 && Marker <= 0xCF && Marker != 0xC4 && Marker != 0xC8 && Marker != 0xCC;
+                if (bFrameMarker && !bFoundFrame)
+                {
+                    bFoundFrame = true;
+                    bProgressive = Marker == 0xC2;
+                }
+                else if (Marker == 0xDA && bFoundFrame)
+                {
+                    ++NumScans;
+                    bInEntropyData = true;
+                }
+
+                ParseOffset += 2 + SegmentLength;
+            }
+        }
+
+    private:
+        // each preview decodes everything received so far
+        static constexpr int32 MaxPreviews = 8;
+
+        const int64 TotalSize;
+        TArray<uint8> EncodedData;
+
+        // next byte to look for markers at, can be past the received data while a segment is skipped
+        int64 ParseOffset = 0;
+        bool bInEntropyData = false;
+        bool bFoundFrame = false;
+
+        bool bProgressive = false;
+        int32 NumScans = 0;
+        int32 NumPreviewedScans = 0;
+        int64 NumPreviewedBytes = 0;
+        int32 NumPreviews = 0;
+    };
+}
+
+TUniquePtr<FRuntimeImageProgressiveDecoder> FRuntimeImageProgressiveDecoder::Create(ERuntimeImageFormat ImageFormat, int64 TotalSize)
+{
+    switch (ImageFormat)
+    {
+        case ERuntimeImageFormat::PNG:      return MakeUnique<FPNGProgressiveDecoder>();
+        case ERuntimeImageFormat::JPEG:     return MakeUnique<FJPEGProgressiveDecoder>(TotalSize);
+        default:                            break;
+    }
+
+    return nullptr;
+}
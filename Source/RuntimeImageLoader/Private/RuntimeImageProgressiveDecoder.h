@@ -0,0 +1,27 @@
+// Copyright 2022 Peter Leontev. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include "RuntimeImageData.h"
+
+
+/**
+ * Decodes image while it's being downloaded and produces previews of the part that has arrived so far.
+ * Not thread-safe, data has to be appended from one thread at a time.
+ */
+class FRuntimeImageProgressiveDecoder
+{
+public:
+    /** Returns nullptr for formats which can't be previewed */
+    static TUniquePtr<FRuntimeImageProgressiveDecoder> Create(ERuntimeImageFormat ImageFormat, int64 TotalSize);
+
+    virtual ~FRuntimeImageProgressiveDecoder() {}
+
+    /** Feeds bytes that arrived since last call. Returns true if preview got better */
+    virtual bool AppendData(const uint8* Data, int64 Num) = 0;
+
+    /** Fills image of the same size as the final one, parts that did not arrive yet are left blank */
+    virtual bool GetPreview(FRuntimeImageData& OutImageData) = 0;
+};
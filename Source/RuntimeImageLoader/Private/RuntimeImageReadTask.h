@@ -0,0 +1,70 @@
+// Copyright 2022 Peter Leontev. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/CriticalSection.h"
+#include "HAL/ThreadSafeBool.h"
+#include "Containers/Queue.h"
+
+#include "RuntimeImageReader.h"
+#include "RuntimeImageData.h"
+#include "RuntimeImageDiskCache.h"
+#include "ImageReaders/IImageReader.h"
+#include "RuntimeImageProgressiveDecoder.h"
+
+class UTexture2D;
+
+/**
+ * State of a single image request while it travels through the stages of image reader pipeline
+ */
+struct FRuntimeImageReadTask
+{
+    FImageReadRequest Request;
+    FImageReadResult Result;
+
+    // set by URuntimeImageReader::CancelRequest, remaining stages are skipped
+    FThreadSafeBool bCancelled = false;
+    // copy of FImageReadRequest::bExpedited that URuntimeImageReader::SetRequestExpedited changes while stages run
+    FThreadSafeBool bExpedited = false;
+
+    // Fetch -> Decode
+    FImageReadBuffer ImageBuffer;
+
+    // Decode -> Transform -> Upload
+    FRuntimeImageData ImageData;
+    // part of decode memory budget held till the request is completed
+    int64 ReservedDecodeMemory = 0;
+
+    // local files only
+    FDateTime SourceModificationTime;
+
+    // disk cache entry of the request, empty if disk cache is not used
+    FString DiskCacheKey;
+    FRuntimeImageDiskCacheHeader DiskCacheHeader;
+    // cached entry is valid, decode stage reads pixels from it and transform stage is skipped
+    bool bLoadFromDiskCache = false;
+    bool bStoreInDiskCache = false;
+    // server confirmed cached entry, decode stage stores it with the new expiration time
+    bool bRefreshDiskCacheHeader = false;
+    // pixels of cached entry did not match its description, request is fetched from the source instead
+    bool bDiskCacheEntryBroken = false;
+
+    // progressive requests only, decoder is fed with downloaded chunks by one preview task at a time
+    TUniquePtr<FRuntimeImageProgressiveDecoder> ProgressiveDecoder;
+    TQueue<TArray<uint8>, EQueueMode::Spsc> ProgressiveChunks;
+    int64 NumProgressiveBytes = 0;
+    bool bPreviewsDisabled = false;
+    FThreadSafeBool bDecodingPreview = false;
+    FThreadSafeBool bDownloadFinished = false;
+    // fetch stage waits for HttpReader. Download completion or URuntimeImageReader::Clear, whichever resets it, finishes the stage
+    FThreadSafeBool bDownloadPending = false;
+
+    // guards preview texture while previews and final image are uploaded to it
+    FCriticalSection PreviewLock;
+    // referenced by URuntimeImageReader::PreviewTextures
+    UTexture2D* PreviewTexture = nullptr;
+    bool bFinalImageUploaded = false;
+    // result was handed to the reader, previews uploaded afterwards are not referenced anymore
+    bool bCompleted = false;
+};
@@ -10,69 +10,138 @@
 #include "RHICommandList.h"
 #include "RHIDefinitions.h"
 #include "RenderUtils.h"
+#include "RenderingThread.h"
 #include "Engine/Texture.h"
 #include "Engine/Texture2D.h"
+#include "Engine/TextureRenderTarget2D.h"
 #include "PixelFormat.h"
 #include "TextureResource.h"
+#include "RHIStaticStates.h"
+#include "RenderGraphBuilder.h"
+#include "RenderGraphUtils.h"
+#include "GenerateMips.h"
 #include "Launch/Resources/Version.h"
 #include "Async/Async.h"
+#include "Async/Future.h"
 #include "Containers/ResourceArray.h"
+#include "Misc/ScopeLock.h"
+#include "Misc/ScopeExit.h"
+#include "HAL/FileManager.h"
 
 #include "ImageReaders/ImageReaderFactory.h"
 #include "ImageReaders/IImageReader.h"
 #include "RuntimeImageUtils.h"
 #include "RuntimeTextureResource.h"
+#include "RuntimeImageReaderWorker.h"
+#include "RuntimeImageReadTask.h"
+#include "RuntimeImageLoaderSettings.h"
+#include "RuntimeImageCache.h"
+#include "RuntimeImageDiskCache.h"
+#include "RuntimeTexturePool.h"
+#include "Helpers/MipHelpers.h"
+#include "Helpers/BlockCompressionHelpers.h"
+#include "Helpers/ScaledDecodeHelpers.h"
+#include "Helpers/ResizeHelpers.h"
+#include "Helpers/ConvertHelpers.h"
+#include "RuntimeImageLoaderStats.h"
 
 
 
 DEFINE_LOG_CATEGORY_STATIC(LogRuntimeImageReader, Log, All);
 
-void URuntimeImageReader::Initialize()
+FConstructTextureEvent::FConstructTextureEvent()
+    : Event(FPlatformProcess::GetSynchEventFromPool(false))
 {
-    ThreadSemaphore = FPlatformProcess::GetSynchEventFromPool(false);
-    TextureConstructedSemaphore = FPlatformProcess::GetSynchEventFromPool(false);
-    Thread = FRunnableThread::Create(this, TEXT("RuntimeImageReader"), 0, TPri_SlightlyBelowNormal);
-
-    UE_LOG(LogRuntimeImageReader, Log, TEXT("Image reader thread started!"))
 }
 
-void URuntimeImageReader::Deinitialize()
+FConstructTextureEvent::~FConstructTextureEvent()
 {
-    Clear();
-    Stop();
-
-    UE_LOG(LogRuntimeImageReader, Log, TEXT("Image reader thread exited!"))
+    FPlatformProcess::ReturnSynchEventToPool(Event);
 }
 
-bool URuntimeImageReader::Init()
+void URuntimeImageReader::Initialize(bool bUseCaches)
 {
-    return true;
-}
+    const URuntimeImageLoaderSettings* Settings = GetDefault<URuntimeImageLoaderSettings>();
+    NumWorkers = Settings->GetNumWorkers();
+    bUseTaskGraph = Settings->bUseTaskGraph;
 
-uint32 URuntimeImageReader::Run()
-{
-    while (!bStopThread)
+    StageQueues[(int32)EImageReadStage::Decode].SetMaxDepth(Settings->MaxDecodeQueueDepth);
+    StageQueues[(int32)EImageReadStage::Transform].SetMaxDepth(Settings->MaxTransformQueueDepth);
+    StageQueues[(int32)EImageReadStage::Upload].SetMaxDepth(Settings->MaxUploadQueueDepth);
+
+    HttpReader = FImageReaderFactory::CreateHttpReader(Settings->MaxConcurrentDownloads, Settings->MaxDownloadsPerHost);
+    ProgressiveChunkSize = Settings->ProgressiveChunkSizeKB * 1024;
+    UploadBudget = (int64)Settings->UploadBudgetKBPerFrame * 1024;
+    DecodeMemoryBudget = (int64)Settings->DecodeMemoryBudgetMB * 1024 * 1024;
+
+    if (bUseCaches && Settings->bEnableDiskCache)
+    {
+        DiskCache = MakeShared<FRuntimeImageDiskCache, ESPMode::ThreadSafe>(Settings->GetDiskCacheDirectory(), (int64)Settings->DiskCacheBudgetMB * 1024 * 1024);
+        bDiskCacheLocalFiles = Settings->bDiskCacheLocalFiles;
+
+        // scanning cache directory can take a while
+        TSharedPtr<FRuntimeImageDiskCache, ESPMode::ThreadSafe> DiskCacheToTrim = DiskCache;
+        AsyncTask(ENamedThreads::AnyBackgroundThreadNormalTask, [DiskCacheToTrim]() { DiskCacheToTrim->Trim(); });
+    }
+
+    if (bUseCaches && Settings->MaxPooledTextures > 0)
+    {
+        TexturePool = NewObject<URuntimeTexturePool>(this);
+        TexturePool->Initialize(Settings->MaxPooledTextures);
+    }
+
+    if (!bUseTaskGraph)
     {
-        ThreadSemaphore->Wait();
-        
-        BlockTillAllRequestsFinished();
+        for (int32 WorkerIndex = 0; WorkerIndex < NumWorkers; ++WorkerIndex)
+        {
+            Workers.Add(new FRuntimeImageReaderWorker(this, WorkerIndex));
+        }
     }
 
-    return 0;
+    UE_LOG(LogRuntimeImageReader, Log, TEXT("Image reader started! Workers: %d, use task graph: %d"), NumWorkers, bUseTaskGraph ? 1 : 0)
 }
 
-void URuntimeImageReader::Exit()
+void URuntimeImageReader::Deinitialize()
 {
-    // 
+    Clear();
+    Stop();
+
+    if (IsValid(TexturePool))
+    {
+        TexturePool->Empty();
+    }
+
+    UE_LOG(LogRuntimeImageReader, Log, TEXT("Image reader exited!"))
 }
 
 void URuntimeImageReader::Tick(float DeltaTime)
 {
-    FConstructTextureTask Task;
-    while (!bStopThread && ConstructTasks.Dequeue(Task))
+    ProcessConstructTasks();
+    ProcessCompletedRequests();
+
+    SET_DWORD_STAT(STAT_RuntimeImageLoader_FetchQueue, GetQueueDepth(EImageReadStage::Fetch));
+    SET_DWORD_STAT(STAT_RuntimeImageLoader_DecodeQueue, GetQueueDepth(EImageReadStage::Decode));
+    SET_DWORD_STAT(STAT_RuntimeImageLoader_TransformQueue, GetQueueDepth(EImageReadStage::Transform));
+    SET_DWORD_STAT(STAT_RuntimeImageLoader_UploadQueue, GetQueueDepth(EImageReadStage::Upload));
+    SET_DWORD_STAT(STAT_RuntimeImageLoader_RequestsInFlight, NumPendingRequests.GetValue());
+    SET_DWORD_STAT(STAT_RuntimeImageLoader_UploadsInFlight, NumActiveUploads.GetValue());
+#if STATS
+    {
+        FScopeLock DecodeMemoryScopeLock(&DecodeMemoryLock);
+        SET_DWORD_STAT(STAT_RuntimeImageLoader_WaitingForMemory, MemoryWaitingTasks.Num());
+    }
+#endif
+
+    if (NumActiveUploads.GetValue() > 0)
+    {
+        // continue uploads that ran out of budget of the previous frame
+        ScheduleUploadBatch();
+    }
+
+    if (bUseTaskGraph)
     {
-        ConstructedTextures.Add(FRuntimeImageUtils::CreateTexture(Task.ImageFilename, *Task.ImageData));
-        TextureConstructedSemaphore->Trigger();
+        // pick up requests that were queued while the last task was finishing
+        DispatchTaskGraphWorkers();
     }
 }
 
@@ -81,353 +150,2176 @@ TStatId URuntimeImageReader::GetStatId() const
     RETURN_QUICK_DECLARE_CYCLE_STAT(URuntimeImageReader, STATGROUP_Tickables);
 }
 
-void URuntimeImageReader::AddRequest(const FImageReadRequest& Request)
+int32 URuntimeImageReader::AddRequest(const FImageReadRequest& Request)
 {
-    Requests.Enqueue(Request);
+    FImageReadRequest QueuedRequest(Request);
+    QueuedRequest.RequestId = NextRequestId.Increment();
 
-    bCompletedWork.AtomicSet(false);
-}
-
-bool URuntimeImageReader::GetResult(FImageReadResult& OutResult)
-{
-    if (Results.Num() > 0)
     {
-        OutResult = Results.Pop();
+        FScopeLock ResultsScopeLock(&ResultsLock);
+        PendingResults.Add(QueuedRequest.RequestId);
 
-        return true;
+        if (QueuedRequest.bDecodeOnly)
+        {
+            UnorderedResults.Add(QueuedRequest.RequestId);
+        }
     }
 
-    return false;
-}
-
-void URuntimeImageReader::Clear()
-{
-    Requests.Empty();
-    Results.Empty();
+    FRuntimeImageReadTaskPtr Task = MakeShared<FRuntimeImageReadTask, ESPMode::ThreadSafe>();
+    Task->Request = QueuedRequest;
+    Task->Result.ImageFilename = QueuedRequest.ImageFilename;
+    Task->Result.RequestId = QueuedRequest.RequestId;
+    Task->bExpedited = QueuedRequest.bExpedited;
 
-    if (ImageReader.IsValid())
     {
-        ImageReader->Cancel();
+        FScopeLock ActiveTasksScopeLock(&ActiveTasksLock);
+        ActiveTasks.Add(QueuedRequest.RequestId, Task);
     }
 
-    bCompletedWork = true;
-}
+    if (QueuedRequest.TargetTexture != nullptr || QueuedRequest.TargetRenderTarget != nullptr)
+    {
+        FScopeLock TargetTexturesScopeLock(&TargetTexturesLock);
+        TargetTextures.Add(QueuedRequest.RequestId, QueuedRequest.TargetRenderTarget != nullptr ? (UTexture*)QueuedRequest.TargetRenderTarget : (UTexture*)QueuedRequest.TargetTexture);
+    }
 
-void URuntimeImageReader::Stop()
-{
-    bStopThread = true;
-    Trigger();
+    NumPendingRequests.Increment();
 
-    if (ImageReader.IsValid())
+    // cached pixels only need to be uploaded
+    const EImageReadStage FirstStage = QueuedRequest.DecodedImageData.IsValid() ? EImageReadStage::Upload : EImageReadStage::Fetch;
+    if (Task->bExpedited)
     {
-        ImageReader->Flush();
+        RunExpeditedStage(FirstStage, Task);
+    }
+    else
+    {
+        StageQueues[(int32)FirstStage].Enqueue(Task);
     }
 
-    Thread->WaitForCompletion();
-
-    FPlatformProcess::ReturnSynchEventToPool(ThreadSemaphore);
+    return QueuedRequest.RequestId;
 }
 
-bool URuntimeImageReader::IsWorkCompleted() const
+bool URuntimeImageReader::GetResult(FImageReadResult& OutResult)
 {
-    return bCompletedWork;
-}
+    check(IsInGameThread());
 
-void URuntimeImageReader::Trigger()
-{
-    ThreadSemaphore->Trigger();
-}
+    // results of requests completed since the last tick
+    ProcessCompletedRequests();
 
-void URuntimeImageReader::BlockTillAllRequestsFinished()
-{
-    while (!bCompletedWork && !bStopThread)
+    FScopeLock ResultsScopeLock(&ResultsLock);
+
+    for (int32 Index = 0; Index < PendingResults.Num(); ++Index)
     {
-        FImageReadRequest Request;
-        while (Requests.Dequeue(Request) && !bStopThread)
+        const int32 RequestId = PendingResults[Index];
+        const bool bUnordered = UnorderedResults.Contains(RequestId);
+
+        if (FImageReadResult* ReadResult = Results.Find(RequestId))
         {
-            FImageReadResult& ReadResult = Results.Emplace_GetRef();
-            ReadResult.ImageFilename = Request.ImageFilename;
+            OutResult = MoveTemp(*ReadResult);
 
-            ImageReader = FImageReaderFactory::CreateReader(Request.ImageFilename);
+            Results.Remove(RequestId);
+            PendingResults.RemoveAt(Index);
+            UnorderedResults.Remove(RequestId);
 
-            TArray<uint8> ImageBuffer;
-            if (!ImageReader->ReadImage(Request.ImageFilename, ImageBuffer))
-            {
-                ReadResult.OutError = FString::Printf(TEXT("Failed to read %s image. Error: %s"), *Request.ImageFilename, *ImageReader->GetLastError());
-                continue;
-            }
+            return true;
+        }
 
-            FRuntimeImageData ImageData;
-            if (!FRuntimeImageUtils::ImportBufferAsImage(ImageBuffer.GetData(), ImageBuffer.Num(), ImageData, ReadResult.OutError))
-            {
-                continue;
-            }
+        if (!bUnordered)
+        {
+            // requests after the first one that is not ready wait for it
+            break;
+        }
+    }
 
-            if (ReadResult.OutError.Len() > 0)
-            {
-                continue;
-            }
+    return false;
+}
 
-            // sanity checks
-            check(ImageData.RawData.Num() > 0);
-            check(ImageData.TextureSourceFormat != TSF_Invalid);
+void URuntimeImageReader::ReleaseTexture(UTexture2D* Texture)
+{
+    check(IsInGameThread());
 
-            ImageData.PixelFormat = DeterminePixelFormat(ImageData.Format, Request.TransformParams);
-            if (ImageData.PixelFormat == PF_Unknown)
-            {
-                ReadResult.OutError = FString::Printf(TEXT("Pixel format is not supported: %d"), (int32)ImageData.PixelFormat);
-                continue;
-            }
+    if (IsValid(TexturePool))
+    {
+        TexturePool->Add(Texture);
+    }
+}
 
-            ApplyTransformations(ImageData, Request.TransformParams);
+bool URuntimeImageReader::GetPreview(int32 RequestId, UTexture2D*& OutPreviewTexture)
+{
+    FScopeLock PreviewTexturesScopeLock(&PreviewTexturesLock);
 
-            if (IsInGameThread())
-            {
-                ConstructedTextures.Add(FRuntimeImageUtils::CreateTexture(Request.ImageFilename, ImageData));
-            }
-            else
-            {
-                FConstructTextureTask Task;
-                {
-                    Task.ImageFilename = Request.ImageFilename;
-                    Task.ImageData = &ImageData;
-                }
-                ConstructTasks.Enqueue(Task);
+    OutPreviewTexture = PreviewTextures.FindRef(RequestId);
+    return OutPreviewTexture != nullptr;
+}
 
-                while (!TextureConstructedSemaphore->Wait(100) && !bStopThread);
-            }
+bool URuntimeImageReader::GetResult(int32 RequestId, FImageReadResult& OutResult)
+{
+    check(IsInGameThread());
 
-            if (ConstructedTextures.Num() == 0)
-            {
-                ReadResult.OutError = TEXT("Texture was not constructed. Please contact developer support: https://t.me/+RmbtPdzK2ntiYzQy");
-                return;
-            }
+    ProcessCompletedRequests();
 
-            ReadResult.OutTexture = ConstructedTextures.Pop();
+    FScopeLock ResultsScopeLock(&ResultsLock);
 
-            CreateTexture(ReadResult.OutTexture, ImageData);
-        }
+    if (FImageReadResult* ReadResult = Results.Find(RequestId))
+    {
+        OutResult = MoveTemp(*ReadResult);
+
+        Results.Remove(RequestId);
+        PendingResults.Remove(RequestId);
+        UnorderedResults.Remove(RequestId);
 
-        bCompletedWork.AtomicSet(Requests.IsEmpty());
+        return true;
     }
+
+    return false;
 }
 
-EPixelFormat URuntimeImageReader::DeterminePixelFormat(ERawImageFormat::Type ImageFormat, const FTransformImageParams& Params) const
+void URuntimeImageReader::PrioritizeRequest(int32 RequestId)
 {
-    EPixelFormat PixelFormat;
-    
-    // determine pixel format
-    switch (ImageFormat)
+    FRuntimeImageReadTaskPtr Task;
     {
-        case ERawImageFormat::G8:            PixelFormat = (Params.bForUI) ? PF_B8G8R8A8 : PF_G8; break;
-        case ERawImageFormat::G16:           PixelFormat = PF_G16; break;
-        case ERawImageFormat::BGRA8:         PixelFormat = PF_B8G8R8A8; break;
-        case ERawImageFormat::BGRE8:         PixelFormat = PF_B8G8R8A8; break;
-        case ERawImageFormat::RGBA16:        PixelFormat = (Params.bForUI) ? PF_B8G8R8A8 : PF_R16G16B16A16_SINT; break;
-        case ERawImageFormat::RGBA16F:       PixelFormat = PF_FloatRGBA; break;
-        default:                             PixelFormat = PF_Unknown; break;
+        FScopeLock ActiveTasksScopeLock(&ActiveTasksLock);
+        Task = ActiveTasks.FindRef(RequestId);
     }
 
-    return PixelFormat;
+    if (Task.IsValid() && HttpReader.IsValid() && FImageReaderFactory::IsHttpURI(Task->Request.ImageFilename))
+    {
+        HttpReader->PrioritizeRead(RequestId);
+    }
 }
 
-struct FTextureDataResource : public FResourceBulkDataInterface
+void URuntimeImageReader::SetRequestExpedited(int32 RequestId, bool bExpedited)
 {
-public:
-    FTextureDataResource(void* InMipData, int32 InDataSize)
-        : MipData(InMipData), DataSize(InDataSize)
-    {}
-
-    const void* GetResourceBulkData() const override { return MipData; }
-    uint32 GetResourceBulkDataSize() const override { return DataSize; }
-    void Discard() override {}
-
-private:
-    void* MipData;
-    int32 DataSize;
-};
-
+    FRuntimeImageReadTaskPtr Task;
+    {
+        FScopeLock ActiveTasksScopeLock(&ActiveTasksLock);
+        Task = ActiveTasks.FindRef(RequestId);
+    }
 
-void URuntimeImageReader::CreateTexture(UTexture2D* NewTexture, const FRuntimeImageData& ImageData)
-{
-    FTexture2DRHIRef RHITexture2D = nullptr;
+    if (!Task.IsValid())
+    {
+        return;
+    }
 
-#if PLATFORM_WINDOWS
-    RHITexture2D = CreateTexture_Windows(NewTexture, ImageData);
-#elif (PLATFORM_ANDROID || PLATFORM_ANDROID_VULKAN)
-    RHITexture2D = CreateTexture_Mobile(NewTexture, ImageData);
-#else
-    RHITexture2D = CreateTexture_Other(NewTexture, ImageData);
-#endif
+    // stage that is queued or running already is not moved, the change applies from the next one
+    Task->bExpedited = bExpedited;
 
-    FinalizeTexture(NewTexture, RHITexture2D);
+    if (bExpedited)
+    {
+        PrioritizeRequest(RequestId);
+    }
 }
 
-FTexture2DRHIRef URuntimeImageReader::CreateTexture_Windows(UTexture2D* NewTexture, const FRuntimeImageData& ImageData)
+void URuntimeImageReader::CancelRequest(int32 RequestId)
 {
-    uint32 NumMips = 1;
-    uint32 NumSamples = 1;
-    void* Mip0Data = (void*)ImageData.RawData.GetData();
+    {
+        FScopeLock ResultsScopeLock(&ResultsLock);
 
-    ETextureCreateFlags TextureFlags = TexCreate_ShaderResource;
-    if (ImageData.SRGB)
+        // request that is still in flight drops its result
+        PendingResults.Remove(RequestId);
+        UnorderedResults.Remove(RequestId);
+        Results.Remove(RequestId);
+    }
+
+    FRuntimeImageReadTaskPtr Task;
     {
-        TextureFlags |= TexCreate_SRGB;
+        FScopeLock ActiveTasksScopeLock(&ActiveTasksLock);
+        Task = ActiveTasks.FindRef(RequestId);
     }
 
-    FTexture2DRHIRef RHITexture2D = nullptr;
+    if (!Task.IsValid())
+    {
+        return;
+    }
 
-    ensureMsgf(ImageData.SizeX > 0, TEXT("ImageData.SizeX must be > 0"));
-    ensureMsgf(ImageData.SizeY > 0, TEXT("ImageData.SizeY must be > 0"));
+    // stages that did not start yet are skipped
+    Task->bCancelled = true;
 
-    if (GRHISupportsAsyncTextureCreation)
+    if (HttpReader.IsValid() && FImageReaderFactory::IsHttpURI(Task->Request.ImageFilename))
     {
-        RHITexture2D = RHIAsyncCreateTexture2D(
-            ImageData.SizeX, ImageData.SizeY,
-            ImageData.PixelFormat,
-            ImageData.NumMips,
-            TextureFlags,
-            &Mip0Data,
-            1
-        );
+        HttpReader->CancelRead(RequestId);
     }
-    else
+}
+
+void URuntimeImageReader::Clear()
+{
+    check(IsInGameThread());
+
+    TArray<FRuntimeImageReadTaskPtr> DownloadingTasks;
     {
-        FTextureDataResource TextureData(Mip0Data, ImageData.RawData.Num());
+        FScopeLock ActiveTasksScopeLock(&ActiveTasksLock);
 
-        FRHIResourceCreateInfo CreateInfo(TEXT("RuntimeImageReaderTextureData"));
-        CreateInfo.BulkData = &TextureData;
+        // tasks that are in the middle of a stage stop after it
+        for (const TPair<int32, FRuntimeImageReadTaskPtr>& ActiveTask : ActiveTasks)
+        {
+            ActiveTask.Value->bCancelled = true;
 
-        FGraphEventRef CreateTextureTask = FFunctionGraphTask::CreateAndDispatchWhenReady(
-            [&RHITexture2D, &CreateInfo, &ImageData, &TextureFlags]()
+            // completion of a cancelled download may never come, e.g. once HttpReader is destroyed
+            if (ActiveTask.Value->bDownloadPending.AtomicSet(false))
             {
-                RHITexture2D = RHICreateTexture2D(
-                    ImageData.SizeX, ImageData.SizeY,
-                    ImageData.PixelFormat,
-                    ImageData.NumMips,
-                    1,
-                    TextureFlags,
-                    CreateInfo
-                );
-            }, TStatId(), nullptr, ENamedThreads::ActualRenderingThread
-        );
-        CreateTextureTask->Wait();
+                DownloadingTasks.Add(ActiveTask.Value);
+            }
+        }
+        ActiveTasks.Empty();
     }
 
-    return RHITexture2D;
-}
+    TArray<FRuntimeImageReadTaskPtr> TasksToDrop;
+    {
+        FScopeLock DecodeMemoryScopeLock(&DecodeMemoryLock);
 
+        // waiting tasks hold no memory, they are dropped the same way as queued ones
+        TasksToDrop = MoveTemp(MemoryWaitingTasks);
+    }
 
-FTexture2DRHIRef URuntimeImageReader::CreateTexture_Mobile(UTexture2D* NewTexture, const FRuntimeImageData& ImageData)
-{
-    uint32 NumMips = 1;
-    uint32 NumSamples = 1;
-    void* Mip0Data = (void*)ImageData.RawData.GetData();
+    for (TRuntimeImageStageQueue<FRuntimeImageReadTaskPtr>& StageQueue : StageQueues)
+    {
+        FRuntimeImageReadTaskPtr Task;
+        while (StageQueue.Dequeue(Task))
+        {
+            TasksToDrop.Add(Task);
+        }
+    }
 
-    ETextureCreateFlags TextureFlags = TexCreate_ShaderResource;
-    if (ImageData.SRGB)
     {
-        TextureFlags |= TexCreate_SRGB;
+        FScopeLock DownloadedTasksScopeLock(&DownloadedTasksLock);
+
+        TasksToDrop.Append(DownloadedTasks);
+        NumDownloadedTasks.Subtract(DownloadedTasks.Num());
+        DownloadedTasks.Empty();
     }
 
-    FTexture2DRHIRef RHITexture2D = nullptr;
+    for (const FRuntimeImageReadTaskPtr& Task : TasksToDrop)
+    {
+        DropTask(*Task);
+    }
 
-    ensureMsgf(ImageData.SizeX > 0, TEXT("ImageData.SizeX must be > 0"));
-    ensureMsgf(ImageData.SizeY > 0, TEXT("ImageData.SizeY must be > 0"));
+    {
+        FScopeLock ResultsScopeLock(&ResultsLock);
 
-    FGraphEventRef CreateTextureTask = FFunctionGraphTask::CreateAndDispatchWhenReady(
-        [&RHITexture2D, &ImageData, &TextureFlags]()
-        {
-            FRHIResourceCreateInfo DummyCreateInfo(TEXT("DummyCreateInfo"));
-            RHITexture2D = RHICreateTexture2D(
-                ImageData.SizeX, ImageData.SizeY,
-                ImageData.PixelFormat,
-                ImageData.NumMips,
-                1,
-                TextureFlags,
-                DummyCreateInfo
-            );
+        // requests that are still in flight will drop their results
+        PendingResults.Empty();
+        UnorderedResults.Empty();
+        Results.Empty();
+    }
 
-            FUpdateTextureRegion2D TextureRegion2D;
-            {
-                TextureRegion2D.DestX = 0;
-                TextureRegion2D.DestY = 0;
-                TextureRegion2D.SrcX = 0;
-                TextureRegion2D.SrcY = 0;
-                TextureRegion2D.Width = ImageData.SizeX;
-                TextureRegion2D.Height = ImageData.SizeY;
-            }
+    {
+        FScopeLock ReadersScopeLock(&ActiveImageReadersLock);
 
-            RHIUpdateTexture2D(
-                RHITexture2D, 0, TextureRegion2D,
-                TextureRegion2D.Width * GPixelFormats[ImageData.PixelFormat].BlockBytes,
-                ImageData.RawData.GetData()
-            );
-        }, TStatId(), nullptr, ENamedThreads::ActualRenderingThread
-    );
-    CreateTextureTask->Wait();
+        for (const TSharedPtr<IImageReader, ESPMode::ThreadSafe>& ImageReader : ActiveImageReaders)
+        {
+            ImageReader->Cancel();
+        }
+    }
 
-    return RHITexture2D;
-}
+    if (HttpReader.IsValid())
+    {
+        HttpReader->Cancel();
+    }
 
-FTexture2DRHIRef URuntimeImageReader::CreateTexture_Other(UTexture2D* NewTexture, const FRuntimeImageData& ImageData)
-{
-    // TODO: Figure out the best way to support other graphics APIs and platfornms
-    return CreateTexture_Windows(NewTexture, ImageData);
+    // results are dropped, completion only releases the textures kept for them
+    for (const FRuntimeImageReadTaskPtr& Task : DownloadingTasks)
+    {
+        Task->Result.OutError = TEXT("Request was cancelled");
+        FinishStage(EImageReadStage::Fetch, Task, EImageReadStageResult::Failed);
+    }
+    ProcessCompletedRequests();
 }
 
-void URuntimeImageReader::FinalizeTexture(UTexture2D* NewTexture, FTexture2DRHIRef RHITexture2D)
+void URuntimeImageReader::Stop()
 {
-    // Create proper texture resource so UMG can display runtime texture
-    FRuntimeTextureResource* NewTextureResource = new FRuntimeTextureResource(NewTexture, RHITexture2D);
-    NewTexture->SetResource(NewTextureResource);
+    bStopThread = true;
 
-    FGraphEventRef UpdateResourceTask = FFunctionGraphTask::CreateAndDispatchWhenReady(
-        [&NewTextureResource, &NewTexture, &RHITexture2D]()
-        {
-            NewTextureResource->InitResource();
-            RHIUpdateTextureReference(NewTexture->TextureReference.TextureReferenceRHI, RHITexture2D);
-            NewTextureResource->SetTextureReference(NewTexture->TextureReference.TextureReferenceRHI);
+    {
+        FScopeLock ReadersScopeLock(&ActiveImageReadersLock);
 
-        }, TStatId(), nullptr, ENamedThreads::ActualRenderingThread
-    );
-    UpdateResourceTask->Wait();
-}
+        for (const TSharedPtr<IImageReader, ESPMode::ThreadSafe>& ImageReader : ActiveImageReaders)
+        {
+            ImageReader->Flush();
+        }
+    }
 
-void URuntimeImageReader::ApplyTransformations(FRuntimeImageData& ImageData, FTransformImageParams TransformParams)
-{
-    if (!TransformParams.IsPercentSizeValid())
+    if (HttpReader.IsValid())
     {
-        UE_LOG(LogRuntimeImageReader, Verbose, TEXT("Supplied transform params are not valid! PercentSizeX, PercentSizeX: (%d, %d)"), TransformParams.PercentSizeX, TransformParams.PercentSizeY);
+        // finishes pending downloads with an error
+        HttpReader->Cancel();
     }
-    
-    if (TransformParams.IsPercentSizeValid())
-    {
-        const int32 TransformedSizeX = FMath::Floor(ImageData.SizeX * TransformParams.PercentSizeX * 0.01f);
-        const int32 TransformedSizeY = FMath::Floor(ImageData.SizeY * TransformParams.PercentSizeY * 0.01f);
-        
-        FImage TransformedImage;
-        TransformedImage.Init(TransformedSizeX, TransformedSizeY, ImageData.Format);
 
-        ImageData.ResizeTo(TransformedImage, TransformedImage.SizeX, TransformedImage.SizeY, ImageData.Format, ImageData.GammaSpace);
+    // workers waiting for game thread are released before they are joined
+    CancelConstructTasks();
 
-        ImageData.RawData = MoveTemp(TransformedImage.RawData);
-        ImageData.SizeX = TransformedImage.SizeX;
-        ImageData.SizeY = TransformedImage.SizeY;
+    for (FRuntimeImageReaderWorker* Worker : Workers)
+    {
+        delete Worker;
     }
+    Workers.Empty();
 
-    if (TransformParams.bForUI)
+    // uploads of pending requests are finished without the budget
+    NumUploadFlushes.Increment();
+    ScheduleUploadBatch();
+    FlushRenderingCommands();
+
+    // task graph and expedited tasks still running can queue construct tasks and uploads, game thread serves them till they are done
+    while (NumActiveTasks.GetValue() > 0 || NumExpeditedTasks.GetValue() > 0 || NumActivePreviewTasks.GetValue() > 0 || NumActiveUploads.GetValue() > 0)
     {
-        // no need to convert float RGBA
-        if (ImageData.TextureSourceFormat != TSF_RGBA16F)
-        {
-            FImage BGRAImage;
-            BGRAImage.Init(ImageData.SizeX, ImageData.SizeY, ERawImageFormat::BGRA8);
-            ImageData.CopyTo(BGRAImage, ERawImageFormat::BGRA8, EGammaSpace::sRGB);
+        CancelConstructTasks();
 
-            ImageData.RawData = MoveTemp(BGRAImage.RawData);
-            ImageData.SRGB = true;
-            ImageData.GammaSpace = EGammaSpace::sRGB;
+        if (NumActiveUploads.GetValue() > 0)
+        {
+            ScheduleUploadBatch();
+            FlushRenderingCommands();
         }
+
+        FPlatformProcess::Sleep(0.f);
+    }
+
+    HttpReader.Reset();
+    DiskCache.Reset();
+}
+
+bool URuntimeImageReader::IsWorkCompleted() const
+{
+    return NumPendingRequests.GetValue() == 0;
+}
+
+void URuntimeImageReader::Trigger()
+{
+    if (bUseTaskGraph)
+    {
+        DispatchTaskGraphWorkers();
+        return;
+    }
+
+    for (FRuntimeImageReaderWorker* Worker : Workers)
+    {
+        Worker->Trigger();
+    }
+}
+
+void URuntimeImageReader::DispatchTaskGraphWorkers()
+{
+    while (!bStopThread && HasRunnableStage())
+    {
+        // do not run more tasks than the pool size allows
+        if (NumActiveTasks.Increment() > NumWorkers)
+        {
+            NumActiveTasks.Decrement();
+            return;
+        }
+
+        FFunctionGraphTask::CreateAndDispatchWhenReady(
+            [this]()
+            {
+                ProcessRequests();
+                NumActiveTasks.Decrement();
+            }, TStatId(), nullptr, ENamedThreads::AnyBackgroundThreadNormalTask
+        );
+    }
+}
+
+bool URuntimeImageReader::WaitForResult(int32 RequestId, float TimeoutSeconds, FImageReadResult& OutResult)
+{
+    check(IsInGameThread());
+    SCOPE_RUNTIME_IMAGE_CYCLE_COUNTER(STAT_RuntimeImageLoader_WaitForResult);
+
+    // frames do not advance while game thread waits
+    NumUploadFlushes.Increment();
+    ON_SCOPE_EXIT
+    {
+        NumUploadFlushes.Decrement();
+    };
+
+    const double EndTime = FPlatformTime::Seconds() + TimeoutSeconds;
+
+    while (!bStopThread)
+    {
+        if (GetResult(RequestId, OutResult))
+        {
+            return true;
+        }
+
+        {
+            FScopeLock ResultsScopeLock(&ResultsLock);
+            if (!PendingResults.Contains(RequestId))
+            {
+                // cleared or handed out already
+                OutResult = FImageReadResult();
+                OutResult.RequestId = RequestId;
+                OutResult.OutError = TEXT("Request was cancelled");
+                return true;
+            }
+        }
+
+        if (TimeoutSeconds > 0.f && FPlatformTime::Seconds() >= EndTime)
+        {
+            return false;
+        }
+
+        // only what the request needs from game thread is done here: texture construction, download completion and uploads
+        ProcessConstructTasks();
+
+        if (HttpReader.IsValid())
+        {
+            HttpReader->Tick();
+        }
+
+        if (NumActiveUploads.GetValue() > 0)
+        {
+            ScheduleUploadBatch();
+        }
+
+        FPlatformProcess::Sleep(0.f);
+    }
+
+    return false;
+}
+
+int32 URuntimeImageReader::GetQueueDepth(EImageReadStage Stage) const
+{
+    check(Stage < EImageReadStage::Num);
+    return StageQueues[(int32)Stage].Num();
+}
+
+void URuntimeImageReader::ProcessRequests()
+{
+    while (!bStopThread && RunNextStage())
+    {
+        // running a stage might have freed a slot for a stage other workers are waiting for
+        if (HasRunnableStage())
+        {
+            Trigger();
+        }
+    }
+}
+
+bool URuntimeImageReader::RunNextStage()
+{
+    // decode stage might have made room for downloads that finished meanwhile
+    EnqueueDownloadedTasks();
+
+    // downstream stages go first so in-flight images leave the pipeline before new ones enter it
+    for (int32 StageIndex = (int32)EImageReadStage::Num - 1; StageIndex >= 0; --StageIndex)
+    {
+        const bool bIsLastStage = (StageIndex == (int32)EImageReadStage::Num - 1);
+        if (!bIsLastStage && StageQueues[StageIndex + 1].IsFull())
+        {
+            continue;
+        }
+
+        FRuntimeImageReadTaskPtr Task;
+        if (!StageQueues[StageIndex].Dequeue(Task))
+        {
+            continue;
+        }
+
+        ExecuteStage((EImageReadStage)StageIndex, Task);
+        return true;
+    }
+
+    return false;
+}
+
+bool URuntimeImageReader::HasRunnableStage() const
+{
+    if (NumDownloadedTasks.GetValue() > 0 && !StageQueues[(int32)EImageReadStage::Decode].IsFull())
+    {
+        return true;
+    }
+
+    for (int32 StageIndex = 0; StageIndex < (int32)EImageReadStage::Num; ++StageIndex)
+    {
+        const bool bIsLastStage = (StageIndex == (int32)EImageReadStage::Num - 1);
+        if (!StageQueues[StageIndex].IsEmpty() && (bIsLastStage || !StageQueues[StageIndex + 1].IsFull()))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void URuntimeImageReader::ExecuteStage(EImageReadStage Stage, const FRuntimeImageReadTaskPtr& Task)
+{
+    if (Task->bCancelled)
+    {
+        Task->Result.OutError = TEXT("Request was cancelled");
+        FinishStage(Stage, Task, EImageReadStageResult::Failed);
+    }
+    else
+    {
+        FinishStage(Stage, Task, RunStage(Stage, Task));
+    }
+}
+
+EImageReadStageResult URuntimeImageReader::RunStage(EImageReadStage Stage, const FRuntimeImageReadTaskPtr& Task)
+{
+    bool bSucceeded = false;
+
+    switch (Stage)
+    {
+        case EImageReadStage::Fetch:        return FetchStage(Task);
+        case EImageReadStage::Decode:
+        {
+            if (!ReserveDecodeMemory(Task))
+            {
+                return EImageReadStageResult::Pending;
+            }
+            bSucceeded = DecodeStage(*Task);
+
+            if (!bSucceeded && Task->bDiskCacheEntryBroken)
+            {
+                // broken entry is a cache miss, image is fetched from its source again
+                Task->bLoadFromDiskCache = false;
+                Task->bRefreshDiskCacheHeader = false;
+
+                if (Task->bExpedited)
+                {
+                    RunExpeditedStage(EImageReadStage::Fetch, Task);
+                }
+                else
+                {
+                    StageQueues[(int32)EImageReadStage::Fetch].Enqueue(Task);
+                }
+                return EImageReadStageResult::Pending;
+            }
+            break;
+        }
+        case EImageReadStage::Transform:    bSucceeded = TransformStage(*Task); break;
+        case EImageReadStage::Upload:       return UploadStage(Task);
+        default:                            checkNoEntry(); break;
+    }
+
+    return bSucceeded ? EImageReadStageResult::Succeeded : EImageReadStageResult::Failed;
+}
+
+bool URuntimeImageReader::ReserveDecodeMemory(const FRuntimeImageReadTaskPtr& Task)
+{
+    if (DecodeMemoryBudget <= 0 || Task->bLoadFromDiskCache)
+    {
+        return true;
+    }
+
+    const int64 EstimatedSize = FRuntimeImageUtils::EstimateDecodedSize(Task->ImageBuffer.GetData(), (int32)Task->ImageBuffer.Num(), Task->Request.FormatHint);
+
+    FScopeLock DecodeMemoryScopeLock(&DecodeMemoryLock);
+
+    // image larger than the whole budget still goes once nothing else holds memory, expedited requests do not wait
+    if (ReservedDecodeMemory > 0 && ReservedDecodeMemory + EstimatedSize > DecodeMemoryBudget && !Task->bExpedited)
+    {
+        MemoryWaitingTasks.Add(Task);
+        return false;
+    }
+
+    ReservedDecodeMemory += EstimatedSize;
+    Task->ReservedDecodeMemory = EstimatedSize;
+
+    SET_MEMORY_STAT(STAT_RuntimeImageLoader_DecodeMemoryReserved, ReservedDecodeMemory);
+
+    return true;
+}
+
+void URuntimeImageReader::ReleaseDecodeMemory(FRuntimeImageReadTask& Task)
+{
+    if (Task.ReservedDecodeMemory == 0)
+    {
+        return;
+    }
+
+    TArray<FRuntimeImageReadTaskPtr> TasksToRetry;
+    {
+        FScopeLock DecodeMemoryScopeLock(&DecodeMemoryLock);
+
+        ReservedDecodeMemory -= Task.ReservedDecodeMemory;
+        Task.ReservedDecodeMemory = 0;
+
+        SET_MEMORY_STAT(STAT_RuntimeImageLoader_DecodeMemoryReserved, ReservedDecodeMemory);
+
+        TasksToRetry = MoveTemp(MemoryWaitingTasks);
+    }
+
+    for (const FRuntimeImageReadTaskPtr& TaskToRetry : TasksToRetry)
+    {
+        StageQueues[(int32)EImageReadStage::Decode].Enqueue(TaskToRetry);
+    }
+
+    if (TasksToRetry.Num() > 0)
+    {
+        Trigger();
+    }
+}
+
+void URuntimeImageReader::RunExpeditedStage(EImageReadStage Stage, const FRuntimeImageReadTaskPtr& Task)
+{
+    NumExpeditedTasks.Increment();
+
+    FFunctionGraphTask::CreateAndDispatchWhenReady(
+        [this, Stage, Task]()
+        {
+            ExecuteStage(Stage, Task);
+            NumExpeditedTasks.Decrement();
+        }, TStatId(), nullptr, ENamedThreads::AnyHiPriThreadHiPriTask
+    );
+}
+
+void URuntimeImageReader::FinishStage(EImageReadStage Stage, const FRuntimeImageReadTaskPtr& Task, EImageReadStageResult StageResult)
+{
+    if (StageResult == EImageReadStageResult::Pending)
+    {
+        return;
+    }
+
+    int32 NextStageIndex = (int32)Stage + 1;
+    if (Task->bLoadFromDiskCache && Stage == EImageReadStage::Decode)
+    {
+        // cached pixels are transformed already
+        NextStageIndex = (int32)EImageReadStage::Upload;
+    }
+
+    if (Task->Request.bDecodeOnly && NextStageIndex == (int32)EImageReadStage::Upload && StageResult == EImageReadStageResult::Succeeded)
+    {
+        // pixels go to the result instead of a texture
+        Task->Result.ImageData = MakeShared<FRuntimeImageData, ESPMode::ThreadSafe>(MoveTemp(Task->ImageData));
+        NextStageIndex = (int32)EImageReadStage::Num;
+    }
+
+    if (StageResult == EImageReadStageResult::Succeeded && NextStageIndex < (int32)EImageReadStage::Num)
+    {
+        if (Task->bExpedited)
+        {
+            RunExpeditedStage((EImageReadStage)NextStageIndex, Task);
+        }
+        else
+        {
+            StageQueues[NextStageIndex].Enqueue(Task);
+        }
+    }
+    else
+    {
+        {
+            FScopeLock PreviewScopeLock(&Task->PreviewLock);
+            Task->bCompleted = true;
+        }
+
+        // pixels are on GPU or handed to the result by now
+        ReleaseDecodeMemory(*Task);
+
+        // stages finish on workers and render thread, while maps keeping textures from GC are changed on game thread only
+        CompletedResults.Enqueue(Task->Result);
+    }
+}
+
+EImageReadStageResult URuntimeImageReader::FetchStage(const FRuntimeImageReadTaskPtr& Task)
+{
+    SCOPE_RUNTIME_IMAGE_CYCLE_COUNTER(STAT_RuntimeImageLoader_Fetch);
+
+    const FImageReadRequest& Request = Task->Request;
+    const bool bIsHttpURI = FImageReaderFactory::IsHttpURI(Request.ImageFilename);
+
+    // modification time only validates disk cache entries of local files, other reads skip the stat
+    if (!bIsHttpURI && DiskCache.IsValid() && bDiskCacheLocalFiles)
+    {
+        Task->SourceModificationTime = IFileManager::Get().GetTimeStamp(*Request.ImageFilename);
+    }
+
+    FImageCacheValidators Validators;
+    if (ValidateDiskCacheEntry(*Task, Validators))
+    {
+        INC_DWORD_STAT(STAT_RuntimeImageLoader_DiskCacheHits);
+
+        // pixels are read from disk cache by decode stage
+        Task->bLoadFromDiskCache = true;
+        Task->bStoreInDiskCache = false;
+        return EImageReadStageResult::Succeeded;
+    }
+
+    if (bIsHttpURI && HttpReader->SupportsAsyncRead() && !IsInGameThread())
+    {
+        TWeakObjectPtr<URuntimeImageReader> WeakThis(this);
+
+        // downloaded images go straight to decode queue as they arrive
+        FOnImageReadCompleted OnCompleted =
+            [WeakThis, Task](FImageReadResponse&& Response)
+            {
+                URuntimeImageReader* ImageReader = WeakThis.Get();
+                if (ImageReader == nullptr || !Task->bDownloadPending.AtomicSet(false))
+                {
+                    // reader is gone or Clear finished the task already
+                    return;
+                }
+
+                const bool bSucceeded = ImageReader->HandleReadResponse(*Task, MoveTemp(Response));
+
+                ImageReader->FinishDownload(Task, bSucceeded);
+                ImageReader->Trigger();
+            };
+
+        Task->bDownloadPending = true;
+
+        if (Request.bProgressive && ProgressiveChunkSize > 0)
+        {
+            HttpReader->ReadImageProgressive(Request.ImageFilename, Validators, Request.RequestId, ProgressiveChunkSize,
+                [WeakThis, Task](const TArray<uint8>& ReceivedData, int64 TotalSize)
+                {
+                    if (URuntimeImageReader* ImageReader = WeakThis.Get())
+                    {
+                        ImageReader->HandleDownloadProgress(Task, ReceivedData, TotalSize);
+                    }
+                },
+                MoveTemp(OnCompleted)
+            );
+        }
+        else
+        {
+            HttpReader->ReadImageAsync(Request.ImageFilename, Validators, Request.RequestId, MoveTemp(OnCompleted));
+        }
+
+        if (Task->bExpedited)
+        {
+            HttpReader->PrioritizeRead(Request.RequestId);
+        }
+
+        return EImageReadStageResult::Pending;
+    }
+
+    if (bIsHttpURI && HttpReader->SupportsAsyncRead())
+    {
+        // game thread can't leave the request pending, it waits for the same conditional read instead
+        TSharedRef<TPromise<FImageReadResponse>, ESPMode::ThreadSafe> ResponsePromise = MakeShared<TPromise<FImageReadResponse>, ESPMode::ThreadSafe>();
+        TFuture<FImageReadResponse> ResponseFuture = ResponsePromise->GetFuture();
+
+        HttpReader->ReadImageAsync(Request.ImageFilename, Validators, Request.RequestId,
+            [ResponsePromise](FImageReadResponse&& Response)
+            {
+                ResponsePromise->SetValue(MoveTemp(Response));
+            }
+        );
+
+        if (IsInGameThread())
+        {
+            // completion is dispatched on game thread so it has to be pumped here, without waiting for other downloads
+            while (!ResponseFuture.IsReady())
+            {
+                HttpReader->Tick();
+                FPlatformProcess::Sleep(0.f);
+            }
+        }
+
+        FImageReadResponse Response = ResponseFuture.Get();
+        return HandleReadResponse(*Task, MoveTemp(Response)) ? EImageReadStageResult::Succeeded : EImageReadStageResult::Failed;
+    }
+
+    TSharedPtr<IImageReader, ESPMode::ThreadSafe> ImageReader = FImageReaderFactory::CreateReader(Request.ImageFilename);
+    {
+        FScopeLock ReadersScopeLock(&ActiveImageReadersLock);
+        ActiveImageReaders.Add(ImageReader);
+    }
+
+    ON_SCOPE_EXIT
+    {
+        FScopeLock ReadersScopeLock(&ActiveImageReadersLock);
+        ActiveImageReaders.Remove(ImageReader);
+    };
+
+    FString ReadError;
+    if (!ImageReader->ReadImageBuffer(Request.ImageFilename, Task->ImageBuffer, ReadError))
+    {
+        Task->Result.OutError = FString::Printf(TEXT("Failed to read %s image. Error: %s"), *Request.ImageFilename, *ReadError);
+        return EImageReadStageResult::Failed;
+    }
+
+    return EImageReadStageResult::Succeeded;
+}
+
+void URuntimeImageReader::FinishDownload(const FRuntimeImageReadTaskPtr& Task, bool bSucceeded)
+{
+    // downloads finish regardless of decode queue, so they wait aside till it has room
+    if (bSucceeded && !Task->bExpedited && StageQueues[(int32)EImageReadStage::Decode].IsFull())
+    {
+        FScopeLock DownloadedTasksScopeLock(&DownloadedTasksLock);
+
+        DownloadedTasks.Add(Task);
+        NumDownloadedTasks.Increment();
+        return;
+    }
+
+    FinishStage(EImageReadStage::Fetch, Task, bSucceeded ? EImageReadStageResult::Succeeded : EImageReadStageResult::Failed);
+}
+
+void URuntimeImageReader::EnqueueDownloadedTasks()
+{
+    if (NumDownloadedTasks.GetValue() == 0)
+    {
+        return;
+    }
+
+    FScopeLock DownloadedTasksScopeLock(&DownloadedTasksLock);
+
+    while (DownloadedTasks.Num() > 0 && !StageQueues[(int32)EImageReadStage::Decode].IsFull())
+    {
+        StageQueues[(int32)EImageReadStage::Decode].Enqueue(DownloadedTasks[0]);
+        DownloadedTasks.RemoveAt(0);
+        NumDownloadedTasks.Decrement();
+    }
+}
+
+bool URuntimeImageReader::HandleReadResponse(FRuntimeImageReadTask& Task, FImageReadResponse&& Response)
+{
+    // full image is decoded by decode stage from now on
+    Task.bDownloadFinished = true;
+
+    if (Response.bNotModified)
+    {
+        INC_DWORD_STAT(STAT_RuntimeImageLoader_DiskCacheHits);
+
+        Task.bLoadFromDiskCache = true;
+        Task.bStoreInDiskCache = false;
+
+        // cached copy is valid for another max-age, server may have sent new validators with it
+        if (Response.Validators.IsSet())
+        {
+            Task.DiskCacheHeader.Validators = Response.Validators;
+        }
+        Task.DiskCacheHeader.ExpirationTime = FDateTime::UtcNow() + FTimespan::FromSeconds(Response.MaxAge);
+        Task.bRefreshDiskCacheHeader = !Response.bNoStore;
+    }
+    else if (Response.bSucceeded)
+    {
+        Task.ImageBuffer.SetData(MoveTemp(Response.ImageData));
+
+        Task.DiskCacheHeader.Validators = Response.Validators;
+        Task.DiskCacheHeader.ExpirationTime = FDateTime::UtcNow() + FTimespan::FromSeconds(Response.MaxAge);
+        Task.bStoreInDiskCache &= !Response.bNoStore;
+    }
+    else
+    {
+        Task.Result.OutError = FString::Printf(TEXT("Failed to read %s image. Error: %s"), *Task.Request.ImageFilename, *Response.Error);
+    }
+
+    return Response.bSucceeded;
+}
+
+bool URuntimeImageReader::ValidateDiskCacheEntry(FRuntimeImageReadTask& Task, FImageCacheValidators& OutValidators) const
+{
+    const FImageReadRequest& Request = Task.Request;
+    const bool bIsHttpURI = FImageReaderFactory::IsHttpURI(Request.ImageFilename);
+
+    if (!DiskCache.IsValid() || (!bIsHttpURI && !bDiskCacheLocalFiles))
+    {
+        return false;
+    }
+
+    Task.DiskCacheKey = URuntimeImageCache::MakeCacheKey(Request.ImageFilename, Request.TransformParams);
+    Task.bStoreInDiskCache = true;
+    Task.DiskCacheHeader.ImageURI = Request.ImageFilename;
+    Task.DiskCacheHeader.SourceModificationTime = Task.SourceModificationTime;
+
+    if (Task.bDiskCacheEntryBroken)
+    {
+        // entry could not be removed, it's not read again
+        return false;
+    }
+
+    FRuntimeImageDiskCacheHeader CachedHeader;
+    if (!DiskCache->LoadHeader(Task.DiskCacheKey, CachedHeader))
+    {
+        INC_DWORD_STAT(STAT_RuntimeImageLoader_DiskCacheMisses);
+        return false;
+    }
+
+    if (!bIsHttpURI)
+    {
+        return Task.SourceModificationTime != FDateTime::MinValue() && CachedHeader.SourceModificationTime == Task.SourceModificationTime;
+    }
+
+    if (FDateTime::UtcNow() < CachedHeader.ExpirationTime)
+    {
+        return true;
+    }
+
+    // ask server whether cached copy is still valid
+    OutValidators = CachedHeader.Validators;
+    Task.DiskCacheHeader = CachedHeader;
+
+    return false;
+}
+
+bool URuntimeImageReader::DecodeStage(FRuntimeImageReadTask& Task)
+{
+    SCOPE_RUNTIME_IMAGE_CYCLE_COUNTER(STAT_RuntimeImageLoader_Decode);
+
+    FRuntimeImageData& ImageData = Task.ImageData;
+
+    if (Task.bLoadFromDiskCache)
+    {
+        if (!DiskCache->LoadImageData(Task.DiskCacheKey, ImageData))
+        {
+            UE_LOG(LogRuntimeImageReader, Warning, TEXT("Disk cache entry of %s is broken, image is read again"), *Task.Request.ImageFilename);
+
+            DiskCache->Remove(Task.DiskCacheKey);
+            Task.bDiskCacheEntryBroken = true;
+            return false;
+        }
+
+        if (Task.bRefreshDiskCacheHeader)
+        {
+            // entry is rewritten as a whole, so next sessions use it without asking the server till the new expiration
+            DiskCache->Store(Task.DiskCacheKey, Task.DiskCacheHeader, ImageData);
+        }
+
+        return true;
+    }
+
+    // decoder may crop and shrink the image already, transform stage finishes the rest
+    const bool bImported = FRuntimeImageUtils::ImportBufferAsImage(
+        Task.ImageBuffer.GetData(), (int32)Task.ImageBuffer.Num(), ImageData, Task.Result.OutError, Task.Request.FormatHint, Task.Request.TransformParams.GetDecodeHints()
+    );
+
+    // encoded image is not needed anymore
+    Task.ImageBuffer.Empty();
+
+    if (!bImported || Task.Result.OutError.Len() > 0)
+    {
+        return false;
+    }
+
+    // sanity checks
+    check(ImageData.RawData.Num() > 0);
+    check(ImageData.TextureSourceFormat != TSF_Invalid);
+
+    ImageData.ModificationTime = Task.SourceModificationTime;
+    ImageData.PixelFormat = DeterminePixelFormat(ImageData.Format, Task.Request.TransformParams);
+    if (ImageData.PixelFormat == PF_Unknown)
+    {
+        Task.Result.OutError = FString::Printf(TEXT("Pixel format is not supported: %d"), (int32)ImageData.PixelFormat);
+        return false;
+    }
+
+    INC_MEMORY_STAT_BY(STAT_RuntimeImageLoader_BytesDecoded, ImageData.RawData.Num());
+
+    return true;
+}
+
+bool URuntimeImageReader::TransformStage(FRuntimeImageReadTask& Task)
+{
+    SCOPE_RUNTIME_IMAGE_CYCLE_COUNTER(STAT_RuntimeImageLoader_Transform);
+
+    ApplyTransformations(Task.ImageData, Task.Request.TransformParams);
+
+    if (Task.bStoreInDiskCache)
+    {
+        DiskCache->Store(Task.DiskCacheKey, Task.DiskCacheHeader, Task.ImageData);
+    }
+
+    return true;
+}
+
+EImageReadStageResult URuntimeImageReader::UploadStage(const FRuntimeImageReadTaskPtr& Task)
+{
+    SCOPE_RUNTIME_IMAGE_CYCLE_COUNTER(STAT_RuntimeImageLoader_Upload);
+
+    const FImageReadRequest& Request = Task->Request;
+    FImageReadResult& ReadResult = Task->Result;
+
+    const FRuntimeImageData& ImageData = Request.DecodedImageData.IsValid() ? *Request.DecodedImageData : Task->ImageData;
+
+    // render thread reads the pixels, task keeps them alive till upload is completed
+    TFunction<void()> OnUploaded = [this, Task]()
+    {
+        if (Task->Request.bKeepImageData && !Task->Request.DecodedImageData.IsValid())
+        {
+            Task->Result.ImageData = MakeShared<FRuntimeImageData, ESPMode::ThreadSafe>(MoveTemp(Task->ImageData));
+        }
+        else
+        {
+            // pixels live on GPU from now on
+            Task->ImageData.RawData.Empty();
+            Task->ImageData.AdditionalMips.Empty();
+        }
+
+        FinishStage(EImageReadStage::Upload, Task, EImageReadStageResult::Succeeded);
+    };
+
+    if (Request.bProgressive && UploadToPreviewTexture(*Task, ImageData, MoveTemp(OnUploaded)))
+    {
+        return EImageReadStageResult::Pending;
+    }
+
+    if (Request.TargetRenderTarget != nullptr && !CanUpdateRenderTarget(Request.TargetRenderTarget, ImageData))
+    {
+        ReadResult.OutError = FString::Printf(
+            TEXT("Render target does not match the image. Image size: (%d, %d), pixel format: %s"),
+            ImageData.SizeX, ImageData.SizeY, GetPixelFormatString(ImageData.PixelFormat)
+        );
+        return EImageReadStageResult::Failed;
+    }
+
+    if (UploadToTarget(*Task, ImageData, MoveTemp(OnUploaded)))
+    {
+        return EImageReadStageResult::Pending;
+    }
+
+    ReadResult.OutTexture = ConstructTextureOnGameThread(Request.RequestId, Request.ImageFilename, ImageData);
+
+    if (!IsValid(ReadResult.OutTexture))
+    {
+        ReadResult.OutError = TEXT("Texture was not constructed. Please contact developer support: https://t.me/+RmbtPdzK2ntiYzQy");
+        return EImageReadStageResult::Failed;
+    }
+
+    UploadTexture(ReadResult.OutTexture, ImageData, MoveTemp(OnUploaded));
+
+    return EImageReadStageResult::Pending;
+}
+
+void URuntimeImageReader::ProcessCompletedRequests()
+{
+    check(IsInGameThread());
+
+    FImageReadResult ReadResult;
+    while (CompletedResults.Dequeue(ReadResult))
+    {
+        CompleteRequest(ReadResult);
+    }
+}
+
+void URuntimeImageReader::CompleteRequest(FImageReadResult& ReadResult)
+{
+    check(IsInGameThread());
+
+    {
+        FScopeLock ResultsScopeLock(&ResultsLock);
+
+        // result is dropped if request was cleared while in flight
+        if (PendingResults.Contains(ReadResult.RequestId))
+        {
+            Results.Add(ReadResult.RequestId, ReadResult);
+        }
+    }
+
+    {
+        // texture is referenced by result from now on
+        FScopeLock TexturesScopeLock(&ConstructedTexturesLock);
+        ConstructedTextures.Remove(ReadResult.RequestId);
+    }
+
+    {
+        FScopeLock PreviewTexturesScopeLock(&PreviewTexturesLock);
+        PreviewTextures.Remove(ReadResult.RequestId);
+    }
+
+    {
+        FScopeLock TargetTexturesScopeLock(&TargetTexturesLock);
+        TargetTextures.Remove(ReadResult.RequestId);
+    }
+
+    {
+        FScopeLock ActiveTasksScopeLock(&ActiveTasksLock);
+        ActiveTasks.Remove(ReadResult.RequestId);
+    }
+
+    if (ReadResult.OutError.IsEmpty())
+    {
+        INC_DWORD_STAT(STAT_RuntimeImageLoader_RequestsCompleted);
+    }
+    else
+    {
+        INC_DWORD_STAT(STAT_RuntimeImageLoader_RequestsFailed);
+    }
+
+    NumPendingRequests.Decrement();
+}
+
+void URuntimeImageReader::DropTask(FRuntimeImageReadTask& Task)
+{
+    check(IsInGameThread());
+
+    Task.bCancelled = true;
+    {
+        // previews that are decoded meanwhile are not handed out
+        FScopeLock PreviewScopeLock(&Task.PreviewLock);
+        Task.bCompleted = true;
+        Task.PreviewTexture = nullptr;
+    }
+
+    ReleaseDecodeMemory(Task);
+    NumPendingRequests.Decrement();
+
+    const int32 RequestId = Task.Request.RequestId;
+    {
+        FScopeLock TexturesScopeLock(&ConstructedTexturesLock);
+        ConstructedTextures.Remove(RequestId);
+        ConstructedTextures.Remove(-RequestId);
+    }
+
+    {
+        FScopeLock PreviewTexturesScopeLock(&PreviewTexturesLock);
+        PreviewTextures.Remove(RequestId);
+    }
+
+    {
+        FScopeLock TargetTexturesScopeLock(&TargetTexturesLock);
+        TargetTextures.Remove(RequestId);
+    }
+}
+
+void URuntimeImageReader::ProcessConstructTasks()
+{
+    check(IsInGameThread());
+
+    FConstructTextureTask Task;
+    while (!bStopThread && ConstructTasks.Dequeue(Task))
+    {
+        ConstructTexture(Task.RequestId, Task.ImageFilename, *Task.ImageData);
+        Task.ConstructedEvent->Event->Trigger();
+    }
+}
+
+void URuntimeImageReader::CancelConstructTasks()
+{
+    check(IsInGameThread());
+
+    // workers find no texture and fail their requests
+    FConstructTextureTask Task;
+    while (ConstructTasks.Dequeue(Task))
+    {
+        Task.ConstructedEvent->Event->Trigger();
+    }
+}
+
+UTexture2D* URuntimeImageReader::ConstructTexture(int32 RequestId, const FString& ImageFilename, const FRuntimeImageData& ImageData)
+{
+    SCOPE_RUNTIME_IMAGE_CYCLE_COUNTER(STAT_RuntimeImageLoader_ConstructTexture);
+
+    UTexture2D* NewTexture = IsValid(TexturePool) ? TexturePool->Acquire(ImageData) : nullptr;
+    if (NewTexture == nullptr)
+    {
+        NewTexture = FRuntimeImageUtils::CreateTexture(ImageFilename, ImageData);
+    }
+    else
+    {
+        INC_DWORD_STAT(STAT_RuntimeImageLoader_TexturePoolHits);
+    }
+
+    FScopeLock TexturesScopeLock(&ConstructedTexturesLock);
+    ConstructedTextures.Add(RequestId, NewTexture);
+
+    return NewTexture;
+}
+
+UTexture2D* URuntimeImageReader::ConstructTextureOnGameThread(int32 RequestId, const FString& ImageFilename, const FRuntimeImageData& ImageData)
+{
+    if (IsInGameThread())
+    {
+        ConstructTexture(RequestId, ImageFilename, ImageData);
+    }
+    else
+    {
+        const TSharedPtr<FConstructTextureEvent, ESPMode::ThreadSafe> ConstructedEvent = MakeShared<FConstructTextureEvent, ESPMode::ThreadSafe>();
+
+        FConstructTextureTask ConstructTask;
+        {
+            ConstructTask.RequestId = RequestId;
+            ConstructTask.ImageFilename = ImageFilename;
+            ConstructTask.ImageData = &ImageData;
+            ConstructTask.ConstructedEvent = ConstructedEvent;
+        }
+        ConstructTasks.Enqueue(MoveTemp(ConstructTask));
+
+        // task that is still queued when reader stops keeps the event alive, it's never run though as its pixels are gone then
+        SCOPE_RUNTIME_IMAGE_CYCLE_COUNTER(STAT_RuntimeImageLoader_WaitForGameThread);
+        while (!ConstructedEvent->Event->Wait(100) && !bStopThread);
+    }
+
+    FScopeLock TexturesScopeLock(&ConstructedTexturesLock);
+    return ConstructedTextures.FindRef(RequestId);
+}
+
+void URuntimeImageReader::HandleDownloadProgress(const FRuntimeImageReadTaskPtr& Task, const TArray<uint8>& ReceivedData, int64 TotalSize)
+{
+    check(IsInGameThread());
+
+    if (bStopThread || Task->bPreviewsDisabled || Task->bCancelled)
+    {
+        return;
+    }
+
+    if (!Task->ProgressiveDecoder.IsValid())
+    {
+        const ERuntimeImageFormat ImageFormat = (Task->Request.FormatHint != ERuntimeImageFormat::Auto)
+            ? Task->Request.FormatHint
+            : FRuntimeImageUtils::DetectImageFormat(ReceivedData.GetData(), ReceivedData.Num());
+
+        Task->ProgressiveDecoder = FRuntimeImageProgressiveDecoder::Create(ImageFormat, TotalSize);
+        if (!Task->ProgressiveDecoder.IsValid())
+        {
+            // image is shown once it's fully downloaded
+            Task->bPreviewsDisabled = true;
+            return;
+        }
+    }
+
+    Task->ProgressiveChunks.Enqueue(TArray<uint8>(ReceivedData.GetData() + Task->NumProgressiveBytes, ReceivedData.Num() - Task->NumProgressiveBytes));
+    Task->NumProgressiveBytes = ReceivedData.Num();
+
+    if (Task->bDecodingPreview.AtomicSet(true))
+    {
+        // running preview task picks the chunk up
+        return;
+    }
+
+    NumActivePreviewTasks.Increment();
+
+    FFunctionGraphTask::CreateAndDispatchWhenReady(
+        [this, Task]()
+        {
+            do
+            {
+                DecodePreview(Task);
+                Task->bDecodingPreview = false;
+            }
+            // chunk could be queued right before the flag was reset
+            while (!Task->ProgressiveChunks.IsEmpty() && !Task->bDecodingPreview.AtomicSet(true));
+
+            NumActivePreviewTasks.Decrement();
+        }, TStatId(), nullptr, ENamedThreads::AnyBackgroundThreadNormalTask
+    );
+}
+
+void URuntimeImageReader::DecodePreview(const FRuntimeImageReadTaskPtr& Task)
+{
+    SCOPE_RUNTIME_IMAGE_CYCLE_COUNTER(STAT_RuntimeImageLoader_DecodePreview);
+
+    bool bHasNewPreview = false;
+
+    TArray<uint8> Chunk;
+    while (Task->ProgressiveChunks.Dequeue(Chunk))
+    {
+        bHasNewPreview |= Task->ProgressiveDecoder->AppendData(Chunk.GetData(), Chunk.Num());
+    }
+
+    if (!bHasNewPreview || Task->bDownloadFinished || bStopThread)
+    {
+        return;
+    }
+
+    // owned by upload callback, render thread reads the pixels after this returns
+    FRuntimeImageDataPtr PreviewData = MakeShared<FRuntimeImageData, ESPMode::ThreadSafe>();
+    if (!Task->ProgressiveDecoder->GetPreview(*PreviewData))
+    {
+        return;
+    }
+
+    // previews are replaced shortly, mips and compression are not worth it
+    FTransformImageParams PreviewParams = Task->Request.TransformParams;
+    PreviewParams.bGenerateMips = false;
+    PreviewParams.Compression = ERuntimeImageCompression::None;
+
+    PreviewData->PixelFormat = DeterminePixelFormat(PreviewData->Format, PreviewParams);
+    if (PreviewData->PixelFormat == PF_Unknown)
+    {
+        return;
+    }
+
+    ApplyTransformations(*PreviewData, PreviewParams);
+
+    UploadPreview(Task, PreviewData);
+}
+
+void URuntimeImageReader::UploadPreview(const FRuntimeImageReadTaskPtr& Task, const FRuntimeImageDataPtr& PreviewData)
+{
+    {
+        FScopeLock PreviewScopeLock(&Task->PreviewLock);
+
+        if (Task->bFinalImageUploaded || Task->bCompleted || bStopThread)
+        {
+            return;
+        }
+
+        if (Task->PreviewTexture != nullptr)
+        {
+            if (CanUpdateTexture(Task->PreviewTexture, *PreviewData))
+            {
+                UpdateTexture(Task->PreviewTexture, *PreviewData, [PreviewData]() {});
+            }
+            return;
+        }
+    }
+
+    // constructed outside of the lock because game thread can be uploading the final image under it.
+    // Negative id keeps it apart from the texture of the final image
+    const int32 RequestId = Task->Request.RequestId;
+    UTexture2D* PreviewTexture = ConstructTextureOnGameThread(-RequestId, Task->Request.ImageFilename, *PreviewData);
+
+    FScopeLock PreviewScopeLock(&Task->PreviewLock);
+
+    if (!IsValid(PreviewTexture) || Task->bFinalImageUploaded || Task->bCompleted)
+    {
+        FScopeLock TexturesScopeLock(&ConstructedTexturesLock);
+        ConstructedTextures.Remove(-RequestId);
+        return;
+    }
+
+    // uploads run in order, so next previews and final image find the texture created
+    Task->PreviewTexture = PreviewTexture;
+
+    UploadTexture(PreviewTexture, *PreviewData, [this, Task, PreviewData, PreviewTexture, RequestId]()
+    {
+        {
+            FScopeLock UploadedScopeLock(&Task->PreviewLock);
+
+            // preview is handed out only once it can be displayed
+            if (!Task->bCompleted)
+            {
+                FScopeLock PreviewTexturesScopeLock(&PreviewTexturesLock);
+                PreviewTextures.Add(RequestId, PreviewTexture);
+            }
+        }
+
+        // constructed textures kept it from GC till it's handed to preview textures
+        FScopeLock TexturesScopeLock(&ConstructedTexturesLock);
+        ConstructedTextures.Remove(-RequestId);
+    });
+}
+
+bool URuntimeImageReader::UploadToPreviewTexture(FRuntimeImageReadTask& Task, const FRuntimeImageData& ImageData, TFunction<void()>&& OnCompleted)
+{
+    FScopeLock PreviewScopeLock(&Task.PreviewLock);
+
+    // previews that are still decoding are dropped
+    Task.bFinalImageUploaded = true;
+
+    if (Task.PreviewTexture == nullptr || !CanUpdateTexture(Task.PreviewTexture, ImageData))
+    {
+        return false;
+    }
+
+    // result is read once the upload is completed
+    Task.Result.OutTexture = Task.PreviewTexture;
+
+    UpdateTexture(Task.PreviewTexture, ImageData, MoveTemp(OnCompleted));
+    return true;
+}
+
+bool URuntimeImageReader::UploadToTarget(FRuntimeImageReadTask& Task, const FRuntimeImageData& ImageData, TFunction<void()>&& OnCompleted)
+{
+    const FImageReadRequest& Request = Task.Request;
+
+    if (Request.TargetRenderTarget != nullptr)
+    {
+        UpdateRenderTarget(Request.TargetRenderTarget, ImageData, MoveTemp(OnCompleted), Request.DirtyRegion);
+        return true;
+    }
+
+    if (Request.TargetTexture == nullptr || Request.TargetTexture->GetResource() == nullptr || !CanUpdateTexture(Request.TargetTexture, ImageData))
+    {
+        return false;
+    }
+
+    Task.Result.OutTexture = Request.TargetTexture;
+
+    UpdateTexture(Request.TargetTexture, ImageData, MoveTemp(OnCompleted), Request.DirtyRegion);
+    return true;
+}
+
+EPixelFormat URuntimeImageReader::DeterminePixelFormat(ERawImageFormat::Type ImageFormat, const FTransformImageParams& Params) const
+{
+    EPixelFormat PixelFormat;
+    
+    // determine pixel format
+    switch (ImageFormat)
+    {
+        case ERawImageFormat::G8:            PixelFormat = (Params.bForUI) ? PF_B8G8R8A8 : PF_G8; break;
+        case ERawImageFormat::G16:           PixelFormat = (Params.bForUI) ? PF_B8G8R8A8 : PF_G16; break;
+        case ERawImageFormat::BGRA8:         PixelFormat = PF_B8G8R8A8; break;
+        case ERawImageFormat::BGRE8:         PixelFormat = PF_B8G8R8A8; break;
+        case ERawImageFormat::RGBA16:        PixelFormat = (Params.bForUI) ? PF_B8G8R8A8 : PF_R16G16B16A16_UNORM; break;
+        case ERawImageFormat::RGBA16F:       PixelFormat = PF_FloatRGBA; break;
+        default:                             PixelFormat = PF_Unknown; break;
+    }
+
+    return PixelFormat;
+}
+
+struct FTextureDataResource : public FResourceBulkDataInterface
+{
+public:
+    FTextureDataResource(void* InMipData, int32 InDataSize)
+        : MipData(InMipData), DataSize(InDataSize)
+    {}
+
+    const void* GetResourceBulkData() const override { return MipData; }
+    uint32 GetResourceBulkDataSize() const override { return DataSize; }
+    void Discard() override {}
+
+private:
+    void* MipData;
+    int32 DataSize;
+};
+
+static ETextureCreateFlags GetTextureCreateFlags(const FRuntimeImageData& ImageData)
+{
+    ETextureCreateFlags TextureFlags = TexCreate_ShaderResource;
+    if (ImageData.SRGB)
+    {
+        TextureFlags |= TexCreate_SRGB;
+    }
+
+    if (ImageData.bGenerateMipsOnGPU)
+    {
+        // FGenerateMips writes mips by compute pass into UAVs, which sRGB formats can't have, so those go through raster pass
+        TextureFlags |= TexCreate_RenderTargetable | TexCreate_GenerateMipCapable;
+        if (!ImageData.SRGB)
+        {
+            TextureFlags |= TexCreate_UAV;
+        }
+    }
+
+    return TextureFlags;
+}
+
+static void GetMipsData(const FRuntimeImageData& ImageData, TArray<void*, TInlineAllocator<MAX_TEXTURE_MIP_COUNT>>& OutMipsData)
+{
+    OutMipsData.Add((void*)ImageData.RawData.GetData());
+
+    for (const FRuntimeImageRawData& MipData : ImageData.AdditionalMips)
+    {
+        OutMipsData.Add((void*)MipData.GetData());
+    }
+}
+
+static int64 GetUploadSize(const FRuntimeImageData& ImageData)
+{
+    int64 UploadSize = ImageData.RawData.Num();
+
+    for (const FRuntimeImageRawData& MipData : ImageData.AdditionalMips)
+    {
+        UploadSize += MipData.Num();
+    }
+
+    return UploadSize;
+}
+
+/**
+ * Uploads rows of mips which are available on CPU till the byte budget runs out, at least one row while any budget is left.
+ * Position is kept between calls, returns true once every row is uploaded. Render thread only
+ */
+static bool UploadMipRows(FTexture2DRHIRef RHITexture2D, const FRuntimeImageData& ImageData, int32& InOutMipIndex, int32& InOutBlockRow, int64& InOutBytesLeft)
+{
+    check(IsInRenderingThread());
+
+    TArray<void*, TInlineAllocator<MAX_TEXTURE_MIP_COUNT>> MipsData;
+    GetMipsData(ImageData, MipsData);
+
+    const FPixelFormatInfo& FormatInfo = GPixelFormats[ImageData.PixelFormat];
+
+    for (; InOutMipIndex < MipsData.Num(); ++InOutMipIndex, InOutBlockRow = 0)
+    {
+        const uint32 MipSizeX = FMipHelpers::GetMipSize(ImageData.SizeX, InOutMipIndex);
+        const uint32 MipSizeY = FMipHelpers::GetMipSize(ImageData.SizeY, InOutMipIndex);
+        const uint32 Pitch = FMath::DivideAndRoundUp<uint32>(MipSizeX, FormatInfo.BlockSizeX) * FormatInfo.BlockBytes;
+        const int32 NumBlockRows = FMath::DivideAndRoundUp<uint32>(MipSizeY, FormatInfo.BlockSizeY);
+
+        while (InOutBlockRow < NumBlockRows)
+        {
+            if (InOutBytesLeft <= 0)
+            {
+                return false;
+            }
+
+            const int32 NumRows = (int32)FMath::Clamp<int64>(InOutBytesLeft / Pitch, 1, NumBlockRows - InOutBlockRow);
+
+            FUpdateTextureRegion2D TextureRegion2D;
+            {
+                TextureRegion2D.DestX = 0;
+                TextureRegion2D.DestY = InOutBlockRow * FormatInfo.BlockSizeY;
+                TextureRegion2D.SrcX = 0;
+                TextureRegion2D.SrcY = 0;
+                TextureRegion2D.Width = MipSizeX;
+                TextureRegion2D.Height = FMath::Min<uint32>(NumRows * FormatInfo.BlockSizeY, MipSizeY - TextureRegion2D.DestY);
+            }
+
+            RHIUpdateTexture2D(
+                RHITexture2D, InOutMipIndex, TextureRegion2D, Pitch,
+                (const uint8*)MipsData[InOutMipIndex] + (int64)InOutBlockRow * Pitch
+            );
+
+            InOutBlockRow += NumRows;
+            InOutBytesLeft -= (int64)NumRows * Pitch;
+        }
+    }
+
+    return true;
+}
+
+/** Builds mips which are not available on CPU if requested. Render thread only */
+static void GenerateTextureMips(FTexture2DRHIRef RHITexture2D, const FRuntimeImageData& ImageData)
+{
+    check(IsInRenderingThread());
+
+    if (ImageData.bGenerateMipsOnGPU && ImageData.NumMips > 1)
+    {
+        FRHICommandListImmediate& RHICmdList = FRHICommandListExecutor::GetImmediateCommandList();
+
+        FRDGBuilder GraphBuilder(RHICmdList);
+        FRDGTextureRef MipsTexture = GraphBuilder.RegisterExternalTexture(CreateRenderTarget(RHITexture2D, TEXT("RuntimeImageReaderMips")));
+
+        // sRGB textures are created without UAV so must use raster pass
+        const EGenerateMipsPass GenerateMipsPass = ImageData.SRGB ? EGenerateMipsPass::Raster : EGenerateMipsPass::AutoDetect;
+
+#if ENGINE_MAJOR_VERSION < 5
+        FGenerateMips::Execute(GraphBuilder, MipsTexture, TStaticSamplerState<SF_Bilinear, AM_Clamp, AM_Clamp, AM_Clamp>::GetRHI(), GenerateMipsPass);
+#else
+        FGenerateMipsParams GenerateMipsParams;
+        {
+            GenerateMipsParams.Filter = SF_Bilinear;
+            GenerateMipsParams.AddressU = AM_Clamp;
+            GenerateMipsParams.AddressV = AM_Clamp;
+            GenerateMipsParams.AddressW = AM_Clamp;
+        }
+        FGenerateMips::Execute(GraphBuilder, GMaxRHIFeatureLevel, MipsTexture, GenerateMipsParams, GenerateMipsPass);
+
+        // texture is sampled by materials and UMG afterwards
+        GraphBuilder.SetTextureAccessFinal(MipsTexture, ERHIAccess::SRVMask);
+#endif
+
+        GraphBuilder.Execute();
+    }
+}
+
+/** Uploads mips which are available on CPU starting from FirstMipIndex and builds the rest on GPU if requested. Render thread only */
+static void UpdateTextureMips(FTexture2DRHIRef RHITexture2D, const FRuntimeImageData& ImageData, int32 FirstMipIndex = 0)
+{
+    int32 MipIndex = FirstMipIndex;
+    int32 BlockRow = 0;
+    int64 BytesLeft = MAX_int64;
+    UploadMipRows(RHITexture2D, ImageData, MipIndex, BlockRow, BytesLeft);
+
+    GenerateTextureMips(RHITexture2D, ImageData);
+}
+
+/** Uploads part of the top mip, the region is expanded to whole blocks. Returns the number of bytes uploaded. Render thread only */
+static int64 UpdateTextureRegion(FTexture2DRHIRef RHITexture2D, const FRuntimeImageData& ImageData, const FIntRect& Region)
+{
+    check(IsInRenderingThread());
+
+    const FPixelFormatInfo& FormatInfo = GPixelFormats[ImageData.PixelFormat];
+
+    const int32 FirstBlockX = FMath::Clamp(Region.Min.X, 0, ImageData.SizeX) / FormatInfo.BlockSizeX;
+    const int32 FirstBlockY = FMath::Clamp(Region.Min.Y, 0, ImageData.SizeY) / FormatInfo.BlockSizeY;
+    const int32 EndBlockX = FMath::DivideAndRoundUp(FMath::Clamp(Region.Max.X, 0, ImageData.SizeX), FormatInfo.BlockSizeX);
+    const int32 EndBlockY = FMath::DivideAndRoundUp(FMath::Clamp(Region.Max.Y, 0, ImageData.SizeY), FormatInfo.BlockSizeY);
+
+    if (EndBlockX <= FirstBlockX || EndBlockY <= FirstBlockY)
+    {
+        return 0;
+    }
+
+    const uint32 Pitch = FMath::DivideAndRoundUp(ImageData.SizeX, FormatInfo.BlockSizeX) * FormatInfo.BlockBytes;
+
+    FUpdateTextureRegion2D TextureRegion2D;
+    {
+        TextureRegion2D.DestX = FirstBlockX * FormatInfo.BlockSizeX;
+        TextureRegion2D.DestY = FirstBlockY * FormatInfo.BlockSizeY;
+        TextureRegion2D.SrcX = 0;
+        TextureRegion2D.SrcY = 0;
+        TextureRegion2D.Width = FMath::Min(EndBlockX * FormatInfo.BlockSizeX, ImageData.SizeX) - TextureRegion2D.DestX;
+        TextureRegion2D.Height = FMath::Min(EndBlockY * FormatInfo.BlockSizeY, ImageData.SizeY) - TextureRegion2D.DestY;
+    }
+
+    // source points at the first pixel of the region, rows keep the pitch of the whole image
+    RHIUpdateTexture2D(
+        RHITexture2D, 0, TextureRegion2D, Pitch,
+        ImageData.RawData.GetData() + (int64)FirstBlockY * Pitch + (int64)FirstBlockX * FormatInfo.BlockBytes
+    );
+
+    return (int64)(EndBlockY - FirstBlockY) * (EndBlockX - FirstBlockX) * FormatInfo.BlockBytes;
+}
+
+/** RHI of the texture or render target that upload overwrites, null if it has none */
+static FTexture2DRHIRef GetUpdatedTextureRHI(const FTextureUpload& Upload)
+{
+    const FTextureResource* TextureResource = (Upload.RenderTarget != nullptr) ? Upload.RenderTarget->GetResource() : Upload.Texture->GetResource();
+    if (TextureResource == nullptr || !TextureResource->TextureRHI.IsValid())
+    {
+        return nullptr;
+    }
+
+    return TextureResource->TextureRHI->GetTexture2D();
+}
+
+/** Texture is created from worker thread if every mip is available on CPU */
+static bool CanCreateTextureAsync(const FRuntimeImageData& ImageData)
+{
+#if (PLATFORM_ANDROID || PLATFORM_ANDROID_VULKAN)
+    return false;
+#else
+    return GRHISupportsAsyncTextureCreation && !ImageData.bGenerateMipsOnGPU;
+#endif
+}
+
+void URuntimeImageReader::UploadTexture(UTexture2D* Texture, const FRuntimeImageData& ImageData, TFunction<void()>&& OnCompleted)
+{
+    if (Texture->GetResource() != nullptr)
+    {
+        // recycled texture of the same size and format is overwritten in place
+        UpdateTexture(Texture, ImageData, MoveTemp(OnCompleted));
+    }
+    else
+    {
+        CreateTexture(Texture, ImageData, MoveTemp(OnCompleted));
+    }
+}
+
+void URuntimeImageReader::CreateTexture(UTexture2D* NewTexture, const FRuntimeImageData& ImageData, TFunction<void()>&& OnCompleted)
+{
+    ensureMsgf(ImageData.SizeX > 0, TEXT("ImageData.SizeX must be > 0"));
+    ensureMsgf(ImageData.SizeY > 0, TEXT("ImageData.SizeY must be > 0"));
+
+    FTextureUpload Upload;
+    Upload.Texture = NewTexture;
+    Upload.ImageData = &ImageData;
+    Upload.OnCompleted = MoveTemp(OnCompleted);
+
+    if (CanCreateTextureAsync(ImageData))
+    {
+        TArray<void*, TInlineAllocator<MAX_TEXTURE_MIP_COUNT>> MipsData;
+        GetMipsData(ImageData, MipsData);
+
+        Upload.RHITexture2D = RHIAsyncCreateTexture2D(
+            ImageData.SizeX, ImageData.SizeY,
+            ImageData.PixelFormat,
+            ImageData.NumMips,
+            GetTextureCreateFlags(ImageData),
+            MipsData.GetData(),
+            MipsData.Num()
+        );
+    }
+
+    // Create proper texture resource so UMG can display runtime texture
+    Upload.NewResource = new FRuntimeTextureResource(NewTexture, ImageData.SizeX, ImageData.SizeY, ImageData.PixelFormat, ImageData.SRGB);
+    NewTexture->SetResource(Upload.NewResource);
+
+    EnqueueUpload(MoveTemp(Upload));
+}
+
+void URuntimeImageReader::CreateAtlasTexture(UTexture2D* AtlasTexture, const FRuntimeImageData& AtlasData, const TArray<UTexture2D*>& Textures, const TArray<FIntPoint>& Positions, TFunction<void()>&& OnCompleted)
+{
+    check(Textures.Num() == Positions.Num());
+
+    FTextureUpload Upload;
+    Upload.Texture = AtlasTexture;
+    Upload.OnCompleted = MoveTemp(OnCompleted);
+
+    Upload.NewResource = new FRuntimeTextureResource(AtlasTexture, AtlasData.SizeX, AtlasData.SizeY, AtlasData.PixelFormat, AtlasData.SRGB);
+    AtlasTexture->SetResource(Upload.NewResource);
+
+    const FIntPoint AtlasSize(AtlasData.SizeX, AtlasData.SizeY);
+    const EPixelFormat PixelFormat = AtlasData.PixelFormat;
+    const ETextureCreateFlags TextureFlags = GetTextureCreateFlags(AtlasData);
+
+    Upload.BuildTexture = [AtlasSize, PixelFormat, TextureFlags, Textures, Positions]()
+    {
+        // padding between images stays transparent black
+        TArray<uint8> ZeroData;
+        ZeroData.SetNumZeroed(CalculateImageBytes(AtlasSize.X, AtlasSize.Y, 0, PixelFormat));
+        FTextureDataResource TextureData(ZeroData.GetData(), ZeroData.Num());
+
+        FRHIResourceCreateInfo CreateInfo(TEXT("RuntimeImageReaderAtlas"));
+        CreateInfo.BulkData = &TextureData;
+
+        FTexture2DRHIRef AtlasRHI = RHICreateTexture2D(AtlasSize.X, AtlasSize.Y, PixelFormat, 1, 1, TextureFlags, CreateInfo);
+
+        FRHICommandListImmediate& RHICmdList = FRHICommandListExecutor::GetImmediateCommandList();
+        RHICmdList.Transition(FRHITransitionInfo(AtlasRHI, ERHIAccess::Unknown, ERHIAccess::CopyDest));
+
+        for (int32 Index = 0; Index < Textures.Num(); ++Index)
+        {
+            const FTextureResource* TextureResource = Textures[Index] != nullptr ? Textures[Index]->GetResource() : nullptr;
+            if (TextureResource == nullptr || !TextureResource->TextureRHI.IsValid())
+            {
+                continue;
+            }
+
+            FRHITexture* SourceRHI = TextureResource->TextureRHI;
+            const FIntVector SourceSize = SourceRHI->GetSizeXYZ();
+
+            FRHICopyTextureInfo CopyInfo;
+            CopyInfo.Size = FIntVector(SourceSize.X, SourceSize.Y, 1);
+            CopyInfo.DestPosition = FIntVector(Positions[Index].X, Positions[Index].Y, 0);
+
+            RHICmdList.Transition(FRHITransitionInfo(SourceRHI, ERHIAccess::SRVMask, ERHIAccess::CopySrc));
+            RHICmdList.CopyTexture(SourceRHI, AtlasRHI, CopyInfo);
+            RHICmdList.Transition(FRHITransitionInfo(SourceRHI, ERHIAccess::CopySrc, ERHIAccess::SRVMask));
+        }
+
+        RHICmdList.Transition(FRHITransitionInfo(AtlasRHI, ERHIAccess::CopyDest, ERHIAccess::SRVMask));
+
+        return AtlasRHI;
+    };
+
+    EnqueueUpload(MoveTemp(Upload));
+}
+
+FTexture2DRHIRef URuntimeImageReader::CreateRHITexture(UTexture2D* NewTexture, const FRuntimeImageData& ImageData)
+{
+#if PLATFORM_WINDOWS
+    return CreateTexture_Windows(NewTexture, ImageData);
+#elif (PLATFORM_ANDROID || PLATFORM_ANDROID_VULKAN)
+    return CreateTexture_Mobile(NewTexture, ImageData);
+#else
+    return CreateTexture_Other(NewTexture, ImageData);
+#endif
+}
+
+FTexture2DRHIRef URuntimeImageReader::CreateTexture_Windows(UTexture2D* NewTexture, const FRuntimeImageData& ImageData)
+{
+    check(IsInRenderingThread());
+
+    ETextureCreateFlags TextureFlags = GetTextureCreateFlags(ImageData);
+
+    FTexture2DRHIRef RHITexture2D = nullptr;
+
+    if (ImageData.NumMips == 1)
+    {
+        FTextureDataResource TextureData((void*)ImageData.RawData.GetData(), ImageData.RawData.Num());
+
+        FRHIResourceCreateInfo CreateInfo(TEXT("RuntimeImageReaderTextureData"));
+        CreateInfo.BulkData = &TextureData;
+
+        RHITexture2D = RHICreateTexture2D(
+            ImageData.SizeX, ImageData.SizeY,
+            ImageData.PixelFormat,
+            ImageData.NumMips,
+            1,
+            TextureFlags,
+            CreateInfo
+        );
+    }
+    else
+    {
+        FRHIResourceCreateInfo CreateInfo(TEXT("RuntimeImageReaderTextureData"));
+        RHITexture2D = RHICreateTexture2D(
+            ImageData.SizeX, ImageData.SizeY,
+            ImageData.PixelFormat,
+            ImageData.NumMips,
+            1,
+            TextureFlags,
+            CreateInfo
+        );
+
+        UpdateTextureMips(RHITexture2D, ImageData);
+    }
+
+    return RHITexture2D;
+}
+
+
+FTexture2DRHIRef URuntimeImageReader::CreateTexture_Mobile(UTexture2D* NewTexture, const FRuntimeImageData& ImageData)
+{
+    check(IsInRenderingThread());
+
+    // Vulkan and OpenGL can't create textures from workers. Pixels passed at creation are copied by the RHI thread,
+    // Vulkan records the copy to its upload command buffer, while every RHIUpdateTexture2D stalls the RHI thread
+    ETextureCreateFlags TextureFlags = GetTextureCreateFlags(ImageData);
+
+    const bool bAllMipsOnCPU = ImageData.AdditionalMips.Num() == ImageData.NumMips - 1;
+    const bool bVulkan = IsVulkanPlatform(GMaxRHIShaderPlatform);
+
+    // initial data of Vulkan fills top mip only, OpenGL reads the whole chain back to back
+    TArray<uint8> MipChainData;
+    if (!bVulkan && bAllMipsOnCPU && ImageData.NumMips > 1)
+    {
+        MipChainData.Reserve(GetUploadSize(ImageData));
+        MipChainData.Append(ImageData.RawData.GetData(), ImageData.RawData.Num());
+        for (const FRuntimeImageRawData& MipData : ImageData.AdditionalMips)
+        {
+            MipChainData.Append(MipData.GetData(), MipData.Num());
+        }
+    }
+
+    const bool bHasInitialData = bVulkan || bAllMipsOnCPU;
+    FTextureDataResource TextureData(
+        MipChainData.Num() > 0 ? (void*)MipChainData.GetData() : (void*)ImageData.RawData.GetData(),
+        MipChainData.Num() > 0 ? MipChainData.Num() : ImageData.RawData.Num()
+    );
+
+    FRHIResourceCreateInfo CreateInfo(TEXT("RuntimeImageReaderTextureData"));
+    if (bHasInitialData)
+    {
+        CreateInfo.BulkData = &TextureData;
+    }
+
+    FTexture2DRHIRef RHITexture2D = RHICreateTexture2D(
+        ImageData.SizeX, ImageData.SizeY,
+        ImageData.PixelFormat,
+        ImageData.NumMips,
+        1,
+        TextureFlags,
+        CreateInfo
+    );
+
+    // mips which are not part of initial data are uploaded or generated as usual
+    const int32 FirstMipIndex = !bHasInitialData ? 0 : (bVulkan ? 1 : ImageData.NumMips);
+    UpdateTextureMips(RHITexture2D, ImageData, FirstMipIndex);
+
+    return RHITexture2D;
+}
+
+FTexture2DRHIRef URuntimeImageReader::CreateTexture_Other(UTexture2D* NewTexture, const FRuntimeImageData& ImageData)
+{
+    // desktop Vulkan and OpenGL share the upload rules of mobile ones, other RHIs take initial data like D3D
+    if (IsVulkanPlatform(GMaxRHIShaderPlatform) || IsOpenGLPlatform(GMaxRHIShaderPlatform))
+    {
+        return CreateTexture_Mobile(NewTexture, ImageData);
+    }
+
+    return CreateTexture_Windows(NewTexture, ImageData);
+}
+
+void URuntimeImageReader::FinalizeTexture(UTexture2D* NewTexture, FRuntimeTextureResource* NewTextureResource, FTexture2DRHIRef RHITexture2D)
+{
+    check(IsInRenderingThread());
+    SCOPE_RUNTIME_IMAGE_CYCLE_COUNTER(STAT_RuntimeImageLoader_FinalizeTexture);
+
+    NewTextureResource->TextureRHI = RHITexture2D;
+    NewTextureResource->InitResource();
+    RHIUpdateTextureReference(NewTexture->TextureReference.TextureReferenceRHI, RHITexture2D);
+    NewTextureResource->SetTextureReference(NewTexture->TextureReference.TextureReferenceRHI);
+}
+
+void URuntimeImageReader::UpdateTexture(UTexture2D* Texture, const FRuntimeImageData& ImageData, TFunction<void()>&& OnCompleted, const FIntRect& Region)
+{
+    FTextureUpload Upload;
+    Upload.Texture = Texture;
+    Upload.ImageData = &ImageData;
+    Upload.OnCompleted = MoveTemp(OnCompleted);
+    Upload.UpdateRegion = Region;
+
+    EnqueueUpload(MoveTemp(Upload));
+}
+
+void URuntimeImageReader::UpdateRenderTarget(UTextureRenderTarget2D* RenderTarget, const FRuntimeImageData& ImageData, TFunction<void()>&& OnCompleted, const FIntRect& Region)
+{
+    FTextureUpload Upload;
+    Upload.RenderTarget = RenderTarget;
+    Upload.ImageData = &ImageData;
+    Upload.OnCompleted = MoveTemp(OnCompleted);
+    Upload.UpdateRegion = Region;
+
+    EnqueueUpload(MoveTemp(Upload));
+}
+
+void URuntimeImageReader::EnqueueUpload(FTextureUpload&& Upload)
+{
+    NumActiveUploads.Increment();
+    PendingUploads.Enqueue(MoveTemp(Upload));
+
+    ScheduleUploadBatch();
+}
+
+void URuntimeImageReader::ScheduleUploadBatch()
+{
+    if (bUploadBatchScheduled.AtomicSet(true))
+    {
+        // render thread picks uploads up with the batch that is already scheduled
+        return;
+    }
+
+    FFunctionGraphTask::CreateAndDispatchWhenReady(
+        [this]()
+        {
+            ProcessUploads();
+        }, TStatId(), nullptr, ENamedThreads::ActualRenderingThread
+    );
+}
+
+void URuntimeImageReader::ProcessUploads()
+{
+    check(IsInRenderingThread());
+    SCOPE_RUNTIME_IMAGE_CYCLE_COUNTER(STAT_RuntimeImageLoader_ProcessUploads);
+
+    // uploads queued from now on schedule the next batch
+    bUploadBatchScheduled = false;
+
+    if (UploadBudgetFrame != GFrameNumberRenderThread)
+    {
+        UploadBudgetFrame = GFrameNumberRenderThread;
+        UploadBytesLeft = UploadBudget;
+    }
+
+    // frames do not advance while someone blocks on requests
+    const bool bIgnoreBudget = UploadBudget <= 0 || NumUploadFlushes.GetValue() > 0;
+
+    while (ActiveUpload.IsSet() || PendingUploads.Dequeue(ActiveUpload))
+    {
+        int64 BytesLeft = bIgnoreBudget ? MAX_int64 : UploadBytesLeft;
+        const bool bUploadCompleted = BytesLeft > 0 && ProcessUpload(ActiveUpload, BytesLeft);
+
+        if (!bIgnoreBudget)
+        {
+            UploadBytesLeft = BytesLeft;
+        }
+
+        if (!bUploadCompleted)
+        {
+            // game thread tick schedules the rest with the next frame
+            return;
+        }
+
+        ActiveUpload.OnCompleted();
+        ActiveUpload = FTextureUpload();
+
+        NumActiveUploads.Decrement();
+    }
+}
+
+bool URuntimeImageReader::ProcessUpload(FTextureUpload& Upload, int64& InOutBytesLeft)
+{
+    if (Upload.BuildTexture)
+    {
+        FinalizeTexture(Upload.Texture, Upload.NewResource, Upload.BuildTexture());
+        return true;
+    }
+
+    const FRuntimeImageData& ImageData = *Upload.ImageData;
+
+#if STATS
+    const int64 BytesLeftBefore = InOutBytesLeft;
+    ON_SCOPE_EXIT
+    {
+        INC_MEMORY_STAT_BY(STAT_RuntimeImageLoader_BytesUploaded, BytesLeftBefore - InOutBytesLeft);
+    };
+#endif
+
+    if (!Upload.bSplitIntoBands)
+    {
+        if (Upload.NewResource != nullptr && Upload.RHITexture2D.IsValid())
+        {
+            // created with pixels by worker
+            INC_MEMORY_STAT_BY(STAT_RuntimeImageLoader_BytesUploaded, GetUploadSize(ImageData));
+            FinalizeTexture(Upload.Texture, Upload.NewResource, Upload.RHITexture2D);
+            return true;
+        }
+
+        if (Upload.NewResource == nullptr && Upload.UpdateRegion.Area() > 0)
+        {
+            // dirty regions are meant to be small, they are uploaded at once
+            FTexture2DRHIRef RHITexture2D = GetUpdatedTextureRHI(Upload);
+            if (RHITexture2D.IsValid())
+            {
+                InOutBytesLeft -= UpdateTextureRegion(RHITexture2D, ImageData, Upload.UpdateRegion);
+            }
+            return true;
+        }
+
+        const int64 UploadSize = GetUploadSize(ImageData);
+        if (UploadSize <= InOutBytesLeft)
+        {
+            if (Upload.NewResource != nullptr)
+            {
+                FinalizeTexture(Upload.Texture, Upload.NewResource, CreateRHITexture(Upload.Texture, ImageData));
+            }
+            else
+            {
+                FTexture2DRHIRef RHITexture2D = GetUpdatedTextureRHI(Upload);
+                if (RHITexture2D.IsValid())
+                {
+                    UpdateTextureMips(RHITexture2D, ImageData);
+                }
+            }
+
+            InOutBytesLeft -= UploadSize;
+            return true;
+        }
+
+        // does not fit the budget that is left, rows are uploaded in bands over the next frames
+        if (Upload.NewResource != nullptr)
+        {
+            FRHIResourceCreateInfo CreateInfo(TEXT("RuntimeImageReaderTextureData"));
+            Upload.RHITexture2D = RHICreateTexture2D(
+                ImageData.SizeX, ImageData.SizeY,
+                ImageData.PixelFormat,
+                ImageData.NumMips,
+                1,
+                GetTextureCreateFlags(ImageData),
+                CreateInfo
+            );
+        }
+        else
+        {
+            Upload.RHITexture2D = GetUpdatedTextureRHI(Upload);
+            if (!Upload.RHITexture2D.IsValid())
+            {
+                return true;
+            }
+        }
+
+        Upload.bSplitIntoBands = true;
+    }
+
+    if (!UploadMipRows(Upload.RHITexture2D, ImageData, Upload.NextMipIndex, Upload.NextBlockRow, InOutBytesLeft))
+    {
+        return false;
+    }
+
+    GenerateTextureMips(Upload.RHITexture2D, ImageData);
+
+    if (Upload.NewResource != nullptr)
+    {
+        FinalizeTexture(Upload.Texture, Upload.NewResource, Upload.RHITexture2D);
+    }
+
+    return true;
+}
+
+bool URuntimeImageReader::CanUpdateTexture(const UTexture2D* Texture, const FRuntimeImageData& ImageData)
+{
+#if ENGINE_MAJOR_VERSION < 5
+    const FTexturePlatformData* PlatformData = Texture->PlatformData;
+#else
+    const FTexturePlatformData* PlatformData = Texture->GetPlatformData();
+#endif
+
+    return PlatformData != nullptr &&
+        PlatformData->SizeX == ImageData.SizeX &&
+        PlatformData->SizeY == ImageData.SizeY &&
+        PlatformData->PixelFormat == ImageData.PixelFormat &&
+        PlatformData->Mips.Num() == 1 && ImageData.NumMips == 1 &&
+        Texture->SRGB == ImageData.SRGB;
+}
+
+bool URuntimeImageReader::CanUpdateRenderTarget(const UTextureRenderTarget2D* RenderTarget, const FRuntimeImageData& ImageData)
+{
+    // pixels are written as they are, sRGB of the render target is not matched
+    return RenderTarget->GetResource() != nullptr &&
+        RenderTarget->SizeX == ImageData.SizeX &&
+        RenderTarget->SizeY == ImageData.SizeY &&
+        RenderTarget->GetFormat() == ImageData.PixelFormat &&
+        ImageData.NumMips == 1;
+}
+
+void URuntimeImageReader::ApplyTransformations(FRuntimeImageData& ImageData, FTransformImageParams TransformParams)
+{
+    if (TransformParams.SizeMode == ERuntimeImageSizeMode::Percent && !TransformParams.IsPercentSizeValid())
+    {
+        UE_LOG(LogRuntimeImageReader, Verbose, TEXT("Supplied transform params are not valid! PercentSizeX, PercentSizeX: (%d, %d)"), TransformParams.PercentSizeX, TransformParams.PercentSizeY);
+    }
+    else if (TransformParams.SizeMode != ERuntimeImageSizeMode::Percent && !TransformParams.IsTargetSizeValid())
+    {
+        UE_LOG(LogRuntimeImageReader, Verbose, TEXT("Supplied transform params are not valid! TargetSize: (%d, %d)"), TransformParams.TargetSize.X, TransformParams.TargetSize.Y);
+    }
+    
+    // image that still covers the whole source is cropped here, decoders which skip pixels crop it themselves
+    const FIntRect ImageRect(0, 0, ImageData.SizeX, ImageData.SizeY);
+    if (ImageData.SourceRect.Area() <= 0)
+    {
+        ImageData.SourceRect = ImageRect;
+    }
+
+    if (TransformParams.HasCrop() && ImageData.SourceRect == ImageRect)
+    {
+        const FIntRect CropRegion = FScaledDecodeHelpers::ClampRegion(
+            FIntRect(TransformParams.CropOffset, TransformParams.CropOffset + TransformParams.CropSize), ImageData.SizeX, ImageData.SizeY
+        );
+
+        if (CropRegion != ImageRect)
+        {
+            FScaledDecodeHelpers::CropImage(ImageData, CropRegion);
+        }
+    }
+
+    // target size is relative to the region of the source, image may be shrunk by decoder already
+    const FIntPoint TransformedSize = TransformParams.GetDecodeHints().GetTargetSize(ImageData.SourceRect.Size());
+
+    if (TransformedSize.X != ImageData.SizeX || TransformedSize.Y != ImageData.SizeY)
+    {
+        // pixels are converted for UI while they are resized
+        const bool bConvertForUI = TransformParams.bForUI && ImageData.TextureSourceFormat != TSF_RGBA16F;
+
+        if (!FResizeHelpers::ResizeImage(ImageData, TransformedSize.X, TransformedSize.Y, TransformParams.ResizeFilter, bConvertForUI))
+        {
+            FImage TransformedImage;
+            TransformedImage.Init(TransformedSize.X, TransformedSize.Y, ImageData.Format);
+
+            ImageData.ResizeTo(TransformedImage, TransformedImage.SizeX, TransformedImage.SizeY, ImageData.Format, ImageData.GammaSpace);
+
+            ImageData.RawData = MoveTemp(TransformedImage.RawData);
+            ImageData.SizeX = TransformedImage.SizeX;
+            ImageData.SizeY = TransformedImage.SizeY;
+        }
+    }
+
+    if (TransformParams.bForUI)
+    {
+        // no need to convert float RGBA or pixels that are BGRA8 already
+        const bool bIsUIReady = ImageData.Format == ERawImageFormat::BGRA8 && ImageData.GammaSpace == EGammaSpace::sRGB;
+        if (ImageData.TextureSourceFormat != TSF_RGBA16F && !bIsUIReady && !FConvertHelpers::ConvertToBGRA8(ImageData))
+        {
+            // formats without a dedicated conversion go through the generic one
+            FImage BGRAImage;
+            BGRAImage.Init(ImageData.SizeX, ImageData.SizeY, ERawImageFormat::BGRA8);
+            ImageData.CopyTo(BGRAImage, ERawImageFormat::BGRA8, EGammaSpace::sRGB);
+
+            ImageData.RawData = MoveTemp(BGRAImage.RawData);
+            ImageData.Format = ERawImageFormat::BGRA8;
+            ImageData.TextureSourceFormat = TSF_BGRA8;
+            ImageData.SRGB = true;
+            ImageData.GammaSpace = EGammaSpace::sRGB;
+        }
+    }
+
+    const bool bIsHDRImage = ImageData.Format == ERawImageFormat::RGBA16F && ImageData.PixelFormat == PF_FloatRGBA;
+
+    EPixelFormat CompressedFormat = PF_Unknown;
+    if (TransformParams.Compression != ERuntimeImageCompression::None)
+    {
+        // half float pixels keep their range in BC6H, 8 bit block formats would clip them
+        CompressedFormat = bIsHDRImage
+            ? FBlockCompressionHelpers::GetCompressedHDRPixelFormat()
+            : FBlockCompressionHelpers::GetCompressedPixelFormat(TransformParams.Compression);
+        if (CompressedFormat == PF_Unknown || !FBlockCompressionHelpers::CanCompressImage(ImageData))
+        {
+            UE_LOG(LogRuntimeImageReader, Verbose, TEXT("Image can't be compressed, it's uploaded uncompressed. Size: (%d, %d), format: %d"), ImageData.SizeX, ImageData.SizeY, (int32)ImageData.Format);
+            CompressedFormat = PF_Unknown;
+        }
+    }
+
+    // uncompressed half float pixels are packed into smaller float format once mips are built from them
+    const EPixelFormat HDRPixelFormat = (bIsHDRImage && CompressedFormat == PF_Unknown) ? FConvertHelpers::GetHDRPixelFormat(TransformParams.HDRFormat) : PF_Unknown;
+
+    if (TransformParams.bGenerateMips)
+    {
+        const int32 MaxNumMips = FMipHelpers::GetMaxNumMips(ImageData.SizeX, ImageData.SizeY);
+        const int32 NumMips = (TransformParams.NumMips > 0) ? FMath::Min(TransformParams.NumMips, MaxNumMips) : MaxNumMips;
+
+        // shared exponent pixels can't be filtered by GPU either
+        const EPixelFormat UploadPixelFormat = (HDRPixelFormat != PF_Unknown) ? HDRPixelFormat : ImageData.PixelFormat;
+        const bool bCanGenerateOnGPU = ImageData.Format != ERawImageFormat::BGRE8 && FMipHelpers::CanGenerateMipsOnGPU(UploadPixelFormat);
+
+        if (NumMips <= 1)
+        {
+            ImageData.NumMips = 1;
+        }
+        else if (TransformParams.bGenerateMipsOnGPU && bCanGenerateOnGPU && CompressedFormat == PF_Unknown)
+        {
+            ImageData.NumMips = NumMips;
+            ImageData.bGenerateMipsOnGPU = true;
+        }
+        else if (FMipHelpers::GenerateMipsOnCPU(ImageData, NumMips))
+        {
+            ImageData.NumMips = NumMips;
+        }
+        else
+        {
+            UE_LOG(LogRuntimeImageReader, Warning, TEXT("Mips can't be generated for image format: %d"), (int32)ImageData.Format);
+        }
+    }
+
+    if (CompressedFormat != PF_Unknown)
+    {
+        // compressed mips can't be generated on GPU so they are built on CPU above
+        FBlockCompressionHelpers::CompressImage(ImageData, CompressedFormat);
+    }
+    else if (HDRPixelFormat != PF_Unknown && HDRPixelFormat != PF_FloatRGBA)
+    {
+        FConvertHelpers::PackHDRImage(ImageData, HDRPixelFormat);
     }
 }
@@ -0,0 +1,74 @@
+// Copyright 2022 Peter Leontev. All Rights Reserved.
+
+#include "RuntimeImageReaderWorker.h"
+
+#include "GenericPlatform/GenericPlatformProcess.h"
+#include "HAL/RunnableThread.h"
+#include "HAL/Event.h"
+
+#include "RuntimeImageReader.h"
+
+
+FRuntimeImageReaderWorker::FRuntimeImageReaderWorker(URuntimeImageReader* InReader, int32 InWorkerIndex)
+    : Reader(InReader)
+{
+    ThreadSemaphore = FPlatformProcess::GetSynchEventFromPool(false);
+
+    const FString ThreadName = FString::Printf(TEXT("RuntimeImageReader_%d"), InWorkerIndex);
+    Thread = FRunnableThread::Create(this, *ThreadName, 0, TPri_SlightlyBelowNormal);
+}
+
+FRuntimeImageReaderWorker::~FRuntimeImageReaderWorker()
+{
+    StopAndWait();
+
+    delete Thread;
+    Thread = nullptr;
+
+    FPlatformProcess::ReturnSynchEventToPool(ThreadSemaphore);
+    ThreadSemaphore = nullptr;
+}
+
+void FRuntimeImageReaderWorker::Trigger()
+{
+    ThreadSemaphore->Trigger();
+}
+
+void FRuntimeImageReaderWorker::StopAndWait()
+{
+    if (Thread == nullptr)
+    {
+        return;
+    }
+
+    Stop();
+    Thread->WaitForCompletion();
+}
+
+bool FRuntimeImageReaderWorker::Init()
+{
+    return true;
+}
+
+uint32 FRuntimeImageReaderWorker::Run()
+{
+    while (!bStopThread)
+    {
+        ThreadSemaphore->Wait();
+
+        Reader->ProcessRequests();
+    }
+
+    return 0;
+}
+
+void FRuntimeImageReaderWorker::Stop()
+{
+    bStopThread = true;
+    Trigger();
+}
+
+void FRuntimeImageReaderWorker::Exit()
+{
+    //
+}
@@ -0,0 +1,40 @@
+// Copyright 2022 Peter Leontev. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/Runnable.h"
+#include "HAL/ThreadSafeBool.h"
+
+class URuntimeImageReader;
+class FRunnableThread;
+class FEvent;
+
+/**
+ * Dedicated thread of the image reader pool. Sleeps until triggered and then drains pending image requests.
+ */
+class FRuntimeImageReaderWorker : public FRunnable
+{
+public:
+    FRuntimeImageReaderWorker(URuntimeImageReader* InReader, int32 InWorkerIndex);
+    virtual ~FRuntimeImageReaderWorker();
+
+    void Trigger();
+    void StopAndWait();
+
+protected:
+    /* FRunnable interface */
+    bool Init() override;
+    uint32 Run() override;
+    void Stop() override;
+    void Exit() override;
+    /* ~FRunnable interface */
+
+private:
+    URuntimeImageReader* Reader = nullptr;
+
+    FRunnableThread* Thread = nullptr;
+    FEvent* ThreadSemaphore = nullptr;
+
+    FThreadSafeBool bStopThread = false;
+};
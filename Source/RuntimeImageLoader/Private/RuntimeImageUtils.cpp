@@ -21,6 +21,9 @@
 #include "Helpers/PNGHelpers.h"
 #include "Helpers/TIFFLoader.h"
 #include "Helpers/QOIHelpers.h"
+#include "Helpers/JPEGLoader.h"
+#include "Helpers/ScaledDecodeHelpers.h"
+#include "RuntimeImageLoaderStats.h"
 
 
 namespace FRuntimeImageUtils
@@ -57,337 +60,712 @@ namespace FRuntimeImageUtils
         return bValid;
     }
 
-    bool ImportBufferAsImage(const uint8* Buffer, int32 Length, FRuntimeImageData& OutImage, FString& OutError)
+    bool IsTGAHeaderValid(const uint8* Buffer, int32 Length)
     {
-        QUICK_SCOPE_CYCLE_COUNTER(STAT_EvoImageUtils_ImportFileAsTexture_ImportBufferAsImage);
-        
-        IImageWrapperModule& ImageWrapperModule = FModuleManager::LoadModuleChecked<IImageWrapperModule>(FName("ImageWrapper"));
+        const FTGAHelpers::FTGAFileHeader* TGA = (FTGAHelpers::FTGAFileHeader*)Buffer;
+        return Length >= sizeof(FTGAHelpers::FTGAFileHeader) &&
+            ((TGA->ColorMapType == 0 && TGA->ImageTypeCode == 2) ||
+            // ImageTypeCode 3 is greyscale
+            (TGA->ColorMapType == 0 && TGA->ImageTypeCode == 3) ||
+            (TGA->ColorMapType == 0 && TGA->ImageTypeCode == 10) ||
+            (TGA->ColorMapType == 1 && TGA->ImageTypeCode == 1 && TGA->BitsPerPixel == 8));
+    }
 
-        //
-        // PNG
-        //
-        // PNG support both 8 and 16 bit depth images (24 and 48 bits per pixel respectively or 32 and 64 bits when alpha channel is used) 
-        TSharedPtr<IImageWrapper> PngImageWrapper = ImageWrapperModule.CreateImageWrapper(EImageFormat::PNG);
-        if (PngImageWrapper.IsValid() && PngImageWrapper->SetCompressed(Buffer, Length))
+    ERuntimeImageFormat DetectImageFormat(const uint8* Buffer, int32 Length)
+    {
+        SCOPE_RUNTIME_IMAGE_CYCLE_COUNTER(STAT_RuntimeImageLoader_SniffFormat);
+
+        auto HasSignature = [Buffer, Length](const uint8* Signature, int32 SignatureLength)
         {
-            if (!IsImportResolutionValid(PngImageWrapper->GetWidth(), PngImageWrapper->GetHeight(), true))
-            {
-                OutError = FString::Printf(TEXT("Texture resolution is not supported: %d x %d"), PngImageWrapper->GetWidth(), PngImageWrapper->GetHeight());
-                return false;
-            }
+            return Length >= SignatureLength && FMemory::Memcmp(Buffer, Signature, SignatureLength) == 0;
+        };
+
+        static const uint8 PNGSignature[] = { 0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A };
+        static const uint8 JPEGSignature[] = { 0xFF, 0xD8, 0xFF };
+        static const uint8 BMPSignature[] = { 'B', 'M' };
+        static const uint8 EXRSignature[] = { 0x76, 0x2F, 0x31, 0x01 };
+        static const uint8 TIFFLESignature[] = { 'I', 'I', 0x2A, 0x00 };
+        static const uint8 TIFFBESignature[] = { 'M', 'M', 0x00, 0x2A };
+        static const uint8 QOISignature[] = { 'q', 'o', 'i', 'f' };
+
+        if (Buffer == nullptr)
+        {
+            return ERuntimeImageFormat::Unknown;
+        }
 
-            // Select the texture's source format
-            ETextureSourceFormat TextureFormat = TSF_Invalid;
-            int32 BitDepth = PngImageWrapper->GetBitDepth();
-            ERGBFormat Format = PngImageWrapper->GetFormat();
+        if (HasSignature(PNGSignature, sizeof(PNGSignature)))
+        {
+            return ERuntimeImageFormat::PNG;
+        }
 
-            if (Format == ERGBFormat::Gray)
-            {
-                if (BitDepth <= 8)
-                {
-                    TextureFormat = TSF_G8;
-                    Format = ERGBFormat::Gray;
-                    BitDepth = 8;
-                }
-                else if (BitDepth == 16)
-                {
-                    // TODO: TSF_G16?
-                    TextureFormat = TSF_RGBA16;
-                    Format = ERGBFormat::RGBA;
-                    BitDepth = 16;
-                }
-            }
-            else if (Format == ERGBFormat::RGBA || Format == ERGBFormat::BGRA)
-            {
-                if (BitDepth <= 8)
-                {
-                    TextureFormat = TSF_BGRA8;
-                    Format = ERGBFormat::BGRA;
-                    BitDepth = 8;
-                }
-                else if (BitDepth == 16)
-                {
-                    TextureFormat = TSF_RGBA16;
-                    Format = ERGBFormat::RGBA;
-                    BitDepth = 16;
-                }
-            }
+        if (HasSignature(JPEGSignature, sizeof(JPEGSignature)))
+        {
+            return ERuntimeImageFormat::JPEG;
+        }
+
+        if (HasSignature(BMPSignature, sizeof(BMPSignature)))
+        {
+            return ERuntimeImageFormat::BMP;
+        }
 
-            if (BitDepth > 16)
+        if (HasSignature(EXRSignature, sizeof(EXRSignature)))
+        {
+            return ERuntimeImageFormat::EXR;
+        }
+
+        if (HasSignature(TIFFLESignature, sizeof(TIFFLESignature)) || HasSignature(TIFFBESignature, sizeof(TIFFBESignature)))
+        {
+            return ERuntimeImageFormat::TIFF;
+        }
+
+        if (HasSignature(QOISignature, sizeof(QOISignature)))
+        {
+            return ERuntimeImageFormat::QOI;
+        }
+
+        // TGA has no signature. Must be the last one
+        if (IsTGAHeaderValid(Buffer, Length))
+        {
+            return ERuntimeImageFormat::TGA;
+        }
+
+        return ERuntimeImageFormat::Unknown;
+    }
+
+    uint32 ReadBigEndian32(const uint8* Data)
+    {
+        return ((uint32)Data[0] << 24) | ((uint32)Data[1] << 16) | ((uint32)Data[2] << 8) | (uint32)Data[3];
+    }
+
+    uint16 ReadBigEndian16(const uint8* Data)
+    {
+        return (uint16)((Data[0] << 8) | Data[1]);
+    }
+
+    bool ReadJPEGSize(const uint8* Buffer, int32 Length, int32& OutWidth, int32& OutHeight)
+    {
+        // walk marker segments till the start of frame one
+        int32 Offset = 2;
+        while (Offset + 9 <= Length)
+        {
+            if (Buffer[Offset] != 0xFF)
             {
-                OutError = TEXT("Only 8 and 16 bit depth PNG images are currently supported.");
                 return false;
             }
 
-            TArray<uint8> RawPNG;
-            if (PngImageWrapper->GetRaw(Format, BitDepth, RawPNG))
+            const uint8 Marker = Buffer[Offset + 1];
+            if (Marker == 0xFF)
             {
-                OutImage.Init2D(
-                    PngImageWrapper->GetWidth(),
-                    PngImageWrapper->GetHeight(),
-                    TextureFormat,
-                    RawPNG.GetData()
-                );
-                OutImage.SRGB = BitDepth < 16;
-                OutImage.GammaSpace = OutImage.SRGB ? EGammaSpace::sRGB : EGammaSpace::Linear; 
-
-                FPNGHelpers::FillZeroAlphaPNGData(OutImage.SizeX, OutImage.SizeY, OutImage.TextureSourceFormat, OutImage.RawData.GetData());
+                // fill byte
+                ++Offset;
+                continue;
             }
-            else
+
+            const bool bIsStartOfFrame = Marker >= 0xC0 && Marker <= 0xCF && Marker != 0xC4 && Marker != 0xC8 && Marker != 0xCC;
+            if (bIsStartOfFrame)
             {
-                OutError = FString::Printf(TEXT("Failed to decode PNG. Bit depth: %d"), BitDepth);
-                return false;
+                OutHeight = ReadBigEndian16(Buffer + Offset + 5);
+                OutWidth = ReadBigEndian16(Buffer + Offset + 7);
+                return true;
             }
 
-            return true;
+            Offset += 2 + ReadBigEndian16(Buffer + Offset + 2);
         }
 
-        //
-        // JPEG
-        //
-        // JPEG can only be 8-bit depth
+        return false;
+    }
 
-        TSharedPtr<IImageWrapper> JpegImageWrapper = ImageWrapperModule.CreateImageWrapper(EImageFormat::JPEG);
-        if (JpegImageWrapper.IsValid() && JpegImageWrapper->SetCompressed(Buffer, Length))
-        {
-            if (!IsImportResolutionValid(JpegImageWrapper->GetWidth(), JpegImageWrapper->GetHeight(), true))
-            {
-                OutError = FString::Printf(TEXT("Texture resolution is not supported: %d x %d"), JpegImageWrapper->GetWidth(), JpegImageWrapper->GetHeight());
-                return false;
-            }
+    int64 EstimateDecodedSize(const uint8* Buffer, int32 Length, ERuntimeImageFormat FormatHint)
+    {
+        const ERuntimeImageFormat ImageFormat = (FormatHint == ERuntimeImageFormat::Auto) ? DetectImageFormat(Buffer, Length) : FormatHint;
 
-            // Select the texture's source format
-            ETextureSourceFormat TextureFormat = TSF_Invalid;
-            int32 BitDepth = JpegImageWrapper->GetBitDepth();
-            ERGBFormat Format = JpegImageWrapper->GetFormat();
+        int32 Width = 0;
+        int32 Height = 0;
+        int32 BytesPerPixel = 4;
 
-            if (Format == ERGBFormat::Gray)
+        switch (ImageFormat)
+        {
+            case ERuntimeImageFormat::PNG:
             {
-                if (BitDepth <= 8)
+                // IHDR is always the first chunk
+                if (Length >= 25)
                 {
-                    TextureFormat = TSF_G8;
-                    Format = ERGBFormat::Gray;
-                    BitDepth = 8;
+                    Width = ReadBigEndian32(Buffer + 16);
+                    Height = ReadBigEndian32(Buffer + 20);
+                    BytesPerPixel = Buffer[24] > 8 ? 8 : 4;
                 }
+                break;
+            }
+            case ERuntimeImageFormat::JPEG:
+            {
+                ReadJPEGSize(Buffer, Length, Width, Height);
+                break;
             }
-            else if (Format == ERGBFormat::RGBA)
+            case ERuntimeImageFormat::BMP:
             {
-                if (BitDepth <= 8)
+                if (Length >= 26)
                 {
-                    TextureFormat = TSF_BGRA8;
-                    Format = ERGBFormat::BGRA;
-                    BitDepth = 8;
+                    Width = FMath::Abs((int32)FPlatformMemory::ReadUnaligned<uint32>(Buffer + 18));
+                    Height = FMath::Abs((int32)FPlatformMemory::ReadUnaligned<uint32>(Buffer + 22));
                 }
+                break;
             }
-
-            if (TextureFormat == TSF_Invalid)
+            case ERuntimeImageFormat::TGA:
             {
-                OutError = FString::Printf(TEXT("JPEG file contains data in an unsupported format. Bit depth: %d"), BitDepth);
-                return false;
+                if (Length >= 16)
+                {
+                    Width = Buffer[12] | (Buffer[13] << 8);
+                    Height = Buffer[14] | (Buffer[15] << 8);
+                }
+                break;
             }
-
-            TArray<uint8> RawJPEG;
-            if (JpegImageWrapper->GetRaw(Format, BitDepth, RawJPEG))
+            case ERuntimeImageFormat::QOI:
             {
-                OutImage.Init2D(
-                    JpegImageWrapper->GetWidth(),
-                    JpegImageWrapper->GetHeight(),
-                    TextureFormat,
-                    RawJPEG.GetData()
-                );
-                OutImage.SRGB = true;
-                OutImage.GammaSpace = OutImage.SRGB ? EGammaSpace::sRGB : EGammaSpace::Linear;
+                if (Length >= 12)
+                {
+                    Width = ReadBigEndian32(Buffer + 4);
+                    Height = ReadBigEndian32(Buffer + 8);
+                }
+                break;
             }
-            else
+            default:
             {
-                OutError = TEXT("Failed to decode JPEG. Please contact devs");
-                return false;
+                break;
             }
+        }
 
+        const int64 DecodedSize = (Width > 0 && Height > 0) ? (int64)Width * Height * BytesPerPixel : (int64)Length * 4;
+        return DecodedSize * 2;
+    }
+
+    //
+    // PNG
+    //
+    // PNG support both 8 and 16 bit depth images (24 and 48 bits per pixel respectively or 32 and 64 bits when alpha channel is used) 
+    bool ImportPNG(const uint8* Buffer, int32 Length, FRuntimeImageData& OutImage, FString& OutError, const FRuntimeImageDecodeHints& DecodeHints)
+    {
+        SCOPE_RUNTIME_IMAGE_CYCLE_COUNTER(STAT_RuntimeImageLoader_DecodePNG);
+
+        IImageWrapperModule& ImageWrapperModule = FModuleManager::LoadModuleChecked<IImageWrapperModule>(FName("ImageWrapper"));
+
+        TSharedPtr<IImageWrapper> PngImageWrapper = ImageWrapperModule.CreateImageWrapper(EImageFormat::PNG);
+        if (!PngImageWrapper.IsValid() || !PngImageWrapper->SetCompressed(Buffer, Length))
+        {
+            OutError = TEXT("Failed to parse PNG header");
+            return false;
+        }
+
+        FIntRect DecodeRegion;
+        int32 DecodeScale = 1;
+        if (FScaledDecodeHelpers::GetDecodeRegion(DecodeHints, PngImageWrapper->GetWidth(), PngImageWrapper->GetHeight(), 8, DecodeRegion, DecodeScale) &&
+            IsImportResolutionValid(FMath::DivideAndRoundUp(DecodeRegion.Width(), DecodeScale), FMath::DivideAndRoundUp(DecodeRegion.Height(), DecodeScale), true) &&
+            FPNGHelpers::DecodeScaled(Buffer, Length, DecodeRegion, DecodeScale, OutImage))
+        {
             return true;
         }
 
-        //
-        // BMP
-        //
-        TSharedPtr<IImageWrapper> BmpImageWrapper = ImageWrapperModule.CreateImageWrapper(EImageFormat::BMP);
-        if (BmpImageWrapper.IsValid() && BmpImageWrapper->SetCompressed(Buffer, Length))
+        if (!IsImportResolutionValid(PngImageWrapper->GetWidth(), PngImageWrapper->GetHeight(), true))
+        {
+            OutError = FString::Printf(TEXT("Texture resolution is not supported: %d x %d"), PngImageWrapper->GetWidth(), PngImageWrapper->GetHeight());
+            return false;
+        }
+
+        // Select the texture's source format
+        ETextureSourceFormat TextureFormat = TSF_Invalid;
+        int32 BitDepth = PngImageWrapper->GetBitDepth();
+        ERGBFormat Format = PngImageWrapper->GetFormat();
+
+        if (Format == ERGBFormat::Gray)
         {
-            // Check the resolution of the imported texture to ensure validity
-            if (!IsImportResolutionValid(BmpImageWrapper->GetWidth(), BmpImageWrapper->GetHeight(), true))
+            if (BitDepth <= 8)
             {
-                OutError = FString::Printf(TEXT("Texture resolution is not supported: %d x %d"), BmpImageWrapper->GetWidth(), BmpImageWrapper->GetHeight());
-                return false;
+                TextureFormat = TSF_G8;
+                Format = ERGBFormat::Gray;
+                BitDepth = 8;
             }
-
-            TArray<uint8> RawBMP;
-            if (BmpImageWrapper->GetRaw(BmpImageWrapper->GetFormat(), BmpImageWrapper->GetBitDepth(), RawBMP))
+            else if (BitDepth == 16)
+            {
+                // single channel keeps a quarter of the memory RGBA16 expansion would take
+                TextureFormat = TSF_G16;
+                Format = ERGBFormat::Gray;
+                BitDepth = 16;
+            }
+        }
+        else if (Format == ERGBFormat::RGBA || Format == ERGBFormat::BGRA)
+        {
+            if (BitDepth <= 8)
             {
-                // Set texture properties.
-                OutImage.Init2D(
-                    BmpImageWrapper->GetWidth(),
-                    BmpImageWrapper->GetHeight(),
-                    TSF_BGRA8,
-                    RawBMP.GetData()
-                );
-                
-                OutImage.SRGB = true;
-                OutImage.GammaSpace = OutImage.SRGB ? EGammaSpace::sRGB : EGammaSpace::Linear;
+                TextureFormat = TSF_BGRA8;
+                Format = ERGBFormat::BGRA;
+                BitDepth = 8;
             }
-            else
+            else if (BitDepth == 16)
             {
-                OutError = FString::Printf(TEXT("Failed to decode BMP. Bit depth: %d"), BmpImageWrapper->GetBitDepth());
-                return false;
+                TextureFormat = TSF_RGBA16;
+                Format = ERGBFormat::RGBA;
+                BitDepth = 16;
             }
+        }
 
+        if (BitDepth > 16)
+        {
+            OutError = TEXT("Only 8 and 16 bit depth PNG images are currently supported.");
+            return false;
+        }
+
+        // decode straight into image data
+        FRuntimeImageRawData RawPNG;
+        if (!PngImageWrapper->GetRaw(Format, BitDepth, RawPNG))
+        {
+            OutError = FString::Printf(TEXT("Failed to decode PNG. Bit depth: %d"), BitDepth);
+            return false;
+        }
+
+        if (!OutImage.Init2D(
+            PngImageWrapper->GetWidth(),
+            PngImageWrapper->GetHeight(),
+            TextureFormat,
+            MoveTemp(RawPNG)
+        ))
+        {
+            OutError = TEXT("Decoded PNG pixels do not match image size");
+            return false;
+        }
+        OutImage.SRGB = BitDepth < 16;
+        OutImage.GammaSpace = OutImage.SRGB ? EGammaSpace::sRGB : EGammaSpace::Linear; 
+
+        FPNGHelpers::FillZeroAlphaPNGData(OutImage.SizeX, OutImage.SizeY, OutImage.TextureSourceFormat, OutImage.RawData.GetData());
+
+        return true;
+    }
+
+    //
+    // JPEG
+    //
+    // JPEG can only be 8-bit depth
+    bool ImportScaledJPEG(const uint8* Buffer, int32 Length, int32 Width, int32 Height, const FIntRect& Region, int32 Scale, FRuntimeImageData& OutImage)
+    {
+#if WITH_FREEIMAGE_LIB
+        FRuntimeJpegLoadHelper JpegLoadHelper;
+        if (!JpegLoadHelper.IsValid() || !JpegLoadHelper.Load(Buffer, Length, FMath::Max(Width, Height) / Scale))
+        {
+            return false;
+        }
+
+        // libjpeg rounds scaled size up, region is mapped to decoded pixels the same way
+        const FIntRect ScaledRegion(
+            (int32)((int64)Region.Min.X * JpegLoadHelper.Width / Width),
+            (int32)((int64)Region.Min.Y * JpegLoadHelper.Height / Height),
+            (int32)FMath::DivideAndRoundUp<int64>((int64)Region.Max.X * JpegLoadHelper.Width, Width),
+            (int32)FMath::DivideAndRoundUp<int64>((int64)Region.Max.Y * JpegLoadHelper.Height, Height)
+        );
+
+        if (ScaledRegion.Area() <= 0 || !IsImportResolutionValid(ScaledRegion.Width(), ScaledRegion.Height(), true))
+        {
+            return false;
+        }
+
+        if (!OutImage.Init2D(
+            JpegLoadHelper.Width,
+            JpegLoadHelper.Height,
+            JpegLoadHelper.TextureSourceFormat,
+            MoveTemp(JpegLoadHelper.RawData)
+        ))
+        {
+            return false;
+        }
+
+        if (ScaledRegion != FIntRect(0, 0, OutImage.SizeX, OutImage.SizeY))
+        {
+            FScaledDecodeHelpers::CropImage(OutImage, ScaledRegion);
+        }
+
+        OutImage.SourceRect = Region;
+        OutImage.SRGB = true;
+        OutImage.GammaSpace = EGammaSpace::sRGB;
+
+        return true;
+#else
+        return false;
+#endif // WITH_FREEIMAGE_LIB
+    }
+
+    bool ImportJPEG(const uint8* Buffer, int32 Length, FRuntimeImageData& OutImage, FString& OutError, const FRuntimeImageDecodeHints& DecodeHints)
+    {
+        SCOPE_RUNTIME_IMAGE_CYCLE_COUNTER(STAT_RuntimeImageLoader_DecodeJPEG);
+
+        IImageWrapperModule& ImageWrapperModule = FModuleManager::LoadModuleChecked<IImageWrapperModule>(FName("ImageWrapper"));
+
+        TSharedPtr<IImageWrapper> JpegImageWrapper = ImageWrapperModule.CreateImageWrapper(EImageFormat::JPEG);
+        if (!JpegImageWrapper.IsValid() || !JpegImageWrapper->SetCompressed(Buffer, Length))
+        {
+            OutError = TEXT("Failed to parse JPEG header");
+            return false;
+        }
+
+        // only shrinking skips work of JPEG decoder, crop alone is left to transform stage
+        FIntRect DecodeRegion;
+        int32 DecodeScale = 1;
+        if (FScaledDecodeHelpers::GetDecodeRegion(DecodeHints, JpegImageWrapper->GetWidth(), JpegImageWrapper->GetHeight(), 8, DecodeRegion, DecodeScale) && DecodeScale > 1 &&
+            ImportScaledJPEG(Buffer, Length, JpegImageWrapper->GetWidth(), JpegImageWrapper->GetHeight(), DecodeRegion, DecodeScale, OutImage))
+        {
             return true;
         }
-       
-        //
-        // TGA
-        //
-        // Support for alpha stored as pseudo-color 8-bit TGA
-        const FTGAHelpers::FTGAFileHeader* TGA = (FTGAHelpers::FTGAFileHeader*)Buffer;
-        if (Length >= sizeof(FTGAHelpers::FTGAFileHeader) &&
-            ((TGA->ColorMapType == 0 && TGA->ImageTypeCode == 2) ||
-            // ImageTypeCode 3 is greyscale
-            (TGA->ColorMapType == 0 && TGA->ImageTypeCode == 3) ||
-            (TGA->ColorMapType == 0 && TGA->ImageTypeCode == 10) ||
-            (TGA->ColorMapType == 1 && TGA->ImageTypeCode == 1 && TGA->BitsPerPixel == 8))
-            )
+
+        if (!IsImportResolutionValid(JpegImageWrapper->GetWidth(), JpegImageWrapper->GetHeight(), true))
+        {
+            OutError = FString::Printf(TEXT("Texture resolution is not supported: %d x %d"), JpegImageWrapper->GetWidth(), JpegImageWrapper->GetHeight());
+            return false;
+        }
+
+        // Select the texture's source format
+        ETextureSourceFormat TextureFormat = TSF_Invalid;
+        int32 BitDepth = JpegImageWrapper->GetBitDepth();
+        ERGBFormat Format = JpegImageWrapper->GetFormat();
+
+        if (Format == ERGBFormat::Gray)
         {
-            // Check the resolution of the imported texture to ensure validity
-            if (!IsImportResolutionValid(TGA->Width, TGA->Height, true))
+            if (BitDepth <= 8)
             {
-                OutError = FString::Printf(TEXT("Texture resolution is not supported: %d x %d"), TGA->Width, TGA->Height);
-                return false;
+                TextureFormat = TSF_G8;
+                Format = ERGBFormat::Gray;
+                BitDepth = 8;
             }
-
-            const bool bResult = FTGAHelpers::DecompressTGA(TGA, OutImage, OutError);
-            if (bResult)
+        }
+        else if (Format == ERGBFormat::RGBA)
+        {
+            if (BitDepth <= 8)
             {
-                if (OutImage.CompressionSettings == TC_Grayscale && TGA->ImageTypeCode == 3)
-                {
-                    // default grayscales to linear as they wont get compression otherwise and are commonly used as masks
-                    OutImage.SRGB = false;
-                    
-                }
-
-                OutImage.GammaSpace = OutImage.SRGB ? EGammaSpace::sRGB : EGammaSpace::Linear;
+                TextureFormat = TSF_BGRA8;
+                Format = ERGBFormat::BGRA;
+                BitDepth = 8;
             }
-            else
+        }
+
+        if (TextureFormat == TSF_Invalid)
+        {
+            OutError = FString::Printf(TEXT("JPEG file contains data in an unsupported format. Bit depth: %d"), BitDepth);
+            return false;
+        }
+
+        // decode straight into image data
+        FRuntimeImageRawData RawJPEG;
+        if (!JpegImageWrapper->GetRaw(Format, BitDepth, RawJPEG))
+        {
+            OutError = TEXT("Failed to decode JPEG. Please contact devs");
+            return false;
+        }
+
+        if (!OutImage.Init2D(
+            JpegImageWrapper->GetWidth(),
+            JpegImageWrapper->GetHeight(),
+            TextureFormat,
+            MoveTemp(RawJPEG)
+        ))
+        {
+            OutError = TEXT("Decoded JPEG pixels do not match image size");
+            return false;
+        }
+        OutImage.SRGB = true;
+        OutImage.GammaSpace = OutImage.SRGB ? EGammaSpace::sRGB : EGammaSpace::Linear;
+
+        return true;
+    }
+
+    //
+    // BMP
+    //
+    bool ImportBMP(const uint8* Buffer, int32 Length, FRuntimeImageData& OutImage, FString& OutError)
+    {
+        SCOPE_RUNTIME_IMAGE_CYCLE_COUNTER(STAT_RuntimeImageLoader_DecodeBMP);
+
+        IImageWrapperModule& ImageWrapperModule = FModuleManager::LoadModuleChecked<IImageWrapperModule>(FName("ImageWrapper"));
+
+        TSharedPtr<IImageWrapper> BmpImageWrapper = ImageWrapperModule.CreateImageWrapper(EImageFormat::BMP);
+        if (!BmpImageWrapper.IsValid() || !BmpImageWrapper->SetCompressed(Buffer, Length))
+        {
+            OutError = TEXT("Failed to parse BMP header");
+            return false;
+        }
+
+        // Check the resolution of the imported texture to ensure validity
+        if (!IsImportResolutionValid(BmpImageWrapper->GetWidth(), BmpImageWrapper->GetHeight(), true))
+        {
+            OutError = FString::Printf(TEXT("Texture resolution is not supported: %d x %d"), BmpImageWrapper->GetWidth(), BmpImageWrapper->GetHeight());
+            return false;
+        }
+
+        // decode straight into image data
+        FRuntimeImageRawData RawBMP;
+        if (!BmpImageWrapper->GetRaw(BmpImageWrapper->GetFormat(), BmpImageWrapper->GetBitDepth(), RawBMP))
+        {
+            OutError = FString::Printf(TEXT("Failed to decode BMP. Bit depth: %d"), BmpImageWrapper->GetBitDepth());
+            return false;
+        }
+
+        // Set texture properties.
+        if (!OutImage.Init2D(
+            BmpImageWrapper->GetWidth(),
+            BmpImageWrapper->GetHeight(),
+            TSF_BGRA8,
+            MoveTemp(RawBMP)
+        ))
+        {
+            OutError = TEXT("Decoded BMP pixels do not match image size");
+            return false;
+        }
+
+        OutImage.SRGB = true;
+        OutImage.GammaSpace = OutImage.SRGB ? EGammaSpace::sRGB : EGammaSpace::Linear;
+
+        return true;
+    }
+
+    //
+    // TGA
+    //
+    // Support for alpha stored as pseudo-color 8-bit TGA
+    bool ImportTGA(const uint8* Buffer, int32 Length, FRuntimeImageData& OutImage, FString& OutError)
+    {
+        SCOPE_RUNTIME_IMAGE_CYCLE_COUNTER(STAT_RuntimeImageLoader_DecodeTGA);
+
+        if (!IsTGAHeaderValid(Buffer, Length))
+        {
+            OutError = TEXT("TGA header is not supported");
+            return false;
+        }
+
+        const FTGAHelpers::FTGAFileHeader* TGA = (FTGAHelpers::FTGAFileHeader*)Buffer;
+
+        // Check the resolution of the imported texture to ensure validity
+        if (!IsImportResolutionValid(TGA->Width, TGA->Height, true))
+        {
+            OutError = FString::Printf(TEXT("Texture resolution is not supported: %d x %d"), TGA->Width, TGA->Height);
+            return false;
+        }
+
+        if (!FTGAHelpers::DecompressTGA(TGA, OutImage, OutError))
+        {
+            if (OutError.IsEmpty())
             {
                 OutError = TEXT("Failed to decompress TGA. Please contact devs");
-                return false;
             }
+            return false;
         }
 
+        if (OutImage.CompressionSettings == TC_Grayscale && TGA->ImageTypeCode == 3)
+        {
+            // default grayscales to linear as they wont get compression otherwise and are commonly used as masks
+            OutImage.SRGB = false;
+        }
+
+        OutImage.GammaSpace = OutImage.SRGB ? EGammaSpace::sRGB : EGammaSpace::Linear;
+
+        return true;
+    }
+
+    //
+    // OpenEXR
+    //
+    bool ImportEXR(const uint8* Buffer, int32 Length, FRuntimeImageData& OutImage, FString& OutError)
+    {
+        SCOPE_RUNTIME_IMAGE_CYCLE_COUNTER(STAT_RuntimeImageLoader_DecodeEXR);
+
+        IImageWrapperModule& ImageWrapperModule = FModuleManager::LoadModuleChecked<IImageWrapperModule>(FName("ImageWrapper"));
 
-        //
-        // OpenEXR
-        //
         TSharedPtr<IImageWrapper> ExrImageWrapper = ImageWrapperModule.CreateImageWrapper(EImageFormat::EXR);
-        if (ExrImageWrapper.IsValid() && ExrImageWrapper->SetCompressed(Buffer, Length))
+        if (!ExrImageWrapper.IsValid() || !ExrImageWrapper->SetCompressed(Buffer, Length))
         {
-            int32 Width = ExrImageWrapper->GetWidth();
-            int32 Height = ExrImageWrapper->GetHeight();
+            OutError = TEXT("Failed to parse EXR header");
+            return false;
+        }
 
-            if (!IsImportResolutionValid(Width, Height, true))
-            {
-                return false;
-            }
+        int32 Width = ExrImageWrapper->GetWidth();
+        int32 Height = ExrImageWrapper->GetHeight();
 
-            // Select the texture's source format
-            ETextureSourceFormat TextureFormat = TSF_Invalid;
-            int32 BitDepth = ExrImageWrapper->GetBitDepth();
-            ERGBFormat Format = ExrImageWrapper->GetFormat();
+        if (!IsImportResolutionValid(Width, Height, true))
+        {
+            OutError = FString::Printf(TEXT("Texture resolution is not supported: %d x %d"), Width, Height);
+            return false;
+        }
 
-            if (Format == ERGBFormat::RGBA && BitDepth == 16)
-            {
-                TextureFormat = TSF_RGBA16F;
-                Format = ERGBFormat::BGRA;
-            }
+        // Select the texture's source format
+        ETextureSourceFormat TextureFormat = TSF_Invalid;
+        int32 BitDepth = ExrImageWrapper->GetBitDepth();
+        ERGBFormat Format = ExrImageWrapper->GetFormat();
 
-            if (TextureFormat == TSF_Invalid)
-            {
-                OutError = TEXT("EXR file contains data in an unsupported format.");
-                return false;
-            }
+        if (Format == ERGBFormat::RGBA && (BitDepth == 16 || BitDepth == 32))
+        {
+            // full float channels are narrowed to half by OpenEXR while decoding, there is no 32 bit float pipeline
+            TextureFormat = TSF_RGBA16F;
+            Format = ERGBFormat::BGRA;
+            BitDepth = 16;
+        }
 
-            TArray<uint8> RawExr;
-            if (ExrImageWrapper->GetRaw(Format, BitDepth, RawExr))
-            {
-                OutImage.Init2D(
-                    Width,
-                    Height,
-                    TextureFormat,
-                    RawExr.GetData()
-                );
-
-                OutImage.SRGB = false;
-                OutImage.GammaSpace = OutImage.SRGB ? EGammaSpace::sRGB : EGammaSpace::Linear;
-                OutImage.CompressionSettings = TC_HDR;
-            }
-            else
-            {
-                OutError = FString::Printf(TEXT("Failed to decode EXR. Bit depth: %d"), BitDepth);
-                return false;
-            }
+        if (TextureFormat == TSF_Invalid)
+        {
+            OutError = TEXT("EXR file contains data in an unsupported format.");
+            return false;
+        }
 
-            return true;
+        // decode straight into image data
+        FRuntimeImageRawData RawExr;
+        if (!ExrImageWrapper->GetRaw(Format, BitDepth, RawExr))
+        {
+            OutError = FString::Printf(TEXT("Failed to decode EXR. Bit depth: %d"), BitDepth);
+            return false;
         }
 
-        //
-        // TIFF
-        //
+        if (!OutImage.Init2D(
+            Width,
+            Height,
+            TextureFormat,
+            MoveTemp(RawExr)
+        ))
+        {
+            OutError = TEXT("Decoded EXR pixels do not match image size");
+            return false;
+        }
+
+        OutImage.SRGB = false;
+        OutImage.GammaSpace = OutImage.SRGB ? EGammaSpace::sRGB : EGammaSpace::Linear;
+        OutImage.CompressionSettings = TC_HDR;
+
+        return true;
+    }
+
+    //
+    // TIFF
+    //
+    bool ImportTIFF(const uint8* Buffer, int32 Length, FRuntimeImageData& OutImage, FString& OutError)
+    {
+        SCOPE_RUNTIME_IMAGE_CYCLE_COUNTER(STAT_RuntimeImageLoader_DecodeTIFF);
+
 #if WITH_FREEIMAGE_LIB
         FRuntimeTiffLoadHelper TiffLoaderHelper;
-        if (TiffLoaderHelper.IsValid())
+        if (!TiffLoaderHelper.IsValid())
         {
-            if (TiffLoaderHelper.Load(Buffer, Length))
-            {
-                OutImage.Init2D(
-                    TiffLoaderHelper.Width,
-                    TiffLoaderHelper.Height,
-                    TiffLoaderHelper.TextureSourceFormat,
-                    TiffLoaderHelper.RawData.GetData()
-                );
+            OutError = TiffLoaderHelper.GetError();
+            return false;
+        }
 
-                OutImage.SRGB = TiffLoaderHelper.bSRGB;
-                OutImage.GammaSpace = OutImage.SRGB ? EGammaSpace::sRGB : EGammaSpace::Linear;
-                OutImage.CompressionSettings = TiffLoaderHelper.CompressionSettings;
+        if (!TiffLoaderHelper.Load(Buffer, Length))
+        {
+            OutError = TEXT("Failed to decode TIFF");
+            return false;
+        }
 
-                return true;
-            }
+        if (!OutImage.Init2D(
+            TiffLoaderHelper.Width,
+            TiffLoaderHelper.Height,
+            TiffLoaderHelper.TextureSourceFormat,
+            MoveTemp(TiffLoaderHelper.RawData)
+        ))
+        {
+            OutError = TEXT("Decoded TIFF pixels do not match image size");
+            return false;
         }
+
+        OutImage.SRGB = TiffLoaderHelper.bSRGB;
+        OutImage.GammaSpace = OutImage.SRGB ? EGammaSpace::sRGB : EGammaSpace::Linear;
+        OutImage.CompressionSettings = TiffLoaderHelper.CompressionSettings;
+
+        return true;
+#else
+        OutError = TEXT("TIFF is not supported on this platform");
+        return false;
 #endif // WITH_FREEIMAGE_LIB
+    }
+
+    //
+    // QOI
+    //
+    bool ImportQOI(const uint8* Buffer, int32 Length, FRuntimeImageData& OutImage, FString& OutError, const FRuntimeImageDecodeHints& DecodeHints)
+    {
+        SCOPE_RUNTIME_IMAGE_CYCLE_COUNTER(STAT_RuntimeImageLoader_DecodeQOI);
 
-        //
-        // QOI
-        //
         FQOILoader QOILoader;
-        if (QOILoader.IsValidImage(Buffer, Length))
+        if (!QOILoader.IsValidImage(Buffer, Length))
         {
-            if (QOILoader.Load(Buffer, Length))
-            {
-                OutImage.Init2D(
-                    QOILoader.Width,
-                    QOILoader.Height,
-                    QOILoader.TextureSourceFormat,
-                    QOILoader.RawData.GetData()
-                );
-                
-                OutImage.SRGB = QOILoader.bSRGB;
-                OutImage.GammaSpace = OutImage.SRGB ? EGammaSpace::sRGB : EGammaSpace::Linear;
-                OutImage.CompressionSettings = QOILoader.CompressionSettings;
+            OutError = TEXT("Failed to parse QOI header");
+            return false;
+        }
 
-                return true;
-            }
+        // width and height follow the magic
+        const int32 SourceWidth = (Buffer[4] << 24) | (Buffer[5] << 16) | (Buffer[6] << 8) | Buffer[7];
+        const int32 SourceHeight = (Buffer[8] << 24) | (Buffer[9] << 16) | (Buffer[10] << 8) | Buffer[11];
+
+        FIntRect DecodeRegion;
+        int32 DecodeScale = 1;
+        const bool bDecodeScaled = FScaledDecodeHelpers::GetDecodeRegion(DecodeHints, SourceWidth, SourceHeight, 8, DecodeRegion, DecodeScale);
 
+        if (bDecodeScaled ? !QOILoader.LoadScaled(Buffer, Length, DecodeRegion, DecodeScale) : !QOILoader.Load(Buffer, Length))
+        {
             OutError = QOILoader.GetLastError();
+            return false;
+        }
+
+        if (!OutImage.Init2D(
+            QOILoader.Width,
+            QOILoader.Height,
+            QOILoader.TextureSourceFormat,
+            MoveTemp(QOILoader.RawData)
+        ))
+        {
+            OutError = TEXT("Decoded QOI pixels do not match image size");
+            return false;
+        }
+
+        if (bDecodeScaled)
+        {
+            OutImage.SourceRect = DecodeRegion;
+        }
+
+        OutImage.SRGB = QOILoader.bSRGB;
+        OutImage.GammaSpace = OutImage.SRGB ? EGammaSpace::sRGB : EGammaSpace::Linear;
+        OutImage.CompressionSettings = QOILoader.CompressionSettings;
+
+        return true;
+    }
+
+    bool ImportBufferAsImage(const uint8* Buffer, int32 Length, FRuntimeImageData& OutImage, FString& OutError, ERuntimeImageFormat FormatHint, const FRuntimeImageDecodeHints& DecodeHints)
+    {
+        const ERuntimeImageFormat DetectedFormat = (FormatHint == ERuntimeImageFormat::Auto) ? DetectImageFormat(Buffer, Length) : FormatHint;
+
+        auto ImportAs = [Buffer, Length, &OutImage, &OutError, &DecodeHints](ERuntimeImageFormat ImageFormat)
+        {
+            switch (ImageFormat)
+            {
+                case ERuntimeImageFormat::PNG:      return ImportPNG(Buffer, Length, OutImage, OutError, DecodeHints);
+                case ERuntimeImageFormat::JPEG:     return ImportJPEG(Buffer, Length, OutImage, OutError, DecodeHints);
+                case ERuntimeImageFormat::BMP:      return ImportBMP(Buffer, Length, OutImage, OutError);
+                case ERuntimeImageFormat::TGA:      return ImportTGA(Buffer, Length, OutImage, OutError);
+                case ERuntimeImageFormat::EXR:      return ImportEXR(Buffer, Length, OutImage, OutError);
+                case ERuntimeImageFormat::TIFF:     return ImportTIFF(Buffer, Length, OutImage, OutError);
+                case ERuntimeImageFormat::QOI:      return ImportQOI(Buffer, Length, OutImage, OutError, DecodeHints);
+                default:                            break;
+            }
+
+            OutError = FString::Printf(TEXT("Failed to decode image. Not supported format!"));
+            return false;
+        };
+
+        if (ImportAs(DetectedFormat))
+        {
+            return true;
+        }
+
+        // format hint might be wrong
+        if (FormatHint != ERuntimeImageFormat::Auto)
+        {
+            const ERuntimeImageFormat SniffedFormat = DetectImageFormat(Buffer, Length);
+            if (SniffedFormat != FormatHint && SniffedFormat != ERuntimeImageFormat::Unknown)
+            {
+                OutError.Empty();
+                return ImportAs(SniffedFormat);
+            }
         }
 
-        OutError = FString::Printf(TEXT("Failed to decode image. Not supported format!"));
         return false;
     }
 
@@ -406,8 +784,6 @@ namespace FRuntimeImageUtils
         NewTexture->SRGB = ImageData.SRGB;
 
         {
-            QUICK_SCOPE_CYCLE_COUNTER(STAT_RuntimeImageReader_ImportFileAsTexture_NewTexture);
-
             check(IsValid(NewTexture));
 
             FTexturePlatformData* PlatformData = new FTexturePlatformData();
@@ -422,10 +798,13 @@ namespace FRuntimeImageUtils
             PlatformData->SizeY = ImageData.SizeY;
             PlatformData->PixelFormat = ImageData.PixelFormat;
 
-            FTexture2DMipMap* Mip = new FTexture2DMipMap();
-            PlatformData->Mips.Add(Mip);
-            Mip->SizeX = ImageData.SizeX;
-            Mip->SizeY = ImageData.SizeY;
+            for (int32 MipIndex = 0; MipIndex < ImageData.NumMips; ++MipIndex)
+            {
+                FTexture2DMipMap* Mip = new FTexture2DMipMap();
+                PlatformData->Mips.Add(Mip);
+                Mip->SizeX = FMath::Max(1, ImageData.SizeX >> MipIndex);
+                Mip->SizeY = FMath::Max(1, ImageData.SizeY >> MipIndex);
+            }
         }
 
         return NewTexture;
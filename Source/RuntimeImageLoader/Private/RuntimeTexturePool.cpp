@@ -0,0 +1,88 @@
+// Copyright 2022 Peter Leontev. All Rights Reserved.
+
+#include "RuntimeTexturePool.h"
+#include "Engine/Texture2D.h"
+#include "TextureResource.h"
+#include "Launch/Resources/Version.h"
+
+
+DEFINE_LOG_CATEGORY_STATIC(LogRuntimeTexturePool, Log, All);
+
+void URuntimeTexturePool::Initialize(int32 InMaxTextures)
+{
+    MaxTextures = InMaxTextures;
+}
+
+void URuntimeTexturePool::Add(UTexture2D* Texture)
+{
+    check(IsInGameThread());
+
+    if (MaxTextures <= 0 || !IsValid(Texture))
+    {
+        return;
+    }
+
+    // only textures that finished uploading can be overwritten in place
+    const FTextureResource* TextureResource = Texture->GetResource();
+    if (TextureResource == nullptr || !TextureResource->TextureRHI.IsValid())
+    {
+        return;
+    }
+
+    Textures.Remove(Texture);
+    Textures.Add(Texture);
+
+    while (Textures.Num() > MaxTextures)
+    {
+        UE_LOG(LogRuntimeTexturePool, Verbose, TEXT("Texture dropped from pool: %s"), *Textures[0]->GetName());
+        Textures.RemoveAt(0);
+    }
+}
+
+UTexture2D* URuntimeTexturePool::Acquire(const FRuntimeImageData& ImageData)
+{
+    check(IsInGameThread());
+
+    // most recently released textures are most likely to be of the same size as the next images
+    for (int32 TextureIndex = Textures.Num() - 1; TextureIndex >= 0; --TextureIndex)
+    {
+        UTexture2D* Texture = Textures[TextureIndex];
+        if (IsValid(Texture) && CanReuseTexture(Texture, ImageData))
+        {
+            Textures.RemoveAt(TextureIndex);
+            return Texture;
+        }
+    }
+
+    return nullptr;
+}
+
+void URuntimeTexturePool::Empty()
+{
+    Textures.Empty();
+}
+
+bool URuntimeTexturePool::CanReuseTexture(const UTexture2D* Texture, const FRuntimeImageData& ImageData)
+{
+#if ENGINE_MAJOR_VERSION < 5
+    const FTexturePlatformData* PlatformData = Texture->PlatformData;
+#else
+    const FTexturePlatformData* PlatformData = Texture->GetPlatformData();
+#endif
+
+    const FTextureResource* TextureResource = Texture->GetResource();
+    if (PlatformData == nullptr || TextureResource == nullptr || !TextureResource->TextureRHI.IsValid())
+    {
+        return false;
+    }
+
+    // mips built on GPU need a texture that can be rendered to
+    const bool bCanGenerateMips = (TextureResource->TextureRHI->GetFlags() & TexCreate_RenderTargetable) != TexCreate_None;
+
+    return PlatformData->SizeX == ImageData.SizeX &&
+        PlatformData->SizeY == ImageData.SizeY &&
+        PlatformData->PixelFormat == ImageData.PixelFormat &&
+        PlatformData->Mips.Num() == ImageData.NumMips &&
+        Texture->SRGB == ImageData.SRGB &&
+        bCanGenerateMips == ImageData.bGenerateMipsOnGPU;
+}
@@ -5,16 +5,18 @@
 #include "Engine/Texture.h"
 #include "Engine/Texture2D.h"
 #include "RenderResource.h"
+#include "RenderUtils.h"
+
+#include "RuntimeImageLoaderStats.h"
 
 DEFINE_LOG_CATEGORY_STATIC(LogRuntimeTextureResource, Log, All);
 
-FRuntimeTextureResource::FRuntimeTextureResource(UTexture2D* InTexture, FTexture2DRHIRef RHITexture2D)
-: Owner(InTexture), SizeX(RHITexture2D->GetSizeX()), SizeY(RHITexture2D->GetSizeY())
+FRuntimeTextureResource::FRuntimeTextureResource(UTexture2D* InTexture, uint32 InSizeX, uint32 InSizeY, EPixelFormat InPixelFormat, bool bInSRGB)
+: Owner(InTexture), SizeX(InSizeX), SizeY(InSizeY)
 {
-    TextureRHI = RHITexture2D;
-    bSRGB = (TextureRHI->GetFlags() & TexCreate_SRGB) != TexCreate_None;
+    bSRGB = bInSRGB;
     bIgnoreGammaConversions = !bSRGB;
-    bGreyScaleFormat = (TextureRHI->GetFormat() == PF_G8) || (TextureRHI->GetFormat() == PF_BC4);
+    bGreyScaleFormat = (InPixelFormat == PF_G8) || (InPixelFormat == PF_BC4);
 
     UE_LOG(LogRuntimeTextureResource, Verbose, TEXT("RuntimeTextureResource has been created!"))
 }
@@ -49,6 +51,12 @@ void FRuntimeTextureResource::InitRHI()
 
     DeferredPassSamplerStateRHI = GetOrCreateSamplerState(DeferredPassSamplerStateInitializer);
 
+    if (TextureRHI.IsValid())
+    {
+        TextureMemorySize = CalcTextureSize(SizeX, SizeY, TextureRHI->GetFormat(), TextureRHI->GetNumMips());
+        INC_MEMORY_STAT_BY(STAT_RuntimeImageLoader_TextureMemory, TextureMemorySize);
+    }
+
     UE_LOG(LogRuntimeTextureResource, Verbose, TEXT("RuntimeTextureResource RHI has been created!"))
 }
 
@@ -57,5 +65,8 @@ void FRuntimeTextureResource::ReleaseRHI()
     RHIUpdateTextureReference(Owner->TextureReference.TextureReferenceRHI, nullptr);
     FTextureResource::ReleaseRHI();
 
+    DEC_MEMORY_STAT_BY(STAT_RuntimeImageLoader_TextureMemory, TextureMemorySize);
+    TextureMemorySize = 0;
+
     UE_LOG(LogRuntimeTextureResource, Verbose, TEXT("RuntimeTextureResource RHI has been destroyed!"))
 }
@@ -15,7 +15,8 @@ class UTexture2D;
 class FRuntimeTextureResource : public FTextureResource
 {
 public:
-    FRuntimeTextureResource(UTexture2D* InTexture, FTexture2DRHIRef RHITexture2D);
+    /** Texture RHI is assigned on render thread before the resource is initialized */
+    FRuntimeTextureResource(UTexture2D* InTexture, uint32 InSizeX, uint32 InSizeY, EPixelFormat InPixelFormat, bool bInSRGB);
     virtual ~FRuntimeTextureResource();
 
     uint32 GetSizeX() const override { return SizeX; }
@@ -28,4 +29,6 @@ private:
     UTexture2D* Owner;
     uint32 SizeX;
     uint32 SizeY;
+    // reported to texture memory stat
+    int64 TextureMemorySize = 0;
 };
\ No newline at end of file
@@ -3,12 +3,112 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "Async/MappedFileHandle.h"
+
+/** Identify version of the image a cached copy was made from */
+struct FImageCacheValidators
+{
+    FString ETag;
+    FString LastModified;
+
+    bool IsSet() const { return !ETag.IsEmpty() || !LastModified.IsEmpty(); }
+};
+
+struct FImageReadResponse
+{
+    bool bSucceeded = false;
+    // image was not changed since the copy identified by request validators was made, ImageData is empty
+    bool bNotModified = false;
+    TArray<uint8> ImageData;
+    FString Error;
+
+    FImageCacheValidators Validators;
+    // seconds the image can be used without asking the source again
+    int32 MaxAge = 0;
+    // source does not allow to store the image
+    bool bNoStore = false;
+};
+
+/** Called when asynchronous read is finished. Image data is empty on failure */
+typedef TFunction<void(FImageReadResponse&& Response)> FOnImageReadCompleted;
+/** Called with all bytes received so far. Total size is -1 if it's not known */
+typedef TFunction<void(const TArray<uint8>& ReceivedData, int64 TotalSize)> FOnImageReadProgress;
+
+/** Read-only view of image file contents. Either owns the bytes or keeps the file memory mapped */
+class FImageReadBuffer
+{
+public:
+    void SetData(TArray<uint8>&& InData)
+    {
+        Empty();
+        Data = MoveTemp(InData);
+    }
+
+    void SetMappedFile(TUniquePtr<IMappedFileHandle>&& InMappedFile, TUniquePtr<IMappedFileRegion>&& InMappedRegion)
+    {
+        Empty();
+        MappedFile = MoveTemp(InMappedFile);
+        MappedRegion = MoveTemp(InMappedRegion);
+    }
+
+    const uint8* GetData() const { return MappedRegion.IsValid() ? MappedRegion->GetMappedPtr() : Data.GetData(); }
+    int64 Num() const { return MappedRegion.IsValid() ? MappedRegion->GetMappedSize() : Data.Num(); }
+    bool IsMapped() const { return MappedRegion.IsValid(); }
+
+    void Empty()
+    {
+        // region has to be unmapped before its file is closed
+        MappedRegion.Reset();
+        MappedFile.Reset();
+        Data.Empty();
+    }
+
+private:
+    TArray<uint8> Data;
+    TUniquePtr<IMappedFileHandle> MappedFile;
+    TUniquePtr<IMappedFileRegion> MappedRegion;
+};
 
 class IImageReader
 {
 public:
-    virtual bool ReadImage(const FString& ImageURI, TArray<uint8>& OutImageData) = 0;
-    virtual FString GetLastError() const { return TEXT(""); };
+    virtual ~IImageReader() {}
+
+    /** Readers can be shared by concurrent reads, so error is returned per read */
+    virtual bool ReadImage(const FString& ImageURI, TArray<uint8>& OutImageData, FString& OutError) = 0;
+    /** Readers that can avoid copying image contents, e.g. by mapping the file, override this */
+    virtual bool ReadImageBuffer(const FString& ImageURI, FImageReadBuffer& OutBuffer, FString& OutError)
+    {
+        TArray<uint8> ImageData;
+        if (!ReadImage(ImageURI, ImageData, OutError))
+        {
+            return false;
+        }
+
+        OutBuffer.SetData(MoveTemp(ImageData));
+        return true;
+    }
     virtual void Flush() = 0;
     virtual void Cancel() = 0;
+
+    /** Readers that support async reads can keep several reads in flight at once, others fail async reads right away */
+    virtual bool SupportsAsyncRead() const { return false; }
+    /** Validators make the read conditional: image is not read again if it was not changed. Read id identifies the read for CancelRead */
+    virtual void ReadImageAsync(const FString& ImageURI, const FImageCacheValidators& Validators, int32 ReadId, FOnImageReadCompleted OnCompleted)
+    {
+        FImageReadResponse Response;
+        Response.Error = TEXT("Reader does not support async reads");
+        OnCompleted(MoveTemp(Response));
+    }
+    /** Same as ReadImageAsync but image is read in chunks and every chunk is reported as soon as it arrives */
+    virtual void ReadImageProgressive(const FString& ImageURI, const FImageCacheValidators& Validators, int32 ReadId, int32 ChunkSize, FOnImageReadProgress OnProgress, FOnImageReadCompleted OnCompleted)
+    {
+        ReadImageAsync(ImageURI, Validators, ReadId, MoveTemp(OnCompleted));
+    }
+    /** Stops async read with the given id, its completion is called with an error */
+    virtual void CancelRead(int32 ReadId) {}
+    /** Moves async read with the given id ahead of the reads that were not started yet */
+    virtual void PrioritizeRead(int32 ReadId) {}
+    /** Dispatches completions of finished async reads, for callers that block game thread */
+    virtual void Tick() {}
 };
@@ -0,0 +1,106 @@
+// Copyright 2022 Peter Leontev. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/Object.h"
+#include "UObject/WeakObjectPtr.h"
+#include "Containers/List.h"
+
+#include "RuntimeImageData.h"
+#include "RuntimeImageReader.h"
+#include "RuntimeImageCache.generated.h"
+
+
+class UTexture2D;
+
+typedef TDoubleLinkedList<FString> FRuntimeImageCacheLruList;
+
+USTRUCT()
+struct RUNTIMEIMAGELOADER_API FRuntimeImageCacheTextureEntry
+{
+    GENERATED_BODY()
+
+    UPROPERTY()
+    UTexture2D* Texture = nullptr;
+
+    int64 SizeInBytes = 0;
+    // position in URuntimeImageCache::TextureLru, owned by the list
+    FRuntimeImageCacheLruList::TDoubleLinkedListNode* LruNode = nullptr;
+};
+
+struct RUNTIMEIMAGELOADER_API FRuntimeImageCacheDataEntry
+{
+    FRuntimeImageDataPtr ImageData;
+    int64 SizeInBytes = 0;
+    // position in URuntimeImageCache::ImageDataLru, owned by the list
+    FRuntimeImageCacheLruList::TDoubleLinkedListNode* LruNode = nullptr;
+};
+
+/**
+ * Two-level cache of loaded images keyed by image URI and transform params.
+ * Level 1 keeps textures alive till their total size exceeds VRAM budget, least recently used textures are evicted first.
+ * Evicted textures are still returned while something else keeps them alive.
+ * Level 2 keeps transformed pixels in RAM so evicted textures are re-uploaded without reading and decoding the image again.
+ * Game thread only.
+ */
+UCLASS()
+class RUNTIMEIMAGELOADER_API URuntimeImageCache : public UObject
+{
+    GENERATED_BODY()
+
+public:
+    void Initialize(int64 InTextureBudget, int64 InImageDataBudget);
+
+    static FString MakeCacheKey(const FString& ImageFilename, const FTransformImageParams& TransformParams);
+
+    UTexture2D* FindTexture(const FString& CacheKey);
+    void AddTexture(const FString& CacheKey, UTexture2D* Texture);
+    /** Forgets the texture under every key, it's not returned by the cache anymore */
+    void RemoveTexture(const UTexture2D* Texture);
+
+    FRuntimeImageDataPtr FindImageData(const FString& CacheKey);
+    void AddImageData(const FString& CacheKey, FRuntimeImageDataPtr ImageData);
+
+    bool IsImageDataCacheEnabled() const { return ImageDataBudget > 0; }
+
+    void Empty();
+
+    int64 GetTextureCacheSize() const { return TextureCacheSize; }
+    int64 GetImageDataCacheSize() const { return ImageDataCacheSize; }
+
+private:
+    void TrimTextures();
+    void TrimImageData();
+
+    void RemoveTextureEntry(const FString& CacheKey);
+    void RemoveImageDataEntry(const FString& CacheKey);
+    /** Drops evicted textures collected by GC once there are as many of them again as after the last purge */
+    void PurgeEvictedTextures();
+
+    static void MarkUsed(FRuntimeImageCacheLruList& Lru, FRuntimeImageCacheLruList::TDoubleLinkedListNode* Node);
+
+    static int64 GetTextureSize(const UTexture2D* Texture);
+    static int64 GetImageDataSize(const FRuntimeImageData& ImageData);
+
+private:
+    UPROPERTY()
+    TMap<FString, FRuntimeImageCacheTextureEntry> Textures;
+    // textures evicted from level 1 which might be still used by someone
+    TMap<FString, TWeakObjectPtr<UTexture2D>> EvictedTextures;
+
+    // keys of every texture in Textures and EvictedTextures, so a texture is removed without scanning them
+    TMultiMap<TWeakObjectPtr<const UTexture2D>, FString> TextureKeys;
+    int32 NumEvictedAfterPurge = 0;
+
+    TMap<FString, FRuntimeImageCacheDataEntry> ImageDatas;
+
+    // cache keys, most recently used first
+    FRuntimeImageCacheLruList TextureLru;
+    FRuntimeImageCacheLruList ImageDataLru;
+
+    int64 TextureBudget = 0;
+    int64 ImageDataBudget = 0;
+    int64 TextureCacheSize = 0;
+    int64 ImageDataCacheSize = 0;
+};
@@ -7,14 +7,76 @@
 #include "PixelFormat.h"
 #include "ImageCore.h"
 
+/** Image container formats supported by the plugin */
+enum class ERuntimeImageFormat : uint8
+{
+    // detect format from the file signature
+    Auto,
+    PNG,
+    JPEG,
+    BMP,
+    TGA,
+    EXR,
+    TIFF,
+    QOI,
+    Unknown
+};
+
+/** Lets decoders skip pixels which transform stage would throw away */
+struct FRuntimeImageDecodeHints
+{
+    // region of the source image that is kept, empty means whole image
+    FIntRect CropRect;
+    // region is resized to this percent afterwards
+    int32 PercentSizeX = 100;
+    int32 PercentSizeY = 100;
+    // or to this size in pixels if it's set, percent is ignored then
+    FIntPoint TargetSize = FIntPoint(0, 0);
+    // target size is reduced to keep aspect ratio of the region
+    bool bKeepAspectRatio = false;
+
+    /** Size the region ends up with after transform stage */
+    FIntPoint GetTargetSize(const FIntPoint& RegionSize) const
+    {
+        if (TargetSize.X > 0 && TargetSize.Y > 0 && RegionSize.X > 0 && RegionSize.Y > 0)
+        {
+            if (!bKeepAspectRatio)
+            {
+                return TargetSize;
+            }
+
+            const float Scale = FMath::Min((float)TargetSize.X / RegionSize.X, (float)TargetSize.Y / RegionSize.Y);
+            return FIntPoint(FMath::Max(1, FMath::RoundToInt(RegionSize.X * Scale)), FMath::Max(1, FMath::RoundToInt(RegionSize.Y * Scale)));
+        }
+
+        return FIntPoint(
+            FMath::Max(1, (int32)FMath::Floor(RegionSize.X * PercentSizeX * 0.01f)),
+            FMath::Max(1, (int32)FMath::Floor(RegionSize.Y * PercentSizeY * 0.01f))
+        );
+    }
+};
+
+// TArray<uint8> in UE4 and TArray64<uint8> in UE5
+typedef decltype(FImage::RawData) FRuntimeImageRawData;
+
 struct RUNTIMEIMAGELOADER_API FRuntimeImageData : public FImage
 {
     void Init2D(int32 InSizeX, int32 InSizeY, ETextureSourceFormat InFormat, const void* InData = nullptr);
+    /** Same as Init2D but takes ownership of pixels decoded straight into InRawData instead of copying them. Returns false if their size does not match */
+    bool Init2D(int32 InSizeX, int32 InSizeY, ETextureSourceFormat InFormat, FRuntimeImageRawData&& InRawData);
 
     int32 NumMips = 1;
+    /** Mips 1..NumMips-1 when they are generated on CPU */
+    TArray<FRuntimeImageRawData> AdditionalMips;
+    /** Mips 1..NumMips-1 are generated on GPU after mip 0 is uploaded */
+    bool bGenerateMipsOnGPU = false;
     bool SRGB = true;
     ETextureSourceFormat TextureSourceFormat = TSF_Invalid;
     TextureCompressionSettings CompressionSettings;
     FDateTime ModificationTime;
     EPixelFormat PixelFormat = PF_B8G8R8A8;
-};
\ No newline at end of file
+    /** Region of the source image the pixels cover. Decoders that crop or shrink while decoding make it differ from image size */
+    FIntRect SourceRect;
+};
+
+typedef TSharedPtr<FRuntimeImageData, ESPMode::ThreadSafe> FRuntimeImageDataPtr;
@@ -16,9 +16,27 @@
 
 
 class URuntimeImageReader;
+class URuntimeImageCache;
 
 
 DECLARE_DELEGATE_OneParam(FOnRequestCompleted, const FImageReadResult&);
+DECLARE_DYNAMIC_DELEGATE_OneParam(FOnImagePreviewAvailable, UTexture2D*, PreviewTexture);
+DECLARE_DYNAMIC_DELEGATE_ThreeParams(FOnImageLoaded, UTexture2D*, Texture, bool, bSuccess, const FString&, Error);
+DECLARE_DYNAMIC_DELEGATE_FiveParams(FOnBatchItemLoaded, int32, ItemIndex, UTexture2D*, Texture, bool, bSuccess, const FString&, Error, float, BatchProgress);
+DECLARE_DYNAMIC_DELEGATE_TwoParams(FOnRenderTargetUpdated, bool, bSuccess, const FString&, Error);
+DECLARE_DYNAMIC_DELEGATE_FourParams(FOnBatchLoaded, const TArray<UTexture2D*>&, Textures, int32, NumFailed, UTexture2D*, AtlasTexture, const TArray<FBox2D>&, AtlasUVs);
+
+/** Identifies async request so it can be cancelled or reprioritized while it's waiting */
+USTRUCT(BlueprintType)
+struct RUNTIMEIMAGELOADER_API FRuntimeImageRequestHandle
+{
+    GENERATED_BODY()
+
+    UPROPERTY()
+    int32 Id = INDEX_NONE;
+
+    bool IsValid() const { return Id != INDEX_NONE; }
+};
 
 struct RUNTIMEIMAGELOADER_API FLoadImageRequest
 {
@@ -36,6 +54,47 @@ public:
 public:
     FImageReadRequest Params;
     FOnRequestCompleted OnRequestCompleted;
+    // identifies requests that produce the same texture
+    FString CacheKey;
+
+    // assigned by URuntimeImageLoader when request is queued
+    int32 Handle = INDEX_NONE;
+    // requests with higher priority are handed to image reader first
+    int32 Priority = 0;
+
+    // progressive requests only, called once. Preview texture is updated in place afterwards
+    FOnImagePreviewAvailable OnPreviewAvailable;
+    bool bPreviewReported = false;
+
+    // pixels go to image data cache only, requests of the same image waiting for it are queued again once it's done
+    bool bPrefetch = false;
+    // completed with error when cancelled, so its batch still finishes
+    bool bBatchItem = false;
+};
+
+/** Images requested together by LoadImagesAsync */
+USTRUCT()
+struct RUNTIMEIMAGELOADER_API FRuntimeImageBatch
+{
+    GENERATED_BODY()
+
+    // by item index, failed items are null
+    UPROPERTY()
+    TArray<UTexture2D*> Textures;
+
+    UPROPERTY()
+    UTexture2D* AtlasTexture = nullptr;
+    // by item index, empty for failed items
+    TArray<FBox2D> AtlasUVs;
+
+    int32 NumCompleted = 0;
+    int32 NumFailed = 0;
+
+    bool bPackIntoAtlas = false;
+    int32 MaxAtlasSize = 0;
+
+    FOnBatchItemLoaded OnItemLoaded;
+    FOnBatchLoaded OnBatchLoaded;
 };
 
 
@@ -53,12 +112,93 @@ public:
     UFUNCTION(BlueprintCallable, Category = "Runtime Image Loader", meta = (AutoCreateRefTerm = "TransformParams", Latent, LatentInfo = "LatentInfo", HidePin = "WorldContextObject", DefaultToSelf = "WorldContextObject"))
     void LoadImageAsync(const FString& ImageFilename, const FTransformImageParams& TransformParams, UTexture2D*& OutTexture, bool& bSuccess, FString& OutError, FLatentActionInfo LatentInfo, UObject* WorldContextObject = nullptr);
     
+    /**
+     * Same as LoadImageAsync but HTTP images are shown while they are downloading. Preview texture is reported once
+     * the first part of the image is decoded. PNG previews get sharper with every pass of interlaced images
+     * and reveal more rows of others, JPEG previews get sharper with every scan of progressive images.
+     */
+    UFUNCTION(BlueprintCallable, Category = "Runtime Image Loader", meta = (AutoCreateRefTerm = "TransformParams", Latent, LatentInfo = "LatentInfo", HidePin = "WorldContextObject", DefaultToSelf = "WorldContextObject"))
+    void LoadImageProgressiveAsync(const FString& ImageFilename, const FTransformImageParams& TransformParams, FOnImagePreviewAvailable OnPreviewAvailable, UTexture2D*& OutTexture, bool& bSuccess, FString& OutError, FLatentActionInfo LatentInfo, UObject* WorldContextObject = nullptr);
+
+    /**
+     * Queues image request and returns its handle. Requests with higher priority are started first, e.g. images of
+     * visible items can be loaded before the ones scrolled off-screen. OnImageLoaded is not called if request is cancelled
+     */
+    UFUNCTION(BlueprintCallable, Category = "Runtime Image Loader", meta = (AutoCreateRefTerm = "TransformParams"))
+    FRuntimeImageRequestHandle LoadImageAsyncWithHandle(const FString& ImageFilename, const FTransformImageParams& TransformParams, int32 Priority, FOnImageLoaded OnImageLoaded);
+
+    /** Cancels request that was not completed yet. Its download is stopped and the image is not decoded. Returns false if request is not found */
+    UFUNCTION(BlueprintCallable, Category = "Runtime Image Loader")
+    bool CancelRequest(FRuntimeImageRequestHandle Handle);
+
+    /**
+     * Changes priority of request that was not completed yet. Request that is loading already is not reordered,
+     * only its download is moved ahead of queued downloads if priority is raised. Returns false if request is not found
+     */
+    UFUNCTION(BlueprintCallable, Category = "Runtime Image Loader")
+    bool SetRequestPriority(FRuntimeImageRequestHandle Handle, int32 Priority);
+
+    /**
+     * Queues requests of all images at once. OnItemLoaded is called as every image completes, OnBatchLoaded once all of them did,
+     * with textures in the order of ImageFilenames. With bPackIntoAtlas images are copied into one atlas texture on GPU,
+     * which needs all of them to have the same pixel format and to fit MaxAtlasSize. Atlas is null otherwise
+     */
+    UFUNCTION(BlueprintCallable, Category = "Runtime Image Loader", meta = (AutoCreateRefTerm = "TransformParams"))
+    void LoadImagesAsync(const TArray<FString>& ImageFilenames, const FTransformImageParams& TransformParams, int32 Priority, bool bPackIntoAtlas, FOnBatchItemLoaded OnItemLoaded, FOnBatchLoaded OnBatchLoaded, int32 MaxAtlasSize = 4096);
+
+    /** Loads image on worker threads while game thread waits for it. Async requests queued before are not waited for */
     UFUNCTION(BlueprintCallable, Category = "Runtime Image Loader", meta = (AutoCreateRefTerm = "TransformParams"))
     void LoadImageSync(const FString& ImageFilename, const FTransformImageParams& TransformParams, UTexture2D*& OutTexture, bool& bSuccess, FString& OutError);
 
+    /**
+     * Same as LoadImageSync but game thread waits no longer than TimeoutSeconds, zero or less waits till the image is loaded.
+     * Returns false if image is not loaded by then, loading continues in the background and OnImageLoaded is called once it's done.
+     * OnImageLoaded is not called if true is returned. Async load of the same image that is in flight already is waited for instead
+     */
+    UFUNCTION(BlueprintCallable, Category = "Runtime Image Loader", meta = (AutoCreateRefTerm = "TransformParams"))
+    bool TryLoadImageSync(const FString& ImageFilename, const FTransformImageParams& TransformParams, float TimeoutSeconds, FOnImageLoaded OnImageLoaded, UTexture2D*& OutTexture, bool& bSuccess, FString& OutError);
+
+    /**
+     * Loads image into ExistingTexture in place if it has the size and pixel format of the transformed image and a single mip,
+     * otherwise a new texture is created and passed to OnImageLoaded. Only DirtySize pixels at DirtyOffset are uploaded
+     * unless DirtySize is zero, e.g. the part of a refreshed snapshot that changed. Caches are skipped as the file is expected to change
+     */
+    UFUNCTION(BlueprintCallable, Category = "Runtime Image Loader", meta = (AutoCreateRefTerm = "TransformParams"))
+    FRuntimeImageRequestHandle UpdateTextureFromImage(UTexture2D* ExistingTexture, const FString& ImageFilename, const FTransformImageParams& TransformParams, FIntPoint DirtyOffset, FIntPoint DirtySize, FOnImageLoaded OnImageLoaded);
+
+    /**
+     * Same as UpdateTextureFromImage but writes pixels into RenderTarget. It has to have the size and pixel format of the transformed image,
+     * e.g. RTF_RGBA8 for images loaded for UI
+     */
+    UFUNCTION(BlueprintCallable, Category = "Runtime Image Loader", meta = (AutoCreateRefTerm = "TransformParams"))
+    FRuntimeImageRequestHandle UpdateRenderTargetFromImage(UTextureRenderTarget2D* RenderTarget, const FString& ImageFilename, const FTransformImageParams& TransformParams, FIntPoint DirtyOffset, FIntPoint DirtySize, FOnRenderTargetUpdated OnUpdated);
+
+    /**
+     * Reads and decodes images into the cache of pixels without creating textures, e.g. while the screen that shows them is on its way.
+     * Prefetches wait behind all other requests. Later requests with the same TransformParams only upload the cached pixels,
+     * an image requested before its prefetch started is loaded as usual. Needs image data cache, its budget limits what stays prefetched
+     */
+    UFUNCTION(BlueprintCallable, Category = "Runtime Image Loader", meta = (AutoCreateRefTerm = "TransformParams"))
+    void Prefetch(const TArray<FString>& ImageFilenames, const FTransformImageParams& TransformParams);
+
+    /**
+     * Prefetches images listed in JSON manifest: { "Groups": [ { "TransformParams": { "bForUI": true, ... }, "Images": [ "uri", ... ] } ] }.
+     * Local paths are relative to the manifest. Returns false if manifest can't be read
+     */
+    UFUNCTION(BlueprintCallable, Category = "Runtime Image Loader")
+    bool PrefetchFromManifest(const FString& ManifestFilename);
+
     UFUNCTION(BlueprintCallable, Category = "Runtime Image Loader")
     void CancelAll();
 
+    /**
+     * Gives texture that is not used anymore back to the loader. If texture pool is enabled in settings, next image
+     * of the same size and format is uploaded to it in place instead of creating a new texture. Texture is removed from cache.
+     * Texture handed to several requests by cache or by loading the same image once is reused after all of them released it
+     */
+    UFUNCTION(BlueprintCallable, Category = "Runtime Image Loader")
+    void ReleaseTexture(UTexture2D* Texture);
+
 protected:
     virtual void Initialize(FSubsystemCollectionBase& Collection) override;
     virtual void Deinitialize() override;
@@ -70,11 +210,52 @@ private:
     virtual bool IsAllowedToTick() const override;
 
     URuntimeImageReader* InitializeImageReader();
+    /** Assigns handle to the request and queues it behind requests of the same or higher priority */
+    FRuntimeImageRequestHandle EnqueueRequest(FLoadImageRequest&& Request);
+    FLoadImageRequest MakeDelegateRequest(const FString& ImageFilename, const FTransformImageParams& TransformParams, FOnImageLoaded OnImageLoaded) const;
+    FLoadImageRequest MakeLatentRequest(const FString& ImageFilename, const FTransformImageParams& TransformParams, UTexture2D*& OutTexture, bool& bSuccess, FString& OutError, FLatentActionInfo LatentInfo);
+    void ReportPreviews();
+    void CompleteRequest(const FImageReadResult& ReadResult);
+    /** Returns id of the active request that loads the image of CacheKey, INDEX_NONE if there is none */
+    int32 FindLoadingRequest(const FString& CacheKey) const;
+
+    /** Completes request right away if its texture is cached */
+    bool CompleteRequestFromCache(FLoadImageRequest& Request);
+    /** Uses cached pixels if there are any and asks image reader to keep pixels for the cache */
+    void PrepareRequestForCache(FImageReadRequest& ReadRequest, const FString& CacheKey) const;
+    void AddResultToCache(const FString& CacheKey, const FImageReadResult& ReadResult);
+    /** Counts requests the texture was handed to, so it's given to pool only after all of them released it */
+    void AddTextureUsers(UTexture2D* Texture, int32 NumUsers);
+    /** Returns false if prefetch is not needed as its image is cached or being loaded already */
+    bool PreparePrefetch(const FLoadImageRequest& Request) const;
+    void CompletePrefetch(const FLoadImageRequest& Request, const FImageReadResult& ReadResult);
+
+    /** Completes batch item with error, other requests are not completed when cancelled */
+    void CompleteCancelledRequest(FLoadImageRequest& Request);
+    void HandleBatchItemLoaded(const FImageReadResult& ReadResult, int32 BatchId, int32 ItemIndex);
+    /** Returns true if atlas is being packed, batch is finished once it's ready */
+    bool PackBatchIntoAtlas(int32 BatchId, FRuntimeImageBatch& Batch);
+    void FinishBatch(int32 BatchId);
 
 private:
     UPROPERTY()
     URuntimeImageReader* ImageReader = nullptr;
 
-    TQueue<FLoadImageRequest> Requests;
-    FLoadImageRequest ActiveRequest;
+    UPROPERTY()
+    URuntimeImageCache* ImageCache = nullptr;
+
+    // requests waiting for a free slot, sorted by priority
+    TArray<FLoadImageRequest> Requests;
+    int32 NextRequestHandle = 0;
+    // requests handed to image reader, by request id
+    TMap<int32, FLoadImageRequest> ActiveRequests;
+    // requests waiting for the active request with the same cache key, by cache key
+    TMap<FString, TArray<FLoadImageRequest>> CoalescedRequests;
+    // number of requests each completed texture was handed to and not released yet
+    TMap<TWeakObjectPtr<UTexture2D>, int32> TextureUsers;
+    int32 NumActivePrefetches = 0;
+
+    UPROPERTY()
+    TMap<int32, FRuntimeImageBatch> Batches;
+    int32 NextBatchId = 0;
 };
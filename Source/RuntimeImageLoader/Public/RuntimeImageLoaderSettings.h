@@ -0,0 +1,114 @@
+// Copyright 2022 Peter Leontev. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DeveloperSettings.h"
+#include "RuntimeImageLoaderSettings.generated.h"
+
+/**
+ * Project-wide settings of Runtime Image Loader (Project Settings -> Plugins -> Runtime Image Loader)
+ */
+UCLASS(Config = Game, DefaultConfig, meta = (DisplayName = "Runtime Image Loader"))
+class RUNTIMEIMAGELOADER_API URuntimeImageLoaderSettings : public UDeveloperSettings
+{
+    GENERATED_BODY()
+
+public:
+    URuntimeImageLoaderSettings();
+
+    /** Number of workers that read and decode images in parallel. 0 means pick automatically based on the number of CPU cores */
+    UPROPERTY(Config, EditAnywhere, Category = "Workers", meta = (ClampMin = 0, ClampMax = 32, UIMin = 0, UIMax = 32))
+    int32 NumWorkers = 0;
+
+    /** Run image requests as task graph tasks instead of dedicated worker threads */
+    UPROPERTY(Config, EditAnywhere, Category = "Workers")
+    bool bUseTaskGraph = false;
+
+    /** Max number of async requests handed to image reader at once. Other requests wait in the queue */
+    UPROPERTY(Config, EditAnywhere, Category = "Requests", meta = (ClampMin = 1, UIMin = 1, UIMax = 64))
+    int32 MaxConcurrentRequests = 8;
+
+    /** Complete async requests in the order they were made. Otherwise requests complete as soon as they are ready */
+    UPROPERTY(Config, EditAnywhere, Category = "Requests")
+    bool bPreserveRequestOrder = true;
+
+    /** Prefetches that are loaded at the same time, they start only while no other request is waiting */
+    UPROPERTY(Config, EditAnywhere, Category = "Requests", meta = (ClampMin = 1, UIMin = 1, UIMax = 16))
+    int32 MaxConcurrentPrefetches = 1;
+
+    /** Max number of fetched images waiting to be decoded. Fetching pauses when the queue is full, downloads that finish meanwhile wait aside */
+    UPROPERTY(Config, EditAnywhere, Category = "Pipeline", meta = (ClampMin = 1, UIMin = 1, UIMax = 64))
+    int32 MaxDecodeQueueDepth = 4;
+
+    /** Max number of decoded images waiting to be transformed. Decoding pauses when the queue is full */
+    UPROPERTY(Config, EditAnywhere, Category = "Pipeline", meta = (ClampMin = 1, UIMin = 1, UIMax = 64))
+    int32 MaxTransformQueueDepth = 4;
+
+    /** Max number of transformed images waiting to be uploaded to GPU. Transforming pauses when the queue is full */
+    UPROPERTY(Config, EditAnywhere, Category = "Pipeline", meta = (ClampMin = 1, UIMin = 1, UIMax = 64))
+    int32 MaxUploadQueueDepth = 2;
+
+    /** Max number of bytes uploaded to GPU by render thread per frame. Larger images are uploaded in bands of rows over several frames. 0 disables the budget */
+    UPROPERTY(Config, EditAnywhere, Category = "Pipeline", meta = (ClampMin = 0, UIMin = 0, UIMax = 65536))
+    int32 UploadBudgetKBPerFrame = 16384;
+
+    /** Estimated memory of images that are decoded, transformed and uploaded at once. Decoding waits till the next image fits. 0 disables the budget */
+    UPROPERTY(Config, EditAnywhere, Category = "Pipeline", meta = (ClampMin = 0, UIMin = 0, UIMax = 4096))
+    int32 DecodeMemoryBudgetMB = 0;
+
+    /** Max number of images downloaded at once over HTTP */
+    UPROPERTY(Config, EditAnywhere, Category = "HTTP", meta = (ClampMin = 1, UIMin = 1, UIMax = 32))
+    int32 MaxConcurrentDownloads = 8;
+
+    /** Max number of images downloaded at once from a single host */
+    UPROPERTY(Config, EditAnywhere, Category = "HTTP", meta = (ClampMin = 1, UIMin = 1, UIMax = 32))
+    int32 MaxDownloadsPerHost = 6;
+
+    /** Progressive requests download images in ranges of this size and update their previews after every range */
+    UPROPERTY(Config, EditAnywhere, Category = "HTTP", meta = (ClampMin = 16, UIMin = 16, UIMax = 4096))
+    int32 ProgressiveChunkSizeKB = 256;
+
+    /**
+     * Return already loaded textures for requests of the same image with the same transform params. Off by default as the texture
+     * is shared by all of them and local files modified meanwhile are not loaded again
+     */
+    UPROPERTY(Config, EditAnywhere, Category = "Cache")
+    bool bEnableCache = false;
+
+    /** Cached textures are evicted least recently used first when their total size exceeds the budget */
+    UPROPERTY(Config, EditAnywhere, Category = "Cache", meta = (EditCondition = "bEnableCache", ClampMin = 0, UIMin = 0, UIMax = 4096))
+    int32 TextureCacheBudgetMB = 256;
+
+    /** Budget for decoded pixels that are kept in RAM to re-create evicted textures quickly. 0 disables it */
+    UPROPERTY(Config, EditAnywhere, Category = "Cache", meta = (EditCondition = "bEnableCache", ClampMin = 0, UIMin = 0, UIMax = 4096))
+    int32 ImageDataCacheBudgetMB = 64;
+
+    /** JSON manifest of images prefetched once the loader starts, relative to project directory. Empty means none */
+    UPROPERTY(Config, EditAnywhere, Category = "Cache", meta = (EditCondition = "bEnableCache"))
+    FString WarmUpManifest;
+
+    /** Max number of textures given back with ReleaseTexture that are kept to be overwritten by next images of the same size and format. 0 disables the pool */
+    UPROPERTY(Config, EditAnywhere, Category = "Texture Pool", meta = (ClampMin = 0, UIMin = 0, UIMax = 256))
+    int32 MaxPooledTextures = 0;
+
+    /** Store transformed pixels of downloaded images on disk so they are not downloaded and decoded again in next sessions. Off by default as entries are written to Saved directory */
+    UPROPERTY(Config, EditAnywhere, Category = "Disk Cache")
+    bool bEnableDiskCache = false;
+
+    /** Store local images on disk cache too. Cached copy is used till image file is modified */
+    UPROPERTY(Config, EditAnywhere, Category = "Disk Cache", meta = (EditCondition = "bEnableDiskCache"))
+    bool bDiskCacheLocalFiles = false;
+
+    /** Least recently written entries are deleted on startup when disk cache size exceeds the budget */
+    UPROPERTY(Config, EditAnywhere, Category = "Disk Cache", meta = (EditCondition = "bEnableDiskCache", ClampMin = 1, UIMin = 1, UIMax = 8192))
+    int32 DiskCacheBudgetMB = 512;
+
+    /** Directory of disk cache. Empty means Saved/RuntimeImageLoader/Cache */
+    UPROPERTY(Config, EditAnywhere, Category = "Disk Cache", meta = (EditCondition = "bEnableDiskCache"))
+    FString DiskCacheDirectory;
+
+public:
+    int32 GetNumWorkers() const;
+    FString GetDiskCacheDirectory() const;
+};
@@ -6,14 +6,66 @@
 #include "Engine/Texture.h"
 #include "Tickable.h"
 #include "Misc/ScopedEvent.h"
-#include "HAL/Runnable.h"
 #include "HAL/ThreadSafeBool.h"
+#include "HAL/ThreadSafeCounter.h"
+#include "HAL/CriticalSection.h"
+#include "Containers/Queue.h"
 #include "RuntimeImageData.h"
+#include "RuntimeImageStageQueue.h"
 #include "RuntimeImageReader.generated.h"
 
 
-class FRunnableThread;
 class FEvent;
+class UTexture2D;
+class UTextureRenderTarget2D;
+
+/** Block compression applied to loaded textures. BCn formats are used where supported and ETC2 otherwise */
+UENUM(BlueprintType)
+enum class ERuntimeImageCompression : uint8
+{
+    None            UMETA(DisplayName = "None"),
+    // BC1 or ETC2 RGB: 4 bits per pixel, alpha is dropped
+    Fast            UMETA(DisplayName = "Fast (BC1/ETC2 RGB)"),
+    // BC3 or ETC2 RGBA: 8 bits per pixel
+    Balanced        UMETA(DisplayName = "Balanced (BC3/ETC2 RGBA)"),
+    // BC7 or ETC2 RGBA: 8 bits per pixel, slowest to encode
+    HighQuality     UMETA(DisplayName = "High Quality (BC7/ETC2 RGBA)")
+};
+
+/** How size of the loaded image is determined */
+UENUM(BlueprintType)
+enum class ERuntimeImageSizeMode : uint8
+{
+    // PercentSizeX and PercentSizeY of the source size
+    Percent         UMETA(DisplayName = "Percent"),
+    // exactly TargetSize, aspect ratio is not kept
+    Absolute        UMETA(DisplayName = "Absolute"),
+    // largest size that fits into TargetSize and keeps aspect ratio
+    AspectFit       UMETA(DisplayName = "Aspect Fit")
+};
+
+/** Filter used when image is resized */
+UENUM(BlueprintType)
+enum class ERuntimeImageResizeFilter : uint8
+{
+    // averages source pixels under the destination pixel, nearest pixel when upscaling
+    Box             UMETA(DisplayName = "Box"),
+    Bilinear        UMETA(DisplayName = "Bilinear"),
+    // sharpest and slowest, 3 lobes
+    Lanczos         UMETA(DisplayName = "Lanczos")
+};
+
+/** Storage of floating point images such as EXR. Compression, if set, takes precedence and encodes BC6H */
+UENUM(BlueprintType)
+enum class ERuntimeImageHDRFormat : uint8
+{
+    // 8 bytes per pixel
+    RGBA16F         UMETA(DisplayName = "RGBA Half"),
+    // 4 bytes per pixel, alpha and negative values are dropped
+    RG11B10F        UMETA(DisplayName = "RG11B10 Float"),
+    // 2 bytes per pixel, red channel only
+    R16F            UMETA(DisplayName = "R Half")
+};
 
 USTRUCT(BlueprintType)
 struct RUNTIMEIMAGELOADER_API FTransformImageParams
@@ -23,15 +75,84 @@ struct RUNTIMEIMAGELOADER_API FTransformImageParams
     UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (Category = "Runtime Image Reader"))
     bool bForUI = true;
 
-    UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (Category = "Runtime Image Reader", UIMin = 0, UIMax = 100, ClampMin = 0, ClampMax = 100))
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (Category = "Runtime Image Reader"))
+    ERuntimeImageSizeMode SizeMode = ERuntimeImageSizeMode::Percent;
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (Category = "Runtime Image Reader", EditCondition = "SizeMode == ERuntimeImageSizeMode::Percent", UIMin = 0, UIMax = 400, ClampMin = 0, ClampMax = 400))
     int32 PercentSizeX = 100;
 
-    UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (Category = "Runtime Image Reader", UIMin = 0, UIMax = 100, ClampMin = 0, ClampMax = 100))
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (Category = "Runtime Image Reader", EditCondition = "SizeMode == ERuntimeImageSizeMode::Percent", UIMin = 0, UIMax = 400, ClampMin = 0, ClampMax = 400))
     int32 PercentSizeY = 100;
 
+    /** Size in pixels for Absolute and Aspect Fit size modes */
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (Category = "Runtime Image Reader", EditCondition = "SizeMode != ERuntimeImageSizeMode::Percent", UIMin = 1, ClampMin = 0))
+    FIntPoint TargetSize = FIntPoint(0, 0);
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (Category = "Runtime Image Reader"))
+    ERuntimeImageResizeFilter ResizeFilter = ERuntimeImageResizeFilter::Bilinear;
+
+    /** Builds full mip chain for textures that are used on 3D meshes */
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (Category = "Runtime Image Reader"))
+    bool bGenerateMips = false;
+
+    /** Limits the number of mips, 0 means full chain down to 1x1 */
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (Category = "Runtime Image Reader", EditCondition = "bGenerateMips", UIMin = 0, ClampMin = 0))
+    int32 NumMips = 0;
+
+    /** Mips are generated by a GPU pass after upload when pixel format allows it, otherwise on CPU */
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (Category = "Runtime Image Reader", EditCondition = "bGenerateMips"))
+    bool bGenerateMipsOnGPU = true;
+
+    /** Compresses 8 bit color images on load, floating point images are compressed to BC6H. Image dimensions have to be multiple of 4 */
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (Category = "Runtime Image Reader"))
+    ERuntimeImageCompression Compression = ERuntimeImageCompression::None;
+
+    /** Texture format of floating point images when they are not compressed */
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (Category = "Runtime Image Reader"))
+    ERuntimeImageHDRFormat HDRFormat = ERuntimeImageHDRFormat::RGBA16F;
+
+    /** Top left corner of the region of the image to keep, in pixels of the source image */
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (Category = "Runtime Image Reader"))
+    FIntPoint CropOffset = FIntPoint(0, 0);
+
+    /** Size of the region of the image to keep, zero keeps the whole image. Percent size is applied to the region */
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (Category = "Runtime Image Reader"))
+    FIntPoint CropSize = FIntPoint(0, 0);
+
+    /** True if percent size changes the size of the image */
     bool IsPercentSizeValid() const
     {
-        return PercentSizeX > 0 && PercentSizeX < 100 && PercentSizeY > 0 && PercentSizeY < 100;
+        return PercentSizeX > 0 && PercentSizeX <= 400 && PercentSizeY > 0 && PercentSizeY <= 400 && (PercentSizeX != 100 || PercentSizeY != 100);
+    }
+
+    bool IsTargetSizeValid() const
+    {
+        return SizeMode != ERuntimeImageSizeMode::Percent && TargetSize.X > 0 && TargetSize.Y > 0;
+    }
+
+    bool HasCrop() const
+    {
+        return CropSize.X > 0 && CropSize.Y > 0;
+    }
+
+    FRuntimeImageDecodeHints GetDecodeHints() const
+    {
+        FRuntimeImageDecodeHints DecodeHints;
+        if (HasCrop())
+        {
+            DecodeHints.CropRect = FIntRect(CropOffset, CropOffset + CropSize);
+        }
+        if (IsTargetSizeValid())
+        {
+            DecodeHints.TargetSize = TargetSize;
+            DecodeHints.bKeepAspectRatio = SizeMode == ERuntimeImageSizeMode::AspectFit;
+        }
+        else if (SizeMode == ERuntimeImageSizeMode::Percent && IsPercentSizeValid())
+        {
+            DecodeHints.PercentSizeX = PercentSizeX;
+            DecodeHints.PercentSizeY = PercentSizeY;
+        }
+        return DecodeHints;
     }
 };
 
@@ -39,6 +160,34 @@ struct RUNTIMEIMAGELOADER_API FImageReadRequest
 {
     FString ImageFilename = TEXT("");
     FTransformImageParams TransformParams;
+
+    // skips format detection when the caller knows the format
+    ERuntimeImageFormat FormatHint = ERuntimeImageFormat::Auto;
+
+    // assigned by URuntimeImageReader::AddRequest
+    int32 RequestId = INDEX_NONE;
+
+    // pixels which are ready for upload, request skips straight to upload stage
+    FRuntimeImageDataPtr DecodedImageData;
+
+    // keep uploaded pixels in FImageReadResult::ImageData instead of freeing them
+    bool bKeepImageData = false;
+
+    // HTTP images are downloaded in chunks and previews are shown while the rest is downloading
+    bool bProgressive = false;
+
+    // stages run on high priority workers as soon as the previous one finishes, past the queues of other requests
+    bool bExpedited = false;
+
+    // request stops before upload, transformed pixels are handed out in FImageReadResult::ImageData and no texture is created
+    bool bDecodeOnly = false;
+
+    // pixels are uploaded into this texture in place if it has their size, pixel format and a single mip, new texture is created otherwise
+    UTexture2D* TargetTexture = nullptr;
+    // pixels are written into this render target instead of a texture, request fails if it does not have their size and pixel format
+    UTextureRenderTarget2D* TargetRenderTarget = nullptr;
+    // part of the transformed image that is uploaded to the target, whole image if empty
+    FIntRect DirtyRegion = FIntRect(0, 0, 0, 0);
 };
 
 USTRUCT()
@@ -50,78 +199,312 @@ struct RUNTIMEIMAGELOADER_API FImageReadResult
     UPROPERTY()
     UTexture2D* OutTexture = nullptr;
     FString OutError = TEXT("");
+    int32 RequestId = INDEX_NONE;
+
+    // set if FImageReadRequest::bKeepImageData was requested
+    FRuntimeImageDataPtr ImageData;
+};
+
+/** Pooled event shared by the waiting worker and its queued construct task, it goes back to the pool once both let it go */
+struct RUNTIMEIMAGELOADER_API FConstructTextureEvent
+{
+    UE_NONCOPYABLE(FConstructTextureEvent);
+
+    FConstructTextureEvent();
+    ~FConstructTextureEvent();
+
+    FEvent* Event;
 };
 
 struct RUNTIMEIMAGELOADER_API FConstructTextureTask
 {
+    int32 RequestId;
     FString ImageFilename;
-    FRuntimeImageData* ImageData;
+    const FRuntimeImageData* ImageData;
+    TSharedPtr<FConstructTextureEvent, ESPMode::ThreadSafe> ConstructedEvent;
+};
+
+class FRuntimeTextureResource;
+
+/** Pixels waiting for render thread to put them into a texture. Uploads are processed in batches, in the order they were queued */
+struct RUNTIMEIMAGELOADER_API FTextureUpload
+{
+    UTexture2D* Texture = nullptr;
+    // kept alive by the owner of OnCompleted
+    const FRuntimeImageData* ImageData = nullptr;
+    // resource of a new texture, existing texture is updated if not set
+    FRuntimeTextureResource* NewResource = nullptr;
+    // created already if RHI supports async texture creation
+    FTexture2DRHIRef RHITexture2D;
+    // called on render thread once texture has the pixels
+    TFunction<void()> OnCompleted;
+    // makes RHI of the new resource on render thread instead of uploading ImageData
+    TFunction<FTexture2DRHIRef()> BuildTexture;
+    // existing render target that is written instead of Texture
+    UTextureRenderTarget2D* RenderTarget = nullptr;
+    // part of the top mip that is uploaded to existing texture, whole image if empty
+    FIntRect UpdateRegion = FIntRect(0, 0, 0, 0);
+
+    bool IsSet() const { return Texture != nullptr || RenderTarget != nullptr; }
+
+    // progress of upload that did not fit the frame budget, render thread only
+    bool bSplitIntoBands = false;
+    int32 NextMipIndex = 0;
+    int32 NextBlockRow = 0;
+};
+
+/** Stages every image request goes through. Each stage is fed by its own queue */
+enum class EImageReadStage : uint8
+{
+    Fetch,
+    Decode,
+    Transform,
+    Upload,
+    Num
+};
+
+enum class EImageReadStageResult : uint8
+{
+    Succeeded,
+    Failed,
+    // stage continues asynchronously and moves the request further on its own
+    Pending
 };
 
 class UTexture2D;
 class IImageReader;
+class FRuntimeImageReaderWorker;
+class FRuntimeImageDiskCache;
+class URuntimeTexturePool;
+struct FRuntimeImageReadTask;
+struct FImageCacheValidators;
+struct FImageReadResponse;
+
+typedef TSharedPtr<FRuntimeImageReadTask, ESPMode::ThreadSafe> FRuntimeImageReadTaskPtr;
 
 UCLASS()
-class RUNTIMEIMAGELOADER_API URuntimeImageReader : public UObject, public FRunnable, public FTickableGameObject
+class RUNTIMEIMAGELOADER_API URuntimeImageReader : public UObject, public FTickableGameObject
 {
     GENERATED_BODY()
 
 public:
-    void Initialize();
+    /** Without caches disk cache and texture pool are off even if enabled in settings, so every image is decoded and uploaded anew */
+    void Initialize(bool bUseCaches = true);
     void Deinitialize();
 
 public:
-    void AddRequest(const FImageReadRequest& Request);
+    /** Queues request and returns its id which is used to fetch the result */
+    int32 AddRequest(const FImageReadRequest& Request);
+    /** Returns results in the same order the requests were added. Game thread only */
     bool GetResult(FImageReadResult& OutResult);
+    /** Returns result of a particular request. Game thread only */
+    bool GetResult(int32 RequestId, FImageReadResult& OutResult);
+    /** Moves download of the request ahead of queued downloads */
+    void PrioritizeRequest(int32 RequestId);
+    /** Runs remaining stages of the request past the queues, or back through them once it's not waited for anymore */
+    void SetRequestExpedited(int32 RequestId, bool bExpedited);
+    /** Drops result of the request. Download is stopped and stages that did not start yet are skipped */
+    void CancelRequest(int32 RequestId);
     void Clear();
     void Stop();
     bool IsWorkCompleted() const;
 
     void Trigger();
-    void BlockTillAllRequestsFinished();
 
-protected:
-    /* FRunnable interface */
-    bool Init() override;
-    uint32 Run() override;
-    void Exit() override;
-    /* ~FRunnable interface */
+    /**
+     * Waits on game thread for the result of a single request, work of other requests is not waited for.
+     * Returns false if request is not completed within TimeoutSeconds, its result is kept for GetResult then. Zero or less waits till it is completed.
+     * Request that was cancelled meanwhile completes with an error
+     */
+    bool WaitForResult(int32 RequestId, float TimeoutSeconds, FImageReadResult& OutResult);
+
+    /** Runs pending pipeline stages on the calling thread till there is nothing to run. Used by pool workers */
+    void ProcessRequests();
+
+    /**
+     * Returns texture that shows the part of progressive request's image downloaded so far.
+     * The texture is updated in place as more data arrives and becomes the result if final image fits it
+     */
+    bool GetPreview(int32 RequestId, UTexture2D*& OutPreviewTexture);
+
+    /** Gives texture back to the pool, so next image of the same size and format is uploaded to it instead of a new texture */
+    void ReleaseTexture(UTexture2D* Texture);
 
+    /**
+     * Queues GPU copy of textures into atlas texture which is created for AtlasData. Null textures are skipped.
+     * Textures must have the pixel format of the atlas and stay alive till OnCompleted is called on render thread
+     */
+    void CreateAtlasTexture(UTexture2D* AtlasTexture, const FRuntimeImageData& AtlasData, const TArray<UTexture2D*>& Textures, const TArray<FIntPoint>& Positions, TFunction<void()>&& OnCompleted);
+
+    /** Number of requests waiting for the given stage */
+    int32 GetQueueDepth(EImageReadStage Stage) const;
+
+protected:
     // FTickableGameObject
     void Tick(float DeltaTime) override;
     TStatId GetStatId() const override;
     // ~FTickableGameObject
 
 private:
+    bool RunNextStage();
+    bool HasRunnableStage() const;
+    /** Runs the stage unless task was cancelled and hands the task to the next one */
+    void ExecuteStage(EImageReadStage Stage, const FRuntimeImageReadTaskPtr& Task);
+    EImageReadStageResult RunStage(EImageReadStage Stage, const FRuntimeImageReadTaskPtr& Task);
+    /** Returns false if decoded image does not fit the memory budget, task is queued for decode again once memory is released */
+    bool ReserveDecodeMemory(const FRuntimeImageReadTaskPtr& Task);
+    void ReleaseDecodeMemory(FRuntimeImageReadTask& Task);
+    /** Expedited requests do not go through stage queues, every stage is a task of its own */
+    void RunExpeditedStage(EImageReadStage Stage, const FRuntimeImageReadTaskPtr& Task);
+    void FinishStage(EImageReadStage Stage, const FRuntimeImageReadTaskPtr& Task, EImageReadStageResult StageResult);
+    EImageReadStageResult FetchStage(const FRuntimeImageReadTaskPtr& Task);
+    /** Passes finished download to decode queue, or keeps it aside while the queue is full */
+    void FinishDownload(const FRuntimeImageReadTaskPtr& Task, bool bSucceeded);
+    void EnqueueDownloadedTasks();
+    /** Takes downloaded image or cache headers of the response for the next stages. Returns false if download failed */
+    bool HandleReadResponse(FRuntimeImageReadTask& Task, FImageReadResponse&& Response);
+    /** Returns true if cached entry can be used without asking the source. Otherwise fills validators for conditional read */
+    bool ValidateDiskCacheEntry(FRuntimeImageReadTask& Task, FImageCacheValidators& OutValidators) const;
+    bool DecodeStage(FRuntimeImageReadTask& Task);
+    bool TransformStage(FRuntimeImageReadTask& Task);
+    EImageReadStageResult UploadStage(const FRuntimeImageReadTaskPtr& Task);
+    /** Completes requests whose last stage finished on other threads. Game thread only */
+    void ProcessCompletedRequests();
+    void CompleteRequest(FImageReadResult& ReadResult);
+    /** Forgets task that is cleared before its stages ran, together with the textures kept for it. Game thread only */
+    void DropTask(FRuntimeImageReadTask& Task);
+    void ProcessConstructTasks();
+    /** Releases workers waiting for textures from game thread without constructing them. Game thread only */
+    void CancelConstructTasks();
+    UTexture2D* ConstructTexture(int32 RequestId, const FString& ImageFilename, const FRuntimeImageData& ImageData);
+    /** Constructs texture on game thread, waits for it if called from a worker */
+    UTexture2D* ConstructTextureOnGameThread(int32 RequestId, const FString& ImageFilename, const FRuntimeImageData& ImageData);
+
+    void HandleDownloadProgress(const FRuntimeImageReadTaskPtr& Task, const TArray<uint8>& ReceivedData, int64 TotalSize);
+    void DecodePreview(const FRuntimeImageReadTaskPtr& Task);
+    void UploadPreview(const FRuntimeImageReadTaskPtr& Task, const FRuntimeImageDataPtr& PreviewData);
+    /** Queues update of preview texture with final image and makes it the result. Returns false if final image does not fit it */
+    bool UploadToPreviewTexture(FRuntimeImageReadTask& Task, const FRuntimeImageData& ImageData, TFunction<void()>&& OnCompleted);
+    /** Queues upload to target texture or render target of the request. Returns false if a new texture has to be created instead */
+    bool UploadToTarget(FRuntimeImageReadTask& Task, const FRuntimeImageData& ImageData, TFunction<void()>&& OnCompleted);
+
+    void DispatchTaskGraphWorkers();
+
     EPixelFormat DeterminePixelFormat(ERawImageFormat::Type ImageFormat, const FTransformImageParams& Params) const;
     void ApplyTransformations(FRuntimeImageData& ImageData, FTransformImageParams TransformParams);
 
-    void CreateTexture(UTexture2D* NewTexture, const FRuntimeImageData& ImageData);
+    /** Creates texture RHI or overwrites the one of recycled texture */
+    void UploadTexture(UTexture2D* Texture, const FRuntimeImageData& ImageData, TFunction<void()>&& OnCompleted);
+    /** Queues creation of texture RHI. Pixels have to stay alive till OnCompleted is called on render thread */
+    void CreateTexture(UTexture2D* NewTexture, const FRuntimeImageData& ImageData, TFunction<void()>&& OnCompleted);
+    /** Creates texture RHI with the pixels. Render thread only */
+    FTexture2DRHIRef CreateRHITexture(UTexture2D* NewTexture, const FRuntimeImageData& ImageData);
     FTexture2DRHIRef CreateTexture_Windows(UTexture2D* NewTexture, const FRuntimeImageData& ImageData);
     FTexture2DRHIRef CreateTexture_Mobile(UTexture2D* NewTexture, const FRuntimeImageData& ImageData);
     FTexture2DRHIRef CreateTexture_Other(UTexture2D* NewTexture, const FRuntimeImageData& ImageData);
-    void FinalizeTexture(UTexture2D* NewTexture, FTexture2DRHIRef RHITexture2D);
+    void FinalizeTexture(UTexture2D* NewTexture, FRuntimeTextureResource* NewTextureResource, FTexture2DRHIRef RHITexture2D);
+    /** Queues upload of pixels to existing texture of the same size and format */
+    void UpdateTexture(UTexture2D* Texture, const FRuntimeImageData& ImageData, TFunction<void()>&& OnCompleted, const FIntRect& Region = FIntRect(0, 0, 0, 0));
+    static bool CanUpdateTexture(const UTexture2D* Texture, const FRuntimeImageData& ImageData);
+    /** Queues upload of pixels to render target of the same size and pixel format */
+    void UpdateRenderTarget(UTextureRenderTarget2D* RenderTarget, const FRuntimeImageData& ImageData, TFunction<void()>&& OnCompleted, const FIntRect& Region = FIntRect(0, 0, 0, 0));
+    static bool CanUpdateRenderTarget(const UTextureRenderTarget2D* RenderTarget, const FRuntimeImageData& ImageData);
+
+    void EnqueueUpload(FTextureUpload&& Upload);
+    /** Render thread is woken only if no batch is scheduled already */
+    void ScheduleUploadBatch();
+    /** Processes queued uploads in order till the byte budget of the frame runs out */
+    void ProcessUploads();
+    /** Returns false if upload ran out of budget and has to be continued */
+    bool ProcessUpload(FTextureUpload& Upload, int64& InOutBytesLeft);
 
 private:
-    TQueue<FImageReadRequest, EQueueMode::Mpsc> Requests;
+    TRuntimeImageStageQueue<FRuntimeImageReadTaskPtr> StageQueues[(int32)EImageReadStage::Num];
+    FThreadSafeCounter NextRequestId;
+    FThreadSafeCounter NumPendingRequests;
 
     UPROPERTY()
-    TArray<FImageReadResult> Results;
+    TMap<int32, FImageReadResult> Results;
+    // ids of requests whose results were not handed out yet, in submission order
+    TArray<int32> PendingResults;
+    // decode only requests among them, their results are handed out as soon as they are ready and do not hold back others
+    TSet<int32> UnorderedResults;
+    FCriticalSection ResultsLock;
+    // results of finished requests waiting for game thread to complete them
+    TQueue<FImageReadResult, EQueueMode::Mpsc> CompletedResults;
+
+    // bytes of estimated peak memory of the requests between decode and completion, 0 means no limit
+    int64 DecodeMemoryBudget = 0;
+    int64 ReservedDecodeMemory = 0;
+    // tasks that did not fit the budget, retried when memory is released
+    TArray<FRuntimeImageReadTaskPtr> MemoryWaitingTasks;
+    FCriticalSection DecodeMemoryLock;
+
+    // downloads that finished while decode queue was full, in order of completion
+    TArray<FRuntimeImageReadTaskPtr> DownloadedTasks;
+    FThreadSafeCounter NumDownloadedTasks;
+    FCriticalSection DownloadedTasksLock;
 
 private:
     TQueue<FConstructTextureTask, EQueueMode::Mpsc> ConstructTasks;
 
     UPROPERTY()
-    TArray<UTexture2D*> ConstructedTextures;
+    TMap<int32, UTexture2D*> ConstructedTextures;
+    FCriticalSection ConstructedTexturesLock;
 
-    FEvent* TextureConstructedSemaphore = nullptr;
+    // previews of progressive requests, by request id
+    UPROPERTY()
+    TMap<int32, UTexture2D*> PreviewTextures;
+    FCriticalSection PreviewTexturesLock;
+
+    // existing textures and render targets requests upload to, kept alive till they complete, by request id
+    UPROPERTY()
+    TMap<int32, UTexture*> TargetTextures;
+    FCriticalSection TargetTexturesLock;
+
+    // textures given back with ReleaseTexture, not created if pool is disabled
+    UPROPERTY()
+    URuntimeTexturePool* TexturePool = nullptr;
+
+    int32 ProgressiveChunkSize = 0;
+    FThreadSafeCounter NumActivePreviewTasks;
 
 private:
-    FRunnableThread* Thread = nullptr;
-    FEvent* ThreadSemaphore = nullptr;
+    TQueue<FTextureUpload, EQueueMode::Mpsc> PendingUploads;
+    FThreadSafeBool bUploadBatchScheduled = false;
+    // queued uploads whose callbacks were not called yet
+    FThreadSafeCounter NumActiveUploads;
+    // blocking waits and shutdown upload without the budget
+    FThreadSafeCounter NumUploadFlushes;
+
+    // bytes uploaded on render thread per frame, 0 means no limit
+    int64 UploadBudget = 0;
+
+    // render thread only
+    FTextureUpload ActiveUpload;
+    int64 UploadBytesLeft = 0;
+    uint32 UploadBudgetFrame = 0;
+
+private:
+    TArray<FRuntimeImageReaderWorker*> Workers;
+
+    bool bUseTaskGraph = false;
+    int32 NumWorkers = 1;
+    FThreadSafeCounter NumActiveTasks;
+    FThreadSafeCounter NumExpeditedTasks;
+
+    // shared by all http requests so downloads run in parallel
+    TSharedPtr<IImageReader, ESPMode::ThreadSafe> HttpReader;
+
+    // requests that were added and not completed yet, by request id
+    TMap<int32, FRuntimeImageReadTaskPtr> ActiveTasks;
+    FCriticalSection ActiveTasksLock;
+
+    TArray<TSharedPtr<IImageReader, ESPMode::ThreadSafe>> ActiveImageReaders;
+    FCriticalSection ActiveImageReadersLock;
 
-    TSharedPtr<IImageReader, ESPMode::ThreadSafe> ImageReader;
+    TSharedPtr<FRuntimeImageDiskCache, ESPMode::ThreadSafe> DiskCache;
+    bool bDiskCacheLocalFiles = false;
 
-    FThreadSafeBool bCompletedWork = true; 
     FThreadSafeBool bStopThread = false;
 };
@@ -0,0 +1,69 @@
+// Copyright 2022 Peter Leontev. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/Queue.h"
+#include "HAL/CriticalSection.h"
+#include "HAL/ThreadSafeCounter.h"
+#include "Misc/ScopeLock.h"
+
+/**
+ * Queue between two stages of image reader pipeline. Any thread can enqueue and dequeue.
+ * Max depth is a soft limit: producers are expected to check IsFull() before they start producing an item.
+ */
+template<typename ItemType>
+class TRuntimeImageStageQueue
+{
+public:
+    void SetMaxDepth(int32 InMaxDepth)
+    {
+        MaxDepth = FMath::Max(1, InMaxDepth);
+    }
+
+    int32 GetMaxDepth() const
+    {
+        return MaxDepth;
+    }
+
+    int32 Num() const
+    {
+        return Depth.GetValue();
+    }
+
+    bool IsEmpty() const
+    {
+        return Num() == 0;
+    }
+
+    bool IsFull() const
+    {
+        return Num() >= MaxDepth;
+    }
+
+    void Enqueue(const ItemType& Item)
+    {
+        Queue.Enqueue(Item);
+        Depth.Increment();
+    }
+
+    bool Dequeue(ItemType& OutItem)
+    {
+        // TQueue supports only a single consumer
+        FScopeLock ScopeLock(&DequeueLock);
+
+        if (Queue.Dequeue(OutItem))
+        {
+            Depth.Decrement();
+            return true;
+        }
+
+        return false;
+    }
+
+private:
+    TQueue<ItemType, EQueueMode::Mpsc> Queue;
+    FCriticalSection DequeueLock;
+    FThreadSafeCounter Depth;
+    int32 MaxDepth = MAX_int32;
+};
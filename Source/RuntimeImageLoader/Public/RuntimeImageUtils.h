@@ -11,7 +11,17 @@ class UTexture2D;
 
 namespace FRuntimeImageUtils
 {
-    bool ImportBufferAsImage(const uint8* Buffer, int32 Length, FRuntimeImageData& OutImage, FString& OutError);
+    /** Detects image format from its signature (magic bytes). TGA has no signature so it's detected by its header */
+    ERuntimeImageFormat DetectImageFormat(const uint8* Buffer, int32 Length);
+
+    /**
+     * Peak memory of decoding and transforming the image: decoded pixels and one converted copy of them.
+     * Dimensions are read from the header, images whose header is not parsed are assumed to be compressed 4:1
+     */
+    int64 EstimateDecodedSize(const uint8* Buffer, int32 Length, ERuntimeImageFormat FormatHint = ERuntimeImageFormat::Auto);
+
+    /** Decoders of PNG, JPEG and QOI use hints to crop and shrink the image while decoding, others decode the whole image */
+    bool ImportBufferAsImage(const uint8* Buffer, int32 Length, FRuntimeImageData& OutImage, FString& OutError, ERuntimeImageFormat FormatHint = ERuntimeImageFormat::Auto, const FRuntimeImageDecodeHints& DecodeHints = FRuntimeImageDecodeHints());
 
     UTexture2D* CreateTexture(const FString& ImageFilename, const FRuntimeImageData& ImageData);
 }
\ No newline at end of file
@@ -0,0 +1,46 @@
+// Copyright 2022 Peter Leontev. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/Object.h"
+
+#include "RuntimeImageData.h"
+#include "RuntimeTexturePool.generated.h"
+
+
+class UTexture2D;
+
+/**
+ * Textures given back by their users. Images of the same size and format are uploaded to them in place,
+ * so neither texture objects nor their RHI textures are created again. Least recently released textures are dropped first.
+ * Game thread only.
+ */
+UCLASS()
+class RUNTIMEIMAGELOADER_API URuntimeTexturePool : public UObject
+{
+    GENERATED_BODY()
+
+public:
+    void Initialize(int32 InMaxTextures);
+
+    /** Texture must not be used by anyone afterwards, its pixels are overwritten by the next image that fits it */
+    void Add(UTexture2D* Texture);
+
+    /** Removes texture the image can be uploaded to from the pool, returns nullptr if there is none */
+    UTexture2D* Acquire(const FRuntimeImageData& ImageData);
+
+    void Empty();
+
+    int32 Num() const { return Textures.Num(); }
+
+private:
+    static bool CanReuseTexture(const UTexture2D* Texture, const FRuntimeImageData& ImageData);
+
+private:
+    // least recently released first
+    UPROPERTY()
+    TArray<UTexture2D*> Textures;
+
+    int32 MaxTextures = 0;
+};
@@ -31,6 +31,7 @@ public class RuntimeImageLoader : ModuleRules
 			new string[]
 			{
 				"Core",
+				"DeveloperSettings",
 				// ... add other public dependencies that you statically link with here ...
 			}
 			);
@@ -48,12 +49,17 @@ public class RuntimeImageLoader : ModuleRules
 				"RenderCore",
 				"ImageCore",
 				"FreeImage",
-				"HTTP"
+				"HTTP",
+				"Json",
+				"JsonUtilities"
 				// ... add private dependencies that you statically link with here ...	
 			}
 			);
 		
 		
+		// incremental decoding of PNG images while they are downloading
+		AddEngineThirdPartyPrivateStaticDependencies(Target, "zlib", "UElibPNG");
+
 		DynamicallyLoadedModuleNames.AddRange(
 			new string[]
 			{